@@ -0,0 +1,803 @@
+/**
+ * @private
+ * @headerfile bcomp.h <bcomp.h>
+ * @copyright Adequate Systems LLC, 2018-2022. All Rights Reserved.
+ * <br />For license information, please refer to ../LICENSE.md
+*/
+
+/* include guard */
+#ifndef MOCHIMO_BCOMP_C
+#define MOCHIMO_BCOMP_C
+
+
+/* for fopencookie() (glibc), see bc_fopen() */
+#ifndef _GNU_SOURCE
+   #define _GNU_SOURCE
+#endif
+
+#include "bcomp.h"
+
+/* internal support */
+#include "error.h"
+
+/* external support */
+#include <string.h>
+#include <stdlib.h>
+#include "extint.h"
+#include "extio.h"
+
+/* LZ compression parameters */
+#define BCZ_HASHBITS       12
+#define BCZ_MINMATCH       4
+#define BCZ_MFLIMIT        12
+#define BCZ_LASTLITERALS   5
+#define BCZ_MAXOFFSET      0xffff
+
+/**
+ * @private
+ * Compression frame of a compressed block file, see bc_fopen().
+*/
+typedef struct {
+   long long zoff;   /* file offset of frame data */
+   long long roff;   /* offset of frame in uncompressed block data */
+   word32 zlen;      /* compressed length of frame */
+   word32 len;       /* uncompressed length of frame */
+} BCZ_FRAME;
+
+/**
+ * @private
+ * Compressed block file stream, decompressing frames on demand.
+*/
+typedef struct {
+   FILE *fp;            /* compressed block file */
+   BCZ_FRAME *frame;    /* frame index */
+   size_t nframes;      /* number of frames */
+   size_t cached;       /* index of frame in buf, or nframes for none */
+   long long rawlen;    /* length of uncompressed block file */
+   long long trailer;   /* file offset of (uncompressed) trailer */
+   long long pos;       /* stream position, in uncompressed block data */
+   word8 zbuf[BCZ_FRAMEBOUND];   /* compressed frame */
+   word8 buf[BCZ_FRAMELEN];      /* uncompressed frame */
+} BCZ_STREAM;
+
+/**
+ * @private
+ * Read an unaligned 32-bit value from a byte pointer.
+*/
+static inline word32 bc__read32(const word8 *p)
+{
+   word32 v;
+
+   memcpy(&v, p, sizeof(v));
+
+   return v;
+}
+
+/**
+ * @private
+ * Hash a 32-bit sequence into the compression match table.
+*/
+static inline word32 bc__hash(word32 v)
+{
+   return ((word32) (v * 2654435761U)) >> (32 - BCZ_HASHBITS);
+}
+
+/**
+ * @private
+ * Write an extended length (excluding the 15 stored in a token nibble).
+ * @returns Pointer to next output byte, or NULL if out of space
+*/
+static word8 *bc__putlen(word8 *op, const word8 *oend, size_t len)
+{
+   for ( ; len >= 255; len -= 255) {
+      if (op >= oend) return NULL;
+      *(op++) = 255;
+   }
+   if (op >= oend) return NULL;
+   *(op++) = (word8) len;
+
+   return op;
+}
+
+/**
+ * @private
+ * Read an extended length (excluding the 15 stored in a token nibble).
+ * @returns Pointer to next input byte, or NULL on input overrun
+*/
+static const word8 *bc__getlen(const word8 *ip, const word8 *iend,
+   size_t *len)
+{
+   word8 b;
+
+   do {
+      if (ip >= iend) return NULL;
+      b = *(ip++);
+      *len += b;
+   } while (b == 255);
+
+   return ip;
+}
+
+/**
+ * @private
+ * Write a sequence of literals (and optionally a match) to output.
+ * @returns Pointer to next output byte, or NULL if out of space
+*/
+static word8 *bc__putseq(word8 *op, const word8 *oend, const word8 *lit,
+   size_t litlen, size_t offset, size_t mlen)
+{
+   word8 *token;
+
+   if (op >= oend) return NULL;
+   token = op++;
+   /* literal length and literals */
+   if (litlen >= 15) {
+      *token = 15 << 4;
+      op = bc__putlen(op, oend, litlen - 15);
+      if (op == NULL) return NULL;
+   } else *token = (word8) (litlen << 4);
+   if ((size_t) (oend - op) < litlen) return NULL;
+   memcpy(op, lit, litlen);
+   op += litlen;
+   /* final sequence contains literals only */
+   if (offset == 0) return op;
+   /* match offset and length */
+   if ((size_t) (oend - op) < 2) return NULL;
+   *(op++) = (word8) offset;
+   *(op++) = (word8) (offset >> 8);
+   mlen -= BCZ_MINMATCH;
+   if (mlen >= 15) {
+      *token |= 15;
+      op = bc__putlen(op, oend, mlen - 15);
+   } else *token |= (word8) mlen;
+
+   return op;
+}
+
+/**
+ * Compress a buffer of data using an LZ77 style sequence format.
+ * Suited to block data, where addresses, tags and zeroed reference
+ * fields are frequently repeated within a small window.
+ * @param in Pointer to data to compress
+ * @param inlen Length of data to compress, in bytes
+ * @param out Pointer to buffer to place compressed data
+ * @param outlen Length of @a out buffer, in bytes
+ * @returns Length of compressed data, or 0 if @a out is too small
+*/
+size_t bc_zpack(const void *in, size_t inlen, void *out, size_t outlen)
+{
+   word32 table[1 << BCZ_HASHBITS];
+   const word8 *ibase, *ip, *iend, *ilimit, *anchor, *ref;
+   word8 *op, *oend;
+   size_t mlen;
+   word32 h, v;
+
+   /* init */
+   memset(table, 0, sizeof(table));
+   ibase = ip = anchor = (const word8 *) in;
+   iend = ibase + inlen;
+   op = (word8 *) out;
+   oend = op + outlen;
+
+   if (inlen > BCZ_MFLIMIT) {
+      ilimit = iend - BCZ_MFLIMIT;
+      while (ip < ilimit) {
+         /* lookup (and replace) previous occurrence of sequence */
+         v = bc__read32(ip);
+         h = bc__hash(v);
+         ref = ibase + table[h];
+         table[h] = (word32) (ip - ibase);
+         if (ref >= ip || (ip - ref) > BCZ_MAXOFFSET ||
+               bc__read32(ref) != v) {
+            ip++;
+            continue;
+         }
+         /* extend match -- final bytes are always literals */
+         mlen = BCZ_MINMATCH;
+         while (ip + mlen < iend - BCZ_LASTLITERALS && ref[mlen] == ip[mlen]) {
+            mlen++;
+         }
+         op = bc__putseq(op, oend, anchor, (size_t) (ip - anchor),
+            (size_t) (ip - ref), mlen);
+         if (op == NULL) return 0;
+         ip += mlen;
+         anchor = ip;
+      }
+   }
+
+   /* final literals */
+   op = bc__putseq(op, oend, anchor, (size_t) (iend - anchor), 0, 0);
+   if (op == NULL) return 0;
+
+   return (size_t) (op - (word8 *) out);
+}  /* end bc_zpack() */
+
+/**
+ * Decompress a buffer of data compressed with bc_zpack().
+ * All offsets and lengths are bounds checked against both buffers.
+ * @param in Pointer to data to decompress
+ * @param inlen Length of data to decompress, in bytes
+ * @param out Pointer to buffer to place decompressed data
+ * @param outlen Length of @a out buffer, in bytes
+ * @returns Length of decompressed data, or 0 on malformed input
+*/
+size_t bc_zunpack(const void *in, size_t inlen, void *out, size_t outlen)
+{
+   const word8 *ip, *iend, *ref;
+   word8 *obase, *op, *oend;
+   size_t len;
+   word8 token;
+
+   /* init */
+   ip = (const word8 *) in;
+   iend = ip + inlen;
+   obase = op = (word8 *) out;
+   oend = op + outlen;
+
+   while (ip < iend) {
+      token = *(ip++);
+      /* literal length and literals */
+      len = token >> 4;
+      if (len == 15) {
+         ip = bc__getlen(ip, iend, &len);
+         if (ip == NULL) return 0;
+      }
+      if ((size_t) (iend - ip) < len || (size_t) (oend - op) < len) return 0;
+      memcpy(op, ip, len);
+      ip += len;
+      op += len;
+      /* final sequence contains literals only */
+      if (ip == iend) break;
+      /* match offset */
+      if ((iend - ip) < 2) return 0;
+      len = (size_t) ip[0] | ((size_t) ip[1] << 8);
+      ip += 2;
+      if (len == 0 || len > (size_t) (op - obase)) return 0;
+      ref = op - len;
+      /* match length -- copy bytewise, matches may overlap */
+      len = token & 15;
+      if (len == 15) {
+         ip = bc__getlen(ip, iend, &len);
+         if (ip == NULL) return 0;
+      }
+      len += BCZ_MINMATCH;
+      if ((size_t) (oend - op) < len) return 0;
+      while (len--) *(op++) = *(ref++);
+   }
+
+   return (size_t) (op - obase);
+}  /* end bc_zunpack() */
+
+/**
+ * Check if a file is a compressed block file.
+ * @param fname Filename of block file to check
+ * @returns (int) 1 if file is compressed, else 0
+*/
+int bc_iscompressed(const char *fname)
+{
+   char magic[BCZ_MAGICLEN];
+   FILE *fp;
+   int ecode;
+
+   fp = fopen(fname, "rb");
+   if (fp == NULL) return 0;
+   ecode = fread(magic, BCZ_MAGICLEN, 1, fp) == 1 &&
+      memcmp(magic, BCZ_MAGIC, BCZ_MAGICLEN) == 0;
+   fclose(fp);
+
+   return ecode;
+}  /* end bc_iscompressed() */
+
+/**
+ * Compress a block file, in place. The block trailer is retained
+ * (uncompressed) at the end of file. Files that are already compressed,
+ * or that would not reduce in size, are left untouched.
+ * @param fname Filename of block file to compress
+ * @return (int) value representing operation result
+ * @retval VERROR on error; check errno for details
+ * @retval VEOK on success
+*/
+int bc_compress(const char *fname)
+{
+   BTRAILER bt;
+   FILENAME tmpname;
+   word8 hdr[8], rawlen[8];
+   word8 *inbuf, *outbuf;
+   long long len, remain, zlen;
+   size_t n, zn;
+   FILE *fp, *zfp;
+
+   /* init */
+   inbuf = outbuf = NULL;
+   zfp = NULL;
+   snprintf(tmpname, sizeof(tmpname), "%s.tmp", fname);
+
+   /* nothing to do for compressed files */
+   if (bc_iscompressed(fname)) return VEOK;
+
+   /* open block file and determine length */
+   fp = fopen(fname, "rb");
+   if (fp == NULL) return VERROR;
+   if (fseek64(fp, 0LL, SEEK_END) != 0) goto ERROR_CLEANUP;
+   len = ftell64(fp);
+   if (len == (-1)) goto ERROR_CLEANUP;
+   if (len < (long long) sizeof(BTRAILER)) {
+      set_errno(EMCM_FILELEN);
+      goto ERROR_CLEANUP;
+   }
+   if (fseek64(fp, 0LL, SEEK_SET) != 0) goto ERROR_CLEANUP;
+
+   /* allocate frame buffers */
+   inbuf = malloc(BCZ_FRAMELEN);
+   outbuf = malloc(BCZ_FRAMEBOUND);
+   if (inbuf == NULL || outbuf == NULL) goto ERROR_CLEANUP;
+
+   /* write compressed file header */
+   zfp = fopen(tmpname, "wb");
+   if (zfp == NULL) goto ERROR_CLEANUP;
+   memset(rawlen, 0, sizeof(rawlen));
+   put64(rawlen, &len);
+   if (fwrite(BCZ_MAGIC, BCZ_MAGICLEN, 1, zfp) != 1) goto ERROR_CLEANUP;
+   if (fwrite(rawlen, sizeof(rawlen), 1, zfp) != 1) goto ERROR_CLEANUP;
+
+   /* compress block data (excl. trailer) in frames */
+   for (remain = len - sizeof(BTRAILER); remain > 0; remain -= n) {
+      n = remain < BCZ_FRAMELEN ? (size_t) remain : BCZ_FRAMELEN;
+      if (fread(inbuf, n, 1, fp) != 1) goto RDERR_CLEANUP;
+      zn = bc_zpack(inbuf, n, outbuf, BCZ_FRAMEBOUND);
+      put32(hdr + 4, (word32) n);
+      if (zn == 0 || zn >= n) {
+         /* store frame */
+         put32(hdr, (word32) n);
+         if (fwrite(hdr, sizeof(hdr), 1, zfp) != 1) goto ERROR_CLEANUP;
+         if (fwrite(inbuf, n, 1, zfp) != 1) goto ERROR_CLEANUP;
+      } else {
+         put32(hdr, (word32) zn);
+         if (fwrite(hdr, sizeof(hdr), 1, zfp) != 1) goto ERROR_CLEANUP;
+         if (fwrite(outbuf, zn, 1, zfp) != 1) goto ERROR_CLEANUP;
+      }
+   }
+   /* write end frame and (uncompressed) trailer */
+   memset(hdr, 0, sizeof(hdr));
+   if (fwrite(hdr, sizeof(hdr), 1, zfp) != 1) goto ERROR_CLEANUP;
+   if (fread(&bt, sizeof(BTRAILER), 1, fp) != 1) goto RDERR_CLEANUP;
+   if (fwrite(&bt, sizeof(BTRAILER), 1, zfp) != 1) goto ERROR_CLEANUP;
+   zlen = ftell64(zfp);
+   if (zlen == (-1)) goto ERROR_CLEANUP;
+
+   /* cleanup */
+   free(outbuf);
+   free(inbuf);
+   fclose(zfp);
+   fclose(fp);
+
+   /* keep the smaller of the two files */
+   if (zlen >= len) {
+      remove(tmpname);
+      return VEOK;
+   }
+   if (rename(tmpname, fname) != 0) {
+      remove(tmpname);
+      return VERROR;
+   }
+
+   return VEOK;
+
+   /* cleanup / error handling */
+RDERR_CLEANUP:
+   if (!ferror(fp)) {
+      set_errno(EMCM_EOF);
+   }
+ERROR_CLEANUP:
+   if (outbuf) free(outbuf);
+   if (inbuf) free(inbuf);
+   if (zfp) {
+      fclose(zfp);
+      remove(tmpname);
+   }
+   fclose(fp);
+
+   return VERROR;
+}  /* end bc_compress() */
+
+/**
+ * Decompress a compressed block file stream into an output stream.
+ * Frames are decompressed and written as they are read, such that
+ * memory requirements are limited to a single frame.
+ * @param in File pointer to compressed block data (at magic)
+ * @param out File pointer to write uncompressed block data
+ * @return (int) value representing operation result
+ * @retval VERROR on error; check errno for details
+ * @retval VEOK on success
+*/
+int bc_decompress_fp(FILE *in, FILE *out)
+{
+   BTRAILER bt;
+   char magic[BCZ_MAGICLEN];
+   word8 hdr[8], rawlen[8];
+   word8 *inbuf, *outbuf;
+   long long len, total;
+   word32 zn, n;
+
+   /* init */
+   inbuf = outbuf = NULL;
+   total = len = 0;
+
+   /* read compressed file header */
+   if (fread(magic, BCZ_MAGICLEN, 1, in) != 1) goto RDERR_CLEANUP;
+   if (fread(rawlen, sizeof(rawlen), 1, in) != 1) goto RDERR_CLEANUP;
+   if (memcmp(magic, BCZ_MAGIC, BCZ_MAGICLEN) != 0) {
+      set_errno(EMCM_ZDATA);
+      goto ERROR_CLEANUP;
+   }
+   put64(&len, rawlen);
+
+   /* allocate frame buffers */
+   inbuf = malloc(BCZ_FRAMEBOUND);
+   outbuf = malloc(BCZ_FRAMELEN);
+   if (inbuf == NULL || outbuf == NULL) goto ERROR_CLEANUP;
+
+   /* decompress frames until end frame */
+   for ( ;; total += n) {
+      if (fread(hdr, sizeof(hdr), 1, in) != 1) goto RDERR_CLEANUP;
+      zn = get32(hdr);
+      n = get32(hdr + 4);
+      if (zn == 0 && n == 0) break;
+      if (zn == 0 || zn > BCZ_FRAMEBOUND || n == 0 || n > BCZ_FRAMELEN) {
+         set_errno(EMCM_ZDATA);
+         goto ERROR_CLEANUP;
+      }
+      if (fread(inbuf, zn, 1, in) != 1) goto RDERR_CLEANUP;
+      if (zn == n) {
+         /* stored frame */
+         if (fwrite(inbuf, n, 1, out) != 1) goto ERROR_CLEANUP;
+         continue;
+      }
+      if (bc_zunpack(inbuf, zn, outbuf, BCZ_FRAMELEN) != n) {
+         set_errno(EMCM_ZDATA);
+         goto ERROR_CLEANUP;
+      }
+      if (fwrite(outbuf, n, 1, out) != 1) goto ERROR_CLEANUP;
+   }
+   /* copy (uncompressed) trailer */
+   if (fread(&bt, sizeof(BTRAILER), 1, in) != 1) goto RDERR_CLEANUP;
+   if (fwrite(&bt, sizeof(BTRAILER), 1, out) != 1) goto ERROR_CLEANUP;
+   total += sizeof(BTRAILER);
+   /* check decompressed length */
+   if (total != len) {
+      set_errno(EMCM_FILELEN);
+      goto ERROR_CLEANUP;
+   }
+
+   /* cleanup */
+   free(outbuf);
+   free(inbuf);
+
+   return VEOK;
+
+   /* cleanup / error handling */
+RDERR_CLEANUP:
+   if (!ferror(in)) {
+      set_errno(EMCM_EOF);
+   }
+ERROR_CLEANUP:
+   if (outbuf) free(outbuf);
+   if (inbuf) free(inbuf);
+
+   return VERROR;
+}  /* end bc_decompress_fp() */
+
+/**
+ * Decompress a compressed block file, in place.
+ * Files that are not compressed are left untouched.
+ * @param fname Filename of block file to decompress
+ * @return (int) value representing operation result
+ * @retval VERROR on error; check errno for details
+ * @retval VEOK on success
+*/
+int bc_decompress(const char *fname)
+{
+   FILENAME tmpname;
+   FILE *fp, *rawfp;
+   int ecode;
+
+   /* nothing to do for uncompressed files */
+   if (!bc_iscompressed(fname)) return VEOK;
+
+   snprintf(tmpname, sizeof(tmpname), "%s.tmp", fname);
+   fp = fopen(fname, "rb");
+   if (fp == NULL) return VERROR;
+   rawfp = fopen(tmpname, "wb");
+   if (rawfp == NULL) {
+      fclose(fp);
+      return VERROR;
+   }
+
+   ecode = bc_decompress_fp(fp, rawfp);
+   fclose(rawfp);
+   fclose(fp);
+
+   if (ecode == VEOK && rename(tmpname, fname) != 0) ecode = VERROR;
+   if (ecode != VEOK) remove(tmpname);
+
+   return ecode;
+}  /* end bc_decompress() */
+
+#ifdef __GLIBC__
+
+/**
+ * @private
+ * Free a compressed block file stream, closing the compressed file.
+*/
+static void bc__sfree(BCZ_STREAM *sp)
+{
+   if (sp->fp) fclose(sp->fp);
+   if (sp->frame) free(sp->frame);
+   free(sp);
+}  /* end bc__sfree() */
+
+/**
+ * @private
+ * Build the frame index of a compressed block stream, by reading frame
+ * headers (only), and check frame lengths against the stored length.
+ * @returns VEOK on success, else VERROR; check errno for details
+*/
+static int bc__sindex(BCZ_STREAM *sp)
+{
+   BCZ_FRAME *frame;
+   word8 hdr[8], rawlen[8];
+   long long roff, zoff;
+   size_t cap;
+   word32 zn, n;
+
+   /* read compressed file header (after magic) */
+   if (fseek64(sp->fp, (long long) BCZ_MAGICLEN, SEEK_SET) != 0) {
+      return VERROR;
+   }
+   if (fread(rawlen, sizeof(rawlen), 1, sp->fp) != 1) goto RDERR;
+   put64(&sp->rawlen, rawlen);
+   if (sp->rawlen < (long long) sizeof(BTRAILER)) goto BADDATA;
+
+   /* index frames until end frame */
+   zoff = BCZ_MAGICLEN + sizeof(rawlen);
+   for (roff = cap = 0; ; roff += n) {
+      if (fread(hdr, sizeof(hdr), 1, sp->fp) != 1) goto RDERR;
+      zoff += sizeof(hdr);
+      zn = get32(hdr);
+      n = get32(hdr + 4);
+      if (zn == 0 && n == 0) break;
+      if (zn == 0 || zn > BCZ_FRAMEBOUND || n == 0 || n > BCZ_FRAMELEN) {
+         goto BADDATA;
+      }
+      if (sp->nframes == cap) {
+         cap = cap ? cap * 2 : 64;
+         frame = realloc(sp->frame, sizeof(BCZ_FRAME) * cap);
+         if (frame == NULL) return VERROR;
+         sp->frame = frame;
+      }
+      frame = &sp->frame[sp->nframes++];
+      frame->zoff = zoff;
+      frame->roff = roff;
+      frame->zlen = zn;
+      frame->len = n;
+      zoff += zn;
+      if (fseek64(sp->fp, zoff, SEEK_SET) != 0) return VERROR;
+   }
+   /* check decompressed length */
+   if (roff + (long long) sizeof(BTRAILER) != sp->rawlen) {
+      set_errno(EMCM_FILELEN);
+      return VERROR;
+   }
+   sp->trailer = zoff;
+   sp->cached = sp->nframes;
+
+   return VEOK;
+
+RDERR:
+   if (!ferror(sp->fp)) set_errno(EMCM_EOF);
+   return VERROR;
+BADDATA:
+   set_errno(EMCM_ZDATA);
+   return VERROR;
+}  /* end bc__sindex() */
+
+/**
+ * @private
+ * Get the frame of a compressed block stream holding a position, in
+ * uncompressed block data, decompressing the frame as required.
+ * @returns Pointer to frame, or NULL on error; check errno for details
+*/
+static BCZ_FRAME *bc__sframe(BCZ_STREAM *sp, long long pos)
+{
+   BCZ_FRAME *frame;
+   size_t lo, hi, mid;
+
+   /* (most) reads are sequential; check cached and following frame */
+   lo = sp->cached < sp->nframes ? sp->cached : 0;
+   if (pos >= sp->frame[lo].roff + sp->frame[lo].len) {
+      if (lo + 1 < sp->nframes && pos < sp->frame[lo + 1].roff +
+            sp->frame[lo + 1].len) lo++;
+      else lo = sp->nframes;
+   } else if (pos < sp->frame[lo].roff) lo = sp->nframes;
+   /* ... else, binary search frame index */
+   if (lo == sp->nframes) {
+      for (lo = 0, hi = sp->nframes - 1; lo < hi; ) {
+         mid = lo + ((hi - lo + 1) / 2);
+         if (sp->frame[mid].roff <= pos) lo = mid;
+         else hi = mid - 1;
+      }
+   }
+   frame = &sp->frame[lo];
+   if (lo == sp->cached) return frame;
+
+   /* decompress frame into buffer */
+   sp->cached = sp->nframes;
+   if (fseek64(sp->fp, frame->zoff, SEEK_SET) != 0) return NULL;
+   if (frame->zlen == frame->len) {
+      /* stored frame */
+      if (fread(sp->buf, frame->len, 1, sp->fp) != 1) goto RDERR;
+   } else {
+      if (fread(sp->zbuf, frame->zlen, 1, sp->fp) != 1) goto RDERR;
+      if (bc_zunpack(sp->zbuf, frame->zlen, sp->buf, BCZ_FRAMELEN) !=
+            frame->len) {
+         set_errno(EMCM_ZDATA);
+         return NULL;
+      }
+   }
+   sp->cached = lo;
+
+   return frame;
+
+RDERR:
+   if (!ferror(sp->fp)) set_errno(EMCM_EOF);
+   return NULL;
+}  /* end bc__sframe() */
+
+/**
+ * @private
+ * Read function of a compressed block stream (cookie_read_function_t).
+*/
+static ssize_t bc__sread(void *cookie, char *buf, size_t size)
+{
+   BCZ_STREAM *sp = (BCZ_STREAM *) cookie;
+   BCZ_FRAME *frame;
+   long long tpos, avail;
+   size_t n, len;
+
+   for (n = 0; n < size && sp->pos < sp->rawlen; n += len) {
+      avail = sp->rawlen - sp->pos;
+      tpos = sp->rawlen - (long long) sizeof(BTRAILER);
+      if (sp->pos >= tpos) {
+         /* (uncompressed) trailer */
+         len = (size_t) avail < size - n ? (size_t) avail : size - n;
+         if (fseek64(sp->fp, sp->trailer + (sp->pos - tpos), SEEK_SET) != 0 ||
+               fread(buf + n, len, 1, sp->fp) != 1) {
+            if (!ferror(sp->fp)) set_errno(EMCM_EOF);
+            return -1;
+         }
+      } else {
+         frame = bc__sframe(sp, sp->pos);
+         if (frame == NULL) return -1;
+         avail = frame->roff + frame->len - sp->pos;
+         len = (size_t) avail < size - n ? (size_t) avail : size - n;
+         memcpy(buf + n, sp->buf + (sp->pos - frame->roff), len);
+      }
+      sp->pos += (long long) len;
+   }
+
+   return (ssize_t) n;
+}  /* end bc__sread() */
+
+/**
+ * @private
+ * Seek function of a compressed block stream (cookie_seek_function_t).
+*/
+static int bc__sseek(void *cookie, off64_t *offset, int whence)
+{
+   BCZ_STREAM *sp = (BCZ_STREAM *) cookie;
+   long long pos;
+
+   switch (whence) {
+      case SEEK_SET: pos = *offset; break;
+      case SEEK_CUR: pos = sp->pos + *offset; break;
+      case SEEK_END: pos = sp->rawlen + *offset; break;
+      default: pos = -1;
+   }
+   if (pos < 0) {
+      set_errno(EINVAL);
+      return -1;
+   }
+   sp->pos = pos;
+   *offset = pos;
+
+   return 0;
+}  /* end bc__sseek() */
+
+/**
+ * @private
+ * Close function of a compressed block stream (cookie_close_function_t).
+*/
+static int bc__sclose(void *cookie)
+{
+   bc__sfree((BCZ_STREAM *) cookie);
+
+   return 0;
+}  /* end bc__sclose() */
+
+#endif
+
+/**
+ * Open a block file for reading, transparently decompressing compressed
+ * block files. The returned stream is positioned at the start of
+ * (uncompressed) block data and supports all the usual seek operations
+ * of a raw block file. Where available (glibc), frames of a compressed
+ * block file are decompressed on demand, as the stream is read, with
+ * memory limited to a single frame; elsewhere, a compressed block file
+ * is decompressed into an anonymous temporary file.
+ * @param fname Filename of block file to open
+ * @returns FILE pointer to uncompressed block data, or NULL on error;
+ * check errno for details
+*/
+FILE *bc_fopen(const char *fname)
+{
+   char magic[BCZ_MAGICLEN];
+   FILE *fp, *rawfp;
+
+   fp = fopen(fname, "rb");
+   if (fp == NULL) return NULL;
+
+   /* check for compressed block file */
+   if (fread(magic, BCZ_MAGICLEN, 1, fp) != 1 ||
+         memcmp(magic, BCZ_MAGIC, BCZ_MAGICLEN) != 0) {
+      /* ... uncompressed block file, rewind for caller */
+      if (fseek64(fp, 0LL, SEEK_SET) != 0) {
+         fclose(fp);
+         return NULL;
+      }
+      return fp;
+   }
+
+#ifdef __GLIBC__
+   cookie_io_functions_t io = {
+      .read = bc__sread, .write = NULL, .seek = bc__sseek,
+      .close = bc__sclose
+   };
+   BCZ_STREAM *sp;
+
+   /* decompress frames on demand, behind stream */
+   sp = calloc(1, sizeof(BCZ_STREAM));
+   if (sp == NULL) {
+      fclose(fp);
+      return NULL;
+   }
+   sp->fp = fp;
+   if (bc__sindex(sp) != VEOK) {
+      bc__sfree(sp);
+      return NULL;
+   }
+   rawfp = fopencookie(sp, "rb", io);
+   if (rawfp == NULL) bc__sfree(sp);
+
+#else
+   /* decompress into anonymous temporary file */
+   rawfp = tmpfile();
+   if (rawfp == NULL) {
+      fclose(fp);
+      return NULL;
+   }
+   rewind(fp);
+   if (bc_decompress_fp(fp, rawfp) != VEOK) {
+      fclose(rawfp);
+      fclose(fp);
+      return NULL;
+   }
+   fclose(fp);
+   rewind(rawfp);
+
+#endif
+
+   return rawfp;
+}  /* end bc_fopen() */
+
+/* end include guard */
+#endif
@@ -0,0 +1,60 @@
+/**
+ * @file bcomp.h
+ * @brief Mochimo block archive compression support.
+ * @details Blocks stored in the archive (Bcdir) may be compressed into a
+ * framed LZ format. The block trailer of a compressed block is always
+ * stored uncompressed at the end of file, such that read_trailer() and
+ * other trailer based operations remain unaffected by compression.
+ * ```
+ *    [magic 4][rawlen 8]
+ *    [zlen 4][len 4][data zlen] ... [0 4][0 4]
+ *    [BTRAILER 160]
+ * ```
+ * A frame with equal `zlen` and `len` values contains stored data.
+ * @copyright Adequate Systems LLC, 2018-2022. All Rights Reserved.
+ * <br />For license information, please refer to ../LICENSE.md
+*/
+
+/* include guard */
+#ifndef MOCHIMO_BCOMP_H
+#define MOCHIMO_BCOMP_H
+
+
+/* internal support */
+#include "types.h"
+
+/* external support */
+#include <stdio.h>
+
+/**
+ * Compressed block file identifier. When read as a block header length,
+ * the magic value can never represent a valid header length.
+*/
+#define BCZ_MAGIC       "MCZ\x01"
+#define BCZ_MAGICLEN    4
+
+/** Maximum uncompressed length of a single compression frame. */
+#define BCZ_FRAMELEN    ( 1 << 16 )
+
+/** Maximum compressed length of a single compression frame. */
+#define BCZ_FRAMEBOUND  ( BCZ_FRAMELEN + (BCZ_FRAMELEN / 255) + 16 )
+
+/* C/C++ compatible function prototypes */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+size_t bc_zpack(const void *in, size_t inlen, void *out, size_t outlen);
+size_t bc_zunpack(const void *in, size_t inlen, void *out, size_t outlen);
+int bc_iscompressed(const char *fname);
+int bc_compress(const char *fname);
+int bc_decompress_fp(FILE *in, FILE *out);
+int bc_decompress(const char *fname);
+FILE *bc_fopen(const char *fname);
+
+#ifdef __cplusplus
+}  /* end extern "C" */
+#endif
+
+/* end include guard */
+#endif
@@ -27,6 +27,8 @@
 #include "sha256.h"
 #include "extmath.h"
 #include "extlib.h"
+#include "extio.h"
+#include <unistd.h>  /* for getpid() */
 
 /* Pseudoblock mining address tag (hexadecimal encoding) */
 static const word8 Maddr_pseudo[ADDR_TAG_LEN] = {
@@ -151,19 +153,18 @@ ERROR_CLEANUP:
 */
 int neogen(const BTRAILER *prev_bt, const char *lefile, const char *output)
 {
-   LENTRY le;           /* ledger entry */
+   MERKLE_CTX mctx;     /* streaming merkle tree */
+   LENTRY *buf;         /* malloc'd ledger entry buffer */
    BTRAILER bt;         /* block trailer */
    NGHEADER ngh;        /* neogenesis header data */
    FILE *fp, *lfp;
-   word8 *mtree;        /* malloc'd merkle tree */
-   size_t mcount;       /* merkle tree count */
-   size_t j;            /* loop counter */
+   size_t lcount;       /* ledger entry count */
+   size_t j, n;         /* loop counter, buffered count */
    long long llen;      /* ledger length */
 
    /* init */
    fp = lfp = NULL;
-   mtree = NULL;
-   mcount = 0;
+   buf = NULL;
 
    /* init block trailer (zero) and compute bnum */
    memset(&bt, 0, sizeof(BTRAILER));
@@ -204,29 +205,27 @@ int neogen(const BTRAILER *prev_bt, const char *lefile, const char *output)
    /* Begin the Neo-Genesis block by writing the header */
    if (fwrite(&ngh, sizeof(NGHEADER), 1, fp) != 1) goto ERROR_CLEANUP;
 
-   /* get merkle tree count and malloc */
-   mcount = (size_t) llen / sizeof(LENTRY);
-   mtree = malloc(mcount * HASHLEN);
-   if (mtree == NULL) goto ERROR_CLEANUP;
-
-   /** @todo switch to a progressive merkle hash function that
-    * doesn't require the entire list to be in memory at once.
-    */
+   /* get ledger entry count and malloc buffer */
+   lcount = (size_t) llen / sizeof(LENTRY);
+   buf = malloc(LEBUFCOUNT * sizeof(LENTRY));
+   if (buf == NULL) goto ERROR_CLEANUP;
 
    /* Cue ledger.dat to beginning and copy it to neo-gen block
-    * header whilst collecting merkle tree nodes.
+    * header whilst folding entries into the streaming merkle tree.
     */
-   for (rewind(lfp), j = 0; j < mcount; j++) {
-      /* read individual ledger entries for processing */
-      if (fread(&le, sizeof(LENTRY), 1, lfp) != 1) {
+   merkle_init(&mctx, lcount);
+   for (rewind(lfp), j = 0; j < lcount; j += n) {
+      /* read buffered ledger entries for processing */
+      n = (lcount - j) < LEBUFCOUNT ? (lcount - j) : LEBUFCOUNT;
+      if (fread(buf, sizeof(LENTRY), n, lfp) != n) {
          /* check file error, else unexpected EOF */
          if (ferror(lfp)) goto ERROR_CLEANUP;
          set_errno(EMCM_EOF);
          goto ERROR_CLEANUP;
       }
-      /* write to neogenesis file and update merkle list */
-      if (fwrite(&le, sizeof(LENTRY), 1, fp) != 1) goto ERROR_CLEANUP;
-      sha256(&le, sizeof(LENTRY), mtree + (j * HASHLEN));
+      /* write to neogenesis file and update merkle tree */
+      if (fwrite(buf, sizeof(LENTRY), n, fp) != n) goto ERROR_CLEANUP;
+      merkle_leaves(&mctx, buf, sizeof(LENTRY), n);
    }
 
    /* fill block trailer with remaining data */
@@ -236,7 +235,7 @@ int neogen(const BTRAILER *prev_bt, const char *lefile, const char *output)
    /* ... bt.tcount left zero'd (no transactions) */
    put32(bt.time0, get32(prev_bt->time0));
    put32(bt.difficulty, get32(prev_bt->difficulty));
-   merkle_root(mtree, mcount, bt.mroot);
+   if (merkle_final(&mctx, bt.mroot) != VEOK) goto ERROR_CLEANUP;
    /* ... bt.nonce left zero'd (not required) */
    put32(bt.stime, get32(prev_bt->stime));
    /* compute neogenesis block hash directly into block trailer */
@@ -250,13 +249,13 @@ int neogen(const BTRAILER *prev_bt, const char *lefile, const char *output)
    /* cleanup */
    fclose(fp);
    fclose(lfp);
-   free(mtree);
+   free(buf);
 
    return VEOK;
 
    /* cleanup / error handling */
 ERROR_CLEANUP:
-   if (mtree) free(mtree);
+   if (buf) free(buf);
    if (lfp) fclose(lfp);
    if (fp) {
       fclose(fp);
@@ -530,5 +529,51 @@ ERROR_CLEANUP:
    return VERROR;
 }  /* end b_con() */
 
+/**
+ * Hand a solved candidate block trailer to the server, as "mblock.dat".
+ * Records the solve time and block hash of the trailer, then rewrites the
+ * trailer to an isolated copy of the candidate block, @a fname, which is
+ * left unchanged.
+ * @param bt Pointer to solved block trailer (stime and bhash are set)
+ * @param fname Filename of candidate block solved
+ * @return (int) value representing operation result
+ * @retval VERROR on error, or where a mined block is already pending;
+ * check errno for details
+ * @retval VEOK on success
+*/
+int b_mined(BTRAILER *bt, const char *fname)
+{
+   FILE *fp;
+   char mfname[FILENAME_MAX];
+
+   /* record solve time and hash block trailer */
+   if (get32(bt->time0) == (word32) time(NULL)) {
+      put32(bt->stime, (word32) time(NULL) + 1);
+   } else put32(bt->stime, (word32) time(NULL));
+   sha256(bt, sizeof(BTRAILER) - HASHLEN, bt->bhash);
+   /* rewrite block trailer to isolated copy of candidate block */
+   sprintf(mfname, "mb%u.tmp", (unsigned) getpid());
+   if (fcopy(fname, mfname) != VEOK) goto ERROR_CLEANUP;
+   fp = fopen(mfname, "r+b");
+   if (fp == NULL) goto ERROR_CLEANUP;
+   if (fseek64(fp, -(sizeof(BTRAILER)), SEEK_END) != 0 ||
+         fwrite(bt, sizeof(BTRAILER), 1, fp) != 1) {
+      fclose(fp);
+      goto ERROR_CLEANUP;
+   }
+   if (fclose(fp) != 0) goto ERROR_CLEANUP;
+   /* check for and trigger mined block update */
+   if (fexists("mblock.dat")) goto ERROR_CLEANUP;
+   if (rename(mfname, "mblock.dat") != 0) goto ERROR_CLEANUP;
+   ftouch("cblock.lck");
+
+   return VEOK;
+
+ERROR_CLEANUP:
+   remove(mfname);
+
+   return VERROR;
+}  /* end b_mined() */
+
 /* end include guard */
 #endif
@@ -23,6 +23,7 @@ int pseudo(const char *output);
 int neogen(const BTRAILER *bt, const char *lefile, const char *output);
 int b_adjust_maddr_fp(FILE *fp);
 int b_con(const char *output);
+int b_mined(BTRAILER *bt, const char *fname);
 
 #ifdef __cplusplus
 }  /* end extern "C" */
@@ -0,0 +1,218 @@
+/**
+ * @file bcomp-chain.c
+ * @brief Block archive compression benchmark, over a chain segment.
+ * @details Compresses copies of every (non-neogenesis) block of a chain
+ * segment, such as that generated by chaingen, and reports the ratio of
+ * compression, the rate of compression, and the rate of reading block
+ * data through bc_fopen() (as per send_file()), against reading raw
+ * block files and against decompressing into a temporary file first.
+ * Results are printed as a single JSON object, tagged with the build
+ * VERSION, for comparison between commits.
+ * <br />Usage: bcomp-chain [block directory] [seconds per rate]
+ * @copyright Adequate Systems LLC, 2018-2022. All Rights Reserved.
+ * <br />For license information, please refer to ../LICENSE.md
+*/
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bcomp.h"
+
+#ifndef VERSION
+   #define VERSION   "unknown"
+#endif
+
+#define BCDIR     "bc"  /* default block directory, as per chaingen */
+#define SECONDS   2.0   /* default seconds per rate */
+#define READLEN   8192  /* read length, as per send_file() packets */
+#define MAXBLOCKS 4096  /* maximum blocks of chain segment */
+
+/* read buffer and result sink, defeats elimination of reads */
+static char Rbuf[READLEN];
+static volatile word32 Sink;
+
+/* chain segment, as raw and compressed copies */
+static char Raw[MAXBLOCKS][FILENAME_MAX];
+static char Zip[MAXBLOCKS][FILENAME_MAX];
+static int Nblocks;
+
+/* monotonic wall time, in seconds */
+static double bench_wtime(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+/* length of a file, or -1 on error */
+static long long bench_flen(const char *fname)
+{
+   long long len;
+   FILE *fp;
+
+   fp = fopen(fname, "rb");
+   if (fp == NULL) return -1;
+   len = fseek(fp, 0L, SEEK_END) == 0 ? (long long) ftell(fp) : -1;
+   fclose(fp);
+
+   return len;
+}
+
+/* copy a file, returns 0 on success */
+static int bench_copy(const char *src, const char *dst)
+{
+   FILE *in, *out;
+   size_t n;
+   int ecode;
+
+   in = fopen(src, "rb");
+   if (in == NULL) return -1;
+   out = fopen(dst, "wb");
+   if (out == NULL) {
+      fclose(in);
+      return -1;
+   }
+   ecode = 0;
+   while ((n = fread(Rbuf, 1, sizeof(Rbuf), in)) > 0) {
+      if (fwrite(Rbuf, n, 1, out) != 1) ecode = -1;
+   }
+   if (ferror(in)) ecode = -1;
+   fclose(out);
+   fclose(in);
+
+   return ecode;
+}
+
+/* read a stream to EOF in READLEN reads, returns bytes read */
+static long long bench_drain(FILE *fp)
+{
+   long long total;
+   size_t n;
+
+   for (total = 0; (n = fread(Rbuf, 1, sizeof(Rbuf), fp)) > 0; total += n) {
+      Sink += (word8) Rbuf[0];
+   }
+
+   return total;
+}
+
+/* read all blocks, by mode, for (at least) seconds, returns MB/s */
+static double bench_read(int mode, double seconds)
+{
+   double start, delta;
+   long long total;
+   FILE *fp, *tmp;
+   int j;
+
+   start = bench_wtime();
+   total = 0;
+   do {
+      for (j = 0; j < Nblocks; j++) {
+         switch (mode) {
+            case 0:  /* raw block file */
+               fp = fopen(Raw[j], "rb");
+               break;
+            case 1:  /* compressed block file, via stream */
+               fp = bc_fopen(Zip[j]);
+               break;
+            default:  /* compressed block file, via temporary file */
+               tmp = fopen(Zip[j], "rb");
+               fp = tmpfile();
+               if (tmp == NULL || fp == NULL ||
+                     bc_decompress_fp(tmp, fp) != VEOK) {
+                  if (fp) fclose(fp);
+                  fp = NULL;
+               } else rewind(fp);
+               if (tmp) fclose(tmp);
+         }
+         if (fp == NULL) return 0.0;
+         total += bench_drain(fp);
+         fclose(fp);
+      }
+      delta = bench_wtime() - start;
+   } while (delta < seconds);
+
+   return (double) total / delta / 1e6;
+}
+
+int main(int argc, char *argv[])
+{
+   struct dirent *ent;
+   const char *bcdir;
+   double seconds, start, pack, raw_mbps, stream_mbps, tmpfile_mbps;
+   long long rawlen, ziplen, len;
+   unsigned long long bnum;
+   DIR *dp;
+   int j;
+
+   bcdir = argc > 1 ? argv[1] : BCDIR;
+   seconds = argc > 2 ? atof(argv[2]) : SECONDS;
+   if (seconds <= 0) seconds = SECONDS;
+
+   /* collect (non-neogenesis) blocks of chain segment */
+   dp = opendir(bcdir);
+   if (dp == NULL) {
+      fprintf(stderr, "cannot open block directory, %s\n", bcdir);
+      return EXIT_FAILURE;
+   }
+   while ((ent = readdir(dp)) != NULL && Nblocks < MAXBLOCKS) {
+      if (sscanf(ent->d_name, "b%llx.bc", &bnum) != 1) continue;
+      if ((bnum & 0xff) == 0) continue;
+      snprintf(Raw[Nblocks], FILENAME_MAX, "%s/%s", bcdir, ent->d_name);
+      snprintf(Zip[Nblocks], FILENAME_MAX, "bcomp-chain-%d.bc", Nblocks);
+      Nblocks++;
+   }
+   closedir(dp);
+   if (Nblocks == 0) {
+      fprintf(stderr, "no (non-neogenesis) blocks in %s\n", bcdir);
+      return EXIT_FAILURE;
+   }
+
+   /* compress copies of blocks */
+   rawlen = ziplen = 0;
+   pack = 0.0;
+   for (j = 0; j < Nblocks; j++) {
+      if (bench_copy(Raw[j], Zip[j]) != 0) {
+         fprintf(stderr, "cannot copy %s\n", Raw[j]);
+         return EXIT_FAILURE;
+      }
+      start = bench_wtime();
+      if (bc_compress(Zip[j]) != VEOK) {
+         fprintf(stderr, "bc_compress(%s) FAILURE\n", Zip[j]);
+         return EXIT_FAILURE;
+      }
+      pack += bench_wtime() - start;
+      len = bench_flen(Raw[j]);
+      rawlen += len;
+      len = bench_flen(Zip[j]);
+      ziplen += len;
+   }
+
+   /* read rates */
+   raw_mbps = bench_read(0, seconds);
+   stream_mbps = bench_read(1, seconds);
+   tmpfile_mbps = bench_read(2, seconds);
+   for (j = 0; j < Nblocks; j++) remove(Zip[j]);
+
+   /* machine-readable results */
+   printf("{\n");
+   printf("  \"bench\": \"bcomp-chain\",\n");
+   printf("  \"version\": \"%s\",\n", VERSION);
+   printf("  \"blocks\": %d,\n", Nblocks);
+   printf("  \"raw_bytes\": %lld,\n", rawlen);
+   printf("  \"compressed_bytes\": %lld,\n", ziplen);
+   printf("  \"ratio\": %.4f,\n", ziplen ? (double) rawlen / ziplen : 0.0);
+   printf("  \"pack_mbps\": %.2f,\n", pack > 0 ? rawlen / pack / 1e6 : 0.0);
+   printf("  \"read_mbps\": {\n");
+   printf("    \"raw\": %.2f,\n", raw_mbps);
+   printf("    \"stream\": %.2f,\n", stream_mbps);
+   printf("    \"tmpfile\": %.2f\n", tmpfile_mbps);
+   printf("  }\n");
+   printf("}\n");
+
+   return EXIT_SUCCESS;
+}
@@ -0,0 +1,220 @@
+/**
+ * @file peach-stages.c
+ * @brief Peach Proof-of-Work benchmark, per stage.
+ * @details Reports per-call cost of each stage of Peach (Nighthash flops,
+ * memory transformations and algorithms, tile generation and jumps), the
+ * solve rate with and without a Peach Map, the verification rate and the
+ * hit rate of the Peach Map. Results are printed as a single JSON object,
+ * tagged with the build VERSION, for comparison between commits.
+ * <br />Usage: peach-stages [seconds per rate]
+ * @copyright Adequate Systems LLC, 2018-2022. All Rights Reserved.
+ * <br />For license information, please refer to ../LICENSE.md
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "peach.c"
+
+#if defined(__x86_64__) || defined(__i386__)
+   #include <x86intrin.h>
+   #define BENCH_UNIT   "cycles"
+#else
+   #define BENCH_UNIT   "ns"
+#endif
+
+#ifndef VERSION
+   #define VERSION   "unknown"
+#endif
+
+#define REPEATS   5     /* repeats per stage, of which best is reported */
+#define ITERS     2000  /* iterations per stage repeat */
+#define SECONDS   2.0   /* default seconds per rate */
+
+/* time a statement per call, over ITERS iterations, best of REPEATS */
+#define BENCH_STAGE(result, stmt) \
+   do { \
+      word64 start_, best_ = ~WORD64_C(0); \
+      int r_, i_; \
+      for (r_ = 0; r_ < REPEATS; r_++) { \
+         start_ = bench_clock(); \
+         for (i_ = 0; i_ < ITERS; i_++) { stmt; } \
+         start_ = bench_clock() - start_; \
+         if (start_ < best_) best_ = start_; \
+      } \
+      (result) = (double) best_ / ITERS; \
+   } while (0)
+
+/* Block 0x1 trailer data taken directly from the Mochimo Blockchain Tfile */
+static word8 Block1[BTSIZE] = {
+   0x00, 0x17, 0x0c, 0x67, 0x11, 0xb9, 0xdc, 0x3c, 0xa7, 0x46,
+   0xc4, 0x6c, 0xc2, 0x81, 0xbc, 0x69, 0xe3, 0x03, 0xdf, 0xad,
+   0x2f, 0x33, 0x3b, 0xa3, 0x97, 0xba, 0x06, 0x1e, 0xcc, 0xef,
+   0xde, 0x03, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+   0xf4, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00,
+   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+   0xf7, 0x2d, 0x1f, 0xae, 0xa8, 0x7f, 0x5b, 0x8f, 0x3c, 0xa9,
+   0xce, 0x6c, 0xdd, 0x5a, 0xe6, 0xf1, 0xb0, 0x81, 0xe5, 0x70,
+   0xc1, 0xf8, 0xe9, 0x63, 0x90, 0xb1, 0x25, 0x38, 0x8e, 0x48,
+   0x46, 0x73, 0x10, 0xf9, 0x01, 0x05, 0xf1, 0x01, 0x26, 0x00,
+   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x56, 0xdf,
+   0x01, 0x11, 0x05, 0x4b, 0xb7, 0x03, 0x01, 0x56, 0x00, 0x00,
+   0x00, 0x00, 0x00, 0x00, 0xb1, 0x0d, 0x31, 0x5b, 0x78, 0x49,
+   0x1f, 0x37, 0xaa, 0xa7, 0x54, 0xef, 0x7d, 0xb8, 0x1a, 0x96,
+   0x42, 0xd4, 0xba, 0x1c, 0xf7, 0x2f, 0x6e, 0x37, 0xff, 0x92,
+   0x99, 0x9a, 0xa0, 0x32, 0x55, 0x51, 0xbc, 0xf1, 0x5f, 0x69
+};
+
+/* result sink, defeats elimination of benchmarked calls */
+static volatile word32 Sink;
+
+/* timestamp counter, else monotonic nanoseconds */
+static inline word64 bench_clock(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+   return (word64) __rdtsc();
+#else
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (word64) ts.tv_sec * 1000000000 + (word64) ts.tv_nsec;
+#endif
+}
+
+/* wall time, in seconds */
+static double bench_wtime(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+/* solve rate (H/s) of a context, over seconds, on unsolvable work */
+static double bench_solve(PEACH_CTX *ctx, BTRAILER *bt, double seconds,
+   word64 *hashes)
+{
+   TRIGG_RNG rng;
+   double start, delta;
+   word64 n;
+   int i;
+
+   trigg_rng_init(&rng, 1, 0);
+   start = bench_wtime();
+   n = 0;
+   do {
+      /* check time every 16 hashes */
+      for (i = 0; i < 16; i++, n++) {
+         Sink += (word32) peach_ctx_solve(ctx, &rng, bt, 255, bt->nonce);
+      }
+      delta = bench_wtime() - start;
+   } while (delta < seconds);
+   if (hashes) *hashes = n;
+
+   return (double) n / delta;
+}
+
+int main(int argc, char *argv[])
+{
+   static word8 tiles[PEACHBATCH][PEACHTILELEN];
+   word8 data[PEACHJUMPLEN], hash[SHA256LEN];
+   word32 index[PEACHBATCH];
+   double algo36[8], algo1060[8];
+   double flops36, flops1060, memtx1060, generate, batch, jump;
+   double hps_map, hps_nomap, vps, start, delta, seconds;
+   word64 hashes, generated, lookups;
+   PEACH_CTX ctx;
+   BTRAILER bt;
+   word32 mario;
+   int i;
+
+   seconds = argc > 1 ? atof(argv[1]) : SECONDS;
+   if (seconds <= 0) seconds = SECONDS;
+   memcpy(&bt, Block1, BTSIZE);
+   for (i = 0; i < PEACHJUMPLEN; i++) data[i] = (word8) (i * 7);
+   for (i = 0; i < PEACHBATCH; i++) index[i] = (word32) i * 16381;
+
+   /* Nighthash stages, as per tile generation (36) and jumps (1060) */
+   BENCH_STAGE(flops36, Sink += peach_dflops(data, PEACHGENLEN, Sink, 0));
+   BENCH_STAGE(flops1060, Sink += peach_dflops(data, PEACHJUMPLEN, Sink, 1));
+   BENCH_STAGE(memtx1060, Sink += peach_dmemtx(data, PEACHJUMPLEN, Sink));
+   for (i = 0; i < 8; i++) {
+      BENCH_STAGE(algo36[i], peach_nightalgo((word32) i, data,
+         PEACHGENLEN, hash); Sink += hash[0]);
+      BENCH_STAGE(algo1060[i], peach_nightalgo((word32) i, data,
+         PEACHJUMPLEN, hash); Sink += hash[0]);
+   }
+   /* tile stages */
+   BENCH_STAGE(generate, peach_generate(Sink & PEACHCACHELEN_M1,
+      bt.phash, tiles[0]); Sink += tiles[0][0]);
+   BENCH_STAGE(batch, peach_generate_batch(index, PEACHBATCH, bt.phash,
+      (word8 *) tiles); Sink += tiles[0][0]);
+   batch /= PEACHBATCH;
+   mario = 0;
+   BENCH_STAGE(jump, peach_jump(&mario, bt.nonce, tiles[0]));
+   Sink += mario;
+
+   /* solve rates, with (private) and without a Peach Map */
+   if (peach_ctx_init(&ctx, PEACH_MAP_PRIVATE) != VEOK) {
+      fprintf(stderr, "peach_ctx_init() FAILURE\n");
+      return EXIT_FAILURE;
+   }
+   peach_ctx_work(&ctx, &bt);
+   hps_map = bench_solve(&ctx, &bt, seconds, &hashes);
+   /* every tile generated into the map was a miss; the rest were hits */
+   for (generated = i = 0; i < PEACHCACHELEN; i++) {
+      generated += ctx.tiles[i] == PEACH_TILE_READY;
+   }
+   lookups = hashes * (PEACHROUNDS + 1);
+   peach_ctx_free(&ctx);
+   peach_ctx_init(&ctx, PEACH_MAP_NONE);
+   peach_ctx_work(&ctx, &bt);
+   hps_nomap = bench_solve(&ctx, &bt, seconds, NULL);
+   peach_ctx_free(&ctx);
+
+   /* verification rate, as per sync */
+   memcpy(&bt, Block1, BTSIZE);
+   start = bench_wtime();
+   hashes = 0;
+   do {
+      Sink += (word32) peach_checkhash(&bt, bt.difficulty[0], NULL);
+      hashes++;
+      delta = bench_wtime() - start;
+   } while (delta < seconds);
+   vps = (double) hashes / delta;
+
+   /* machine-readable results */
+   printf("{\n");
+   printf("  \"bench\": \"peach-stages\",\n");
+   printf("  \"version\": \"%s\",\n", VERSION);
+   printf("  \"unit\": \"%s\",\n", BENCH_UNIT);
+   printf("  \"stages\": {\n");
+   printf("    \"dflops_36\": %.1f,\n", flops36);
+   printf("    \"dflops_tx_1060\": %.1f,\n", flops1060);
+   printf("    \"dmemtx_1060\": %.1f,\n", memtx1060);
+   printf("    \"nightalgo_36\": [");
+   for (i = 0; i < 8; i++) printf("%s%.1f", i ? ", " : "", algo36[i]);
+   printf("],\n    \"nightalgo_1060\": [");
+   for (i = 0; i < 8; i++) printf("%s%.1f", i ? ", " : "", algo1060[i]);
+   printf("],\n");
+   printf("    \"generate\": %.1f,\n", generate);
+   printf("    \"generate_batch\": %.1f,\n", batch);
+   printf("    \"jump\": %.1f\n", jump);
+   printf("  },\n");
+   printf("  \"rates\": {\n");
+   printf("    \"solve_hps_map\": %.2f,\n", hps_map);
+   printf("    \"solve_hps_nomap\": %.2f,\n", hps_nomap);
+   printf("    \"verify_ps\": %.2f\n", vps);
+   printf("  },\n");
+   printf("  \"map\": {\n");
+   printf("    \"lookups\": %llu,\n", (unsigned long long) lookups);
+   printf("    \"misses\": %llu,\n", (unsigned long long) generated);
+   printf("    \"hit_rate\": %.4f\n", lookups
+      ? (double) (lookups - generated) / (double) lookups : 0.0);
+   printf("  }\n");
+   printf("}\n");
+
+   return EXIT_SUCCESS;
+}
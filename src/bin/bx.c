@@ -19,6 +19,7 @@
 
 #include "config.h"
 #include "mochimo.h"
+#include "bcomp.h"
 
 #ifdef UNIXLIKE
 #include <unistd.h>
@@ -224,7 +225,7 @@ int read_block(word32 bnum, BHEADER *bh, BTRAILER *bt, char *filename)
       put32(bnum8, bnum);
       sprintf(fname, "b%s.bc", bnum2hex(bnum8));
    }
-   Bfp = fopen(fname, "rb");
+   Bfp = bc_fopen(fname);  /* decompress archived blocks */
    if(Bfp == NULL) {
       printf("Cannot open %s\n", fname);
       return 1;
@@ -0,0 +1,630 @@
+/**
+ * @private chaingen.c
+ * @brief Mochimo synthetic chain generator.
+ * @details Generates a local chain, within the working directory layout
+ * of a node (bc/, tfile.dat and ledger.dat), for offline testing and
+ * benchmarks at production scale. The genesis block holds a ledger of
+ * WOTS+ funded addresses, derived from a seed as per the transaction bot.
+ * Each following block holds (up to MAXBLTX) signed transactions between
+ * those addresses, solved at difficulty 1, and is validated and applied
+ * by the node's own block update routine, b_update(). Optionally, further
+ * signed transactions (valid against the final ledger) are written to
+ * "txpending.dat", for replay against a node.
+ * <br />NOTE: the genesis ledger is not backed by block rewards, so the
+ * generated chain is for local use only.
+ * @copyright Adequate Systems LLC, 2018-2022. All Rights Reserved.
+ * <br />For license information, please refer to ../LICENSE.md
+*/
+
+#ifndef MOCHIMO_CHAINGEN_C
+#define MOCHIMO_CHAINGEN_C
+
+
+/* internal support */
+#include "types.h"   /* for standard mochimo datatypes */
+#include "wots.h"    /* for WOTS+ signatures */
+#include "tx.h"      /* for transaction support */
+#include "tfile.h"   /* for tfile support */
+#include "trigg.h"   /* for trigg algorithm */
+#include "ledger.h"  /* for ledger support */
+#include "global.h"  /* for node state */
+#include "error.h"   /* for error codes */
+#include "bcon.h"
+#include "bup.h"
+#include "sync.h"
+
+/* external support */
+#include "extint.h"
+#include "extio.h"
+#include "extlib.h"
+#include "extmath.h"
+#include "sha256.h"
+
+/* system support */
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef VERSION
+   #define VERSION "<no-version>"
+
+#endif
+
+/* solve time of generated blocks -- retains difficulty 1 (pre-v2.0) */
+#define BLOCKTIME    300
+/* send amount, per transaction destination */
+#define SENDAMOUNT   1000
+
+/* seed derived master secret */
+static word8 Master[HASHLEN];
+/* funded address slots; current address, key generation and balance */
+static word8 (*Addr)[ADDR_LEN];
+static word32 *Gen;
+static word64 *Balance;
+static word32 Naddr;
+/* transaction template, destination count and (last) transactions */
+static word8 Txtemplate[sizeof(TXHDR) + sizeof(TXDAT) + sizeof(TXDSA)];
+static size_t Txlen;
+static int Ndst;
+static word8 *Txbuf;
+
+/**
+ * @private
+ * Derive the secret of an address slot, for a key generation.
+ * @param secret Pointer to place derived secret
+ * @param slot Address slot
+ * @param gen Key generation of address slot
+ */
+static void get_secret(word8 secret[HASHLEN], word32 slot, word32 gen)
+{
+   word8 idx[8];
+
+   put32(idx, slot);
+   put32(idx + 4, gen);
+   tx_secret(secret, Master, idx);
+}  /* end get_secret() */
+
+/**
+ * @private
+ * Derive the address of an address slot, for a key generation. The tag
+ * of an address slot is that of its first (implicit) address, so key
+ * generations after the first require the first address in Addr[].
+ * @param addr Pointer to place derived address
+ * @param slot Address slot
+ * @param gen Key generation of address slot
+ */
+static void get_address(word8 addr[ADDR_LEN], word32 slot, word32 gen)
+{
+   word8 wots[WOTS_ADDR_LEN];
+   word8 secret[HASHLEN];
+   word8 hashed[ADDR_LEN];
+
+   get_secret(secret, slot, gen);
+   tx_wots(wots, secret);
+   addr_from_wots(wots, hashed);
+   if (gen > 0) {
+      memcpy(ADDR_TAG_PTR(hashed), ADDR_TAG_PTR(Addr[slot]), ADDR_TAG_LEN);
+   }
+   memcpy(addr, hashed, ADDR_LEN);
+}  /* end get_address() */
+
+/**
+ * @private
+ * Comparison function to sort MDST objects.
+ */
+static int mdst_compare(const void *a, const void *b)
+{
+   return memcmp(a, b, sizeof(MDST));
+}  /* end mdst_compare() */
+
+/**
+ * @private
+ * Build and sign a transaction, spending the entire balance of an
+ * address slot to the following address slots, with change to the next
+ * key generation of the address slot.
+ * @param tx Pointer to transaction entry to build
+ * @param slot Address slot of transaction source
+ */
+static void build_tx(TXENTRY *tx, word32 slot)
+{
+   word8 wots[WOTS_ADDR_LEN];
+   word8 secret[HASHLEN];
+   word8 hash[HASHLEN];
+   word32 adrs[8];
+   word64 amount, send, change, fee;
+   int j;
+
+   /* initialize transaction from template */
+   tx_read(tx, Txtemplate, Txlen);
+   memcpy(tx->src_addr, Addr[slot], ADDR_LEN);
+   get_address(tx->chg_addr, slot, Gen[slot] + 1);
+   /* destinations are the (tags of) following address slots, sorted */
+   amount = SENDAMOUNT;
+   for (j = 0; j < Ndst; j++) {
+      memcpy(tx->mdst[j].tag, Addr[(slot + 1 + j) % Naddr], ADDR_TAG_LEN);
+      put64(tx->mdst[j].amount, &amount);
+   }
+   qsort(tx->mdst, (size_t) Ndst, sizeof(MDST), mdst_compare);
+   /* balance is spent entirely -- fee is minimum per destination */
+   send = amount * Ndst;
+   fee = (word64) MFEE * Ndst;
+   change = Balance[slot] - send - fee;
+   put64(tx->send_total, &send);
+   put64(tx->change_total, &change);
+   put64(tx->tx_fee, &fee);
+
+   /* generate WOTS+ signature */
+   get_secret(secret, slot, Gen[slot]);
+   tx_wots(wots, secret);
+   tx_hash(tx, TX_HASH_MESSAGE, hash);
+   memcpy(adrs, wots + WOTS_PK_LEN + SHA256LEN, 32);
+   wots_sign(tx->wots->signature, hash, secret, wots + WOTS_PK_LEN, adrs);
+   memcpy(tx->wots->pub_seed, wots + WOTS_PK_LEN, 32);
+   memcpy(tx->wots->adrs, wots + WOTS_PK_LEN + SHA256LEN, 32);
+   /* ... force WOTS+ default */
+   put32(tx->wots->adrs + 20, 0x42);
+   put32(tx->wots->adrs + 24, 0x0e);
+   put32(tx->wots->adrs + 28, 0x01);
+
+   /* set zero nonce and transaction id */
+   memset(tx->tx_nonce, 0, 8);
+   tx_hash(tx, TX_HASH_ID, tx->tx_id);
+}  /* end build_tx() */
+
+/**
+ * @private
+ * Select up to @a count funded address slots, starting at @a first.
+ * @param slots Pointer to place selected address slots
+ * @param count Maximum number of address slots to select
+ * @param first First address slot to consider
+ * @return Number of address slots selected
+ */
+static size_t select_slots(word32 *slots, size_t count, word32 first)
+{
+   word64 cost;
+   word32 j, slot;
+   size_t n;
+
+   cost = (word64) (SENDAMOUNT + MFEE) * Ndst;
+   for (n = j = 0; n < count && j < Naddr; j++) {
+      slot = (first + j) % Naddr;
+      if (Balance[slot] >= cost) slots[n++] = slot;
+   }
+
+   return n;
+}  /* end select_slots() */
+
+/**
+ * @private
+ * Build, sign and write transactions from the selected address slots.
+ * Transactions are retained in Txbuf[], for apply_txs().
+ * @param slots Pointer to selected address slots
+ * @param count Number of selected address slots
+ * @param fname Filename to write transactions to
+ * @return (int) value representing operation result
+ * @retval VERROR on error; check errno for details
+ * @retval VEOK on success
+ */
+static int write_txs(const word32 *slots, size_t count, const char *fname)
+{
+   size_t txsz;
+   long long j;
+
+   txsz = Txlen + sizeof(TXTLR);
+
+   /* signatures dominate, so build transactions in parallel */
+#pragma omp parallel for schedule(dynamic, 64)
+   for (j = 0; j < (long long) count; j++) {
+      TXENTRY tx;
+      build_tx(&tx, slots[j]);
+      memcpy(Txbuf + (j * txsz), tx.buffer, txsz);
+   }
+
+   if (write_data(Txbuf, count * txsz, fname) != (int) (count * txsz)) {
+      return VERROR;
+   }
+
+   return VEOK;
+}  /* end write_txs() */
+
+/**
+ * @private
+ * Apply the (last written) transactions of the selected address slots
+ * to local state, as per the ledger update of a block containing them.
+ * @param slots Pointer to selected address slots
+ * @param count Number of selected address slots
+ */
+static void apply_txs(const word32 *slots, size_t count)
+{
+   TXHDR *hdr;
+   size_t j, txsz;
+   word32 slot;
+   int k;
+
+   txsz = Txlen + sizeof(TXTLR);
+   for (j = 0; j < count; j++) {
+      slot = slots[j];
+      hdr = (TXHDR *) (Txbuf + (j * txsz));
+      /* source is debited and rehashed to change address */
+      Balance[slot] -= (word64) (SENDAMOUNT + MFEE) * Ndst;
+      memcpy(Addr[slot], hdr->chg_addr, ADDR_LEN);
+      Gen[slot]++;
+   }
+   /* credit destinations */
+   for (j = 0; j < count; j++) {
+      for (k = 0; k < Ndst; k++) {
+         Balance[(slots[j] + 1 + k) % Naddr] += SENDAMOUNT;
+      }
+   }
+}  /* end apply_txs() */
+
+/**
+ * @private
+ * Write the genesis block, holding a ledger of funded address slots,
+ * and derive the ledger and Tfile from it.
+ * @param fname Filename of genesis block
+ * @return (int) value representing operation result
+ * @retval VERROR on error; check errno for details
+ * @retval VEOK on success
+ */
+static int write_genesis(const char *fname)
+{
+   /* the genesis trailer is empty, excluding the block hash */
+   static const word8 genesis_hash[HASHLEN] = {
+      0x00, 0x17, 0x0c, 0x67, 0x11, 0xb9, 0xdc, 0x3c,
+      0xa7, 0x46, 0xc4, 0x6c, 0xc2, 0x81, 0xbc, 0x69,
+      0xe3, 0x03, 0xdf, 0xad, 0x2f, 0x33, 0x3b, 0xa3,
+      0x97, 0xba, 0x06, 0x1e, 0xcc, 0xef, 0xde, 0x03
+   };
+   NGHEADER ngh;
+   BTRAILER bt;
+   LENTRY *le;
+   word64 lbytes;
+   word32 j;
+   FILE *fp;
+
+   /* build sorted ledger of funded address slots */
+   le = malloc(Naddr * sizeof(LENTRY));
+   if (le == NULL) return VERROR;
+   for (j = 0; j < Naddr; j++) {
+      memcpy(le[j].addr, Addr[j], ADDR_LEN);
+      put64(le[j].balance, &Balance[j]);
+   }
+   qsort(le, Naddr, sizeof(LENTRY), addr_compare);
+   for (j = 1; j < Naddr; j++) {
+      if (addr_tag_compare(le[j - 1].addr, le[j].addr) == 0) {
+         set_errno(EMCM_LESORT);
+         goto ERROR_CLEANUP;
+      }
+   }
+
+   /* write genesis block */
+   fp = fopen(fname, "wb");
+   if (fp == NULL) goto ERROR_CLEANUP;
+   lbytes = (word64) Naddr * sizeof(LENTRY);
+   put32(ngh.hdrlen, sizeof(NGHEADER));
+   put64(ngh.lbytes, &lbytes);
+   memset(&bt, 0, sizeof(BTRAILER));
+   memcpy(bt.bhash, genesis_hash, HASHLEN);
+   if (fwrite(&ngh, sizeof(NGHEADER), 1, fp) != 1 ||
+         fwrite(le, sizeof(LENTRY), Naddr, fp) != Naddr ||
+         fwrite(&bt, sizeof(BTRAILER), 1, fp) != 1) {
+      fclose(fp);
+      goto ERROR_CLEANUP;
+   }
+   fclose(fp);
+   free(le);
+
+   /* derive ledger and Tfile from genesis block */
+   if (le_extract(fname, "ledger.dat") != VEOK) return VERROR;
+   return append_tfile(&bt, 1, "tfile.dat");
+
+   /* cleanup / error handling */
+ERROR_CLEANUP:
+   free(le);
+
+   return VERROR;
+}  /* end write_genesis() */
+
+/**
+ * @private
+ * Solve the candidate block, @a fname, at its difficulty.
+ * @param fname Filename of candidate block
+ * @return (int) value representing operation result
+ * @retval VERROR on error; check errno for details
+ * @retval VEOK on success
+ */
+static int solve_block(const char *fname)
+{
+   BTRAILER bt;
+   FILE *fp;
+
+   if (read_trailer(&bt, fname) != VEOK) return VERROR;
+   while (trigg_solve(&bt, bt.difficulty[0], bt.nonce) != VEOK);
+   put32(bt.stime, get32(bt.time0) + BLOCKTIME);
+   sha256(&bt, sizeof(BTRAILER) - HASHLEN, bt.bhash);
+
+   /* rewrite block trailer */
+   fp = fopen(fname, "r+b");
+   if (fp == NULL) return VERROR;
+   if (fseek(fp, -((long) sizeof(BTRAILER)), SEEK_END) != 0 ||
+         fwrite(&bt, sizeof(BTRAILER), 1, fp) != 1) {
+      fclose(fp);
+      return VERROR;
+   }
+
+   return fclose(fp) == 0 ? VEOK : VERROR;
+}  /* end solve_block() */
+
+void print_usage(void)
+{
+   fprintf(stdout,
+      "usage: chaingen [options]\n"
+      "   -a, --addresses <num>     funded addresses in genesis ledger\n"
+      "   -b, --blocks <num>        block height of generated chain\n"
+      "   -d, --destinations <num>  destinations per transaction (1-256)\n"
+      "   -f, --funds <num>         genesis balance per address (nMCM)\n"
+      "   -l, --log-level <num>     level of detail in logging (0-5)\n"
+      "   -o, --output <dir>        output (node working) directory\n"
+      "   -p, --pending <num>       signed transactions to txpending.dat\n"
+      "   -s, --seed <text>         seed of address key derivation\n"
+      "   -t, --transactions <num>  transactions per block (max %d)\n\n",
+      MAXBLTX
+   );
+}  /* end print_usage() */
+
+int main(int argc, char *argv[])
+{
+   FILENAME cblock = "cblock.dat";
+   FILENAME fname;
+   word32 *slots;
+   word64 funds;
+   word8 height[8];
+   unsigned long argu;
+   unsigned long addresses, blocks, pending, txs;
+   size_t count, total;
+   char *output, *seed, *argp;
+   word32 first;
+   time_t start;
+   int argi;
+
+   {
+      /* little endian check -- executed in isolation */
+      STATIC_ASSERT(sizeof(word32) == 4, word32_size);
+      if (get16((word8[2]) { 0x34, 0x12 }) != 0x1234u) {
+         perr("incompatible endian type");
+         return EXIT_FAILURE;
+      }
+   }
+
+   /* logging setup */
+   setploglevel(PLOG_INFO);
+
+   /* init - defaults */
+   addresses = 1024;
+   blocks = 16;
+   funds = 1000000000000ULL;
+   output = "chaingen";
+   pending = 0;
+   seed = "chaingen";
+   txs = 1024;
+   Ndst = 1;
+
+/* ARGUMENT MACROs */
+#define GET_ARGP_OR_EXIT_FAILURE(ARGP) \
+   do { \
+      ARGP = argvalue(&argi, argc, argv); \
+      if (ARGP == NULL) { \
+         perr("missing value"); \
+         return EXIT_FAILURE; \
+      } \
+   } while (0)
+#define GET_ARGU_OR_EXIT_FAILURE(ARGP, ARGU) \
+   do { \
+      GET_ARGP_OR_EXIT_FAILURE(ARGP); \
+      pdebug("    parsing value: %s", ARGP); \
+      ARGU = strtoul(ARGP, NULL, 0); \
+      if (errno == ERANGE) { \
+         perrno("invalid value"); \
+         return EXIT_FAILURE; \
+      } \
+   } while (0)
+
+   /* parse command line arguments */
+   for (argi = 1; argi < argc; argi++) {
+      /* ARGUMENT OPTIONS */
+      if (argv[argi][0] == '-') {
+         if (argument(argv[argi], "-a", "--addresses")) {
+            GET_ARGU_OR_EXIT_FAILURE(argp, addresses);
+            continue;
+         }
+         if (argument(argv[argi], "-b", "--blocks")) {
+            GET_ARGU_OR_EXIT_FAILURE(argp, blocks);
+            continue;
+         }
+         if (argument(argv[argi], "-d", "--destinations")) {
+            GET_ARGU_OR_EXIT_FAILURE(argp, argu);
+            Ndst = (int) (argu > 256 ? 257 : argu);
+            continue;
+         }
+         if (argument(argv[argi], "-f", "--funds")) {
+            GET_ARGP_OR_EXIT_FAILURE(argp);
+            funds = strtoull(argp, NULL, 0);
+            continue;
+         }
+         if (argument(argv[argi], "-l", "--log-level")) {
+            GET_ARGU_OR_EXIT_FAILURE(argp, argu);
+            setploglevel((int) argu);
+            continue;
+         }
+         if (argument(argv[argi], "-o", "--output")) {
+            GET_ARGP_OR_EXIT_FAILURE(output);
+            continue;
+         }
+         if (argument(argv[argi], "-p", "--pending")) {
+            GET_ARGU_OR_EXIT_FAILURE(argp, pending);
+            continue;
+         }
+         if (argument(argv[argi], "-s", "--seed")) {
+            GET_ARGP_OR_EXIT_FAILURE(seed);
+            continue;
+         }
+         if (argument(argv[argi], "-t", "--transactions")) {
+            GET_ARGU_OR_EXIT_FAILURE(argp, txs);
+            continue;
+         }
+      }
+      /* unrecognised argument, check usage */
+      print_usage();
+      return EXIT_FAILURE;
+   }  /* end command line arguments */
+
+   /* check arguments */
+   if (addresses < 2 || addresses > 0xffffffffUL) {
+      perr("addresses must be at least 2");
+      return EXIT_FAILURE;
+   }
+   if (blocks < 1 || blocks >= V20TRIGGER) {
+      perr("blocks must be within 1-%d (pre-v2.0 difficulty)",
+         V20TRIGGER - 1);
+      return EXIT_FAILURE;
+   }
+   if (Ndst < 1 || Ndst > 256 || (unsigned long) Ndst >= addresses) {
+      perr("destinations must be within 1-256, and less than addresses");
+      return EXIT_FAILURE;
+   }
+   if (txs < 1 || txs > MAXBLTX || txs > addresses) {
+      perr("transactions must be within 1-%d, and at most addresses",
+         MAXBLTX);
+      return EXIT_FAILURE;
+   }
+   if (pending > addresses) {
+      perr("pending must be at most addresses");
+      return EXIT_FAILURE;
+   }
+   Naddr = (word32) addresses;
+
+   /* prepare output directory -- never overwrite an existing chain */
+   path_join(fname, output, Bcdir);
+   if (mkdir_p(fname) != 0 || chdir(output) != 0) {
+      perrno("failed to prepare output directory, %s", output);
+      return EXIT_FAILURE;
+   }
+   if (fexists("tfile.dat") || fexists("ledger.dat")) {
+      perr("output directory contains a chain, %s", output);
+      return EXIT_FAILURE;
+   }
+
+   /* derive master secret and seed random generators (for solves) */
+   sha256(seed, strlen(seed), Master);
+   srand16fast(get32(Master));
+   srand16(get32(Master + 4), get32(Master + 8), get32(Master + 12));
+   srand32(*((unsigned long long *) (Master + 16)));
+
+   /* allocate address slots and transaction selection */
+   Addr = malloc(Naddr * sizeof(*Addr));
+   Gen = calloc(Naddr, sizeof(*Gen));
+   Balance = malloc(Naddr * sizeof(*Balance));
+   slots = malloc(Naddr * sizeof(*slots));
+   if (Addr == NULL || Gen == NULL || Balance == NULL || slots == NULL) {
+      perrno("failed to allocate %" P32u " address slots", Naddr);
+      return EXIT_FAILURE;
+   }
+
+   /* prepare transaction template and buffer */
+   memset(Txtemplate, 0, sizeof(Txtemplate));
+   TXDAT_TYPE(Txtemplate) = TXDAT_MDST;
+   TXDSA_TYPE(Txtemplate) = TXDSA_WOTS;
+   Txtemplate[2] = (word8) (Ndst - 1);
+   Txlen = sizeof(TXHDR) + (sizeof(MDST) * Ndst) + sizeof(WOTSVAL);
+   Txbuf = malloc((txs > pending ? txs : pending) * (Txlen + sizeof(TXTLR)));
+   if (Txbuf == NULL) {
+      perrno("failed to allocate transaction buffer");
+      return EXIT_FAILURE;
+   }
+
+   /* derive funded addresses (in parallel) */
+   plog("Deriving %" P32u " funded addresses...", Naddr);
+   start = time(NULL);
+#pragma omp parallel for schedule(dynamic, 64)
+   for (long long j = 0; j < (long long) Naddr; j++) {
+      get_address(Addr[j], (word32) j, 0);
+      Balance[j] = funds;
+   }
+
+   /* write genesis block, ledger and tfile */
+   path_join(fname, Bcdir, "b0000000000000000.bc");
+   if (write_genesis(fname) != VEOK) {
+      perrno("failed to write genesis, %s", fname);
+      return EXIT_FAILURE;
+   }
+
+   /* initialize node state from genesis -- blocks are backdated */
+   Ininit = Bgflag = 1;
+   if (le_open("ledger.dat") != VEOK || reset_chain() != VEOK) {
+      perrno("failed to initialize chain");
+      return EXIT_FAILURE;
+   }
+   Time0 = (word32) time(NULL) - (word32) (blocks * BLOCKTIME);
+   memset(height, 0, sizeof(height));
+   put32(height, (word32) blocks);
+
+   /* generate blocks -- neogenesis blocks are generated by b_update() */
+   for (first = 0, total = 0; cmp64(Cblocknum, height) < 0; ) {
+      count = select_slots(slots, txs, first);
+      if (count == 0) {
+         perr("no funded addresses remain");
+         return EXIT_FAILURE;
+      }
+      if (write_txs(slots, count, "txclean.dat") != VEOK) {
+         perrno("failed to write txclean.dat");
+         return EXIT_FAILURE;
+      }
+      if (b_con(cblock) != VEOK) {
+         perrno("b_con() FAILURE");
+         return EXIT_FAILURE;
+      }
+      if (solve_block(cblock) != VEOK) {
+         perrno("failed to solve %s", cblock);
+         return EXIT_FAILURE;
+      }
+      if (b_update(cblock) != VEOK) {
+         perrno("b_update() FAILURE");
+         return EXIT_FAILURE;
+      }
+      apply_txs(slots, count);
+      first = (word32) ((first + count) % Naddr);
+      total += count;
+      pdebug("updated block 0x%s, %lu transactions",
+         bnum2hex(Cblocknum, NULL), (unsigned long) count);
+   }
+
+   /* write pending transactions, valid against the final ledger */
+   if (pending) {
+      count = select_slots(slots, pending, first);
+      if (count < pending) pwarn("funded addresses limit pending transactions");
+      if (write_txs(slots, count, "txpending.dat") != VEOK) {
+         perrno("failed to write txpending.dat");
+         return EXIT_FAILURE;
+      }
+      plog("Wrote %lu pending transactions to txpending.dat",
+         (unsigned long) count);
+   }
+
+   plog("Generated chain to 0x%s, %lu transactions, in %.0lf seconds",
+      bnum2hex(Cblocknum, NULL), (unsigned long) total,
+      difftime(time(NULL), start));
+
+   le_close();
+   free(Txbuf);
+   free(slots);
+   free(Balance);
+   free(Gen);
+   free(Addr);
+
+   return EXIT_SUCCESS;
+}  /* end main() */
+
+/* end include guard */
+#endif
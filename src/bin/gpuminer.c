@@ -26,6 +26,7 @@
 #include "error.h"   /* for error codes */
 #include "bup.h"
 #include "bcon.h"
+#include "wserv.h"
 
 /* external support */
 #include "base58.h"
@@ -106,6 +107,12 @@ BTRAILER BT_curr = {0};
 BTRAILER BT_prev = {0};
 FILE *FP_curr = NULL;
 FILE *FP_prev = NULL;
+/* CPU device nonce generator seed */
+word64 Cpu_seed = 0;
+/* work server connection and identifiers of current/previous work */
+SOCKET Wsd = INVALID_SOCKET;
+word32 Wid_curr = 0;
+word32 Wid_prev = 0;
 
 /**
  * @private
@@ -256,7 +263,7 @@ void check_push_peers(void)
          /* get IP list from peer */
          if (get_ipl(&node, allpeers[idx]) == VEOK) {
             /* check compatibility */
-            if (node.tx.version[1] & C_PUSH) {
+            if (node.tx->version[1] & C_PUSH) {
                /* add peer to push list */
                peer = allpeers[idx];
                #pragma omp critical
@@ -265,13 +272,14 @@ void check_push_peers(void)
                }
             }
             /* inspect peer list */
-            for (len = 0; len < get16(node.tx.len); len += 4) {
-               peer = *((word32 *) &node.tx.buffer[len]);
+            for (len = 0; len < get16(node.tx->len); len += 4) {
+               peer = *((word32 *) &node.tx->buffer[len]);
                #pragma omp critical
                if (addpeer(peer, allpeers, RPLISTLEN, &allidx)) {
                   pdebug("Added %s to scan list", ntoa(&peer, ipstr));
                }
             }
+            node_close(&node);
          }  /* end if get_ipl() */
 
          /* atomic increment scan index */
@@ -314,11 +322,11 @@ int recv_fp(NODE *np, FILE *fp)
 
    /* init recv_file() */
    time(&prevtime);
-   tx = &(np->tx);
 
    /* receive packets and write */
    while (recv_tx(np, STD_TIMEOUT) == VEOK) {
-      /* check recv'd packet */
+      /* check recv'd packet -- recv_tx() may move packet buffer */
+      tx = np->tx;
       if (get16(tx->opcode) != OP_SEND_FILE) {
          pdebug("(%s) *** invalid opcode", np->id);
          break;
@@ -340,7 +348,6 @@ int recv_fp(NODE *np, FILE *fp)
 /**
  * Send packets to NODE *np, and write to file, fname.
  * SOCKET np->sd is set non-blocking, ready to recv data.
- * Set fname NULL send np->tx.blocknum request.
  * Returns: VEOK (0) = good, else error code. */
 int send_fp(NODE *np, FILE *fp)
 {
@@ -353,8 +360,9 @@ int send_fp(NODE *np, FILE *fp)
       return VERROR;
    }
 
-   /* init send_file() */
-   tx = &(np->tx);
+   /* init send_file() -- file data is sent in full packets */
+   if (node_reserve(np, sizeof(tx->buffer)) != VEOK) return VERROR;
+   tx = np->tx;
 
    /* read and send packets */
    do {
@@ -385,15 +393,16 @@ int network_recv_cblock(void)
    int ecode;
 
    /* obtain latest cblock */
+   node.sd = INVALID_SOCKET;
+   node.tx = NULL;
    fp = tmpfile();
    if (fp == NULL) goto ERROR_CLEANUP;
    ecode = callserver(&node, Rplist[0]);
    if (ecode == VEOK) ecode = send_op(&node, OP_GET_CBLOCK);
    if (ecode == VEOK) ecode = recv_fp(&node, fp);
    if (ecode != VEOK) goto ECODE_CLEANUP;
-   /* socket cleanup */
-   sock_close(node.sd);
-   node.sd = INVALID_SOCKET;
+   /* node cleanup */
+   node_close(&node);
 
    llen = ftell(fp);
    if (llen == (-1)) goto ERROR_CLEANUP;
@@ -432,14 +441,14 @@ int network_recv_cblock(void)
    return VEOK;
 
 OK_CLEANUP:
-   if (node.sd != INVALID_SOCKET) sock_close(node.sd);
+   node_close(&node);
    if (fp) fclose(fp);
    return VETIMEOUT;
 
 ERROR_CLEANUP:
    ecode = VERROR;
 ECODE_CLEANUP:
-   if (node.sd != INVALID_SOCKET) sock_close(node.sd);
+   node_close(&node);
    if (fp) fclose(fp);
    return ecode;
 }  /* end network_recv_cblock() */
@@ -470,16 +479,17 @@ int network_send_solve(void)
    if (callserver(&node, Rplist[0]) != VEOK) {
       return VERROR;
    }
-   put16(node.tx.len, 0);
+   put16(node.tx->len, 0);
    if (send_op(&node, OP_MBLOCK) != VEOK) {
-      sock_close(node.sd);
+      node_close(&node);
       return VERROR;
    }
    rewind(fp);
    if (send_fp(&node, fp) != VEOK) {
-      sock_close(node.sd);
+      node_close(&node);
       return VERROR;
    }
+   node_close(&node);
    print_bup(&BT_solve);
    /* remove temporary files containing block data */
    if (FP_curr) {
@@ -494,6 +504,137 @@ int network_send_solve(void)
    return VEOK;
 }  /* end network_send_solve() */
 
+/**
+ * Receive pushed work from the work server of the target node (see
+ * wserv.h), connecting (as a subscriber) where not connected.
+ * Work is (only) the 92-byte prefix of the candidate block trailer;
+ * the node reassembles solved blocks itself.
+ * @returns VEOK on new work, VETIMEOUT on no new work, else VERROR
+*/
+int network_recv_work(void)
+{
+   WSERV_MSG msg;
+   BTRAILER bt;
+   char ipaddr[16];
+   int ecode, result = VETIMEOUT;
+   static time_t connect_time;
+
+   /* (re)connect to work server, at most every INIT_TIMEOUT seconds */
+   if (Wsd == INVALID_SOCKET) {
+      if (difftime(time(NULL), connect_time) < INIT_TIMEOUT) return VETIMEOUT;
+      time(&connect_time);
+      Wsd = sock_connect_ip(Rplist[0], Workport, INIT_TIMEOUT);
+      if (Wsd == INVALID_SOCKET) return VERROR;
+      if (sock_set_nonblock(Wsd) == SOCKET_ERROR) goto ERROR_CLEANUP;
+      plog("Subscribed to work server %s:%d", ntoa(Rplist, ipaddr), Workport);
+      Wid_curr = Wid_prev = 0;
+   }
+
+   /* process (all) pushed messages */
+   while ((ecode = wserv_recv(Wsd, &msg, 0)) == VEOK) {
+      switch (msg.type) {
+         case WSERV_WORK:
+            memset(&bt, 0, sizeof(BTRAILER));
+            memcpy(&bt, msg.data, WSERV_WORKLEN);
+            /* check work not already solved (phash+bnum) */
+            if (memcmp(bt.phash, BT_solve.phash, HASHLEN) == 0) break;
+            /* update current block */
+            memset(&BT_solve, 0, sizeof(BTRAILER));
+            memcpy(&BT_prev, &BT_curr, sizeof(BTRAILER));
+            memcpy(&BT_curr, &bt, sizeof(BTRAILER));
+            Wid_prev = Wid_curr;
+            Wid_curr = get32(msg.id);
+            result = VEOK;
+            break;
+         case WSERV_IDLE:
+            /* retain withdrawn work as previous, for late solves */
+            memcpy(&BT_prev, &BT_curr, sizeof(BTRAILER));
+            Wid_prev = Wid_curr;
+            /* no transactions pauses solving */
+            put32(BT_curr.tcount, 0);
+            Wid_curr = 0;
+            break;
+         case WSERV_SHARE: pdebug("work server: share accepted"); break;
+         case WSERV_SOLVE: plog("work server: solve accepted"); break;
+         case WSERV_REJECT: pwarn("work server: solve rejected"); break;
+         default: goto ERROR_CLEANUP;
+      }  /* end switch */
+   }
+   if (ecode != VETIMEOUT) goto ERROR_CLEANUP;
+
+   return result;
+
+ERROR_CLEANUP:
+   sock_close(Wsd);
+   Wsd = INVALID_SOCKET;
+   return VERROR;
+}  /* end network_recv_work() */
+
+/**
+ * Submit a solve to the work server of the target node, as a nonce for
+ * either current or previous work.
+ * @returns VEOK on success, or no solve to submit, else VERROR
+*/
+int network_send_work(void)
+{
+   static word8 nonce[HASHLEN];
+   WSERV_MSG msg;
+
+   /* check (unsubmitted) solve exists to send */
+   if (BT_solve.nonce[0] == 0) return VEOK;
+   if (memcmp(nonce, BT_solve.nonce, HASHLEN) == 0) return VEOK;
+   if (Wsd == INVALID_SOCKET) return VERROR;
+
+   /* identify work of solve */
+   memset(&msg, 0, sizeof(msg));
+   msg.type = WSERV_SUBMIT;
+   if (memcmp(&BT_solve, &BT_curr, WSERV_WORKLEN) == 0) {
+      put32(msg.id, Wid_curr);
+   } else if (memcmp(&BT_solve, &BT_prev, WSERV_WORKLEN) == 0) {
+      put32(msg.id, Wid_prev);
+   } else return VEOK;
+   memcpy(msg.data, BT_solve.nonce, HASHLEN);
+   if (wserv_send(Wsd, &msg) != VEOK) {
+      sock_close(Wsd);
+      Wsd = INVALID_SOCKET;
+      return VERROR;
+   }
+   memcpy(nonce, BT_solve.nonce, HASHLEN);
+   print_bup(&BT_solve);
+
+   return VEOK;
+}  /* end network_send_work() */
+
+/**
+ * Hand a solved block trailer to the network thread, for sending.
+ * @param bt Pointer to solved block trailer (stime and bhash are set)
+ * @returns VEOK on handoff, else VERROR if solve failed verification
+*/
+int solve_handoff(BTRAILER *bt)
+{
+   /* (double) check solve is valid */
+   if (peach_check(bt) != VEOK) {
+      perr("peach_check() failed to verify solve!");
+      return VERROR;
+   }
+   /* acquire (exclusive) lock */
+   MUTEX_LOCK_OR_ABORT(&Slock);
+   /* embed (valid) solve time and block hash */
+   put32(bt->stime, (word32) time(NULL));
+   if (get32(bt->time0) == get32(bt->stime)) {
+      put32(bt->stime, (word32) time(NULL) + 1);
+   }
+   sha256(bt, sizeof(BTRAILER) - HASHLEN, bt->bhash);
+   memcpy(&BT_solve, bt, sizeof(BTRAILER));
+   pdebug("solve handed to network thread...");
+   /* alert (sleeping) network thread */
+   condition_signal(&Salarm);
+   /* release (exclusive) lock */
+   MUTEX_UNLOCK_OR_ABORT(&Slock);
+
+   return VEOK;
+}  /* end solve_handoff() */
+
 /* print (and more importantly, log) server host information */
 void phostinfo(void)
 {
@@ -574,7 +715,10 @@ void print_usage(void)
       "   -m, --maddr <ADDR>           set or select mining address\n"
       "   -N, --node <HOST[,HOST]>     list of Node Mining target hosts\n"
       "   -P, --pool <HOST[,HOST]>     list of Pool Mining target hosts\n"
-      "   -p, --port <num>             port number of target\n\n"
+      "   -p, --port <num>             port number of target\n"
+      "   -t, --threads <num>          number of CPU mining threads\n"
+      "   -w, --work-port <num>        subscribe to work server on port\n"
+      "   --shared-map                 share CPU Peach Map across processes\n\n"
    );
 }
 
@@ -586,8 +730,12 @@ int main(int argc, char *argv[])
    int argi;
 
    DEVICE_CTX device[GPUMAX];
+   DEVICE_CTX *cpu_device = NULL;
    FILENAME maddrfile = {0};
    int device_count;
+   int cpu_threads;
+   int cpu_map;
+   int ecode;
    int interval_ms;
 MCM_DECL_UNUSED
    int miner_mode;
@@ -618,6 +766,7 @@ MCM_DECL_UNUSED
    srand16fast(urandom(seeds, sizeof(seeds)));
    srand16(seeds[1], seeds[2], seeds[3]);
    srand32(*((unsigned long long *) &seeds[4]));
+   Cpu_seed = ((word64) seeds[6] << 32) | seeds[7];
    /* enable socket support */
    sock_startup();
 
@@ -625,6 +774,8 @@ MCM_DECL_UNUSED
    miner_mode = NODE_MODE;
    Port = Dstport = PORT1;
    interval_ms = 10000; /* ms */
+   cpu_threads = -1; /* auto */
+   cpu_map = PEACH_MAP_PRIVATE;
    Dynasleep = 10; /* ms */
 
 /* ARGUMENT MACROs */
@@ -763,6 +914,32 @@ MCM_DECL_UNUSED
             Port = Dstport = (word16) argu;
             continue; /* next arg */
          }
+         if (argument(argv[argi], NULL, "--shared-map")) {
+            /* share CPU Peach Map with co-located solvers */
+            cpu_map = PEACH_MAP_SHARED | PEACH_MAP_HUGE;
+            continue; /* next arg */
+         }
+         if (argument(argv[argi], "-t", "--threads")) {
+            /* obtain CPU threads value (auto-base) */
+            GET_ARGU_OR_EXIT_FAILURE(argp, argu);
+            if (argu > 1024) {
+               perr("invalid threads value");
+               return EXIT_FAILURE;
+            }
+            cpu_threads = (int) argu;
+            continue; /* next arg */
+         }
+         if (argument(argv[argi], "-w", "--work-port")) {
+            /* obtain work server port value (auto-base) */
+            GET_ARGU_OR_EXIT_FAILURE(argp, argu);
+            /* check port value range */
+            if (argu < 1 || argu > 65535) {
+               perr("invalid work port value");
+               return EXIT_FAILURE;
+            }
+            Workport = (word16) argu;
+            continue; /* next arg */
+         }
       }  /* end if (argv[argi][0] == '-') */
       /* unrecognised argument, check usage */
       perr("unrecognised argument");
@@ -770,6 +947,9 @@ MCM_DECL_UNUSED
       return EXIT_FAILURE;
    }  /* end command line arguments */
 
+   /* pushed work is polled frequently */
+   if (Workport) interval_ms = 100;
+
    /* print (and log) copyright and version information */
    plog("Mochimo Miner " VERSION ", built " __DATE__ " " __TIME__);
    plog("Copyright (c) 2024 Adequate Systems, LLC.  All Rights Reserved.");
@@ -778,17 +958,52 @@ MCM_DECL_UNUSED
    plog("   https://mochimo.org/license (TEXT version)");
    printf("\n");
 
+#ifdef CUDA
    device_count = init_cuda_devices(device, GPUMAX);
+#else
+   device_count = 0;
+#endif
    if (device_count < 1) {
-      perr("No CUDA devices found.");
-      plog("Mining will not be possible...");
-      return EXIT_FAILURE;
+      device_count = 0;
+      /* fallback to CPU solving threads, unless disabled */
+      if (cpu_threads == 0) {
+         perr("No CUDA devices found.");
+         plog("Mining will not be possible...");
+         return EXIT_FAILURE;
+      }
+      pwarn("No CUDA devices found. Mining with CPU...");
+      if (cpu_threads < 0) cpu_threads = omp_get_num_procs();
+   } else if (cpu_threads < 0) cpu_threads = 0;
+   /* CPU solving threads are scheduled as (an additional) device */
+   if (init_cpu_devices(&device[device_count],
+         GPUMAX - device_count, cpu_threads) > 0) {
+      cpu_device = &device[device_count++];
    }
-   plog("Cuda Devices (%d)...", device_count);
+   plog("Devices (%d)...", device_count);
    for (int idx = 0; Running && idx < device_count; idx++) {
       plog(" - %s", device[idx].info);
       pdebug("initilizing device...");
-      if (peach_init_cuda_device(&device[idx]) != VEOK) {
+      /* execute init protocol per device type */
+      switch (device[idx].type) {
+#ifdef CUDA
+         case CUDA_DEVICE:
+            ecode = peach_init_cuda_device(&device[idx]);
+            break;
+#endif
+         case CPU_DEVICE:
+            ecode = peach_init_cpu_device(&device[idx], cpu_map, Cpu_seed);
+            if (ecode != VEOK && cpu_map != PEACH_MAP_NONE) {
+               /* fallback to CPU threads without a Peach Map */
+               perrno("Peach Map allocation FAILURE");
+               pwarn("CPU threads will generate all Peach tiles...");
+               ecode = peach_init_cpu_device(&device[idx],
+                  PEACH_MAP_NONE, Cpu_seed);
+            }
+            break;
+         default:
+            ecode = VERROR;
+      }
+      if (ecode != VEOK) {
          perrno("peach initialization FAILURE");
          pwarn("%s will not be utilized...", device[idx].info);
       }
@@ -798,7 +1013,7 @@ MCM_DECL_UNUSED
    int thread_idx = 1;
 
    /* enter (parallel) mining loop */
-   #pragma omp parallel num_threads(3)
+   #pragma omp parallel num_threads(3 + cpu_threads)
    {
       BTRAILER *bt = NULL;
       int task_idx = -1;
@@ -817,6 +1032,7 @@ MCM_DECL_UNUSED
       switch (task_idx) {
          case 2: {
             BTRAILER bt_solve = {0};
+            word8 phash[HASHLEN] = {0};
             time_t now;
 
             /* set working block trailer to current */
@@ -848,44 +1064,40 @@ MCM_DECL_UNUSED
                      paused = 0;
                   }
                }
+               /* remove shared Peach Maps of previous work */
+               if ((cpu_map & PEACH_MAP_SHARED) &&
+                     memcmp(phash, bt->phash, HASHLEN) != 0) {
+                  memcpy(phash, bt->phash, HASHLEN);
+                  peach_shm_sweep(phash);
+               }
                /* manage devices solving */
-               for (int idx = 0; idx < device_count && !paused; idx++) {
+               for (int idx = 0; idx < device_count; idx++) {
                   /* execute solve protocol per device type */
                   switch (device[idx].type) {
+#ifdef CUDA
                      case CUDA_DEVICE:
+                        if (paused) continue;
                         ecode = peach_solve_cuda(&device[idx], &BT_curr, 0, &bt_solve);
                         break;
+#endif
                   /* case OPENCL_DEVICE:
                         solve = peach_solve_opencl(&device[idx], &BT_curr, 0, &bt);
                         break; */
+                     case CPU_DEVICE:
+                        /* CPU work is withdrawn (NULL) while paused */
+                        ecode = peach_solve_cpu(&device[idx],
+                           paused ? NULL : &BT_curr, 0, &bt_solve);
+                        break;
                      default:
                         /* skip */
                         continue;
                   }
                   /* check for solve */
-                  if (ecode == VEOK) {
-                     /* (double) check solve is valid */
-                     if (peach_check(&bt_solve) != VEOK) {
-                        perr("peach_check() failed to verify solve!");
-                        continue;  /* ... device loop */
-                     }
-                     /* acquire (exclusive) lock */
-                     MUTEX_LOCK_OR_ABORT(&Slock);
-                     /* embed (valid) solve time and block hash */
-                     put32(bt_solve.stime, (word32) time(NULL));
-                     if (get32(bt_solve.time0) == get32(bt_solve.stime)) {
-                        put32(bt_solve.stime, (word32) time(NULL) + 1);
-                     }
-                     sha256(&bt_solve, sizeof(BTRAILER) - HASHLEN, bt_solve.bhash);
-                     memcpy(&BT_solve, &bt_solve, sizeof(BTRAILER));
-                     pdebug("solve handed to network thread...");
-                     /* alert (sleeping) network thread */
-                     condition_signal(&Salarm);
-                     /* release (exclusive) lock */
-                     MUTEX_UNLOCK_OR_ABORT(&Slock);
-                  }  /* end if solve */
+                  if (ecode == VEOK) solve_handoff(&bt_solve);
                }  /* end device loop */
             }  /* end while */
+            /* withdraw work from CPU solving threads, for exit */
+            if (cpu_device) peach_solve_cpu(cpu_device, NULL, 0, &bt_solve);
             break;
          }  /* end Device Handler */
          case 1: {
@@ -897,51 +1109,59 @@ MCM_DECL_UNUSED
             /* exclusive "Running" loop... */
             MUTEX_LOCK_OR_ABORT(&Slock);
             while (Running) {
-               /* send solve or check network */
-               if (network_send_solve() == VEOK) {
-                  if (network_recv_cblock() == VEOK) {
-                     /* ... currently there is a period of time between
-                      * a block transition where a Node does not have
-                      * transactions to produce a candidate block and
-                      * will simply abort the connection. This results
-                      * in miners continuing to mine the previous block
-                      * until transactions appear on the next block, or
-                      * the BRIDGE time is reached... */
-                     /* report stats, or set block trailer to previous */
-                     if (bt) {
-                        /* only report on block changes */
-                        if (get32(bt->bnum) != get32(BT_curr.bnum)) {
-                           total = 0.0;
-                           /* report block summary */
-                           plog("Work summary; block %u(0x%x), difficulty %u",
-                              get32(bt->bnum), get32(bt->bnum), bt->difficulty[0]);
-                           /* print block work stats and hashrate per device */
-                           for (int idx = 0; idx < device_count; idx++) {
-                              if (device[idx].status <= DEV_NULL) {
-                                 plog(" - %s failure...", device[idx].info);
-                                 continue;
-                              }
-                              total += (double) device[idx].hps;
-                              hps = (double) device[idx].hps;
-                              m = metric_reduce(&hps);
-                              plog(" - %s %.02lf%sH/s", device[idx].info, hps, m);
-                           }  /* end device loop */
-                           /* repoort total hashrate if device count > 1 */
-                           if (device_count > 1) {
-                              m = metric_reduce(&total);
-                              plog(" - Total %.02lf%sH/s", total, m);
-                           }
-                        }  /* end if bt */
-                     } else bt = &BT_prev;
-                     plog("New work; %s:%"P16u" %u(0x%x):%u:%s...",
-                        ntoa(Rplist, NULL), Dstport, get32(BT_curr.bnum),
-                        get32(BT_curr.bnum), BT_curr.difficulty[0],
-                        hash2hex32(BT_curr.mroot, NULL));
-                  } else if (errno != EAGAIN) {
+               /* send solve or check network (or work server) */
+               if (Workport) {
+                  ecode = network_send_work();
+                  if (ecode == VEOK) ecode = network_recv_work();
+                  if (ecode == VERROR) perrno("work server FAILURE");
+               } else if (network_send_solve() == VEOK) {
+                  ecode = network_recv_cblock();
+                  if (ecode != VEOK && errno != EAGAIN) {
                      perrno("network_recv_cblock() FAILURE");
                   }
                } else {
                   perrno("network_send_solve() FAILURE");
+                  ecode = VERROR;
+               }
+               if (ecode == VEOK) {
+                  /* ... currently there is a period of time between
+                   * a block transition where a Node does not have
+                   * transactions to produce a candidate block and
+                   * will simply abort the connection. This results
+                   * in miners continuing to mine the previous block
+                   * until transactions appear on the next block, or
+                   * the BRIDGE time is reached... */
+                  /* report stats, or set block trailer to previous */
+                  if (bt) {
+                     /* only report on block changes */
+                     if (get32(bt->bnum) != get32(BT_curr.bnum)) {
+                        total = 0.0;
+                        /* report block summary */
+                        plog("Work summary; block %u(0x%x), difficulty %u",
+                           get32(bt->bnum), get32(bt->bnum), bt->difficulty[0]);
+                        /* print block work stats and hashrate per device */
+                        for (int idx = 0; idx < device_count; idx++) {
+                           if (device[idx].status <= DEV_NULL) {
+                              plog(" - %s failure...", device[idx].info);
+                              continue;
+                           }
+                           total += (double) device[idx].hps;
+                           hps = (double) device[idx].hps;
+                           m = metric_reduce(&hps);
+                           plog(" - %s %.02lf%sH/s (%zu hashes)",
+                              device[idx].info, hps, m, device[idx].work);
+                        }  /* end device loop */
+                        /* repoort total hashrate if device count > 1 */
+                        if (device_count > 1) {
+                           m = metric_reduce(&total);
+                           plog(" - Total %.02lf%sH/s", total, m);
+                        }
+                     }  /* end if bt */
+                  } else bt = &BT_prev;
+                  plog("New work; %s:%"P16u" %u(0x%x):%u:%s...",
+                     ntoa(Rplist, NULL), Dstport, get32(BT_curr.bnum),
+                     get32(BT_curr.bnum), BT_curr.difficulty[0],
+                     hash2hex32(BT_curr.mroot, NULL));
                }
                /* wait for work, sleepy time (5 second timeout)... */
                ecode = condition_timedwait(&Salarm, &Slock, interval_ms);
@@ -956,12 +1176,24 @@ MCM_DECL_UNUSED
             MUTEX_UNLOCK_OR_ABORT(&Slock);
             break;
          }  /* end Network Handler */
-         default: {
-            /* Remaining Threads: Idle */
+         case 0: {
+            /* Master Thread: Idle */
          /* thread_setname(thread_self(), "idle"); */
             while (Running) millisleep(100);
             break;
          }  /* end Idle */
+         default: {
+            /* Remaining Threads: CPU solver */
+            thread_setname(thread_self(), "cpu_solver");
+            /* solve work of the CPU device, while distributed */
+            while (Running && cpu_device) {
+               if (peach_work_cpu(cpu_device) != VEOK) {
+                  /* wait for work */
+                  millisleep(Dynasleep);
+               }
+            }  /* end while */
+            break;
+         }  /* end CPU solver */
       }  /* end switch */
       /* acquire (exclusive) lock */
       MUTEX_LOCK_OR_ABORT(&Slock);
@@ -971,6 +1203,7 @@ MCM_DECL_UNUSED
       MUTEX_UNLOCK_OR_ABORT(&Slock);
    }  /* end parallel */
    pdebug("all threads finished...");
+   if (cpu_device) peach_free_cpu_device(cpu_device);
 
    printf("\n\n");
    return EXIT_SUCCESS;
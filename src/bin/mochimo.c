@@ -41,6 +41,7 @@
 #include <dirent.h>  /* UNIX directory utils */
 #include <errno.h>
 #include <ctype.h>
+#include <pthread.h> /* for passive mining threads */
 
 /* external support */
 #include "sha256.h"
@@ -66,10 +67,15 @@
 #include "error.h"
 #include "bup.h"
 #include "bcon.h"
+#include "wserv.h"
+#include "metrics.h"
+#include "workq.h"
+#include "pstat.h"
 
 char *Opt_cplistfile = "coreip.lst";
 char *Opt_rplistfile = "recent.lst";
 char *Opt_eplistfile = "epink.lst";
+char *Opt_pstatfile = "pstat.dat";
 
 #ifdef _WIN32
 #include <windows.h>
@@ -267,7 +273,7 @@ void monitor(void)
          printf("Recent peers:\n");
          print_ipl(Rplist, RPLISTLEN);
          printf("Pinklisted:\n");
-         print_ipl(Epinklist, EPINKLEN);
+         print_pinkl();
          continue;
       } else if (*buff == '\0') {   /* ENTER to continue server */
          Monitor = runmode;
@@ -364,11 +370,13 @@ int init(void)
 
    plog("Init peers...");
    /* initialize peer lists */
-   count = read_ipl(Opt_eplistfile, Epinklist, EPINKLEN, &Epinkidx);
+   count = read_pinkl(Opt_eplistfile);
    if (count > 0) plog(" - added %" P32u " pinklisted peers", count);
    count = read_ipl(Opt_cplistfile, Rplist, RPLISTLEN, &Rplistidx);
    count += read_ipl(Opt_rplistfile, Rplist, RPLISTLEN, &Rplistidx);
    if (count > 0) plog(" - added %" P32u " recent peers", count);
+   count = pstat_load(Opt_pstatfile);
+   if (count > 0) plog(" - loaded %" P32u " peer statistics", count);
 
    /* scan entire network of peers */
    while (Running) {
@@ -591,8 +599,129 @@ int init(void)
    return Running ? VEOK : VERROR;
 }  /* end init() */
 
+/* passive mining work, shared by miner() threads */
+typedef struct {
+   BTRAILER bt;      /* candidate block trailer */
+   BTRAILER solve;   /* solved block trailer, set by first solving thread */
+   word64 seed;      /* nonce generator seed, shared by all threads */
+   int streams;      /* nonce generator streams taken (atomic) */
+   int solved;       /* non-zero once solved (atomic) */
+} MINER_WORK;
+
+/**
+ * Passive mining thread. Solves for Mineduty percent of each second.
+ * @param arg Pointer to shared MINER_WORK, prepared by miner()
+*/
+void *miner_thread(void *arg)
+{
+   MINER_WORK *work = (MINER_WORK *) arg;
+   struct timespec start, now;
+   TRIGG_RNG rng;
+   BTRAILER bt;
+   double elapsed;
+
+   memcpy(&bt, &work->bt, sizeof(BTRAILER));
+   /* disjoint nonce stream per thread */
+   trigg_rng_init(&rng, work->seed,
+      (word64) __atomic_fetch_add(&work->streams, 1, __ATOMIC_RELAXED));
+   while (Running && !__atomic_load_n(&work->solved, __ATOMIC_ACQUIRE)) {
+      /* solve for duty portion of each (1 second) period */
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      do {
+         if (peach_solve_r(&rng, &bt, bt.difficulty[0], bt.nonce) == VEOK) {
+            if (__atomic_exchange_n(&work->solved, 1, __ATOMIC_ACQ_REL) == 0) {
+               memcpy(&work->solve, &bt, sizeof(BTRAILER));
+            }
+            return NULL;
+         }
+         clock_gettime(CLOCK_MONOTONIC, &now);
+         elapsed = difftime(now.tv_sec, start.tv_sec) +
+            (double) (now.tv_nsec - start.tv_nsec) / 1e9;
+      } while (Running && elapsed * 100.0 < Mineduty &&
+         !__atomic_load_n(&work->solved, __ATOMIC_ACQUIRE));
+      /* idle for remainder of period */
+      if (Running && elapsed < 1.0) {
+         millisleep((word32) ((1.0 - elapsed) * 1000.0));
+      }
+   }
+
+   return NULL;
+}  /* end miner_thread() */
+
+/**
+ * Passive mining worker. Solve the candidate block, @a fname, using up to
+ * Minethreads threads for Mineduty percent of each second. A solved block
+ * is handed to the server as "mblock.dat", leaving @a fname unchanged.
+ * @param fname Filename of candidate block to solve
+ * @returns VEOK on solve, else VERROR
+ * @note Runs in a child process, so uses POSIX threads over OpenMP.
+ * An OpenMP thread pool of the parent does not survive fork().
+*/
+int miner(const char *fname)
+{
+   pthread_t tid[256];
+   MINER_WORK work;
+   int j, n;
+
+   /* read candidate block trailer and init */
+   if (read_trailer(&work.bt, fname) != VEOK) return VERROR;
+   peach_init(&work.bt);
+   urandom(&work.seed, sizeof(work.seed));
+   work.streams = 0;
+   work.solved = 0;
+
+   /* solve within budget (threads, duty cycle) */
+   for (n = 0; n < Minethreads; n++) {
+      if (pthread_create(&tid[n], NULL, miner_thread, &work) != 0) {
+         perrno("pthread_create() FAILURE");
+         break;
+      }
+   }
+   for (j = 0; j < n; j++) pthread_join(tid[j], NULL);
+   if (!work.solved) return VERROR;
+
+   /* hand solve to server (as mblock.dat) */
+   if (b_mined(&work.solve, fname) != VEOK) {
+      perrno("miner() handoff FAILURE");
+      return VERROR;
+   }
+
+   return VEOK;
+}  /* end miner() */
+
+/**
+ * Start the passive miner (child process) on "cblock.dat", and push
+ * "cblock.dat" work to work server subscribers.
+ * Any running passive miner is stopped first. The server owns shared
+ * Peach Maps; only that of "cblock.dat" is kept, and tiles left claimed
+ * by a stopped miner are released.
+ * @returns Process id of passive miner, or 0 if not started
+*/
+int start_miner(void)
+{
+   BTRAILER bt;
+
+   stop_miner();
+   if (wserv_work("cblock.dat") != VEOK) perrno("wserv_work() FAILURE");
+   if (read_trailer(&bt, "cblock.dat") == VEOK) {
+      peach_shm_sweep(bt.phash);
+      peach_shm_reclaim(bt.phash);
+   }
+   if (Minethreads == 0 || !fexistsnz("cblock.dat")) return 0;
+   Miner_pid = fork();
+   if (Miner_pid == -1) {
+      perr("Cannot fork() for miner()");
+      Miner_pid = 0;
+   } else if (Miner_pid == 0) {
+      /* in child */
+      exit(miner("cblock.dat") == VEOK ? 0 : 1);  /* child exits */
+   }
+   return Miner_pid;
+}  /* end start_miner() */
+
 int start_bcon(void)
 {
+   stop_miner();  /* candidate block is replaced */
    put64(Bcbnum, Cblocknum);  /* save current block number */
    Bcon_pid = fork();
    if (Bcon_pid == -1) {
@@ -609,6 +738,74 @@ int start_bcon(void)
    return Bcon_pid;
 }
 
+/**
+ * Execute a peer request that gettx() could not answer inline.
+ * Called by request worker threads -- see workq_init().
+ * Temporary file names are unique per connection (socket).
+ * @param np Pointer to (handshaked) NODE of request
+ * @returns Request status, VEBAD or VEBAD2 where peer was bad
+ */
+int execute(NODE *np)
+{
+   char fname[FILENAME_MAX];
+   word16 opcode;
+   int status;
+
+   opcode = get16(np->tx->opcode);
+   pdebug("opcode = %d", opcode);
+   switch (opcode) {
+      case OP_FOUND:
+         /* get the advertised found block -- synchronous
+          * Blockfound was set by gettx()
+          */
+         sock_close(np->sd);  /* close initial connection */
+         np->sd = INVALID_SOCKET;
+         status = get_file(np->ip, np->tx->cblock, "rblock.dat");
+         break;
+      case OP_GET_BLOCK:
+         /* send np->tx->blocknum to peer */
+         status = send_file(np, NULL);
+         break;
+      case OP_GET_TFILE:
+         /* send out tfile.dat to peer */
+         status = send_file(np, "tfile.dat");
+         break;
+      case OP_GET_CBLOCK:
+         /* send out cblock.dat to peer via file copy */
+         status = fexists("cblock.dat") ? VEOK : VERROR;
+         if (status == VEOK) {
+            sprintf(fname, "cb%u.tmp", (unsigned) np->sd);
+            status = fcopy("cblock.dat", fname);
+            if (status == VEOK) {
+               status = send_file(np, fname);
+               remove(fname);
+            }
+         }
+         break;
+      case OP_MBLOCK:
+         /* receive mined block as mblock.dat from peer */
+         sprintf(fname, "rx%u.tmp", (unsigned) np->sd);
+         status = recv_file(np, fname);
+         if (status != VEOK || fexists("mblock.dat")) {
+            remove(fname);
+         } else {
+            rename(fname, "mblock.dat");
+            ftouch("cblock.lck");
+         }
+         break;
+      case OP_TF:
+         /* send tfile.dat section to peer */
+         status = send_tf(np);
+         break;
+      default:
+         metrics_inc(METRICS_BADLOGS);  /* bad OP's */
+         pdebug("bad opcode: %d", opcode);
+         status = VEBAD;
+   }  /* end switch op */
+
+   return status;
+}  /* end execute() */
+
 /**
  * The Mochimo Server/Client!
  *
@@ -621,27 +818,22 @@ int server(int reuse_addr)
    static time_t Ltime;
    static time_t Stime;    /* status display update time */
    static time_t nsd_time;  /* event timers */
-   static time_t bctime, mtime, mqtime, sftime, vtime;
+   static time_t bctime, mqtime, sftime, vtime;
    static time_t ipltime;
    static SOCKET lsd, nsd;
-   static NODE *np, node;
+   static NODE node;
+   static WORKQ_DONE done;  /* request completion record */
    static struct sockaddr_in addr;
    static int status;   /* child return status */
    static pid_t pid;    /* child pid */
    static int lfd;      /* for lock() */
-   static word16 opcode;
-   char fname[FILENAME_MAX];
-
-   /* passive mining stuff */
-   BTRAILER bt;
-   FILE *fp;
+   word64 start;        /* request handling start time */
 
    /* Initialise event timers */
    Ltime = time(NULL);      /* real time GMT in seconds */
    Stime = Ltime + 10;      /* status display time */
    bctime = Ltime + 30;     /* block constructor time */
    mqtime = Ltime + 10;     /* mirror() time */
-   mtime = Ltime + 5;       /* miner time */
    Utime = Ltime;           /* for watchdog timer */
    Watchdog = BRIDGEv3 + (rand16() % 600);
    ipltime = Ltime + (rand16() % 300) + 10;  /* ip list fetch time */
@@ -680,6 +872,24 @@ int server(int reuse_addr)
    listen(lsd, LQLEN);  /* LQSIZ */
    nsd = INVALID_SOCKET;
 
+   /* start request worker threads */
+   if (workq_init(Reqthreads, MAXNODES, execute) != VEOK) {
+      restart("workq_init() failed");
+   }
+
+   /* start work server, where enabled */
+   if (Workport) {
+      if (wserv_init(Workport, Workdiff) != VEOK) {
+         perrno("wserv_init(%d) FAILURE", Workport);
+      } else plog("Work server on port %d...", Workport);
+   }
+   /* start metrics endpoint, where enabled */
+   if (Metricsport) {
+      if (metrics_listen(Metricsport) != VEOK) {
+         perrno("metrics_listen(%d) FAILURE", Metricsport);
+      } else plog("Metrics on 127.0.0.1:%d...", Metricsport);
+   }
+
    if (Safemode && !iszero(Cblocknum, 8)) {
       plog("\nSafemode...\n");
       send_found();
@@ -699,43 +909,40 @@ int server(int reuse_addr)
 
       show("listen");  /* display status for ps */
 
-      /* Reap zombies and collect status.
-       * No child left behind...
+      /* Collect request completions and status.
+       * No request left behind...
        */
-      for(np = Nodes; np < Hi_node; np++) {
-         if(np->pid == 0) continue;
-         pid = waitpid(np->pid, &status, WNOHANG);
-         if(pid <= 0) continue;  /* child still running or signal */
-         freeslot(np);
-         opcode = get16(np->tx.opcode);
-         pdebug("np->pid: %d  pid: %d  status: 0x%x  op: %" P16u "  (%d)",
-                        np->pid, pid, status, opcode, errno);  /* debug */
-         /* Adds to lists if needed and returns exit status 0-3 */
-         status = child_status(np, pid, status);
-         if(opcode == OP_FOUND) {
+      while (workq_collect(&done)) {
+         pdebug("ip: %s  status: %d  op: %" P16u "  (%d)",
+            ntoa(&done.ip, NULL), done.status, done.opcode, done.errnum);
+         /* Adds to lists if needed */
+         if (done.status >= VEBAD) epinklist(done.ip);
+         if (done.status >= VEBAD2) pinklist(done.ip);
+         if(done.opcode == OP_FOUND) {
             if(Blockfound == 0) perr("line %d", __LINE__);
             else {
                /* exit services */
                stop_bcon();
+               stop_miner();
                stop_found();
                /* update recv'd block */
                if(b_update("rblock.dat") == VEOK) {
                   send_found();  /* start send_found() child */
-                  addrecent(np->ip);   /* v.28 */
+                  addrecent(done.ip);  /* v.28 */
                   Stime = Ltime + 20;  /* hold status display */
                }
                /* check txclean.dat contains transactions */
                if (fexistsnz("txclean.dat")) start_bcon();
                Blockfound = 0;
             }
-         }  /* end if OP_FOUND child */
-         else if(opcode == OP_GET_BLOCK || opcode == OP_GET_TFILE) {
+         }  /* end if OP_FOUND request */
+         else if(done.opcode == OP_GET_BLOCK || done.opcode == OP_GET_TFILE) {
             /* only add those that "optin" with a successful op */
-            if (status == 0 && np->tx.version[1] & C_OPTIN) {
-               addrecent(np->ip);
+            if (done.status == VEOK && done.optin) {
+               addrecent(done.ip);
             }
          }
-      }  /* end for check Node[] zombies */
+      }  /* end while collect completions */
 
       /* Reap a send_found() child.  If she is done, pid != 0. */
       if(Found_pid > 0) {
@@ -758,98 +965,41 @@ int server(int reuse_addr)
       if(nsd != INVALID_SOCKET) {
          /* gettx() completes the initial handshake and fills node
           * and some parent tables.  It returns -1 if no data yet.
-          * If gettx() completes the transaction, it returns 0, 1, 2, or 3;
-          * otherwise it returns sizeof(TX) and needs help from child
-          * so getslot() allocates a new np and copies node into it.
+          * If gettx() completes the transaction, it returns 1, 2, or 3;
+          * otherwise it returns 0 (VEOK) and needs help from a worker,
+          * so workq_submit() queues node (and its connection).
           */
+         start = metrics_time();
          status = gettx(&node, nsd);  /* fills in node */
          if(status != -1) {
-            if(status == VEOK && (np = getslot(&node)) != NULL) {
-               pid = fork();  /* create child to handle TX */
-               if(pid == 0) {
-                  /* in child -- execute() */
-                  opcode = get16(np->tx.opcode);
-                  pdebug("opcode = %d", opcode);
-                  switch (opcode) {
-                     case OP_FOUND:
-                        /* get the advertised found block -- synchronous
-                        * Blockfound was set by gettx()
-                        */
-                        sock_close(np->sd);  /* close initial connection */
-                        status =
-                           get_file(np->ip, np->tx.cblock, "rblock.dat");
-                        break;
-                     case OP_GET_BLOCK:
-                        /* send np->tx.blocknum to peer */
-                        status = send_file(np, NULL);
-                        break;
-                     case OP_GET_TFILE:
-                        /* send out tfile.dat to peer */
-                        status = send_file(np, "tfile.dat");
-                        break;
-                     case OP_GET_CBLOCK:
-                        /* send out cblock.dat to peer via file copy */
-                        status = fexists("cblock.dat") ? VEOK : VERROR;
-                        if (status == VEOK) {
-                           sprintf(fname, "cb%u.tmp", (unsigned) getpid());
-                           status = fcopy("cblock.dat", fname);
-                           if (status == VEOK) {
-                              status = send_file(np, fname);
-                              remove(fname);
-                           }
-                        }
-                        break;
-                     case OP_MBLOCK:
-                        /* receive mined block as mblock.dat from peer */
-                        status = recv_file(np, "mblock.tmp");
-                        if (status != VEOK || fexists("mblock.dat")) {
-                           remove("mblock.tmp");
-                        } else {
-                           rename("mblock.tmp", "mblock.dat");
-                           ftouch("cblock.lck");
-                        }
-                        break;
-                     case OP_TF:
-                        /* send tfile.dat section to peer */
-                        status = send_tf(np);
-                        break;
-                     default:
-                        Nbadlogs++;  /* bad OP's */
-                        pdebug("bad opcode: %d", opcode);
-                        status = VEBAD;
-                  }  /* end switch op */
-                  sock_close(np->sd);
-                  /* IMPORTANT: the exit status MUST NOT be less than 0.
-                   * When the parent calls WEXITSTATUS(), only 8-bits of
-                   * the status are returned. VETIMEOUT results in an
-                   * underflow and (currently) causes pinklisted peers! */
-                  if (status < 0) status = VERROR;
-                  exit(status);  /* parent calls waitpid() for status */
+            if(status == VEOK) {
+               if (workq_submit(&node, start) != VEOK) {
+                  perrno("workq_submit() failed");
+                  Nspace++;
                }
-               /* parent puts valid child pid in parent table */
-               if(pid != -1) np->pid = pid;
-               else {
-                  /* fork() failed so freeslot() removes child data from
-                   * parent Node[] table.
-                   */
-                  freeslot(np);
-                  perr("fork() failed!");
-                  restart("cannot fork()");
-               }
-            }  /* end if need child and slot found */
-            /* parent closes its socket if gettx() did not */
+            } else if (node.tx) {
+               metrics_observe_op(get16(node.tx->opcode), start);
+            }
+            /* parent releases packet buffer unless handed to worker */
+            pkt_free(node.tx);
+            node.tx = NULL;
+            /* parent closes its socket unless handed to worker */
             if(node.sd != INVALID_SOCKET)
                sock_close(nsd);
             nsd = INVALID_SOCKET;
          } else {   /* status == -1 no data yet -- so check timeout */
             if(Ltime - nsd_time > INIT_TIMEOUT) {
                Ntimeouts++;  /* log statistics */
+               metrics_inc(METRICS_TIMEOUTS);
                sock_close(nsd);
                nsd = INVALID_SOCKET;
             }
          }  /* end if timeout */
       }  /* endif nsd valid */
 
+      /* service work server subscribers and submissions */
+      wserv_poll();
+
       Ngen++;  /* loop counter */
 
       /*
@@ -862,6 +1012,7 @@ int server(int reuse_addr)
          if(cmp64(Cblocknum, Bcbnum) == 0) {
             /* exit services */
             stop_bcon();
+            stop_miner();
             stop_found();
             /* We found a pushed block! Update... */
             if (b_update("mblock.dat") == VEOK) {
@@ -885,6 +1036,7 @@ int server(int reuse_addr)
          } else {
             /* exit services */
             stop_bcon();
+            stop_miner();
             stop_found();
             /* update pseudoblock */
             if (b_update("pblock.dat") != VEOK) {
@@ -927,44 +1079,17 @@ int server(int reuse_addr)
          pid = waitpid(Bcon_pid, &status, WNOHANG);
          if(pid > 0) {
             Bcon_pid = 0;  /* pid not zero means she is done. */
-            /* check cblock and prepare passive mining */
-            if (fexistsnz("cblock.dat")) {
-               /* make isolated copy, read trailer and init */
-               if (read_trailer(&bt, "cblock.dat") != VEOK) {
-                  perrno("read_trailer() FAILURE");
-               } else peach_init(&bt);
-            }
-         }
-      } else if (mtime != Ltime && fexistsnz("cblock.dat")) {
-         mtime = Ltime;
-         /* perform passive mining once every second */
-         if (peach_solve(&bt, bt.difficulty[0], bt.nonce) == VEOK) {
-            /* record solve time and hash block trailer */
-            if (get32(bt.time0) == (word32) time(NULL)) {
-               put32(bt.stime, (word32) time(NULL) + 1);
-            } else put32(bt.stime, (word32) time(NULL));
-            sha256(&bt, sizeof(BTRAILER) - HASHLEN, bt.bhash);
-            /* rewrite block trailer to disk */
-            fp = fopen("cblock.dat", "r+b");
-            if (fp == NULL) {
-               perrno("fopen() FAILURE");
-            } else if (fseek64(fp, -(sizeof(BTRAILER)), SEEK_END) != 0) {
-               perrno("fseek64() FAILURE");
-               fclose(fp);
-            } else if (fwrite(&bt, sizeof(BTRAILER), 1, fp) != 1) {
-               perrno("fwrite() FAILURE");
-               fclose(fp);
-            } else {
-               fclose(fp);
-               /* check for and trigger mined block update */
-               if (!fexists("mblock.dat")) {
-                  rename("cblock.dat", "mblock.dat");
-                  ftouch("cblock.lck");
-               }
-            }
+            /* start passive mining on (new) cblock */
+            start_miner();
          }
       }
 
+      /* Reap the passive miner.  Solves arrive as mblock.dat. */
+      if(Miner_pid > 0) {
+         pid = waitpid(Miner_pid, &status, WNOHANG);
+         if(pid > 0) Miner_pid = 0;
+      }
+
       /* Start mirror()? */
       if(Ltime >= mqtime && Mqcount > 0 && Mqpid == 0) {
          /* get exclusive access to txq1.dat */
@@ -1026,6 +1151,10 @@ int server(int reuse_addr)
    /* cleanup */
    plog("Server exiting, please wait...");
    sock_close(lsd);  /* close listening socket */
+   workq_abort();    /* abort running requests */
+   workq_free();     /* stop request worker threads */
+   wserv_free();     /* close work server */
+   metrics_free();   /* close metrics endpoint */
 
    return 0;
 } /* end server() */
@@ -1127,10 +1256,26 @@ int usage(void)
       "\n\nOPTIONS (advanced):"
       "\n -m, --maddr <ADDR>"
       "\n       set mining address to ADDR (Mochimo Wallet Address)"
+      "\n   --metrics-port <port>"
+      "\n       enable metrics endpoint (Prometheus) on 127.0.0.1:port"
+      "\n   --mining-duty <percent>"
+      "\n       duty cycle of each mining thread, in percent (default 100)"
+      "\n   --mining-threads <num>"
+      "\n       passive mining threads (default 0, disabled)"
+      "\n   --pinklist-size <num>"
+      "\n       pinklist capacity, in ip addresses (default 4096)"
+      "\n   --request-threads <num>"
+      "\n       peer request worker threads (default 8)"
       "\n   --reuse-addr"
       "\n       enable listening server socket option SO_REUSEADDR"
+      "\n   --snapshot"
+      "\n       export ledger snapshot (snapshot.dat) on each neogenesis"
       "\n   --txbot"
       "\n       enable local transaction bot (REQUIRES FUNDING)"
+      "\n   --work-diff <diff>"
+      "\n       work server share difficulty, 0 for solves only (default 0)"
+      "\n   --work-port <port>"
+      "\n       enable work server for local miners on port"
 #ifdef BX_MYSQL
       "\n   -X         Export to MySQL database on block update"
 #endif
@@ -1218,11 +1363,66 @@ int main(int argc, char **argv)
                maddr_chk[16], maddr_chk[17], maddr_chk[18], maddr_chk[19]);
             continue; /* next arg */
          }
+         if (argument(argv[j], NULL, "--metrics-port")) {
+            /* set metrics endpoint port and continue */
+            argp = argvalue(&j, argc, argv);
+            if (argp == NULL || atoi(argp) < 1 || atoi(argp) > 65535) {
+               perr("invalid metrics endpoint port (1-65535)");
+               return EXIT_FAILURE;
+            }
+            Metricsport = (word16) atoi(argp);
+            continue;
+         }
+         if (argument(argv[j], NULL, "--mining-duty")) {
+            /* set passive mining duty cycle and continue */
+            argp = argvalue(&j, argc, argv);
+            if (argp == NULL || atoi(argp) < 1 || atoi(argp) > 100) {
+               perr("invalid mining duty cycle (1-100)");
+               return EXIT_FAILURE;
+            }
+            Mineduty = (word8) atoi(argp);
+            continue;
+         }
+         if (argument(argv[j], NULL, "--mining-threads")) {
+            /* set passive mining threads and continue */
+            argp = argvalue(&j, argc, argv);
+            if (argp == NULL || atoi(argp) < 0 || atoi(argp) > 255) {
+               perr("invalid mining threads (0-255)");
+               return EXIT_FAILURE;
+            }
+            Minethreads = (word8) atoi(argp);
+            continue;
+         }
+         if (argument(argv[j], NULL, "--pinklist-size")) {
+            /* set pinklist capacity and continue */
+            argp = argvalue(&j, argc, argv);
+            if (argp == NULL || atol(argp) < 1 || atol(argp) > 1048576) {
+               perr("invalid pinklist size (1-1048576)");
+               return EXIT_FAILURE;
+            }
+            Pinklistlen = (word32) atol(argp);
+            continue;
+         }
+         if (argument(argv[j], NULL, "--request-threads")) {
+            /* set request worker threads and continue */
+            argp = argvalue(&j, argc, argv);
+            if (argp == NULL || atoi(argp) < 1 || atoi(argp) > 255) {
+               perr("invalid request threads (1-255)");
+               return EXIT_FAILURE;
+            }
+            Reqthreads = (word8) atoi(argp);
+            continue;
+         }
          if (argument(argv[j], NULL, "--reuse-addr")) {
             /* set reuse_addr option and continue */
             reuse_addr = 1;
             continue;
          }
+         if (argument(argv[j], NULL, "--snapshot")) {
+            /* set ledger snapshot export option and continue */
+            Snapshotflag = 1;
+            continue;
+         }
          if (argument(argv[j], NULL, "--txbot")) {
             /* set tx-bot option and continue */
             if (tx_bot_activate(seeds, sizeof(seeds)) != VEOK) {
@@ -1231,6 +1431,26 @@ int main(int argc, char **argv)
             }
             continue;
          }
+         if (argument(argv[j], NULL, "--work-diff")) {
+            /* set work server share difficulty and continue */
+            argp = argvalue(&j, argc, argv);
+            if (argp == NULL || atoi(argp) < 0 || atoi(argp) > 255) {
+               perr("invalid work server share difficulty (0-255)");
+               return EXIT_FAILURE;
+            }
+            Workdiff = (word8) atoi(argp);
+            continue;
+         }
+         if (argument(argv[j], NULL, "--work-port")) {
+            /* set work server port and continue */
+            argp = argvalue(&j, argc, argv);
+            if (argp == NULL || atoi(argp) < 1 || atoi(argp) > 65535) {
+               perr("invalid work server port (1-65535)");
+               return EXIT_FAILURE;
+            }
+            Workport = (word16) atoi(argp);
+            continue;
+         }
       } else return usage();
       /* legacy argument parsing */
       switch(argv[j][1]) {
@@ -1327,6 +1547,12 @@ int main(int argc, char **argv)
    }  /* end for j */
 EOA:  /* end of arguments */
 
+   /* write logs asynchronously, off server (and OpenMP sync) threads */
+   if (setplogasync(1) != VEOK) perrno("setplogasync() FAILURE");
+   /* metrics in shared memory, before any (child) processes */
+   if (metrics_init() != VEOK) perrno("metrics_init() FAILURE");
+   if (pstat_init() != VEOK) perrno("pstat_init() FAILURE");
+
    /* print (and log) copyright and version information */
    plog(EXEC_NAME ", built " __DATE__ " " __TIME__);
    plog("Copyright (c) 2024 Adequate Systems, LLC.  All Rights Reserved.");
@@ -1347,9 +1573,12 @@ EOA:  /* end of arguments */
          stop_mirror();
          stop_found();
          stop_bcon();
+         stop_miner();
+         peach_shm_sweep(NULL);  /* remove shared Peach Maps */
          /* save dynamic peer lists */
          save_ipl(Opt_rplistfile, Rplist, RPLISTLEN);
-         save_ipl(Opt_eplistfile, Epinklist, EPINKLEN);
+         save_pinkl(Opt_eplistfile);
+         pstat_save(Opt_pstatfile);
       }
    }
 
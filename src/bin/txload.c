@@ -0,0 +1,504 @@
+/**
+ * @private txload.c
+ * @brief Mochimo transaction load generator.
+ * @details Replays signed transactions (e.g. "txpending.dat", as written
+ * by chaingen) against a node, as OP_TX requests, at a configurable rate
+ * and concurrency. Each request is answered by the node with an empty
+ * OP_TX, where the transaction was accepted, or an OP_NACK holding the
+ * (error) name of the reason it was rejected. The latency of requests,
+ * from scheduled send time to reply, is recorded and a report of latency
+ * percentiles and the breakdown of NACK reasons is written as JSON,
+ * tagged with the build VERSION, for comparison between builds.
+ * <br />NOTE: latency is measured from the scheduled send time of each
+ * request, such that requests delayed by an overloaded node (at a fixed
+ * rate) are not omitted from the latency distribution.
+ * @copyright Adequate Systems LLC, 2018-2022. All Rights Reserved.
+ * <br />For license information, please refer to ../LICENSE.md
+*/
+
+#ifndef MOCHIMO_TXLOAD_C
+#define MOCHIMO_TXLOAD_C
+
+
+/* internal support */
+#include "types.h"   /* for standard mochimo datatypes */
+#include "network.h" /* for packet support */
+#include "metrics.h" /* for monotonic time */
+#include "tx.h"      /* for transaction support */
+#include "global.h"  /* for node state */
+#include "error.h"   /* for error codes */
+
+/* external support */
+#include "extinet.h"
+#include "extlib.h"
+
+/* system support */
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+
+#ifndef VERSION
+   #define VERSION "<no-version>"
+
+#endif
+
+/* request results */
+#define RESULT_ACCEPT   0
+#define RESULT_REJECT   1
+#define RESULT_ERROR    2
+
+/* request result, latency and NACK reason */
+typedef struct {
+   word64 latency;   /* microseconds */
+   int result;       /* RESULT_* */
+   char nack[32];    /* error name of OP_NACK */
+} TXRESULT;
+
+/* transactions (without trailer) to replay */
+static word8 *Txbuf;
+static size_t *Txoffset;
+static size_t Ntx;
+
+/**
+ * @private
+ * Read signed transactions to replay, from a file. Trailers are dropped,
+ * as per the transaction bot.
+ * @param fname Name of file to read transactions from
+ * @return (int) value representing operation result
+ * @retval VERROR on error; check errno for details
+ * @retval VEOK on success
+ */
+static int read_txs(const char *fname)
+{
+   TXENTRY txe;
+   FILE *fp;
+   void *ptr;
+   size_t len, size, space;
+
+   fp = fopen(fname, "rb");
+   if (fp == NULL) return VERROR;
+
+   /* read transactions into (growing) contiguous buffer */
+   for (Ntx = size = space = 0; tx_fread(&txe, fp) == VEOK; Ntx++) {
+      len = txe.tx_sz - sizeof(TXTLR);
+      if (size + len > space) {
+         space = (space + len) * 2;
+         ptr = realloc(Txbuf, space);
+         if (ptr == NULL) goto FAIL;
+         Txbuf = ptr;
+      }
+      /* grow offsets at powers of 2, retaining space for end offset */
+      if ((Ntx & (Ntx - 1)) == 0) {
+         ptr = realloc(Txoffset, ((Ntx * 2) + 2) * sizeof(*Txoffset));
+         if (ptr == NULL) goto FAIL;
+         Txoffset = ptr;
+      }
+      memcpy(Txbuf + size, txe.buffer, len);
+      Txoffset[Ntx] = size;
+      size += len;
+   }
+   if (ferror(fp)) goto FAIL;
+   fclose(fp);
+
+   if (Ntx == 0) {
+      set_errno(EMCM_TX0);
+      return VERROR;
+   }
+   Txoffset[Ntx] = size;
+
+   return VEOK;
+
+   /* cleanup / error handling */
+FAIL:
+   fclose(fp);
+
+   return VERROR;
+}  /* end read_txs() */
+
+/**
+ * @private
+ * Call node and complete Three-Way handshake, as per callserver(). The
+ * connection is left blocking (with a receive timeout), such that replies
+ * are received as soon as they arrive.
+ * @param np Pointer to NODE to hold connection
+ * @param ip IPv4 address of node
+ * @param id Handshake ID, for request identification
+ * @return (int) value representing operation result
+ * @retval VEBAD on bad handshake
+ * @retval VERROR on error; check errno for details
+ * @retval VEOK on success
+ */
+static int call_node(NODE *np, word32 ip, word16 id)
+{
+   struct timeval tv = { STD_TIMEOUT, 0 };
+   int ecode;
+
+   memset(np, 0, sizeof(NODE));
+   np->ip = ip;
+   ntoa(&ip, np->id);
+   np->tx = pkt_alloc(0);
+   if (np->tx == NULL) return VERROR;
+   ecode = VERROR;
+   np->sd = sock_connect_ip(ip, Dstport, INIT_TIMEOUT);
+   if (np->sd == INVALID_SOCKET) goto FAIL;
+   if (sock_set_blocking(np->sd) == SOCKET_ERROR) goto FAIL;
+   if (setsockopt(np->sd, SOL_SOCKET, SO_RCVTIMEO,
+         (void *) &tv, sizeof(tv)) != 0) goto FAIL;
+
+   /* hello? */
+   np->id1 = id;
+   put16(np->tx->opcode, OP_HELLO);
+   if (send_tx(np, STD_TIMEOUT) != VEOK) goto FAIL;
+   if (recv_tx(np, STD_TIMEOUT) != VEOK) goto FAIL;
+   ecode = VEBAD;
+   if (get16(np->tx->opcode) != OP_HELLO_ACK) goto FAIL;
+   if (get16(np->tx->id1) != np->id1) goto FAIL;
+   np->id2 = get16(np->tx->id2);
+
+   return VEOK;
+
+   /* cleanup / error handling */
+FAIL:
+   node_close(np);
+
+   return ecode;
+}  /* end call_node() */
+
+/**
+ * @private
+ * Send a transaction to a node, as OP_TX, and receive the reply.
+ * @param np Pointer to NODE to send with
+ * @param ip IPv4 address of node
+ * @param idx Index of request
+ * @param res Pointer to place request result
+ */
+static void send_request(NODE *np, word32 ip, size_t idx, TXRESULT *res)
+{
+   const word8 *tx;
+   size_t len;
+
+   res->result = RESULT_ERROR;
+   if (call_node(np, ip, (word16) (idx + 1)) != VEOK) return;
+
+   /* send (cycled) transaction */
+   idx %= Ntx;
+   tx = Txbuf + Txoffset[idx];
+   len = Txoffset[idx + 1] - Txoffset[idx];
+   if (node_reserve(np, len) == VEOK) {
+      memcpy(np->tx->buffer, tx, len);
+      put16(np->tx->len, (word16) len);
+      if (send_op(np, OP_TX) == VEOK && recv_tx(np, STD_TIMEOUT) == VEOK) {
+         switch (get16(np->tx->opcode)) {
+            case OP_TX: res->result = RESULT_ACCEPT; break;
+            case OP_NACK:
+               res->result = RESULT_REJECT;
+               strncpy(res->nack, (char *) np->tx->buffer + 8,
+                  sizeof(res->nack) - 1);
+               break;
+         }  /* end switch */
+      }
+   }
+
+   node_close(np);
+}  /* end send_request() */
+
+/**
+ * @private
+ * Compare request results by result, then NACK name.
+ */
+static int result_compare(const void *a, const void *b)
+{
+   const TXRESULT *ra = (const TXRESULT *) a;
+   const TXRESULT *rb = (const TXRESULT *) b;
+
+   if (ra->result != rb->result) return ra->result - rb->result;
+   return strcmp(ra->nack, rb->nack);
+}  /* end result_compare() */
+
+/**
+ * @private
+ * Compare latencies, ascending.
+ */
+static int latency_compare(const void *a, const void *b)
+{
+   word64 la = *((const word64 *) a);
+   word64 lb = *((const word64 *) b);
+
+   if (la < lb) return -1;
+   return la > lb;
+}  /* end latency_compare() */
+
+/**
+ * @private
+ * Write latency count and percentiles of a result to a JSON report.
+ * @param fp Report file pointer
+ * @param name Name of result
+ * @param res Pointer to results
+ * @param count Number of results
+ * @param result Result type to report
+ */
+static void write_latency(FILE *fp, const char *name, const TXRESULT *res,
+   size_t count, int result)
+{
+   static const char *pctname[] = { "p50", "p90", "p99" };
+   static const double pct[] = { 0.50, 0.90, 0.99 };
+   word64 *lat;
+   size_t j, n, rank;
+   int i;
+
+   /* gather latencies of result, ordered */
+   lat = malloc((count ? count : 1) * sizeof(*lat));
+   for (n = j = 0; lat != NULL && j < count; j++) {
+      if (res[j].result == result) lat[n++] = res[j].latency;
+   }
+   if (n) qsort(lat, n, sizeof(*lat), latency_compare);
+
+   fprintf(fp, "  \"%s\": {\n", name);
+   fprintf(fp, "    \"count\": %lu", (unsigned long) n);
+   for (i = 0; n && i < (int) (sizeof(pct) / sizeof(*pct)); i++) {
+      /* nearest rank percentile */
+      rank = (size_t) (pct[i] * (double) n + 0.999999);
+      fprintf(fp, ",\n    \"%s\": %llu", pctname[i],
+         (unsigned long long) lat[rank ? rank - 1 : 0]);
+   }
+   if (n) {
+      fprintf(fp, ",\n    \"max\": %llu", (unsigned long long) lat[n - 1]);
+   }
+   fprintf(fp, "\n  },\n");
+   free(lat);
+}  /* end write_latency() */
+
+/**
+ * @private
+ * Write JSON report of request results.
+ * @param fname Name of report file
+ * @param res Pointer to results, sorted as per result_compare()
+ * @param count Number of results
+ * @param rate Rate of requests (per second), or zero if unlimited
+ * @param concurrency Number of concurrent requests
+ * @param elapsed Elapsed time of requests, in microseconds
+ * @return (int) value representing operation result
+ * @retval VERROR on error; check errno for details
+ * @retval VEOK on success
+ */
+static int write_report(const char *fname, TXRESULT *res, size_t count,
+   unsigned long rate, unsigned long concurrency, word64 elapsed)
+{
+   size_t j, n;
+   FILE *fp;
+   int first;
+
+   fp = fopen(fname, "w");
+   if (fp == NULL) return VERROR;
+
+   fprintf(fp, "{\n");
+   fprintf(fp, "  \"bench\": \"txload\",\n");
+   fprintf(fp, "  \"version\": \"%s\",\n", VERSION);
+   fprintf(fp, "  \"unit\": \"us\",\n");
+   fprintf(fp, "  \"rate\": %lu,\n", rate);
+   fprintf(fp, "  \"concurrency\": %lu,\n", concurrency);
+   fprintf(fp, "  \"requests\": %lu,\n", (unsigned long) count);
+   fprintf(fp, "  \"elapsed\": %llu,\n", (unsigned long long) elapsed);
+   fprintf(fp, "  \"throughput\": %.2f,\n", elapsed
+      ? (double) count * 1000000.0 / (double) elapsed : 0.0);
+   write_latency(fp, "accept", res, count, RESULT_ACCEPT);
+   write_latency(fp, "reject", res, count, RESULT_REJECT);
+   write_latency(fp, "error", res, count, RESULT_ERROR);
+   /* NACK reasons -- sorted by name */
+   fprintf(fp, "  \"nack\": {");
+   for (first = 1, j = 0; j < count; j += n) {
+      for (n = 1; j + n < count && res[j + n].result == res[j].result &&
+         strcmp(res[j + n].nack, res[j].nack) == 0; n++);
+      if (res[j].result != RESULT_REJECT) continue;
+      fprintf(fp, "%s\n    \"%s\": %lu", first ? "" : ",",
+         res[j].nack[0] ? res[j].nack : "<unknown>", (unsigned long) n);
+      first = 0;
+   }
+   fprintf(fp, "%s}\n", first ? "" : "\n  ");
+   fprintf(fp, "}\n");
+
+   return fclose(fp) == 0 ? VEOK : VERROR;
+}  /* end write_report() */
+
+void print_usage(void)
+{
+   fprintf(stdout,
+      "usage: txload [options]\n"
+      "   -c, --concurrency <num>  concurrent requests (connections)\n"
+      "   -f, --file <file>        signed transactions to replay\n"
+      "   -i, --ip <ipv4>          address of node to send to\n"
+      "   -l, --log-level <num>    level of detail in logging (0-5)\n"
+      "   -n, --requests <num>     requests to send (cycles transactions)\n"
+      "   -o, --output <file>      output file of JSON report\n"
+      "   -p, --port <num>         port of node to send to\n"
+      "   -r, --rate <num>         requests per second (0 = unlimited)\n\n"
+   );
+}  /* end print_usage() */
+
+int main(int argc, char *argv[])
+{
+   TXRESULT *res;
+   word64 start, elapsed;
+   unsigned long argu;
+   unsigned long concurrency, rate, requests;
+   size_t count, j;
+   char *fname, *output, *argp;
+   word32 ip;
+   int argi;
+
+   /* logging setup */
+   setploglevel(PLOG_INFO);
+
+   /* init - defaults */
+   concurrency = 8;
+   fname = "txpending.dat";
+   ip = aton("127.0.0.1");
+   output = "txload.json";
+   rate = 0;
+   requests = 0;
+
+/* ARGUMENT MACROs */
+#define GET_ARGP_OR_EXIT_FAILURE(ARGP) \
+   do { \
+      ARGP = argvalue(&argi, argc, argv); \
+      if (ARGP == NULL) { \
+         perr("missing value"); \
+         return EXIT_FAILURE; \
+      } \
+   } while (0)
+#define GET_ARGU_OR_EXIT_FAILURE(ARGP, ARGU) \
+   do { \
+      GET_ARGP_OR_EXIT_FAILURE(ARGP); \
+      pdebug("    parsing value: %s", ARGP); \
+      ARGU = strtoul(ARGP, NULL, 0); \
+      if (errno == ERANGE) { \
+         perrno("invalid value"); \
+         return EXIT_FAILURE; \
+      } \
+   } while (0)
+
+   /* parse command line arguments */
+   for (argi = 1; argi < argc; argi++) {
+      /* ARGUMENT OPTIONS */
+      if (argv[argi][0] == '-') {
+         if (argument(argv[argi], "-c", "--concurrency")) {
+            GET_ARGU_OR_EXIT_FAILURE(argp, concurrency);
+            continue;
+         }
+         if (argument(argv[argi], "-f", "--file")) {
+            GET_ARGP_OR_EXIT_FAILURE(fname);
+            continue;
+         }
+         if (argument(argv[argi], "-i", "--ip")) {
+            GET_ARGP_OR_EXIT_FAILURE(argp);
+            ip = aton(argp);
+            continue;
+         }
+         if (argument(argv[argi], "-l", "--log-level")) {
+            GET_ARGU_OR_EXIT_FAILURE(argp, argu);
+            setploglevel((int) argu);
+            continue;
+         }
+         if (argument(argv[argi], "-n", "--requests")) {
+            GET_ARGU_OR_EXIT_FAILURE(argp, requests);
+            continue;
+         }
+         if (argument(argv[argi], "-o", "--output")) {
+            GET_ARGP_OR_EXIT_FAILURE(output);
+            continue;
+         }
+         if (argument(argv[argi], "-p", "--port")) {
+            GET_ARGU_OR_EXIT_FAILURE(argp, argu);
+            Dstport = (word16) argu;
+            continue;
+         }
+         if (argument(argv[argi], "-r", "--rate")) {
+            GET_ARGU_OR_EXIT_FAILURE(argp, rate);
+            continue;
+         }
+      }
+      /* unrecognised argument, check usage */
+      print_usage();
+      return EXIT_FAILURE;
+   }  /* end command line arguments */
+
+   /* check arguments */
+   if (concurrency < 1 || concurrency > 1024) {
+      perr("concurrency must be within 1-1024");
+      return EXIT_FAILURE;
+   }
+   if (ip == 0 || Dstport == 0) {
+      perr("invalid node address or port");
+      return EXIT_FAILURE;
+   }
+
+   /* read transactions to replay */
+   if (read_txs(fname) != VEOK) {
+      perrno("failed to read transactions, %s", fname);
+      return EXIT_FAILURE;
+   }
+   count = requests ? (size_t) requests : Ntx;
+
+   /* allocate request results */
+   res = calloc(count, sizeof(*res));
+   if (res == NULL) {
+      perrno("failed to allocate %lu requests", (unsigned long) count);
+      return EXIT_FAILURE;
+   }
+
+   sock_startup();
+   plog("Sending %lu requests (%lu transactions) to %s:%" P16u "...",
+      (unsigned long) count, (unsigned long) Ntx, ntoa(&ip, NULL), Dstport);
+
+   /* send requests, on schedule if rate limited */
+   start = metrics_time();
+#pragma omp parallel num_threads((int) concurrency)
+{
+   struct timespec ts;
+   word64 sched;
+   NODE *np;
+
+   /* NODE per thread -- packet buffers are large */
+   np = malloc(sizeof(NODE));
+
+#pragma omp for schedule(dynamic, 1)
+   for (long long i = 0; i < (long long) count; i++) {
+      sched = start;
+      if (rate) {
+         sched += (word64) i * 1000000 / rate;
+         ts.tv_sec = (time_t) (sched / 1000000);
+         ts.tv_nsec = (long) (sched % 1000000) * 1000;
+         clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+      } else sched = metrics_time();
+      if (np != NULL) send_request(np, ip, (size_t) i, &res[i]);
+      else res[i].result = RESULT_ERROR;
+      res[i].latency = metrics_time() - sched;
+   }
+
+   free(np);
+}  /* end omp parallel */
+   elapsed = metrics_time() - start;
+
+   /* summarize and report */
+   qsort(res, count, sizeof(*res), result_compare);
+   for (j = 0; j < count && res[j].result == RESULT_ACCEPT; j++);
+   plog("Sent %lu requests in %.3fs, %lu accepted",
+      (unsigned long) count, (double) elapsed / 1000000.0, (unsigned long) j);
+   if (write_report(output, res, count, rate, concurrency, elapsed) != VEOK) {
+      perrno("failed to write report, %s", output);
+      return EXIT_FAILURE;
+   }
+   plog("Wrote report to %s", output);
+
+   sock_cleanup();
+   free(res);
+   free(Txoffset);
+   free(Txbuf);
+
+   return EXIT_SUCCESS;
+}  /* end main() */
+
+/* end include guard */
+#endif
@@ -18,10 +18,13 @@
 #include "peer.h"
 #include "peach.h"
 #include "ledger.h"
+#include "metrics.h"
 #include "global.h"
 #include "error.h"
 #include "bval.h"
 #include "bcon.h"
+#include "bcomp.h"
+#include "snapshot.h"
 
 /* external support */
 #include <string.h>
@@ -75,6 +78,13 @@ static int accept_block(BTRAILER *bt, char *fname)
       return VERROR;
    }
 
+#ifdef ENABLE_BLOCK_COMPRESSION
+   /* compress archived block -- neogenesis blocks are left raw */
+   if (Cblocknum[0] != 0 && bc_compress(block_fpath) != VEOK) {
+      pwarn("failed to compress %s, left uncompressed", block_fpath);
+   }
+#endif
+
    return VEOK;
 }  /* end accept_block() */
 
@@ -130,6 +140,7 @@ int b_update(char *fname)
    BTRAILER bt;
    FILENAME block_fname;
    FILENAME clean_fname;
+   word64 start;
    int ecode;
 
    pdebug("updating block...");
@@ -139,6 +150,7 @@ int b_update(char *fname)
       pdebug("%s missing...", fname);
       return VERROR;
    }
+   start = metrics_time();
 
    /* Hotfix for critical bug identified on 09/26/19 */
    if (fexists("cblock.lck")) {
@@ -172,6 +184,7 @@ int b_update(char *fname)
    /* Update:
     * Cblockhash, Cblocknum, Prevhash, Difficulty, Time0, and tfile.dat
     */
+   mutex_lock(&Chainlock);
    if (add64(Cblocknum, One, Cblocknum)) {
       restart("new blocknum overflow");
    } else if (read_trailer(&bt, fname) != VEOK) {
@@ -180,6 +193,7 @@ int b_update(char *fname)
    memcpy(Prevhash, Cblockhash, HASHLEN);
    memcpy(Cblockhash, bt.bhash, HASHLEN);
    add_weight(Weight, bt.difficulty[0]);
+   mutex_unlock(&Chainlock);
    /* Update block difficulty */
    Difficulty = next_difficulty(&bt);
    Time0 = get32(bt.stime);
@@ -201,6 +215,7 @@ int b_update(char *fname)
    if (Ininit == 0) {
       if (Insyncup == 0) {
          Nupdated++;  /* block update counter */
+         metrics_inc(METRICS_UPDATED);
       }
       Utime = time(NULL);  /* update time for watchdog */
    }  /* end if not-Ininit */
@@ -217,14 +232,25 @@ int b_update(char *fname)
       if (neogen(&bt, "ledger.dat", "ngblock.dat") != VEOK) {
          perrno("neogen() FAILURE");
          restart("failed to neogen()");
-      } else if (add64(Cblocknum, One, Cblocknum)) {
-         restart("neogenesis blocknum overflow");
       } else if (read_trailer(&bt, "ngblock.dat") != VEOK) {
          restart("failed to read_trailer(ngblock.dat)");
       }
+      mutex_lock(&Chainlock);
+      if (add64(Cblocknum, One, Cblocknum)) {
+         restart("neogenesis blocknum overflow");
+      }
       memcpy(Prevhash, Cblockhash, HASHLEN);
       memcpy(Cblockhash, bt.bhash, HASHLEN);
+      mutex_unlock(&Chainlock);
       Eon++;
+      /* export ledger snapshot for bootstrapping nodes -- as necessary */
+      if (Snapshotflag) {
+         if (snap_export("ngblock.dat", "snapshot.tmp") != VEOK) {
+            perrno("snap_export() FAILURE");
+         } else if (rename("snapshot.tmp", "snapshot.dat") != 0) {
+            perrno("failed to rename snapshot.dat");
+         }
+      }
       /* add neogenesis block trailer to tfile and accept block */
       if (accept_block(&bt, "ngblock.dat") != VEOK) {
          restart("failed to accept block");
@@ -246,9 +272,8 @@ int b_update(char *fname)
       if(!Bgflag) print_bup(&bt);
    }
 
-   /* update pinklists */
+   /* update pinklist */
    if ((Cblocknum[0] & EPOCHMASK) == 0) purge_epoch();
-   mergepinklists();
    /* trigger synchronous external update - if available */
    if (Ininit == 0 && fexists("../update-external.sh")) {
       system("../update-external.sh");
@@ -274,6 +299,7 @@ CLEANUP:
          remove("txclean.dat");
       }
    }
+   metrics_observe(METRICS_B_UPDATE, start);
 
    return ecode;
 }  /* end b_update() */
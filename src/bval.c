@@ -19,9 +19,11 @@
 #include "tfile.h"
 #include "peach.h"
 #include "ledger.h"
+#include "metrics.h"
 #include "global.h"
 #include "error.h"
 #include "bcon.h"
+#include "bcomp.h"
 
 /* external support */
 #include <string.h>
@@ -47,22 +49,22 @@
 */
 int ng_val(const char *ngfile, const word8 bnum[8])
 {
-   LENTRY le;
+   MERKLE_CTX mctx;
+   LENTRY *buf;
    NGHEADER ngh;
    BTRAILER bt, tft;
    long long len;
    word64 lbytes;
-   size_t j, lcount;
+   size_t j, k, n, lcount;
    word8 prev_addr[ADDR_LEN];
    word8 mroot[HASHLEN];
    word8 amounts[8];
    word8 rewards[8];
-   word8 *mtree;
    FILE *fp;
    int ecode;
 
    /* init */
-   mtree = NULL;
+   buf = NULL;
 
    /* open file for validation */
    fp = fopen(ngfile, "rb");
@@ -124,41 +126,46 @@ int ng_val(const char *ngfile, const word8 bnum[8])
       }
    }
 
-   /* malloc merkle tree */
+   /* malloc ledger entry buffer and init merkle tree */
    lcount = lbytes / sizeof(LENTRY);
-   mtree = malloc(lcount * HASHLEN);
-   if (mtree == NULL) goto ERROR_CLEANUP;
+   buf = malloc(LEBUFCOUNT * sizeof(LENTRY));
+   if (buf == NULL) goto ERROR_CLEANUP;
+   merkle_init(&mctx, lcount);
 
    /* init amounts before summing */
    memset(amounts, 0, 8);
 
-   /* read neogenesis ledger data... */
-   for (j = 0; j < lcount; j++) {
-      if (fread(&le, sizeof(LENTRY), 1, fp) != 1) goto RDERR_CLEANUP;
-      /* check ledger sort -- skip on first read */
-      if (j > 0 && memcmp(le.addr, prev_addr, ADDR_LEN) <= 0) {
-         set_errno(EMCM_LESORT);
-         goto DROP_CLEANUP;
-      }
-      /* update amounts sum, ensure no overflow */
-      if (add64(amounts, le.balance, amounts)) {
-         set_errno(EMCM_MATH64_OVERFLOW);
-         goto DROP_CLEANUP;
+   /* read neogenesis ledger data (buffered)... */
+   for (j = 0; j < lcount; j += n) {
+      n = (lcount - j) < LEBUFCOUNT ? (lcount - j) : LEBUFCOUNT;
+      if (fread(buf, sizeof(LENTRY), n, fp) != n) goto RDERR_CLEANUP;
+      for (k = 0; k < n; k++) {
+         /* check ledger sort -- skip on first read */
+         if ((j + k) > 0 && memcmp(buf[k].addr, prev_addr, ADDR_LEN) <= 0) {
+            set_errno(EMCM_LESORT);
+            goto DROP_CLEANUP;
+         }
+         /* update amounts sum, ensure no overflow */
+         if (add64(amounts, buf[k].balance, amounts)) {
+            set_errno(EMCM_MATH64_OVERFLOW);
+            goto DROP_CLEANUP;
+         }
+         /* store prev addr */
+         memcpy(prev_addr, buf[k].addr, ADDR_LEN);
       }
-      /* hash ledger entry directly into merkel tree -- store prev addr */
-      sha256(&le, sizeof(LENTRY), mtree + (j * HASHLEN));
-      memcpy(prev_addr, le.addr, ADDR_LEN);
+      /* hash ledger entries (in parallel) into merkle tree */
+      merkle_leaves(&mctx, buf, sizeof(LENTRY), n);
    }
 
    /* compute and validate Merkel Root */
-   merkle_root(mtree, lcount, mroot);
+   if (merkle_final(&mctx, mroot) != VEOK) goto ERROR_CLEANUP;
    if (memcmp(bt.mroot, mroot, HASHLEN) != 0) {
       set_errno(EMCM_MROOT);
       goto DROP_CLEANUP;
    }
 
    /* cleanup */
-   free(mtree);
+   free(buf);
    fclose(fp);
 
    /* check accurate sum of Tfile rewards against ledger amounts */
@@ -187,23 +194,18 @@ ERROR_CLEANUP:
 DROP_CLEANUP:
    ecode = VEBAD2;
 CLEANUP:
-   if (mtree) free(mtree);
+   if (buf) free(buf);
    fclose(fp);
 
    return ecode;
 }  /* end ng_val() */
 
 /**
+ * @private
  * Validate a transaction block file and create ledger transaction file.
- * @param bcfile Filename of block file to validate
- * @param ltfile Filename of ledger transactions file to write
- * @return (int) value representing operation result
- * @retval VEBAD2 on malicious block; check errno for details
- * @retval VEBAD on invalid block; check errno for details
- * @retval VERROR on error; check errno for details
- * @retval VEOK on success
- */
-int b_val(const char *bcfile, const char *ltfile)
+ * See b_val() for details.
+*/
+static int b_val__file(const char *bcfile, const char *ltfile)
 {
    TXENTRY txe;            /* holds one transaction entry from block */
    BTRAILER tft;           /* fixed length block trailer (tfile) */
@@ -225,8 +227,8 @@ int b_val(const char *bcfile, const char *ltfile)
    fp = ltfp = NULL;
    mtree = NULL;
 
-   /* open block file and extract metadata */
-   fp = fopen(bcfile, "rb");
+   /* open (decompressed) block file and extract metadata */
+   fp = bc_fopen(bcfile);
    if (fp == NULL) goto ERROR_CLEANUP;
    /* read block trailer (fp left at EOF) */
    if (fseek(fp, -(sizeof(BTRAILER)), SEEK_END) != 0) return VERROR;
@@ -422,6 +424,28 @@ CLEANUP:
       remove(ltfile);
    }
 
+   return ecode;
+}  /* end b_val__file() */
+
+/**
+ * Validate a transaction block file and create ledger transaction file.
+ * @param bcfile Filename of block file to validate
+ * @param ltfile Filename of ledger transactions file to write
+ * @return (int) value representing operation result
+ * @retval VEBAD2 on malicious block; check errno for details
+ * @retval VEBAD on invalid block; check errno for details
+ * @retval VERROR on error; check errno for details
+ * @retval VEOK on success
+ */
+int b_val(const char *bcfile, const char *ltfile)
+{
+   word64 start;
+   int ecode;
+
+   start = metrics_time();
+   ecode = b_val__file(bcfile, ltfile);
+   metrics_observe(METRICS_B_VAL, start);
+
    return ecode;
 }  /* end b_val() */
 
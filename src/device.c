@@ -0,0 +1,57 @@
+/**
+ * @private
+ * @headerfile device.h <device.h>
+ * @copyright Adequate Systems LLC, 2018-2022. All Rights Reserved.
+ * <br />For license information, please refer to ../LICENSE.md
+*/
+
+/* include guard */
+#ifndef MOCHIMO_DEVICE_C
+#define MOCHIMO_DEVICE_C
+
+
+#include "device.h"
+
+/* internal support */
+#include "error.h"
+
+/* external support */
+#include <stdio.h>
+#include <time.h>
+
+/**
+ * Initialize a CPU device context, for solving with host threads.
+ * All CPU solving threads are managed as a single device, such that
+ * host threads share the Peach context of the device.
+ * @param ctx Pointer to array of DEVICE_CTX to initialize
+ * @param len Number of DEVICE_CTX available in @a ctx
+ * @param threads Number of solving threads of the CPU device
+ * @returns Number of CPU devices initialized, or (-1) on error.
+ * Check errno for details.
+ * @exception errno=EINVAL A parameter is invalid
+*/
+int init_cpu_devices(DEVICE_CTX *ctx, int len, int threads)
+{
+   if (ctx == NULL || len < 0 || threads < 0) {
+      set_errno(EINVAL);
+      return (-1);
+   }
+
+   /* no threads, no device */
+   if (threads == 0 || len == 0) return 0;
+
+   ctx->id = 0;
+   ctx->type = CPU_DEVICE;
+   ctx->status = DEV_NULL;
+   ctx->grid = ctx->block = 0;
+   ctx->threads = threads;
+   ctx->work = ctx->hps = 0;
+   ctx->last = time(NULL);
+   ctx->peach = NULL;
+   snprintf(ctx->info, sizeof(ctx->info), "CPU (%d threads)", threads);
+
+   return 1;
+}  /* end init_cpu_devices() */
+
+/* end include guard */
+#endif
@@ -7,6 +7,7 @@
 extern "C" {
 #endif
 
+int init_cpu_devices(DEVICE_CTX *ctx, int len, int threads);
 int init_cuda_devices(DEVICE_CTX *ctx, int len);
 
 #ifdef __cplusplus
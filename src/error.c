@@ -18,15 +18,47 @@
 /* external support */
 #include <stdarg.h>  /* for va_list support */
 #include <math.h>    /* for isnan/isinf/log10/pow */
+#include <stdlib.h>  /* for atexit() */
 #include "extstring.h"
+#include "exttime.h" /* for millisleep() */
+
+#ifndef _WIN32
+   #include <pthread.h> /* for asynchronous log writer */
+
+#endif
+
+/* Asynchronous logging ring buffer, see setplogasync() */
+#define PLOG_RINGLEN  1024 /* number of log slots (power of 2) */
+#define PLOG_SLOTLEN  512  /* length of pre-formatted log text, per slot */
+#define PLOG_WAITMS   5    /* writer thread wait (ms) on empty ring */
+
+/* Pre-formatted log slot of asynchronous logging ring buffer */
+typedef struct {
+   size_t seq;                /* slot sequence number (atomic) */
+   time_t time;               /* time of log */
+   int ll;                    /* level of log */
+   int len;                   /* length of pre-formatted log text */
+   char text[PLOG_SLOTLEN];   /* pre-formatted log text, sans newline */
+} PLOG_SLOT;
 
 /* Initialize default runtime configuration */
 static FILE *Logfile;
 static unsigned int Nerrs;
 static unsigned int Nlogs;
+static unsigned int Ndrops;
 static int Loglevel = PLOG_INFO;
 static int Logtime;
 
+/* asynchronous logging state */
+static PLOG_SLOT Logring[PLOG_RINGLEN];
+static size_t Loghead;  /* sequence of next slot to claim (atomic) */
+static size_t Logtail;  /* sequence of next slot to write (writer only) */
+static int Logasync;    /* non-zero while writer thread is active (atomic) */
+#ifndef _WIN32
+   static pthread_t Logtid;
+
+#endif
+
 /* Windows compatibility */
 #ifdef _WIN32
    /* localtime_r() is not specified by Windows... */
@@ -378,6 +410,102 @@ unsigned int plogcount(void)
    return Nlogs;
 }
 
+/**
+ * Get the number of logs dropped by asynchronous logging, where the ring
+ * buffer of log slots was full (see setplogasync()).
+ * @returns Number of logs dropped
+*/
+unsigned int plogdrops(void)
+{
+   return __atomic_load_n(&Ndrops, __ATOMIC_RELAXED);
+}
+
+/**
+ * @private
+ * Get the log type prefix of a log level.
+ * @param ll level of log
+ * @returns Log type prefix, or empty string
+*/
+static const char *plog_prefix(int ll)
+{
+   switch (ll) {
+      case PLOG_ALERT: return "!!!!!";
+      case PLOG_ERRNO: /* fallthrough */
+      case PLOG_ERROR: return "ERROR";
+      case PLOG_WARN:  return "Warn... ";
+      case PLOG_DEBUG: return "DEBUG";
+   }
+
+   return "";
+}  /* end plog_prefix() */
+
+/**
+ * @private
+ * Pre-format a log into a claimed slot of the asynchronous logging ring
+ * buffer, for the writer thread. Claims are lock-free; where the ring is
+ * full, the log is dropped and counted (see plogdrops()).
+ * @param ll level of log
+ * @param file file name where log occurrred
+ * @param line line number where log occurrred
+ * @param fmt A string format (or message) to log
+ * @param args Variable arguments supporting @a fmt
+ * @param ecode errno at time of log
+ * @returns VEOK on success, else VERROR if the log was dropped
+*/
+static int plog_enqueue(int ll, const char *file, int line,
+   const char *fmt, va_list args, int ecode)
+{
+   PLOG_SLOT *sp;
+   size_t pos, seq;
+   char error[64];
+   char *filename;
+   int len, n;
+
+   /* claim next slot, unless unwritten from the previous lap (full) */
+   pos = __atomic_load_n(&Loghead, __ATOMIC_RELAXED);
+   for ( ;; ) {
+      sp = &Logring[pos & (PLOG_RINGLEN - 1)];
+      seq = __atomic_load_n(&sp->seq, __ATOMIC_ACQUIRE);
+      if (seq == pos) {
+         if (__atomic_compare_exchange_n(&Loghead, &pos, pos + 1, 1,
+               __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+      } else if ((long) (seq - pos) < 0) {
+         __atomic_fetch_add(&Ndrops, 1, __ATOMIC_RELAXED);
+         return VERROR;
+      } else pos = __atomic_load_n(&Loghead, __ATOMIC_RELAXED);
+   }
+
+   /* pre-format log; prefix, file reference, information, error */
+   time(&sp->time);
+   sp->ll = ll;
+   len = snprintf(sp->text, PLOG_SLOTLEN, "%s", plog_prefix(ll));
+   if (ll <= PLOG_ERROR || ll == PLOG_DEBUG) {
+      /* __FILE__ MAY contain a filepath */
+      filename = strrchr(file, PREFERRED_PATH_SEP[0]);
+      if (filename) filename++; else filename = (char *) file;
+      n = snprintf(&sp->text[len], PLOG_SLOTLEN - len, "[%s:%d] ",
+         filename, line);
+      if (n > 0) len += n;
+      if (len >= PLOG_SLOTLEN) len = PLOG_SLOTLEN - 1;
+   }
+   n = vsnprintf(&sp->text[len], PLOG_SLOTLEN - len, fmt, args);
+   if (n > 0) len += n;
+   if (len >= PLOG_SLOTLEN) len = PLOG_SLOTLEN - 1;
+   if (ll == PLOG_ERRNO) {
+      mcm_strerror(ecode, error, sizeof(error));
+      n = snprintf(&sp->text[len], PLOG_SLOTLEN - len, ": (%d) %s",
+         ecode, error);
+      if (n > 0) len += n;
+      if (len >= PLOG_SLOTLEN) len = PLOG_SLOTLEN - 1;
+   }
+   sp->len = len;
+
+   /* publish slot to writer thread */
+   __atomic_store_n(&sp->seq, pos + 1, __ATOMIC_RELEASE);
+
+   return VEOK;
+}  /* end plog_enqueue() */
+
 /**
  * Print a log to screen.
  * @param ll level of log to be printed
@@ -385,6 +513,9 @@ unsigned int plogcount(void)
  * @param line line number where log occurrred
  * @param fmt A string format (or message) to log
  * @param ... Variable arguments supporting @a fmt
+ * @note Where asynchronous logging is set (see setplogasync()), the log
+ * is pre-formatted into a slot of a ring buffer, and printed by a writer
+ * thread, rather than printed on the calling thread.
 */
 void plogx(int ll, const char *file, int line, const char *fmt, ...)
 {
@@ -403,7 +534,17 @@ void plogx(int ll, const char *file, int line, const char *fmt, ...)
    /* store errno for later */
    ecode = errno;
 
-   /* THREADSAFE atomic lock would start here... */
+   /* lock-free asynchronous logging, if set */
+   if (__atomic_load_n(&Logasync, __ATOMIC_ACQUIRE)) {
+      va_start(args, fmt);
+      ecode = plog_enqueue(ll, file, line, fmt, args, ecode);
+      va_end(args);
+      if (ecode == VEOK) {
+         if (ll <= PLOG_ERROR) __atomic_fetch_add(&Nerrs, 1, __ATOMIC_RELAXED);
+         __atomic_fetch_add(&Nlogs, 1, __ATOMIC_RELAXED);
+      }
+      return;
+   }
 
    /* check for specified output file... */
    if (Logfile) {
@@ -417,13 +558,7 @@ void plogx(int ll, const char *file, int line, const char *fmt, ...)
    } else stream = (ll <= PLOG_ERROR) ? stderr : stdout;
 
    /* print log type prefix */
-   switch (ll) {
-      case PLOG_ALERT: fprintf(stream, "!!!!!"); break;
-      case PLOG_ERRNO: /* fallthrough */
-      case PLOG_ERROR: fprintf(stream, "ERROR"); break;
-      case PLOG_WARN:  fprintf(stream, "Warn... "); break;
-      case PLOG_DEBUG: fprintf(stream, "DEBUG"); break;
-   }
+   fprintf(stream, "%s", plog_prefix(ll));
    /* print file reference on error or debug type logs */
    if (ll <= PLOG_ERROR || ll == PLOG_DEBUG) {
       /* __FILE__ MAY contain a filepath */
@@ -447,10 +582,176 @@ void plogx(int ll, const char *file, int line, const char *fmt, ...)
    /* increment log counter/s */
    if (ll <= PLOG_ERROR) Nerrs++;
    Nlogs++;
-
-   /* THREADSAFE atomic lock would end here... */
 }  /* end plogx() */
 
+#ifndef _WIN32
+
+/**
+ * @private
+ * Update a cached log file timestamp, @a timestamp, of second @a sec, to
+ * the second @a t. Formats only where the second has changed.
+ * @param t Time of log
+ * @param sec Pointer to second of cached timestamp
+ * @param timestamp Cached timestamp
+*/
+static void plog_timestamp(time_t t, time_t *sec, char timestamp[28])
+{
+   struct tm dt;
+
+   if (t == *sec) return;
+   *sec = t;
+   localtime_r(&t, &dt);
+   strftime(timestamp, 28, "[%F %T%z] ", &dt);
+}  /* end plog_timestamp() */
+
+/**
+ * @private
+ * Asynchronous log writer thread. Writes published slots of the ring
+ * buffer in batches, flushing streams once per batch, and reports logs
+ * dropped since the previous batch. Timestamps are formatted once per
+ * second. Drains the ring buffer before exiting.
+ * @param arg Unused
+ * @returns NULL
+*/
+static void *plog_writer(void *arg)
+{
+   PLOG_SLOT *sp;
+   FILE *stream;
+   time_t sec;
+   unsigned int drops, reported;
+   int active, count, flush;
+   char timestamp[28];
+
+   (void) arg;
+   sec = -1;
+   reported = 0;
+   do {
+      active = __atomic_load_n(&Logasync, __ATOMIC_ACQUIRE);
+      /* write batch of published slots */
+      for (count = flush = 0; ; count++, Logtail++) {
+         sp = &Logring[Logtail & (PLOG_RINGLEN - 1)];
+         if (__atomic_load_n(&sp->seq, __ATOMIC_ACQUIRE) != Logtail + 1) {
+            break;
+         }
+         if (Logfile) {
+            plog_timestamp(sp->time, &sec, timestamp);
+            fprintf(Logfile, "%s ", timestamp);
+            stream = Logfile;
+            flush |= 4;
+         } else if (sp->ll <= PLOG_ERROR) {
+            stream = stderr;
+            flush |= 2;
+         } else {
+            stream = stdout;
+            flush |= 1;
+         }
+         fwrite(sp->text, 1, (size_t) sp->len, stream);
+         fputc('\n', stream);
+         /* release slot for the next lap */
+         __atomic_store_n(&sp->seq, Logtail + PLOG_RINGLEN, __ATOMIC_RELEASE);
+      }
+      /* report dropped logs */
+      drops = __atomic_load_n(&Ndrops, __ATOMIC_RELAXED);
+      if (drops != reported) {
+         if (Logfile) {
+            plog_timestamp(time(NULL), &sec, timestamp);
+            fprintf(Logfile, "%s ", timestamp);
+            stream = Logfile;
+            flush |= 4;
+         } else {
+            stream = stderr;
+            flush |= 2;
+         }
+         fprintf(stream, "Warn... %u logs dropped (log buffer full)\n",
+            drops - reported);
+         reported = drops;
+      }
+      /* flush streams, once per batch */
+      if (flush & 1) fflush(stdout);
+      if (flush & 2) fflush(stderr);
+      if ((flush & 4) && Logfile) fflush(Logfile);
+      if (count == 0 && active) millisleep(PLOG_WAITMS);
+      /* continue until inactive and all claimed slots are written */
+   } while (active || Logtail != __atomic_load_n(&Loghead, __ATOMIC_ACQUIRE));
+
+   return NULL;
+}  /* end plog_writer() */
+
+/**
+ * @private
+ * Child process (fork()) handler; the writer thread does not survive a
+ * fork(), so child processes log synchronously.
+*/
+static void plog_atfork_child(void)
+{
+   __atomic_store_n(&Logasync, 0, __ATOMIC_RELEASE);
+}  /* end plog_atfork_child() */
+
+/**
+ * @private
+ * Process exit handler; writes all pending asynchronous logs.
+*/
+static void plog_atexit(void)
+{
+   setplogasync(0);
+}  /* end plog_atexit() */
+
+#endif
+
+/**
+ * Set asynchronous logging option. When set, logs are pre-formatted into
+ * fixed slots of a lock-free (multi-producer) ring buffer, and written in
+ * batches by a dedicated writer thread. Where the ring buffer is full,
+ * logs are dropped and counted (see plogdrops()). Child processes log
+ * synchronously. Pending logs are written on unset, or process exit.
+ * @param val Value to set option (boolean)
+ * @returns VEOK on success, else VERROR; check errno for details
+ * @note Not supported on Windows.
+*/
+int setplogasync(int val)
+{
+#ifndef _WIN32
+   static int registered;
+   size_t j;
+   int ecode;
+
+   if (val) {
+      if (__atomic_load_n(&Logasync, __ATOMIC_ACQUIRE)) return VEOK;
+      if (!registered) {
+         if (pthread_atfork(NULL, NULL, plog_atfork_child) != 0) {
+            return VERROR;
+         }
+         if (atexit(plog_atexit) != 0) return VERROR;
+         registered = 1;
+      }
+      /* (re)initialize slot sequence numbers from the writer position */
+      Loghead = Logtail;
+      for (j = 0; j < PLOG_RINGLEN; j++) {
+         Logring[(Logtail + j) & (PLOG_RINGLEN - 1)].seq = Logtail + j;
+      }
+      __atomic_store_n(&Logasync, 1, __ATOMIC_RELEASE);
+      ecode = pthread_create(&Logtid, NULL, plog_writer, NULL);
+      if (ecode != 0) {
+         __atomic_store_n(&Logasync, 0, __ATOMIC_RELEASE);
+         set_errno(ecode);
+         return VERROR;
+      }
+   } else if (__atomic_load_n(&Logasync, __ATOMIC_ACQUIRE)) {
+      __atomic_store_n(&Logasync, 0, __ATOMIC_RELEASE);
+      pthread_join(Logtid, NULL);
+   }
+
+   return VEOK;
+#else
+   if (val) {
+      set_errno(ENOSYS);
+      return VERROR;
+   }
+
+   return VEOK;
+#endif
+}  /* end setplogasync() */
+
 void setplogfile(FILE* fp)
 {
    Logfile = fp;
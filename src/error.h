@@ -155,6 +155,7 @@ typedef char FILENAME[FILENAME_MAX];
    EMCM__ITEM(EMCM_FILEDATA, "Unexpected file data") \
    EMCM__ITEM(EMCM_FILELEN, "Unexpected length of file") \
    EMCM__ITEM(EMCM_SORTLEN, "Unexpected file length during sort") \
+   EMCM__ITEM(EMCM_ZDATA, "Bad compressed file data") \
 /* block related errors... */ \
    EMCM__ITEM(EMCM_BHASH, "Bad block hash") \
    EMCM__ITEM(EMCM_BNUM, "Bad block number") \
@@ -304,7 +305,9 @@ char *mcm_strerror(int errnum, char *buf, size_t bufsz);
 char *mcm_strerrorname(int errnum, char *buf, size_t bufsz);
 unsigned int perrcount(void);
 unsigned int plogcount(void);
+unsigned int plogdrops(void);
 void plogx(int ll, const char *func, int line, const char *fmt, ...);
+int setplogasync(int val);
 void setplogfile(FILE *fp);
 void setploglevel(int ll);
 void setplogtime(int val);
@@ -14,6 +14,7 @@
 
 /* internal support */
 #include "error.h"
+#include "wserv.h"
 
 /* external support */
 #include "extinet.h"
@@ -22,7 +23,7 @@
 #include <string.h>
 #include <sys/wait.h>
 
-int Nonline;         /* number of pid's in Nodes[]                */
+int Nonline;         /* number of requests in worker queue        */
 word32 Quorum = 3;   /* Number of peers in get_eon() gang[MAXQUORUM] */
 word32 Trustblock;   /* trust block validity up to this block     */
 word32 Dynasleep;    /* sleep usec. per loop if Nonline < 1       */
@@ -42,6 +43,13 @@ word16 Port = PORT1; /* Our listening port                        */
 word16 Dstport = PORT1; /* Our send destination port              */
 word8 Blockfound;    /* set on receiving OP_FOUND from peer       */
 word8 Exportflag;    /* enable database export: #ifdef BX_MYSQL   */
+word8 Snapshotflag;  /* export ledger snapshot on neogenesis      */
+word8 Mineduty = 100; /* passive mining duty cycle, in percent    */
+word8 Minethreads;   /* passive mining threads, 0 to disable      */
+word8 Reqthreads = 8; /* request worker threads                   */
+word16 Workport;     /* work server port, 0 to disable            */
+word8 Workdiff;      /* work server share difficulty, 0 for none  */
+word16 Metricsport;  /* metrics endpoint port, 0 to disable       */
 word8 Errorlog;      /* non-zero to log errors to "error.log"     */
 word8 Monitor;       /* set non-zero by ctrlc() to enter monitor  */
 word8 Bgflag;        /* ignore ctrl-c Monitor and no term output  */
@@ -70,6 +78,8 @@ word8 Cblockhash[HASHLEN];
 word8 Prevhash[HASHLEN];
 word8 Weight[HASHLEN];
 
+Mutex Chainlock = MUTEX_INITIALIZER;  /* chain state lock */
+
 /* lock files    writes   reads     deletes
  * mq.lck        gomochi            gomochi
  * neofail.lck   neogen   bupdata   bupdata
@@ -79,6 +89,7 @@ word8 Weight[HASHLEN];
 pid_t Bcon_pid;         /* bcon process id */
 word8 Bcbnum[8];        /* Cblocknum at time of execl bcon */
 pid_t Found_pid;
+pid_t Miner_pid;        /* passive miner process id */
 pid_t Mqpid;            /* mirror() */
 int Mqcount;            /* count of mq.dat records */
 
@@ -92,6 +103,7 @@ void kill_services_exit(int ecode)
 {
    if (Found_pid) kill(Found_pid, SIGTERM);
    if (Bcon_pid) kill(Bcon_pid, SIGTERM);
+   if (Miner_pid) kill(Miner_pid, SIGTERM);
    if (Mqpid) kill(Mqpid, SIGTERM);
    sock_cleanup();
    Running = 0;
@@ -136,6 +148,18 @@ int stop_found(void)
    return status;
 }
 
+/* kill the passive miner, and withdraw work server work */
+void stop_miner(void)
+{
+   wserv_idle();
+   if (Miner_pid) {
+      pdebug("   Waiting for passive miner to exit");
+      kill(Miner_pid, SIGTERM);
+      waitpid(Miner_pid, NULL, 0);
+      Miner_pid = 0;
+   }
+}  /* end stop_miner() */
+
 /* kill mirror() children and grandchildren */
 void stop_mirror(void)
 {
@@ -12,12 +12,13 @@
 
 /* external support */
 #include "types.h"
+#include "extthrd.h"
 
 /* emergency stops */
 #define restart(msg) { palert(msg); kill_services_exit(1); }
 #define resign(msg) { palert(msg); kill_services_exit(0); }
 
-extern int Nonline;         /* number of pid's in Nodes[]                */
+extern int Nonline;         /* number of requests in worker queue        */
 extern word32 Quorum;       /* Number of peers in get_eon() gang[MAXQUORUM] */
 extern word32 Trustblock;   /* trust block validity up to this block     */
 extern word32 Dynasleep;    /* sleep usec. per loop if Nonline < 1       */
@@ -37,6 +38,13 @@ extern word16 Port;         /* Our listening port                        */
 extern word16 Dstport;      /* Our send destination port                 */
 extern word8 Blockfound;    /* set on receiving OP_FOUND from peer       */
 extern word8 Exportflag;    /* enable database export: #ifdef BX_MYSQL   */
+extern word8 Snapshotflag;  /* export ledger snapshot on neogenesis      */
+extern word8 Mineduty;      /* passive mining duty cycle, in percent     */
+extern word8 Minethreads;   /* passive mining threads, 0 to disable      */
+extern word8 Reqthreads;    /* request worker threads                    */
+extern word16 Workport;     /* work server port, 0 to disable            */
+extern word8 Workdiff;      /* work server share difficulty, 0 for none  */
+extern word16 Metricsport;  /* metrics endpoint port, 0 to disable       */
 extern word8 Errorlog;      /* non-zero to log errors to "error.log"     */
 extern word8 Monitor;       /* set non-zero by ctrlc() to enter monitor  */
 extern word8 Bgflag;        /* ignore ctrl-c Monitor and no term output  */
@@ -65,6 +73,11 @@ extern word8 Cblockhash[HASHLEN];
 extern word8 Prevhash[HASHLEN];
 extern word8 Weight[HASHLEN];
 
+/* Chain state lock; held to write the above chain state (Cblocknum,
+ * Cblockhash, Prevhash and Weight), and to read it off the server thread.
+*/
+extern Mutex Chainlock;
+
 /* lock files    writes   reads     deletes
  * mq.lck        gomochi            gomochi
  * neofail.lck   neogen   bupdata   bupdata
@@ -74,6 +87,7 @@ extern word8 Weight[HASHLEN];
 extern pid_t Bcon_pid;              /* bcon process id */
 extern word8 Bcbnum[8];           /* Cblocknum at time of execl bcon */
 extern pid_t Found_pid;
+extern pid_t Miner_pid;          /* passive miner process id */
 extern pid_t Mqpid;              /* mirror() */
 extern int Mqcount;              /* count of mq.dat records */
 
@@ -88,6 +102,7 @@ void kill_services_exit(int ecode);
 char *show(char *state);
 int stop_bcon(void);
 int stop_found(void);
+void stop_miner(void);
 void stop_mirror(void);
 
 #ifdef __cplusplus
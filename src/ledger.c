@@ -13,16 +13,31 @@
 #include "ledger.h"
 
 /* internal support */
+#include "metrics.h"
 #include "global.h"
 #include "error.h"
 
 /* external support */
+#include <stdlib.h>
 #include <string.h>
 #include "sha3.h"
 #include "ripemd160.h"
 #include "extmath.h"
 #include "extlib.h"
 #include <errno.h>
+#include <sys/stat.h>   /* fstat() */
+
+#ifndef _WIN32
+   #include <sys/mman.h>   /* mmap() */
+
+#endif
+
+/* ledger index parameters */
+#define LEIDX_MAGIC     "LIDX"
+#define LEIDX_SLOTS     8
+#define LEIDX_LOAD      6
+#define LEIDX_EMPTY     WORD32_MAX
+#define LEIDX_FNAMELEN  ( FILENAME_MAX + 8 )
 
 /* LEGACY WOTS+ ledger entry struct */
 typedef struct {
@@ -30,9 +45,51 @@ typedef struct {
    word8 balance[8];
 } WOTS_LENTRY;
 
+/**
+ * @private
+ * Ledger index file header. Identifies the ledger the index was built
+ * from, such that stale index files are rejected by le_open(). A ledger
+ * replaced (e.g. renamed into place) or rewritten without rebuilding the
+ * index, differs in file identity (device, inode) or modification time.
+*/
+typedef struct {
+   word8 magic[4];
+   word32 nbuckets;
+   word64 nledger;
+   word8 first[ADDR_LEN];  /* first ledger address */
+   word8 last[ADDR_LEN];   /* last ledger address */
+   word64 dev;             /* ledger file device */
+   word64 ino;             /* ledger file inode */
+   word64 size;            /* ledger file size, in bytes */
+   word64 mtime;           /* ledger file modification time */
+} LEIDXHDR;
+
+/**
+ * @private
+ * Ledger index bucket. Fits a single cache line; tag fingerprints are
+ * kept together so a bucket is checked without touching ledger slots.
+*/
+typedef struct {
+   word32 fp[LEIDX_SLOTS];
+   word32 slot[LEIDX_SLOTS];
+} LEIDXBUCKET;
+
+STATIC_ASSERT(sizeof(LEIDXHDR) == 128, LEIDXHDR_size);
+STATIC_ASSERT(sizeof(LEIDXBUCKET) == 64, LEIDXBUCKET_size);
+
+/* batch ledger query reference */
+typedef struct {
+   const word8 *addr;
+   size_t idx;
+} LEQUERY;
+
 static FILE *Lefp;
 static long long Nledger;
 static char Lefile[FILENAME_MAX] = "ledger.dat";
+static void *Leidxmap;
+static size_t Leidxmaplen;
+static LEIDXBUCKET *Leidx;
+static word32 Leidxmask;
 word32 Sanctuary;
 word32 Lastday;
 
@@ -237,6 +294,206 @@ static int lt_compare(const void *a, const void *b)
    return 0;
 }
 
+/**
+ * @private
+ * Comparison function to sort LEQUERY objects by address.
+*/
+static int le__query_compare(const void *va, const void *vb)
+{
+   const LEQUERY *a = (const LEQUERY *) va;
+   const LEQUERY *b = (const LEQUERY *) vb;
+
+   return memcmp(a->addr, b->addr, ADDR_LEN);
+}
+
+/**
+ * @private
+ * Read a ledger entry, by index, from the open ledger.
+ * @param idx Index of ledger entry to read
+ * @param le Pointer to place ledger entry
+ * @returns VEOK on success, else VERROR; check errno for details
+*/
+static int le__read(long long idx, LENTRY *le)
+{
+   if (fseek64(Lefp, idx * (long long) sizeof(LENTRY), SEEK_SET) != 0) {
+      return VERROR;
+   }
+   if (fread(le, sizeof(LENTRY), 1, Lefp) != 1) {
+      if (!ferror(Lefp)) set_errno(EMCM_EOF);
+      return VERROR;
+   }
+
+   return VEOK;
+}
+
+/**
+ * @private
+ * Hash a ledger address tag for the ledger index. The upper 32 bits
+ * provide the tag fingerprint, and the lower bits select a bucket.
+*/
+static inline word64 le__idxhash(const word8 *tag)
+{
+   word64 a, b;
+   word32 c;
+
+   memcpy(&a, tag, 8);
+   memcpy(&b, tag + 8, 8);
+   memcpy(&c, tag + 16, 4);
+   /* mix; tags are not always uniformly distributed (e.g. implicit) */
+   a ^= (b * 0x9e3779b97f4a7c15ULL) ^ c;
+   a ^= a >> 31;
+   a *= 0xbf58476d1ce4e5b9ULL;
+   a ^= a >> 29;
+
+   return a;
+}
+
+/**
+ * @private
+ * Derive the ledger index filename from a ledger filename.
+*/
+static char *le__idxname(char idxname[LEIDX_FNAMELEN], const char *lefile)
+{
+   snprintf(idxname, LEIDX_FNAMELEN, "%s.idx", lefile);
+
+   return idxname;
+}
+
+/**
+ * @private
+ * Get the identity of an open ledger file, for binding a ledger index.
+ * @param fp Pointer to open ledger file
+ * @param hdr Pointer to ledger index header to place identity
+ * @returns VEOK on success, else VERROR; check errno for details
+*/
+static int le__idx_bind(FILE *fp, LEIDXHDR *hdr)
+{
+   struct stat st;
+
+   if (fstat(fileno(fp), &st) != 0) return VERROR;
+   hdr->dev = (word64) st.st_dev;
+   hdr->ino = (word64) st.st_ino;
+   hdr->size = (word64) st.st_size;
+   hdr->mtime = (word64) st.st_mtime;
+
+   return VEOK;
+}
+
+/**
+ * @private
+ * Unmap the ledger index, if mapped.
+*/
+static void le__idx_close(void)
+{
+#ifndef _WIN32
+   if (Leidxmap) munmap(Leidxmap, Leidxmaplen);
+#endif
+   Leidxmap = NULL;
+   Leidxmaplen = 0;
+   Leidx = NULL;
+   Leidxmask = 0;
+}
+
+/**
+ * @private
+ * Memory map the ledger index of the open ledger. The index header is
+ * checked against the open ledger and rejected if stale.
+ * @param lefile Filename of the open ledger file
+ * @returns VEOK on success, else VERROR
+*/
+static int le__idx_open(const char *lefile)
+{
+#ifndef _WIN32
+   LEIDXHDR hdr, bind;
+   LENTRY le;
+   char idxname[LEIDX_FNAMELEN];
+   long long len;
+   void *map;
+   FILE *fp;
+
+   le__idx_close();
+
+   fp = fopen(le__idxname(idxname, lefile), "rb");
+   if (fp == NULL) return VERROR;
+   if (fread(&hdr, sizeof(hdr), 1, fp) != 1) goto ERROR_CLEANUP;
+   if (fseek64(fp, 0LL, SEEK_END) != 0) goto ERROR_CLEANUP;
+   len = ftell64(fp);
+   /* check index header against open ledger */
+   if (memcmp(hdr.magic, LEIDX_MAGIC, sizeof(hdr.magic)) != 0 ||
+         hdr.nbuckets == 0 || (hdr.nbuckets & (hdr.nbuckets - 1)) ||
+         hdr.nledger != (word64) Nledger || len != (long long)
+         (sizeof(LEIDXHDR) + ((size_t) hdr.nbuckets * sizeof(LEIDXBUCKET)))) {
+      set_errno(EMCM_FILEDATA);
+      goto ERROR_CLEANUP;
+   }
+   /* check index was built from this (unmodified) ledger file */
+   if (le__idx_bind(Lefp, &bind) != VEOK) goto ERROR_CLEANUP;
+   if (hdr.dev != bind.dev || hdr.ino != bind.ino ||
+         hdr.size != bind.size || hdr.mtime != bind.mtime) {
+      goto STALE_CLEANUP;
+   }
+   if (le__read(0, &le) != VEOK) goto ERROR_CLEANUP;
+   if (memcmp(hdr.first, le.addr, ADDR_LEN) != 0) goto STALE_CLEANUP;
+   if (le__read(Nledger - 1, &le) != VEOK) goto ERROR_CLEANUP;
+   if (memcmp(hdr.last, le.addr, ADDR_LEN) != 0) goto STALE_CLEANUP;
+   /* map index (read-only) -- mapping persists beyond fclose() */
+   map = mmap(NULL, (size_t) len, PROT_READ, MAP_SHARED, fileno(fp), 0);
+   if (map == MAP_FAILED) goto ERROR_CLEANUP;
+   fclose(fp);
+
+   Leidxmap = map;
+   Leidxmaplen = (size_t) len;
+   Leidx = (LEIDXBUCKET *) ((word8 *) map + sizeof(LEIDXHDR));
+   Leidxmask = hdr.nbuckets - 1;
+
+   return VEOK;
+
+   /* cleanup / error handling */
+STALE_CLEANUP:
+   set_errno(EMCM_FILEDATA);
+ERROR_CLEANUP:
+   fclose(fp);
+
+   return VERROR;
+
+#else
+   (void) lefile;
+   return VERROR;
+
+#endif
+}  /* end le__idx_open() */
+
+/**
+ * @private
+ * Find a ledger entry via the ledger index. Only valid for search
+ * lengths that cover the full address tag.
+ * @returns 1 if found, 0 if not found, or -1 on error
+*/
+static int le__idx_find(const word8 *addr, LENTRY *le, word16 len)
+{
+   LEIDXBUCKET *bp;
+   word64 hash;
+   word32 b, n, fp;
+   int j;
+
+   hash = le__idxhash(ADDR_TAG_PTR(addr));
+   fp = (word32) (hash >> 32);
+   /* linear probe across buckets, ending at the first empty slot */
+   for (b = (word32) hash & Leidxmask, n = 0; n <= Leidxmask; n++) {
+      bp = &Leidx[b];
+      for (j = 0; j < LEIDX_SLOTS; j++) {
+         if (bp->slot[j] == LEIDX_EMPTY) return 0;
+         if (bp->fp[j] != fp) continue;
+         if ((long long) bp->slot[j] >= Nledger) return -1;
+         if (le__read(bp->slot[j], le) != VEOK) return -1;
+         if (memcmp(addr, le->addr, len) == 0) return 1;
+      }
+      b = (b + 1) & Leidxmask;
+   }
+
+   return 0;
+}  /* end le__idx_find() */
+
 /**
  * Open ledger file for internal operations. Ledger file is read-only.
  * @param lefile Filename of the ledger file to open
@@ -281,6 +538,10 @@ int le_open(const char *lefile)
        */
       strncpy(Lefile, lefile, sizeof(Lefile) - 1);
    }
+   /* map ledger index, if available -- else, binary search only */
+   if (le__idx_open(Lefile) != VEOK) {
+      pdebug("ledger index unavailable, using binary search");
+   }
 
    return VEOK;
 
@@ -297,6 +558,7 @@ ERROR_CLEANUP:
  */
 void le_close(void)
 {
+   le__idx_close();
    if(Lefp == NULL) return;
    fclose(Lefp);
    Lefp = NULL;
@@ -306,6 +568,8 @@ void le_close(void)
 /**
  * Binary search for ledger address. If found, le is filled with the found
  * ledger entry data. Ledger must have been opened with le_open().
+ * Searches covering the full address tag use the ledger index, where
+ * available (see le_index_build()).
  * @param addr Address data to search for
  * @param le Pointer to place found ledger entry
  * @param len Length of address data to search
@@ -336,6 +600,13 @@ int le_find(const word8 *addr, LENTRY *le, word16 len)
    /* clamp search length to ledger address length */
    if (len > ADDR_LEN) len = ADDR_LEN;
 
+   /* full tag (or longer) searches may use the ledger index */
+   if (Leidx != NULL && len >= ADDR_TAG_LEN) {
+      /* ... hits are checked against the ledger entry, but a miss is
+       * not trusted; fallback to binary search on index miss or error */
+      if (le__idx_find(addr, le, len) == 1) return 1;
+   }
+
    low = 0;
    hi = Nledger - 1;
 
@@ -357,6 +628,285 @@ int le_find(const word8 *addr, LENTRY *le, word16 len)
    return 0;  /* not found */
 }  /* end le_find() */
 
+/**
+ * Search for a batch of ledger addresses in a single coordinated pass.
+ * Addresses are sorted and resolved in ascending order, such that each
+ * search begins from the position of the previous result. Small batches
+ * gallop forward from that position, while large batches (relative to
+ * the size of the ledger) are resolved with a sequential merge join.
+ * Where @a len is less than ADDR_LEN, the first matching ledger entry is
+ * returned. Ledger must have been opened with le_open().
+ * @param addrs Pointer to first address of the batch
+ * @param stride Distance between consecutive addresses, in bytes
+ * @param count Number of addresses in the batch
+ * @param les Pointer to array of @a count ledger entries for results
+ * @param found Pointer to array of @a count flags, set 1 where found
+ * @param len Length of address data to search
+ * @return (size_t) number of addresses found; check errno for details
+ * @exception errno=EMCM_LECLOSED if ledger is not open
+ * @exception errno=EINVAL if a pointer is NULL, len is zero, or
+ * stride is less than ADDR_LEN
+ * @exception errno=0 if no address is found
+*/
+size_t le_find_batch(const void *addrs, size_t stride, size_t count,
+   LENTRY *les, word8 *found, word16 len)
+{
+   LEQUERY *query;
+   LENTRY le;
+   long long at, low, lo, hi, mid, step;
+   size_t j, nfound;
+   int cond;
+
+   /* ledger must be open */
+   if (Lefp == NULL) {
+      set_errno(EMCM_LECLOSED);
+      return 0;
+   }
+
+   /* check pointers, address stride and non-zero search length */
+   if (addrs == NULL || les == NULL || found == NULL || len == 0 ||
+         stride < ADDR_LEN) {
+      set_errno(EINVAL);
+      return 0;
+   }
+
+   /* clamp search length to ledger address length */
+   if (len > ADDR_LEN) len = ADDR_LEN;
+
+   /* clear found flags */
+   memset(found, 0, count);
+   if (count == 0) {
+      set_errno(0);
+      return 0;
+   }
+
+   /* sort batch by address -- retain original index for results */
+   query = malloc(count * sizeof(LEQUERY));
+   if (query == NULL) return 0;
+   for (j = 0; j < count; j++) {
+      query[j].addr = (const word8 *) addrs + (j * stride);
+      query[j].idx = j;
+   }
+   qsort(query, count, sizeof(LEQUERY), le__query_compare);
+
+   /* init */
+   nfound = 0;
+   low = 0;
+   at = -1;
+   cond = 0;
+
+   if (count >= (size_t) (Nledger / LEBATCHRATIO)) {
+      /* merge join; ledger entries are read sequentially */
+      if (fseek64(Lefp, 0LL, SEEK_SET) != 0) goto ERROR_CLEANUP;
+      for (j = 0; j < count && low < Nledger; j++) {
+         /* advance past ledger entries preceding query */
+         for ( ; low < Nledger; low++) {
+            if (at != low) {
+               if (fread(&le, sizeof(LENTRY), 1, Lefp) != 1) {
+                  if (!ferror(Lefp)) set_errno(EMCM_EOF);
+                  goto ERROR_CLEANUP;
+               }
+               at = low;
+            }
+            cond = memcmp(le.addr, query[j].addr, len);
+            if (cond >= 0) break;
+         }
+         if (low < Nledger && cond == 0) {
+            memcpy(&les[query[j].idx], &le, sizeof(LENTRY));
+            found[query[j].idx] = 1;
+            nfound++;
+         }
+      }
+   } else {
+      /* galloping search from shared lower bound */
+      for (j = 0; j < count && low < Nledger; j++) {
+         /* ... all entries before lo are known to precede query */
+         lo = low;
+         hi = Nledger;
+         for (step = 1; lo + step - 1 < Nledger; step <<= 1) {
+            mid = lo + step - 1;
+            if (le__read(mid, &le) != VEOK) goto ERROR_CLEANUP;
+            at = mid;
+            if (memcmp(le.addr, query[j].addr, len) >= 0) {
+               hi = mid;
+               break;
+            }
+            lo = mid + 1;
+         }
+         /* ... binary search for lower bound within [lo, hi) */
+         while (lo < hi) {
+            mid = lo + ((hi - lo) / 2);
+            if (le__read(mid, &le) != VEOK) goto ERROR_CLEANUP;
+            at = mid;
+            if (memcmp(le.addr, query[j].addr, len) < 0) lo = mid + 1;
+            else hi = mid;
+         }
+         low = lo;
+         if (low >= Nledger) break;
+         if (at != low) {
+            if (le__read(low, &le) != VEOK) goto ERROR_CLEANUP;
+            at = low;
+         }
+         if (memcmp(le.addr, query[j].addr, len) == 0) {
+            memcpy(&les[query[j].idx], &le, sizeof(LENTRY));
+            found[query[j].idx] = 1;
+            nfound++;
+         }
+      }
+   }
+
+   /* cleanup */
+   free(query);
+
+   /* indicate successful operation in the absence of a result */
+   if (nfound == 0) set_errno(0);
+
+   return nfound;
+
+   /* cleanup / error handling */
+ERROR_CLEANUP:
+   free(query);
+
+   return 0;
+}  /* end le_find_batch() */
+
+/**
+ * Build a ledger index sidecar file for a ledger file. The index is an
+ * open addressing hash table of address tags to ledger slots, in cache
+ * line sized buckets, and is written to "<lefile>.idx" in native byte
+ * order. The sorted ledger file remains the source of truth; the index
+ * only accelerates le_find(). Any existing index is removed first, so a
+ * failed build never leaves a stale index behind.
+ * @param lefile Filename of the ledger file to index
+ * @return (int) value representing operation result
+ * @retval VERROR on error; check errno for details
+ * @retval VEOK on success
+*/
+int le_index_build(const char *lefile)
+{
+   LEIDXHDR hdr;
+   LENTRY le;
+   LEIDXBUCKET *buckets, *bp;
+   char idxname[LEIDX_FNAMELEN];
+   char tmpname[LEIDX_FNAMELEN];
+   long long offset, count, idx;
+   word64 hash;
+   word32 nbuckets, b;
+   int j;
+   FILE *fp, *ifp;
+
+   /* init */
+   buckets = NULL;
+   ifp = NULL;
+   le__idxname(idxname, lefile);
+   snprintf(tmpname, sizeof(tmpname), "%s.idx.tmp", lefile);
+   remove(idxname);
+
+   /* open ledger and determine entry count */
+   fp = fopen(lefile, "rb");
+   if (fp == NULL) return VERROR;
+   if (fseek64(fp, 0LL, SEEK_END) != 0) goto ERROR_CLEANUP;
+   offset = ftell64(fp);
+   if (offset == (-1)) goto ERROR_CLEANUP;
+   if ((size_t) offset < sizeof(LENTRY) || offset % sizeof(LENTRY) != 0) {
+      set_errno(EMCM_FILEDATA);
+      goto ERROR_CLEANUP;
+   }
+   count = offset / (long long) sizeof(LENTRY);
+   if (count >= (long long) LEIDX_EMPTY) {
+      set_errno(EMCM_FILECOUNT);
+      goto ERROR_CLEANUP;
+   }
+   if (fseek64(fp, 0LL, SEEK_SET) != 0) goto ERROR_CLEANUP;
+
+   /* size index to power of 2 buckets, at LEIDX_LOAD entries per bucket */
+   for (nbuckets = 1; nbuckets < (word32) (count / LEIDX_LOAD) + 1; ) {
+      nbuckets <<= 1;
+   }
+   buckets = malloc((size_t) nbuckets * sizeof(LEIDXBUCKET));
+   if (buckets == NULL) goto ERROR_CLEANUP;
+   memset(buckets, 0xff, (size_t) nbuckets * sizeof(LEIDXBUCKET));
+
+   /* prepare header -- bound to ledger file */
+   memset(&hdr, 0, sizeof(hdr));
+   memcpy(hdr.magic, LEIDX_MAGIC, sizeof(hdr.magic));
+   hdr.nbuckets = nbuckets;
+   hdr.nledger = (word64) count;
+   if (le__idx_bind(fp, &hdr) != VEOK) goto ERROR_CLEANUP;
+
+   /* insert every ledger entry tag, in ledger order */
+   for (idx = 0; idx < count; idx++) {
+      if (fread(&le, sizeof(LENTRY), 1, fp) != 1) goto RDERR_CLEANUP;
+      if (idx == 0) memcpy(hdr.first, le.addr, ADDR_LEN);
+      hash = le__idxhash(ADDR_TAG_PTR(le.addr));
+      for (b = (word32) hash & (nbuckets - 1); ; b = (b + 1) & (nbuckets - 1)) {
+         bp = &buckets[b];
+         for (j = 0; j < LEIDX_SLOTS && bp->slot[j] != LEIDX_EMPTY; j++);
+         if (j < LEIDX_SLOTS) break;
+      }
+      bp->fp[j] = (word32) (hash >> 32);
+      bp->slot[j] = (word32) idx;
+   }
+   memcpy(hdr.last, le.addr, ADDR_LEN);
+
+   /* write index to temporary file, and move into place */
+   ifp = fopen(tmpname, "wb");
+   if (ifp == NULL) goto ERROR_CLEANUP;
+   if (fwrite(&hdr, sizeof(hdr), 1, ifp) != 1) goto ERROR_CLEANUP;
+   if (fwrite(buckets, sizeof(LEIDXBUCKET), nbuckets, ifp) != nbuckets) {
+      goto ERROR_CLEANUP;
+   }
+   if (fclose(ifp) != 0) {
+      ifp = NULL;
+      goto ERROR_CLEANUP;
+   }
+   ifp = NULL;
+   if (rename(tmpname, idxname) != 0) goto ERROR_CLEANUP;
+
+   /* cleanup */
+   free(buckets);
+   fclose(fp);
+
+   return VEOK;
+
+   /* cleanup / error handling */
+RDERR_CLEANUP:
+   if (!ferror(fp)) {
+      set_errno(EMCM_EOF);
+   }
+ERROR_CLEANUP:
+   if (ifp) fclose(ifp);
+   if (buckets) free(buckets);
+   remove(tmpname);
+   fclose(fp);
+
+   return VERROR;
+}  /* end le_index_build() */
+
+/**
+ * Update the ledger index after a ledger file is (re)written, or replaced
+ * by other means (e.g. renamed into place). MUST be called by every path
+ * that replaces a ledger file. Index is rebuilt if enabled with
+ * ENABLE_LEDGER_INDEX, else any (now stale) index is removed. Failure is
+ * not fatal; le_find() uses binary search.
+ * @param lefile Filename of the ledger file
+*/
+void le_index_update(const char *lefile)
+{
+#ifdef ENABLE_LEDGER_INDEX
+   if (le_index_build(lefile) != VEOK) {
+      perrno("failed to build ledger index for %s", lefile);
+   }
+
+#else
+   char idxname[LEIDX_FNAMELEN];
+
+   /* remove (now stale) ledger index */
+   remove(le__idxname(idxname, lefile));
+
+#endif
+}  /* end le_index_update() */
+
 /**
  * Extract a ledger from a LEGACY neogenesis block. Checks sort.
  * @note Due to nuances in v2.x ledger processing, this function uses an
@@ -527,6 +1077,9 @@ int le_extract(const char *ngfile, const char *lefile)
    fclose(lfp);
    fclose(fp);
 
+   /* (re)build ledger index for extracted ledger */
+   le_index_update(lefile);
+
    /* ledger extracted */
    return VEOK;
 
@@ -555,17 +1108,11 @@ void print_n_bytes(const char *msg, const void *data, size_t len)
 }
 
 /**
- * Update the ledger by applying deltas from a ledger transaction file.
- * Ledger transaction file is sorted by addr+code, '-' comes before 'A'.
- * Ledger file is kept sorted on addr. Ledger file must have been opened
- * with le_open().
- * @param ltfname Filename of the Ledger transaction (deltas) file
- * @return (int) value representing the update result
- * @retval VEBAD2 on malicious; check errno for details
- * @retval VERROR on error; check errno for details
- * @retval VEOK on success
- */
-int le_update(const char *ltfname)
+ * @private
+ * Update ledger by applying ledger transaction deltas. See le_update()
+ * for details.
+*/
+static int le__update(const char *ltfname)
 {
    LENTRY le_hold;         /* for ledger entry hold data */
    LENTRY le, le_prev;     /* for ledger entry and sequence check data */
@@ -729,6 +1276,9 @@ int le_update(const char *ltfname)
    remove(Lefile);
    if (rename("ledger.update", Lefile) != 0) return VERROR;
 
+   /* (re)build ledger index for updated ledger */
+   le_index_update(Lefile);
+
    /* return result of reopen ledger */
    return le_open(Lefile);
 
@@ -746,6 +1296,29 @@ CLEANUP:
       remove("ledger.update");
    }
 
+   return ecode;
+}  /* end le__update() */
+
+/**
+ * Update the ledger by applying deltas from a ledger transaction file.
+ * Ledger transaction file is sorted by addr+code, '-' comes before 'A'.
+ * Ledger file is kept sorted on addr. Ledger file must have been opened
+ * with le_open().
+ * @param ltfname Filename of the Ledger transaction (deltas) file
+ * @return (int) value representing the update result
+ * @retval VEBAD2 on malicious; check errno for details
+ * @retval VERROR on error; check errno for details
+ * @retval VEOK on success
+ */
+int le_update(const char *ltfname)
+{
+   word64 start;
+   int ecode;
+
+   start = metrics_time();
+   ecode = le__update(ltfname);
+   metrics_observe(METRICS_LE_UPDATE, start);
+
    return ecode;
 }  /* end le_update() */
 
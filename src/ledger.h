@@ -21,6 +21,22 @@
    #define LEBUFSZ ( 1 << 26 ) /* 64M */
 #endif
 
+#ifndef LEBUFCOUNT
+   /**
+    * Number of ledger entries per buffered read, for sequential
+    * (streaming) ledger operations.
+   */
+   #define LEBUFCOUNT 4096
+#endif
+
+#ifndef LEBATCHRATIO
+   /**
+    * Ratio of ledger entries to batch addresses, at or below which
+    * le_find_batch() resolves a batch with a sequential ledger scan.
+   */
+   #define LEBATCHRATIO 64
+#endif
+
 /* global variables */
 extern word32 Sanctuary;
 extern word32 Lastday;
@@ -43,6 +59,10 @@ void le_close(void);
 int le_extract_legacy(const char *ngfile);
 int le_extract(const char *ngfile, const char *lefile);
 int le_find(const word8 *addr, LENTRY *le, word16 len);
+size_t le_find_batch(const void *addrs, size_t stride, size_t count,
+   LENTRY *les, word8 *found, word16 len);
+int le_index_build(const char *lefile);
+void le_index_update(const char *lefile);
 int le_renew(void);
 int le_update(const char *ltfname);
 int tag_compare(const void *a, const void *b);
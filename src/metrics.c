@@ -0,0 +1,439 @@
+/**
+ * @private
+ * @headerfile metrics.h <metrics.h>
+ * @copyright Adequate Systems LLC, 2018-2022. All Rights Reserved.
+ * <br />For license information, please refer to ../LICENSE.md
+*/
+
+/* include guard */
+#ifndef MOCHIMO_METRICS_C
+#define MOCHIMO_METRICS_C
+
+
+#include "metrics.h"
+
+/* internal support */
+#include "network.h"
+#include "error.h"
+
+/* external support */
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>   /* for mmap() */
+#include "extinet.h"
+#include "extthrd.h"
+
+#ifndef _WIN32
+   #include <poll.h>    /* for POLLIN, POLLOUT */
+
+#endif
+
+/**
+ * @private
+ * Length of the (static) buffer of a scrape response body.
+*/
+#define METRICS_BODYLEN 65536
+
+/**
+ * @private
+ * Length of the buffer of a scrape request.
+*/
+#define METRICS_REQLEN  1024
+
+/**
+ * @private
+ * Seconds allowed to serve a scrape request, see metrics_serve().
+*/
+#define METRICS_TIMEOUT 1
+
+/**
+ * @private
+ * Seconds between checks of the endpoint thread for a stop request.
+*/
+#define METRICS_WAKE    0.25
+
+#define METRICS__NAME(ID, NAME, HELP) NAME,
+#define METRICS__HELP(ID, NAME, HELP) HELP,
+
+/* counter and histogram names and descriptions, by identifier */
+static const char *Mcname[] = { METRICS__CTABLE(METRICS__NAME) };
+static const char *Mchelp[] = { METRICS__CTABLE(METRICS__HELP) };
+static const char *Mhname[] = { METRICS__HTABLE(METRICS__NAME) };
+static const char *Mhhelp[] = { METRICS__HTABLE(METRICS__HELP) };
+
+/* histogram bucket upper bounds, in microseconds, and as labels */
+static const word64 Mbound[METRICS_BUCKETS] = {
+   100, 500, 1000, 5000, 10000, 50000,
+   100000, 500000, 1000000, 5000000, 10000000, 30000000
+};
+static const char *Mlabel[METRICS_BUCKETS] = {
+   "0.0001", "0.0005", "0.001", "0.005", "0.01", "0.05",
+   "0.1", "0.5", "1", "5", "10", "30"
+};
+
+/* metrics state */
+static METRICS *Metrics;   /* shared metrics, or NULL */
+static SOCKET Mlsd = INVALID_SOCKET;
+static ThreadId Mtid;      /* endpoint thread, while Mlsd is valid */
+static int Mstop;          /* non-zero to stop endpoint thread */
+static char Mbody[METRICS_BODYLEN];  /* used by endpoint thread only */
+
+/**
+ * @private
+ * Append formatted text to a buffer, without overflow.
+ * @param buf Pointer to buffer to append to
+ * @param len Length of buffer, in bytes
+ * @param n Length of text already in buffer
+ * @param fmt Format string of text to append
+ * @returns Length of text in buffer, after append (truncated)
+*/
+static size_t metrics_append(char *buf, size_t len, size_t n,
+   const char *fmt, ...)
+{
+   va_list args;
+   int count;
+
+   if (n + 1 >= len) return n;
+   va_start(args, fmt);
+   count = vsnprintf(buf + n, len - n, fmt, args);
+   va_end(args);
+   if (count < 0) return n;
+   n += (size_t) count;
+
+   return n < len ? n : len - 1;
+}  /* end metrics_append() */
+
+/**
+ * @private
+ * Append a histogram, in Prometheus text format, to a buffer.
+ * @param buf Pointer to buffer to append to
+ * @param len Length of buffer, in bytes
+ * @param n Length of text already in buffer
+ * @param name Full name of histogram metric
+ * @param label Label of histogram, as `name="value"`, or ""
+ * @param hp Pointer to histogram to append
+ * @returns Length of text in buffer, after append (truncated)
+*/
+static size_t metrics_append_hist(char *buf, size_t len, size_t n,
+   const char *name, const char *label, METRICS_HIST *hp)
+{
+   const char *lb, *rb, *sep;
+   word64 count, cumulative;
+   int j;
+
+   lb = *label ? "{" : "";
+   rb = *label ? "}" : "";
+   sep = *label ? "," : "";
+   cumulative = 0;
+   for (j = 0; j < METRICS_BUCKETS; j++) {
+      cumulative += __atomic_load_n(&hp->bucket[j], __ATOMIC_RELAXED);
+      n = metrics_append(buf, len, n, "%s_bucket{%s%sle=\"%s\"} %llu\n",
+         name, label, sep, Mlabel[j], (unsigned long long) cumulative);
+   }
+   /* concurrent observations may (briefly) leave count behind buckets */
+   count = __atomic_load_n(&hp->count, __ATOMIC_RELAXED);
+   if (count < cumulative) count = cumulative;
+   n = metrics_append(buf, len, n, "%s_bucket{%s%sle=\"+Inf\"} %llu\n",
+      name, label, sep, (unsigned long long) count);
+   n = metrics_append(buf, len, n, "%s_sum%s%s%s %.6f\n", name, lb, label,
+      rb, (double) __atomic_load_n(&hp->sum, __ATOMIC_RELAXED) / 1e6);
+   n = metrics_append(buf, len, n, "%s_count%s%s%s %llu\n", name, lb, label,
+      rb, (unsigned long long) count);
+
+   return n;
+}  /* end metrics_append_hist() */
+
+/**
+ * @private
+ * Record an observation, since @a start, in a histogram.
+ * @param hp Pointer to histogram
+ * @param start Time of start of observation, from metrics_time()
+*/
+static void metrics_hist_observe(METRICS_HIST *hp, word64 start)
+{
+   word64 us;
+   int j;
+
+   us = metrics_time() - start;
+   for (j = 0; j < METRICS_BUCKETS && us > Mbound[j]; j++);
+   if (j < METRICS_BUCKETS) {
+      __atomic_fetch_add(&hp->bucket[j], 1, __ATOMIC_RELAXED);
+   }
+   __atomic_fetch_add(&hp->sum, us, __ATOMIC_RELAXED);
+   __atomic_fetch_add(&hp->count, 1, __ATOMIC_RELAXED);
+}  /* end metrics_hist_observe() */
+
+/**
+ * @private
+ * Send data to a (non-blocking) socket, until a deadline.
+ * @param sd Socket to send to
+ * @param data Pointer to data to send
+ * @param len Length of data to send, in bytes
+ * @param deadline Deadline, from net_deadline()
+ * @returns VEOK on success, else VERROR
+*/
+static int metrics_send(SOCKET sd, const char *data, size_t len,
+   word64 deadline)
+{
+   size_t n;
+   int count;
+
+   for (n = 0; n < len; n += (size_t) count) {
+      count = send(sd, data + n, len - n, 0);
+      if (count < 0) {
+         if (!sock_waiting(sock_errno)) return VERROR;
+         if (net_wait(sd, POLLOUT, deadline) != VEOK) return VERROR;
+         count = 0;
+      }
+   }
+
+   return VEOK;
+}  /* end metrics_send() */
+
+/**
+ * @private
+ * Serve a scrape request, on a (non-blocking) socket. Requests are read
+ * up to the end of the request header, and answered, within a deadline
+ * of METRICS_TIMEOUT seconds. Only GET requests are served; any path is
+ * served with all metrics.
+ * @param sd Socket of scrape request
+ * @returns VEOK on success, else VERROR
+*/
+static int metrics_serve(SOCKET sd)
+{
+   char req[METRICS_REQLEN];
+   char hdr[128];
+   word64 deadline;
+   size_t n, len;
+   int count;
+
+   /* receive request header */
+   deadline = net_deadline(METRICS_TIMEOUT);
+   for (n = 0; n < sizeof(req) - 1; n += (size_t) count) {
+      count = recv(sd, req + n, sizeof(req) - 1 - n, 0);
+      if (count == 0) return VERROR;
+      if (count < 0) {
+         if (!sock_waiting(sock_errno)) return VERROR;
+         if (net_wait(sd, POLLIN, deadline) != VEOK) return VERROR;
+         count = 0;
+         continue;
+      }
+      req[n + (size_t) count] = '\0';
+      if (strstr(req, "\r\n\r\n") || strstr(req, "\n\n")) break;
+   }
+
+   /* read-only endpoint */
+   if (strncmp(req, "GET ", 4) != 0) {
+      strcpy(hdr, "HTTP/1.0 405 Method Not Allowed\r\n"
+         "Allow: GET\r\nContent-Length: 0\r\n\r\n");
+      return metrics_send(sd, hdr, strlen(hdr), deadline);
+   }
+
+   len = metrics_format(Mbody, sizeof(Mbody));
+   snprintf(hdr, sizeof(hdr), "HTTP/1.0 200 OK\r\n"
+      "Content-Type: text/plain; version=0.0.4\r\n"
+      "Content-Length: %lu\r\n\r\n", (unsigned long) len);
+   if (metrics_send(sd, hdr, strlen(hdr), deadline) != VEOK) return VERROR;
+
+   return metrics_send(sd, Mbody, len, deadline);
+}  /* end metrics_serve() */
+
+/**
+ * @private
+ * Metrics endpoint thread; accepts and serves scrape requests, one at a
+ * time, until stopped. Scrapes never delay the server loop.
+*/
+static ThreadProc metrics_thread(void *arg)
+{
+   SOCKET sd;
+
+   (void) arg;
+   while (!__atomic_load_n(&Mstop, __ATOMIC_ACQUIRE)) {
+      /* wait (briefly) for a scrape request */
+      if (net_wait(Mlsd, POLLIN, net_deadline(METRICS_WAKE)) != VEOK) {
+         continue;
+      }
+      sd = accept(Mlsd, NULL, NULL);
+      if (sd == INVALID_SOCKET) continue;
+      if (sock_set_nonblock(sd) != SOCKET_ERROR) {
+         if (metrics_serve(sd) != VEOK) pdebug("metrics: scrape failed");
+      }
+      sock_close(sd);
+   }
+
+   Unthread;
+}  /* end metrics_thread() */
+
+/**
+ * Format all metrics in the Prometheus text exposition format (0.0.4).
+ * Per-opcode histograms are included only for opcodes observed.
+ * @param buf Pointer to buffer to place formatted metrics
+ * @param len Length of buffer, in bytes
+ * @returns Length of formatted metrics in @a buf (excluding the null
+ * terminator), which may be truncated to `len - 1`
+*/
+size_t metrics_format(char *buf, size_t len)
+{
+   char name[64], label[32];
+   size_t n;
+   unsigned op;
+   int j;
+
+   if (len == 0) return 0;
+   buf[0] = '\0';
+   if (Metrics == NULL) return 0;
+
+   n = 0;
+   for (j = 0; j < METRICS_COUNTERS; j++) {
+      snprintf(name, sizeof(name), "mochimo_%s_total", Mcname[j]);
+      n = metrics_append(buf, len, n, "# HELP %s %s\n# TYPE %s counter\n"
+         "%s %llu\n", name, Mchelp[j], name, name, (unsigned long long)
+         __atomic_load_n(&Metrics->counter[j], __ATOMIC_RELAXED));
+   }
+   for (j = 0; j < METRICS_HISTS; j++) {
+      snprintf(name, sizeof(name), "mochimo_%s_seconds", Mhname[j]);
+      n = metrics_append(buf, len, n, "# HELP %s %s\n# TYPE %s histogram\n",
+         name, Mhhelp[j], name);
+      n = metrics_append_hist(buf, len, n, name, "", &Metrics->hist[j]);
+   }
+   n = metrics_append(buf, len, n, "# HELP mochimo_op_seconds "
+      "Latency of request handling, per opcode\n"
+      "# TYPE mochimo_op_seconds histogram\n");
+   for (op = 0; op < METRICS_OPS; op++) {
+      if (__atomic_load_n(&Metrics->op[op].count, __ATOMIC_RELAXED) == 0) {
+         continue;
+      }
+      snprintf(label, sizeof(label), "op=\"%s\"", op2str(op));
+      n = metrics_append_hist(buf, len, n, "mochimo_op_seconds", label,
+         &Metrics->op[op]);
+   }
+
+   return n;
+}  /* end metrics_format() */
+
+/**
+ * Close the metrics endpoint, stopping its thread, and unmap shared
+ * metrics. Metrics updates are ignored thereafter.
+*/
+void metrics_free(void)
+{
+   METRICS *mp;
+
+   if (Mlsd != INVALID_SOCKET) {
+      __atomic_store_n(&Mstop, 1, __ATOMIC_RELEASE);
+      thread_join(Mtid);
+      sock_close(Mlsd);
+   }
+   Mlsd = INVALID_SOCKET;
+   mp = Metrics;
+   Metrics = NULL;
+   if (mp) munmap(mp, sizeof(METRICS));
+}  /* end metrics_free() */
+
+/**
+ * Increment a metrics counter.
+ * @param id Identifier of counter, METRICS_* (see METRICS__CTABLE)
+*/
+void metrics_inc(int id)
+{
+   if (Metrics == NULL || id < 0 || id >= METRICS_COUNTERS) return;
+   __atomic_fetch_add(&Metrics->counter[id], 1, __ATOMIC_RELAXED);
+}  /* end metrics_inc() */
+
+/**
+ * Initialize (zeroed) metrics in anonymous shared memory. MUST be called
+ * before forking processes whose updates are to be visible to the caller.
+ * @returns VEOK on success, else VERROR; check errno for details
+*/
+int metrics_init(void)
+{
+   void *mem;
+
+   if (Metrics) return VEOK;
+   mem = mmap(NULL, sizeof(METRICS), PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+   if (mem == MAP_FAILED) return VERROR;
+   Metrics = (METRICS *) mem;
+
+   return VEOK;
+}  /* end metrics_init() */
+
+/**
+ * Listen for scrape requests on the loopback address, on @a port.
+ * Requests are served by a dedicated thread, until metrics_free().
+ * @param port Listening port of metrics endpoint
+ * @returns VEOK on success, else VERROR; check errno for details
+*/
+int metrics_listen(word16 port)
+{
+   struct sockaddr_in addr;
+   int ecode, on = 1;
+
+   if (Mlsd != INVALID_SOCKET) return VEOK;
+   Mlsd = socket(AF_INET, SOCK_STREAM, 0);
+   if (Mlsd == INVALID_SOCKET) return VERROR;
+   memset(&addr, 0, sizeof(addr));
+   addr.sin_port = htons(port);
+   addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+   addr.sin_family = AF_INET;
+   setsockopt(Mlsd, SOL_SOCKET, SO_REUSEADDR, (void *) &on, sizeof(on));
+   if (bind(Mlsd, (struct sockaddr *) &addr, sizeof(addr)) != 0) goto FAIL;
+   if (sock_set_nonblock(Mlsd) == SOCKET_ERROR) goto FAIL;
+   if (listen(Mlsd, 8) != 0) goto FAIL;
+
+   /* serve scrape requests */
+   __atomic_store_n(&Mstop, 0, __ATOMIC_RELEASE);
+   ecode = thread_create(&Mtid, metrics_thread, NULL);
+   if (ecode != 0) {
+      set_errno(ecode);
+      goto FAIL;
+   }
+
+   return VEOK;
+
+FAIL:
+   sock_close(Mlsd);
+   Mlsd = INVALID_SOCKET;
+
+   return VERROR;
+}  /* end metrics_listen() */
+
+/**
+ * Record a latency observation, since @a start, in a named histogram.
+ * @param id Identifier of histogram, METRICS_* (see METRICS__HTABLE)
+ * @param start Time of start of observation, from metrics_time()
+*/
+void metrics_observe(int id, word64 start)
+{
+   if (Metrics == NULL || id < 0 || id >= METRICS_HISTS) return;
+   metrics_hist_observe(&Metrics->hist[id], start);
+}  /* end metrics_observe() */
+
+/**
+ * Record a latency observation, since @a start, of handling a request.
+ * @param op Opcode of request; unknown opcodes are ignored
+ * @param start Time of start of observation, from metrics_time()
+*/
+void metrics_observe_op(unsigned op, word64 start)
+{
+   if (Metrics == NULL || op >= METRICS_OPS) return;
+   metrics_hist_observe(&Metrics->op[op], start);
+}  /* end metrics_observe_op() */
+
+/**
+ * Get the time, for latency observations, in microseconds of a
+ * monotonic clock.
+ * @returns Monotonic time, in microseconds
+*/
+word64 metrics_time(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (word64) ts.tv_sec * 1000000 + (word64) ts.tv_nsec / 1000;
+}  /* end metrics_time() */
+
+/* end include guard */
+#endif
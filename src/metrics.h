@@ -0,0 +1,118 @@
+/**
+ * @file metrics.h
+ * @brief Mochimo hot-path metrics, counters and latency histograms.
+ * @details Metrics are updated from request worker threads, as well as
+ * from the processes still forked by the server (e.g. send_found() and
+ * mirror()), so they are held in shared memory and updated atomically,
+ * without locks. Before metrics_init(), all updates are ignored.
+ * <br />
+ * Metrics may be scraped, read-only, from a local (loopback) endpoint
+ * in the Prometheus text exposition format, served by its own thread,
+ * see metrics_listen().
+ * @copyright Adequate Systems LLC, 2018-2022. All Rights Reserved.
+ * <br />For license information, please refer to ../LICENSE.md
+*/
+
+/* include guard */
+#ifndef MOCHIMO_METRICS_H
+#define MOCHIMO_METRICS_H
+
+
+#include <stddef.h>
+#include "types.h"
+
+/**
+ * Number of latency histogram buckets, excluding the implicit "+Inf".
+*/
+#define METRICS_BUCKETS 12
+
+/**
+ * Number of per-opcode latency histograms, for opcodes 0 to OP_IDENTIFY.
+*/
+#define METRICS_OPS     (OP_IDENTIFY + 1)
+
+/**
+ * Counters table, as (ID, NAME, HELP). Counters are exposed with the
+ * "mochimo_" prefix and the "_total" suffix.
+*/
+#define METRICS__CTABLE(METRICS__ITEM) \
+   METRICS__ITEM(METRICS_RECVS, "recvs", "Packets received") \
+   METRICS__ITEM(METRICS_RECVERRS, "recverrs", "Packet receive errors") \
+   METRICS__ITEM(METRICS_SENDS, "sends", "Packets sent") \
+   METRICS__ITEM(METRICS_LOGINS, "logins", "Transactions received (raw)") \
+   METRICS__ITEM(METRICS_BADLOGS, "badlogs", "Bad requests received") \
+   METRICS__ITEM(METRICS_DUPS, "dups", "Duplicate transactions received") \
+   METRICS__ITEM(METRICS_TXGOOD, "txgood", "Valid transactions received") \
+   METRICS__ITEM(METRICS_BALANCE, "balance", "Balance requests served") \
+   METRICS__ITEM(METRICS_UPDATED, "updated", "Blocks updated") \
+   METRICS__ITEM(METRICS_TIMEOUTS, "timeouts", "Connection timeouts")
+
+/**
+ * Latency histograms table, as (ID, NAME, HELP). Histograms are exposed
+ * with the "mochimo_" prefix and the "_seconds" suffix.
+*/
+#define METRICS__HTABLE(METRICS__ITEM) \
+   METRICS__ITEM(METRICS_TX_VAL, "tx_val", "Latency of tx_val()") \
+   METRICS__ITEM(METRICS_B_VAL, "b_val", "Latency of b_val()") \
+   METRICS__ITEM(METRICS_LE_UPDATE, "le_update", "Latency of le_update()") \
+   METRICS__ITEM(METRICS_B_UPDATE, "b_update", "Latency of b_update()") \
+   METRICS__ITEM(METRICS_SEND_FILE, "send_file", "Latency of send_file()")
+
+#define METRICS__ENUM(ID, NAME, HELP) ID,
+
+/**
+ * Metrics counter identifiers.
+*/
+enum metrics_counter_t {
+   METRICS__CTABLE(METRICS__ENUM)
+   METRICS_COUNTERS  /**< Number of counters */
+};
+
+/**
+ * Metrics latency histogram identifiers.
+*/
+enum metrics_hist_t {
+   METRICS__HTABLE(METRICS__ENUM)
+   METRICS_HISTS     /**< Number of (named) histograms */
+};
+
+#undef METRICS__ENUM
+
+/**
+ * Metrics latency histogram. Bucket counts are not cumulative.
+*/
+typedef struct {
+   word64 bucket[METRICS_BUCKETS];  /**< observations per bucket */
+   word64 count;                    /**< total observations */
+   word64 sum;                      /**< sum of observations, in us */
+} METRICS_HIST;
+
+/**
+ * Metrics shared memory layout.
+*/
+typedef struct {
+   word64 counter[METRICS_COUNTERS];   /**< counters */
+   METRICS_HIST hist[METRICS_HISTS];   /**< named latency histograms */
+   METRICS_HIST op[METRICS_OPS];       /**< per-opcode latency histograms */
+} METRICS;
+
+/* C/C++ compatible function prototypes */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+size_t metrics_format(char *buf, size_t len);
+void metrics_free(void);
+void metrics_inc(int id);
+int metrics_init(void);
+int metrics_listen(word16 port);
+void metrics_observe(int id, word64 start);
+void metrics_observe_op(unsigned op, word64 start);
+word64 metrics_time(void);
+
+#ifdef __cplusplus
+}  /* end extern "C" */
+#endif
+
+/* end include guard */
+#endif
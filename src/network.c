@@ -18,11 +18,17 @@
 #include "sync.h"
 #include "parallel.h"
 #include "ledger.h"
+#include "metrics.h"
+#include "pstat.h"
 #include "global.h"
 #include "error.h"
+#include "bcomp.h"
 
 /* external support */
+#include <stddef.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include "exttime.h"
 #include "extthrd.h"
 #include "extmath.h"
@@ -30,110 +36,274 @@
 #include "extinet.h"
 #include "crc16.h"
 
+#ifdef _WIN32
+   #define poll(fds, nfds, ms)   WSAPoll(fds, nfds, ms)
+
+#else
+   #include <pthread.h>  /* for pthread_atfork() */
+   #include <poll.h>
+
+#endif
+
 #define valid_op(op)  ((op) >= FIRST_OP && (op) <= LAST_OP)
 #define crowded(op)   (Nonline > (MAXNODES - 5) && (op) != OP_FOUND)
-#define can_fork_tx() (Nonline <= (MAXNODES - 5))
 
-#define TXHDRLEN 124
-#define TXTLRLEN 4
+/* packet buffers per slab allocation, of the packet buffer pool */
+#define PKTSLAB 16
+
+/* ensure packet header length matches packet buffer offset */
+STATIC_ASSERT(offsetof(TX, buffer) == TXHDRLEN, TXHDRLEN_offset);
+
+/* packet buffer pool slot, preceding each packet buffer */
+typedef union PKTSLOT {
+   union PKTSLOT *next; /* next free slot, while free */
+   size_t cls;          /* size class of slot, while allocated */
+   word64 align[2];     /* retains 16 byte alignment of packet buffers */
+} PKTSLOT;
+
+/* packet buffer pool size classes, by packet buffer (data) capacity;
+ * any fixed size reply (e.g. OP_NACK), any transaction, and any packet */
+static const size_t Pktcap[] = { 512, 16384, sizeof(((TX *) NULL)->buffer) };
+#define PKTCLASSES   ( sizeof(Pktcap) / sizeof(*Pktcap) )
+
+/* packet buffer pool free lists, per size class, and lock */
+static PKTSLOT *Pktfree[PKTCLASSES];
+static Mutex Pktlock = MUTEX_INITIALIZER;
 
-NODE Nodes[MAXNODES];   /* data structure for connected NODE's */
-NODE *Hi_node = Nodes;  /* points one beyond last logged in NODE */
 word32 Nrecvs;          /* number of receive errors */
 word32 Nsends;          /* number of send errors */
 word32 Nrecverrs;       /* number of receive errors */
 word32 Nsenderrs;       /* number of send errors */
 
+#ifndef _WIN32
+
 /**
- * Is called after initial accept() or connect()
- * Adds the connection to Node[] array.
- * and returns a new NODE * with *np's data.
+ * @private
+ * Fork handler; acquire the packet buffer pool lock before fork(), such
+ * that forked children do not inherit a lock held by another thread.
 */
-NODE *getslot(NODE *np)
+static void pkt_atfork_prepare(void)
 {
-   NODE *newnp;
+   mutex_lock(&Pktlock);
+}  /* end pkt_atfork_prepare() */
 
-   /*
-    * Find empty slot
-    */
-   for(newnp = Nodes; newnp < &Nodes[MAXNODES]; newnp++)
-      if(newnp->pid == 0) break;
+/**
+ * @private
+ * Fork handler; release the packet buffer pool lock after fork().
+*/
+static void pkt_atfork_release(void)
+{
+   mutex_unlock(&Pktlock);
+}  /* end pkt_atfork_release() */
 
-   if(newnp >= &Nodes[MAXNODES]) {
-      perr("Nodes[] full!");
-      Nspace++;
-      return NULL;
-   }
+#endif
+
+/**
+ * @private
+ * Get the time of a monotonic clock, for I/O deadlines.
+ * @returns Monotonic time, in milliseconds
+*/
+static word64 net_ms(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (word64) ts.tv_sec * 1000 + (word64) ts.tv_nsec / 1000000;
+}  /* end net_ms() */
+
+/**
+ * Get an I/O deadline, @a timeout seconds from now, for net_wait().
+ * @param timeout Timeout, in seconds (fractions allowed)
+ * @returns Deadline, in milliseconds of a monotonic clock
+*/
+word64 net_deadline(double timeout)
+{
+   if (timeout <= 0) return net_ms();
+   return net_ms() + (word64) (timeout * 1000.0);
+}  /* end net_deadline() */
 
-   Nonline++;    /* number of currently connected sockets */
-   pdebug("added NODE %d", (int) (newnp - Nodes));
-   if (newnp >= Hi_node) Hi_node = newnp + 1;
-   memcpy(newnp, np, sizeof(NODE));
-   return newnp;
-}  /* end getslot() */
+/**
+ * Wait for a (non-blocking) socket to become ready, until a deadline.
+ * Readiness includes error and hangup conditions, which are left for
+ * the following recv() or send() to report.
+ * @param sd Socket to wait on
+ * @param events Events to wait for, POLLIN or POLLOUT
+ * @param deadline Deadline, from net_deadline()
+ * @return (int) value representing wait result
+ * @retval VETIMEOUT on deadline; errno is set to ETIMEDOUT
+ * @retval VERROR on error; check errno for details
+ * @retval VEOK when ready
+*/
+int net_wait(SOCKET sd, short events, word64 deadline)
+{
+   struct pollfd pfd;
+   word64 now;
+   int ecode;
 
-/* Mark NODE np in Nodes[] empty by setting np->pid to zero.
- * Adjust Nonline and Hi_node.
- * Caller must close np->sd if needed.
+   pfd.fd = sd;
+   pfd.events = events;
+   for (;;) {
+      now = net_ms();
+      if (now >= deadline) {
+         set_errno(ETIMEDOUT);
+         return VETIMEOUT;
+      }
+      pfd.revents = 0;
+      ecode = poll(&pfd, 1, (int) (deadline - now));
+      if (ecode > 0) return VEOK;
+      if (ecode < 0 && sock_errno != EINTR) return VERROR;
+   }
+}  /* end net_wait() */
+
+/**
+ * Allocate a packet buffer from the packet buffer pool, with capacity
+ * for (at least) @a len bytes of packet data. Packet buffers are taken
+ * from slabs of the smallest size class that fits, such that most packets
+ * (a few dozen bytes) occupy only a fraction of a full TX structure.
+ * The packet header is zeroed. Fields of a TX structure beyond the
+ * capacity of a packet buffer (incl. crc16 and trailer) MUST NOT be used.
+ * @param len Length of packet data to be held by packet buffer
+ * @return (TX *) Pointer to packet buffer, or NULL on error; check errno
  */
-int freeslot(NODE *np)
+TX *pkt_alloc(size_t len)
 {
-   if(np->pid == 0) {
-      perr("*** NODE %ld already free ***", (long) (np - Nodes));
-      return VERROR;
+#ifndef _WIN32
+   static int registered;
+#endif
+   PKTSLOT *slot;
+   word8 *slab;
+   size_t cls, size, j;
+
+   /* find smallest size class that fits */
+   for (cls = 0; cls < PKTCLASSES && Pktcap[cls] < len; cls++);
+   if (cls == PKTCLASSES) {
+      set_errno(EINVAL);
+      return NULL;
    }
-   pdebug("idx=%d  ip = %s pid = %d", (int) (np - Nodes),
-           ntoa(&np->ip, NULL), (int) np->pid);
-   Nonline--;
-   np->pid = 0;
-   /* Update pointer to just beyond highest used slot in Nodes[] */
-   while(Hi_node > Nodes && (Hi_node - 1)->pid == 0)
-      Hi_node--;
-   if (Nonline < 0) {
-      Nonline = 0;
-      perr("Nonline < 0");
-      return VERROR;
+
+   mutex_lock(&Pktlock);
+#ifndef _WIN32
+   /* register fork handlers, once */
+   if (!registered) {
+      if (pthread_atfork(pkt_atfork_prepare, pkt_atfork_release,
+            pkt_atfork_release) == 0) registered = 1;
    }
-   return VEOK;
-}  /* end freeslot() */
+#endif
+   if (Pktfree[cls] == NULL) {
+      /* allocate a slab of slots, and chain slots as free */
+      size = sizeof(PKTSLOT) + TXHDRLEN + Pktcap[cls] + TXTLRLEN;
+      size = (size + sizeof(PKTSLOT) - 1) & ~(sizeof(PKTSLOT) - 1);
+      slab = malloc(size * PKTSLAB);
+      for (j = 0; slab != NULL && j < PKTSLAB; j++) {
+         slot = (PKTSLOT *) (slab + (j * size));
+         slot->next = Pktfree[cls];
+         Pktfree[cls] = slot;
+      }
+   }
+   /* take slot from free list */
+   slot = Pktfree[cls];
+   if (slot != NULL) Pktfree[cls] = slot->next;
+   mutex_unlock(&Pktlock);
+   if (slot == NULL) return NULL;
 
-/* Return child status of pid.
- * Add peer ip to lists if needed.
- * Increment counts.
- * Returns 1 if child did not call exit(1),
- * else the exit() code (which can also be 1).
+   slot->cls = cls;
+   memset(slot + 1, 0, TXHDRLEN);
+
+   return (TX *) (slot + 1);
+}  /* end pkt_alloc() */
+
+/**
+ * Get the capacity, in bytes of packet data, of a packet buffer.
+ * @param pkt Pointer to packet buffer, from pkt_alloc()
+ * @return (size_t) Packet data capacity of packet buffer
  */
-int child_status(NODE *np, pid_t pid, int status)
+size_t pkt_cap(const TX *pkt)
 {
-   pdebug("pid = %d  status = 0x%x", pid, status);
-   if(pid > 0) {  /* child existed and called exit() */
-      if(WIFEXITED(status)) {
-         status = WEXITSTATUS(status);
-         if(status != 0) {
-            if(status >= 2) epinklist(np->ip);
-            if(status >= 3) pinklist(np->ip);
-            return status;
-         }
-      } else return 1;  /* error if not exited */
-      return status;  /* 0 */
-   }  /* end if child exit()'ed */
-   return 1;  /* error if child caught signal */
-}  /* end child_status() */
+   return Pktcap[(((const PKTSLOT *) pkt) - 1)->cls];
+}  /* end pkt_cap() */
+
+/**
+ * Return a packet buffer to the packet buffer pool.
+ * @param pkt Pointer to packet buffer, from pkt_alloc(), or NULL
+ */
+void pkt_free(TX *pkt)
+{
+   PKTSLOT *slot;
+   size_t cls;
+
+   if (pkt == NULL) return;
+
+   slot = ((PKTSLOT *) pkt) - 1;
+   cls = slot->cls;
+   mutex_lock(&Pktlock);
+   slot->next = Pktfree[cls];
+   Pktfree[cls] = slot;
+   mutex_unlock(&Pktlock);
+}  /* end pkt_free() */
+
+/**
+ * Close the connection of a NODE, and release its packet buffer.
+ * Safe to call on a NODE without a connection or packet buffer.
+ * @param np Pointer to NODE
+ */
+void node_close(NODE *np)
+{
+   if (np->sd != INVALID_SOCKET) sock_close(np->sd);
+   np->sd = INVALID_SOCKET;
+   pkt_free(np->tx);
+   np->tx = NULL;
+}  /* end node_close() */
+
+/**
+ * Ensure the packet buffer of a NODE has capacity for @a len bytes of
+ * packet data. Where a larger packet buffer is required, the packet
+ * header and data are moved to a new packet buffer, such that previous
+ * pointers to the packet buffer (np->tx) are invalid.
+ * @param np Pointer to NODE
+ * @param len Length of packet data to be held by packet buffer
+ * @return (int) value representing operation result
+ * @retval VERROR on error; check errno for details
+ * @retval VEOK on success
+ */
+int node_reserve(NODE *np, size_t len)
+{
+   size_t used;
+   TX *pkt;
+
+   if (np->tx != NULL && pkt_cap(np->tx) >= len) return VEOK;
+
+   pkt = pkt_alloc(len);
+   if (pkt == NULL) return VERROR;
+   if (np->tx != NULL) {
+      /* move packet header and (held) packet data */
+      used = get16(np->tx->len);
+      if (used > pkt_cap(np->tx)) used = pkt_cap(np->tx);
+      memcpy(pkt, np->tx, TXHDRLEN + used);
+      pkt_free(np->tx);
+   }
+   np->tx = pkt;
+
+   return VEOK;
+}  /* end node_reserve() */
 
 /**
  * Receive next packet from NODE *np.
  * SOCKET np->sd is already set non-blocking.
- * Returns: VEOK (0) = good, else error code. */
+ * The packet buffer, np->tx, is enlarged as required by the packet.
+ * Waits on poll() for data, until timeout seconds have elapsed.
+ * Returns: VEOK (0) = good, VETIMEOUT on timeout, else error code. */
 int recv_tx(NODE *np, double timeout)
 {
-   int count, len, n;
-   time_t start;
+   int count, ecode, len, n;
+   word64 deadline;
+   word8 *tlr;
    TX *tx;
 
    /* init recv_tx() */
-   tx = &(np->tx);
+   if (node_reserve(np, 0) != VEOK) return VERROR;
+   tx = np->tx;
    put16(tx->len, 0);
-   time(&start);
+   deadline = net_deadline(timeout);
 
    /* loop until PDU is recv'd
     * NOTE: tx.len[2] may extend the requirement recv()
@@ -142,18 +312,28 @@ int recv_tx(NODE *np, double timeout)
 #define recv_len(lenp) ( TXHDRLEN + get16((lenp)) + TXTLRLEN )
    len = recv_len(tx->len);
    for (n = 0; n < len; n += count, len = recv_len(tx->len)) {
-      count = recv(np->sd, (word8 *) tx + n, len - n, 0);
+      /* enlarge packet buffer once packet length is known */
+      if (n >= TXHDRLEN && (size_t) get16(tx->len) > pkt_cap(tx)) {
+         if (node_reserve(np, get16(tx->len)) != VEOK) {
+            perrno("%s packet buffer failure", np->id);
+            return VERROR;
+         }
+         tx = np->tx;
+      }
+      count = recv(np->sd, (word8 *) tx + n,
+         (n < TXHDRLEN ? TXHDRLEN : len) - n, 0);
       switch (count) {
          case (-1): {
             if (sock_waiting(sock_errno)) {
-               if (difftime(time(NULL), start) >= timeout) {
-                  set_errno(ETIMEDOUT);
-                  return VETIMEOUT;
+               /* wait patiently, for data or deadline */
+               ecode = net_wait(np->sd, POLLIN, deadline);
+               if (ecode == VETIMEOUT) return VETIMEOUT;
+               if (ecode == VEOK) {
+                  count = 0;
+                  continue;
                }
-               /* wait patiently */
-               millisleep(10);
-               count = 0;
-               continue;
+               perrno("%s poll() failed", np->id);
+               return VERROR;
             }
             perrno("%s recv() failed", np->id);
          }  /* fallthrough */
@@ -164,28 +344,31 @@ int recv_tx(NODE *np, double timeout)
       }  /* end switch */
    }  /* end for (n... */
 
-   /* shift crc16 and trailer to correct position in TX struct */
-   memmove(tx->crc16, tx->buffer + get16(tx->len), 4);
+   /* crc16 and trailer follow packet data */
+   tlr = tx->buffer + get16(tx->len);
 
    /* compute crc16 checksum and verify packet integrity */
-   if (get16(tx->crc16) != crc16(tx, len - TXTLRLEN)) {
+   if (get16(tlr) != crc16(tx, len - TXTLRLEN)) {
       pdebug("%s *** CRC16 mismatch, 0x%" P16X " != 0x%" P16X,
-         np->id, get16(tx->crc16), crc16(tx, TXHDRLEN + len));
-      Nrecverrs++;
+         np->id, get16(tlr), crc16(tx, len - TXTLRLEN));
+      __atomic_add_fetch(&Nrecverrs, 1, __ATOMIC_RELAXED);
+      metrics_inc(METRICS_RECVERRS);
       return VEBAD;
    }
    /* check packet network protocol version */
    if (get16(tx->network) != TXNETWORK) {
       pdebug("%s *** invalid network, %" P16u " != %" P16u,
          np->id, get16(tx->network), TXNETWORK);
-      Nrecverrs++;
+      __atomic_add_fetch(&Nrecverrs, 1, __ATOMIC_RELAXED);
+      metrics_inc(METRICS_RECVERRS);
       return VEBAD;
    }
    /* check packet trailer */
-   if (get16(tx->trailer) != TXEOT) {
+   if (get16(tlr + 2) != TXEOT) {
       pdebug("%s *** invalid trailer, 0x%" P16X " != 0x%" P16X,
-         np->id, get16(tx->trailer), TXEOT);
-      Nrecverrs++;
+         np->id, get16(tlr + 2), TXEOT);
+      __atomic_add_fetch(&Nrecverrs, 1, __ATOMIC_RELAXED);
+      metrics_inc(METRICS_RECVERRS);
       return VEBAD;
    }
    /* check handshake IDs on all operations (except during handshake) */
@@ -193,13 +376,15 @@ int recv_tx(NODE *np, double timeout)
       if (np->id1 != get16(tx->id1) || np->id2 != get16(tx->id2)) {
          pdebug("%s *** unexpected ID 0x%" P32x, np->id,
             (word32) (get16(tx->id1) | ((word32)get16(tx->id2) << 16)));
-         Nrecverrs++;
+         __atomic_add_fetch(&Nrecverrs, 1, __ATOMIC_RELAXED);
+         metrics_inc(METRICS_RECVERRS);
          return VEBAD;
       }
    }
 
    /* packet recv'd */
-   Nrecvs++;
+   __atomic_add_fetch(&Nrecvs, 1, __ATOMIC_RELAXED);
+   metrics_inc(METRICS_RECVS);
    return VEOK;
 }  /* end recv_tx() */
 
@@ -211,12 +396,12 @@ int recv_file(NODE *np, char *fname)
 {
    TX *tx;
    FILE *fp;
-   time_t prevtime;
+   word64 bytes, start;
    word16 len;
 
    /* init recv_file() */
-   time(&prevtime);
-   tx = &(np->tx);
+   start = net_ms();
+   bytes = 0;
 
    /* open file for writing recv'd data */
    fp = fopen(fname, "wb");
@@ -228,7 +413,8 @@ int recv_file(NODE *np, char *fname)
    /* receive packets and write */
    pdebug("(%s, %s) receiving...", np->id, fname);
    while (recv_tx(np, STD_TIMEOUT) == VEOK) {
-      /* check recv'd packet */
+      /* check recv'd packet -- recv_tx() may move packet buffer */
+      tx = np->tx;
       if (get16(tx->opcode) != OP_SEND_FILE) {
          pdebug("(%s, %s) *** invalid opcode", np->id, fname);
          break;
@@ -238,14 +424,17 @@ int recv_file(NODE *np, char *fname)
          pdebug("(%s, %s) *** I/O error", np->id, fname);
          break;
       }
+      bytes += len;
       /* check EOF */
       if (len < sizeof(tx->buffer)) {
          fclose(fp);
          pdebug("(%s, %s) EOF", np->id, fname);
+         pstat_xfer(np->ip, 1, bytes, (word32) (net_ms() - start));
          return VEOK;
       } /* end if EOF */
    }  /* end for */
    fclose(fp);
+   pstat_xfer(np->ip, 0, bytes, (word32) (net_ms() - start));
    /* delete partial downloads */
    remove(fname);
 
@@ -255,24 +444,26 @@ int recv_file(NODE *np, char *fname)
 /**
  * Send next packet to NODE *np.
  * Set advertised fields and compute CRC16.
- * Returns VEOK on success, else VERROR. */
+ * Waits on poll() for buffer space, until timeout seconds have elapsed.
+ * Returns VEOK on success, VETIMEOUT on timeout, else VERROR. */
 int send_tx(NODE *np, double timeout)
 {
-   int count, len, n;
-   time_t start;
+   int count, ecode, len, n;
+   word64 deadline;
+   word8 *tlr;
    TX *tx;
 
    /* init send_tx() */
-   tx = &(np->tx);
-   time(&start);
+   tx = np->tx;
+   deadline = net_deadline(timeout);
 
    /* fill tx packet with relevant information... */
    tx->version[0] = PVERSION;
    tx->version[1] = Cbits;
    put16(tx->network, TXNETWORK);
-   put16(tx->trailer, TXEOT);
    put16(tx->id1, np->id1);
    put16(tx->id2, np->id2);
+   mutex_lock(&Chainlock);
    put64(tx->cblock, Cblocknum);
    memcpy(tx->cblockhash, Cblockhash, HASHLEN);
    memcpy(tx->pblockhash, Prevhash, HASHLEN);
@@ -280,11 +471,12 @@ int send_tx(NODE *np, double timeout)
    if (get16(tx->opcode) != OP_TX) {
       memcpy(tx->weight, Weight, HASHLEN);
    }
+   mutex_unlock(&Chainlock);
 
-   /* compute packet crc16 checksum -- use length from previous step */
-   put16(tx->crc16, crc16(tx, TXHDRLEN + get16(tx->len)));
-   /* shift crc16 and trailer to correct position in buffer */
-   memmove(tx->buffer + get16(tx->len), tx->crc16, 4);
+   /* compute packet crc16 checksum, and trailer, after packet data */
+   tlr = tx->buffer + get16(tx->len);
+   put16(tlr, crc16(tx, TXHDRLEN + get16(tx->len)));
+   put16(tlr + 2, TXEOT);
 
    /* loop until PDU is recv'd
     * NOTE: tx.len[2] requirement DOES NOT change here
@@ -296,14 +488,15 @@ int send_tx(NODE *np, double timeout)
       switch (count) {
          case (-1): {
             if (sock_waiting(sock_errno)) {
-               if (difftime(time(NULL), start) >= timeout) {
-                  set_errno(ETIMEDOUT);
-                  return VETIMEOUT;
+               /* wait patiently, for buffer space or deadline */
+               ecode = net_wait(np->sd, POLLOUT, deadline);
+               if (ecode == VETIMEOUT) return VETIMEOUT;
+               if (ecode == VEOK) {
+                  count = 0;
+                  continue;
                }
-               /* wait patiently */
-               millisleep(10);
-               count = 0;
-               continue;
+               perrno("%s poll() failed", np->id);
+               return VERROR;
             }
             perrno("%s send() failed", np->id);
          }  /* fallthrough */
@@ -315,14 +508,15 @@ int send_tx(NODE *np, double timeout)
    }  /* end for (n... */
 
    /* packet sent */
-   Nsends++;
+   __atomic_add_fetch(&Nsends, 1, __ATOMIC_RELAXED);
+   metrics_inc(METRICS_SENDS);
    return VEOK;
 }  /* end send_tx() */
 
 
 int send_op(NODE *np, int opcode)
 {
-   put16(np->tx.opcode, opcode);
+   put16(np->tx->opcode, opcode);
    return send_tx(np, STD_TIMEOUT);
 }
 
@@ -345,7 +539,10 @@ int send_op(NODE *np, int opcode)
  */
 int send_nack(NODE *np, int errnum)
 {
-   char *error = (char *) np->tx.buffer;
+   char *error;
+
+   if (node_reserve(np, 8 + 32 + 256) != VEOK) return VERROR;
+   error = (char *) np->tx->buffer;
 
    /* set necessary zero fill */
    memset(error, 0, 8 + 32);
@@ -358,38 +555,41 @@ int send_nack(NODE *np, int errnum)
    mcm_strerror(errnum, error + 8 + 32, 256);
 
    /* check length of description and send NACK */
-   put16(np->tx.len, 8 + 32 + strlen(error + 40) + 1);
+   put16(np->tx->len, 8 + 32 + strlen(error + 40) + 1);
    return send_op(np, OP_NACK);
 }  /* end send_nack() */
 
 /**
  * Send packets to NODE *np, and write to file, fname.
  * SOCKET np->sd is set non-blocking, ready to recv data.
- * Set fname NULL send np->tx.blocknum request.
+ * Set fname NULL send np->tx->blocknum request.
  * Returns: VEOK (0) = good, else error code. */
 int send_file(NODE *np, char *fname)
 {
    char dummy[FILENAME_MAX];
    char bcfname[22];
+   word64 start;
    size_t count;
-   int ecode;
+   int ecode, online;
    FILE *fp;
    TX *tx;
 
-   /* init send_file() */
-   tx = &(np->tx);
+   /* init send_file() -- file data is sent in full packets */
+   if (node_reserve(np, sizeof(tx->buffer)) != VEOK) return VERROR;
+   tx = np->tx;
    if (fname == NULL) {
       bnum2fname(tx->blocknum, bcfname);
       fname = path_join(dummy, Bcdir, bcfname);
    }
    pdebug("(%s, %s) sending...", np->id, fname);
 
-   /* open file for writing recv'd data */
-   fp = fopen(fname, "rb");
+   /* open (decompressed) file for sending data */
+   fp = bc_fopen(fname);
    if (fp == NULL) {
       pdebug("(%s, %s) cannot send file", np->id, fname);
       return VERROR;
    }
+   start = metrics_time();
    /* read and send packets */
    do {
       /* read file data and break on error */
@@ -407,10 +607,12 @@ int send_file(NODE *np, char *fname)
          break;
       }
       /* Make upload bandwidth dynamic. */
-      if (Nonline > 1) millisleep(Nonline - 1);
+      online = __atomic_load_n(&Nonline, __ATOMIC_RELAXED);
+      if (online > 1) millisleep(online - 1);
    } while (ecode == VEOK);
    /* cleanup */
    fclose(fp);
+   metrics_observe(METRICS_SEND_FILE, start);
    return ecode;
 }  /* end send_file() */
 
@@ -419,9 +621,9 @@ int send_file(NODE *np, char *fname)
  * Called from gettx() OP_BALANCE
  * layout:
  * on entry:
- *     np->tx.src_addr    address to query
+ *     np->tx->buffer    address to query
  * on return:
- *     np->tx.send_total = balance of src_addr (0 if not found)
+ *     np->tx->buffer    ledger entry of address (if found)
  *
  * Returns 1 on I/O errors, else 0.
 */
@@ -430,17 +632,19 @@ int send_balance(NODE *np)
    LENTRY le;
    word16 len;
 
-   len = get16(np->tx.len);
+   len = get16(np->tx->len);
    if (len > ADDR_LEN) len = ADDR_LEN;
 
    /* look up source address in ledger */
-   if (le_find(np->tx.buffer, &le, len)) {
-      memcpy(np->tx.buffer, &le, sizeof(LENTRY));
-      put16(np->tx.len, sizeof(LENTRY));
+   if (le_find(np->tx->buffer, &le, len)) {
+      if (node_reserve(np, sizeof(LENTRY)) != VEOK) return 1;
+      memcpy(np->tx->buffer, &le, sizeof(LENTRY));
+      put16(np->tx->len, sizeof(LENTRY));
       send_op(np, OP_SEND_BAL);
    }
 
    Nbalance++;
+   metrics_inc(METRICS_BALANCE);
    return 0;  /* success */
 } /* end send_balance() */
 
@@ -455,13 +659,11 @@ int send_ipl(NODE *np)
    for (count = 0; count < RPLISTLEN; count++) {
       if (Rplist[count] == 0) break;
    }
-   /* limit count to space available in buffer size */
-   if (count > (sizeof(np->tx.buffer) / sizeof(word32))) {
-      count = (sizeof(np->tx.buffer) / sizeof(word32));
-   }
+   /* ensure space available in packet buffer */
+   if (node_reserve(np, sizeof(word32) * count) != VEOK) return VERROR;
    /* copy recent peer list to TX */
-   memcpy(np->tx.buffer, Rplist, sizeof(word32) * count);
-   put16(np->tx.len, sizeof(word32) * count);
+   memcpy(np->tx->buffer, Rplist, sizeof(word32) * count);
+   put16(np->tx->len, sizeof(word32) * count);
    return send_op(np, OP_SEND_IPL);  /* send ip list */
 }
 
@@ -474,19 +676,19 @@ int send_hash(NODE *np)
    char fname[FILENAME_MAX];
    char bcfname[21];
 
-   bnum2fname(np->tx.blocknum, bcfname);
+   bnum2fname(np->tx->blocknum, bcfname);
    path_join(fname, Bcdir, bcfname);
    if (read_trailer(&bt, fname) != VEOK) {
       return VERROR;
    }
    /* copy hash of tx.blocknum to TX */
-   memcpy(np->tx.buffer, bt.bhash, HASHLEN);
-   put16(np->tx.len, HASHLEN);
+   memcpy(np->tx->buffer, bt.bhash, HASHLEN);
+   put16(np->tx->len, HASHLEN);
    return send_op(np, OP_HASH);  /* send back to peer */
 }  /* end send_hash() */
 
 /* Process OP_TF.  Return VEOK on success, else VERROR.
- * Called by child -- execute().
+ * Called by request worker -- execute().
  */
 int send_tf(NODE *np)
 {
@@ -494,10 +696,10 @@ int send_tf(NODE *np)
    word32 first, count;
    char cmd[128], fname[32];
 
-   sprintf(fname, "tf%u.tmp", (int) getpid());
+   sprintf(fname, "tf%u.tmp", (unsigned) np->sd);
 
-   first = get32(np->tx.blocknum);      /* first trailer to send */
-   count = get32(&np->tx.blocknum[4]);  /* count of trailers to send */
+   first = get32(np->tx->blocknum);      /* first trailer to send */
+   count = get32(&np->tx->blocknum[4]);  /* count of trailers to send */
 
    /* limit tfile extract to 1000 trailers */
    if(count > 1000) return VERROR;
@@ -513,9 +715,9 @@ int send_tf(NODE *np)
 int send_identify(NODE *np)
 {
    /* copy recent peer list to TX */
-   sprintf((char *) np->tx.buffer, "Sanctuary=%u,Lastday=%u,Mfee=%u",
+   sprintf((char *) np->tx->buffer, "Sanctuary=%u,Lastday=%u,Mfee=%u",
            Sanctuary, Lastday, Myfee[0]);
-   put16(np->tx.len, (word16) strlen((char *) np->tx.buffer));
+   put16(np->tx->len, (word16) strlen((char *) np->tx->buffer));
    return send_op(np, OP_IDENTIFY);
 }
 
@@ -529,7 +731,7 @@ int send_found(void)
    char bcfname[21];
    char bnumhex[17];
    int ecode, count, len, i;
-   TX tx;
+   TX *proof;
    word8 bnum[8];
 
    if (Found_pid) {
@@ -571,39 +773,56 @@ bad:
    pdebug("...weight(0x%s)", weight2hex(Weight, NULL));
 
    /* get proof from tfile.dat (!!! (NTFTX - 1) ) */
+   ecode = 4;
+   proof = pkt_alloc(NTFTX * sizeof(BTRAILER));
+   if (proof == NULL) goto bad;
    if (sub64(Cblocknum, CL64_32(NTFTX - 1), bnum)) memset(bnum, 0, 8);
-   count = read_tfile(tx.buffer, bnum, NTFTX, "tfile.dat");
+   count = read_tfile(proof->buffer, bnum, NTFTX, "tfile.dat");
+   put16(proof->len, (word16) count * sizeof(BTRAILER));
 
-   /* build peerlist with Rplist (shuffled) */
+   /* build peerlist with Rplist (shuffled), fastest peers first */
    memset(plist, 0, sizeof(plist));
    shufflenz(Rplist, sizeof(*Rplist), RPLISTLEN);
    len = loadpeers(plist, RPLISTLEN, Rplist, RPLISTLEN);
+   pstat_sort(plist, (word32) len);
 
    /* Send found message to peerlist */
    for(i = 0; i < len && Running; i++) {
       if(plist[i] == 0) break;
       if(callserver(&node, plist[i]) != VEOK) continue;
-      memcpy(&node.tx, &tx, sizeof(TX));  /* copy in tfile proof */
-      put16(node.tx.len, (word16) count * sizeof(BTRAILER));
+      /* swap in tfile proof -- send_tx() sets handshake ids */
+      pkt_free(node.tx);
+      node.tx = proof;
       send_op(&node, OP_FOUND);
-      sock_close(node.sd);
+      node.tx = NULL;  /* proof is retained for next peer */
+      node_close(&node);
    }
 
+   pkt_free(proof);
    exit(0);
 }  /* end send_found() */
 
 /**
- * Call peer and complete Three-Way handshake */
+ * Call peer and complete Three-Way handshake. On success, the node holds
+ * an open socket and a packet buffer; release both with node_close(). */
 int callserver(NODE *np, word32 ip)
 {
    char ipaddr[16];  /* for threadsafe ntoa() usage */
+   word64 start;
    word8 id1, id2;
 
    /* init callserver() */
+   start = net_ms();
    id1 = id2 = 0;
    ntoa(&ip, ipaddr);
    memset(np, 0, sizeof(NODE));   /* clear structure */
    snprintf(np->id, sizeof(np->id), "%.15s %.02x~%.02x", ipaddr, id1, id2);
+   np->sd = INVALID_SOCKET;
+   np->tx = pkt_alloc(0);
+   if (np->tx == NULL) {
+      perrno("%s packet buffer failure", np->id);
+      return VERROR;
+   }
    /* begin connection */
    np->ip = ip;
    np->sd = sock_connect_ip(ip, Dstport, INIT_TIMEOUT);
@@ -614,7 +833,7 @@ int callserver(NODE *np, word32 ip)
    /* initiate Three-Way Handshake */
    np->id1 = rand16();
    id1 = (word8) (np->id1 >> 8);
-   put16(np->tx.opcode, OP_HELLO);
+   put16(np->tx->opcode, OP_HELLO);
    snprintf(np->id, sizeof(np->id), "%.15s %.02x~%.02x", ipaddr, id1, id2);
    if (send_tx(np, 1) != VEOK) {
       pdebug("%s failed to send handshake", np->id);
@@ -624,36 +843,38 @@ int callserver(NODE *np, word32 ip)
       goto FAIL_ERR3WAY;
    }
    /* validate Three-Way Handshake */
-   np->id2 = get16(np->tx.id2);
+   np->id2 = get16(np->tx->id2);
    id2 = (word8) np->id2;
    snprintf(np->id, sizeof(np->id), "%.15s %.02x~%.02x", ipaddr, id1, id2);
-   if (get16(np->tx.opcode) != OP_HELLO_ACK) {
+   if (get16(np->tx->opcode) != OP_HELLO_ACK) {
       pdebug("%s *** missing hello acknowledgement", np->id);
       goto FAIL_BAD3WAY;
-   } else if (get16(np->tx.id1) != np->id1) {
+   } else if (get16(np->tx->id1) != np->id1) {
       pdebug("%s *** handshake ID mismatch", np->id);
       goto FAIL_BAD3WAY;
    }
 
    /* success -- made a new friend */
+   pstat_call(ip, 1, (word32) (net_ms() - start));
    return VEOK;
 
    /* failure -- cleanup/error handling */
 FAIL_BAD3WAY:
-   sock_close(np->sd);
-   np->sd = INVALID_SOCKET;
+   pstat_call(ip, 0, 0);
+   node_close(np);
    return VEBAD;
 FAIL_ERR3WAY:
-   sock_close(np->sd);
-   np->sd = INVALID_SOCKET;
-   return VERROR;
 FAIL_ERRSOCK:
+   pstat_call(ip, 0, 0);
+   node_close(np);
    return VERROR;
 }  /* end callserver() */
 
 /**
  * Used for simple one packet responses like OP_GET_IPL.
  * Closes socket and sets np->sd to INVALID_SOCKET on return.
+ * On success, the response is retained in np->tx; release with
+ * node_close() when done.
  * Returns VEOK on success, else VERROR. */
 int get_tx(NODE *np, word32 ip, word16 opcode)
 {
@@ -666,9 +887,10 @@ int get_tx(NODE *np, word32 ip, word16 opcode)
       /* send and receive single packet */
       ecode = send_op(np, opcode);
       if(ecode == VEOK) ecode = recv_tx(np, STD_TIMEOUT);
-      /* cleanup */
+      /* cleanup -- packet buffer is retained on success */
       sock_close(np->sd);
       np->sd = INVALID_SOCKET;
+      if (ecode != VEOK) node_close(np);
    }
    return ecode;
 }  /* end get_tx() */
@@ -691,27 +913,27 @@ int get_file(word32 ip, word8 *bnum, char *fname)
    /* set opcode and block number (as necessary) */
    if (bnum) {
       if (cmp64(bnum, maxbnum)) {
-         put64(node.tx.blocknum, bnum);
-         put16(node.tx.opcode, OP_GET_BLOCK);
-      } else put16(node.tx.opcode, OP_GET_CBLOCK);
+         put64(node.tx->blocknum, bnum);
+         put16(node.tx->opcode, OP_GET_BLOCK);
+      } else put16(node.tx->opcode, OP_GET_CBLOCK);
    } else {
-      put64(node.tx.blocknum, node.tx.cblock);  /* for recv_file() */
-      put16(node.tx.opcode, OP_GET_TFILE);
+      put64(node.tx->blocknum, node.tx->cblock);  /* for recv_file() */
+      put16(node.tx->opcode, OP_GET_TFILE);
    }
    /* send request for block number, and recv into fname */
    ecode = send_tx(&node, STD_TIMEOUT);
    if (ecode == VEOK) ecode = recv_file(&node, fname);
+   else pstat_xfer(ip, 0, 0, 0);
 
    /* cleanup */
-   sock_close(node.sd);
-   node.sd = INVALID_SOCKET;
+   node_close(&node);
    return ecode;
 }  /* end get_file() */
 
 /**
- * Get an ip list from ip, and call addrecent() on the list.
- * Return VEOK if successful, else error code.
- * NOTE: DOES NOT call addrecent() when Rplist is full. */
+ * Get an ip list from ip. On success, the list is retained in np->tx;
+ * release with node_close() when done.
+ * Return VEOK if successful, else error code. */
 int get_ipl(NODE *np, word32 ip)
 {
    char ipaddr[16];  /* for threadsafe ntoa() usage */
@@ -725,9 +947,10 @@ int get_ipl(NODE *np, word32 ip)
       /* send OP_GET_IPL and receive single packet response */
       ecode = send_op(np, OP_GET_IPL);
       if (ecode == VEOK) ecode = recv_tx(np, STD_TIMEOUT);
-      /* cleanup */
+      /* cleanup -- packet buffer is retained on success */
       sock_close(np->sd);
       np->sd = INVALID_SOCKET;
+      if (ecode != VEOK) node_close(np);
    }
 
    return ecode;
@@ -735,8 +958,8 @@ int get_ipl(NODE *np, word32 ip)
 
 /**
  * Get a blockhash of a particular block number from ip.
- * Uses node.tx.cblock from node when bnum is NULL.
- * Place returned hash in *blockhash.
+ * Uses node.tx->cblock from node when bnum is NULL.
+ * Place returned hash in *blockhash. Node is closed on return.
  * Return VEOK if successful, else error code. */
 int get_hash(NODE *np, word32 ip, void *bnum, void *blockhash)
 {
@@ -748,7 +971,7 @@ int get_hash(NODE *np, word32 ip, void *bnum, void *blockhash)
    if (callserver(np, ip) != VEOK) return VERROR;
 
    /* insert blocknum request */
-   tx = &(np->tx);
+   tx = np->tx;
    if (bnum == NULL) {
       pdebug("%s passing node's cblock to blocknum...", np->id);
       put64(tx->blocknum, tx->cblock);
@@ -757,41 +980,44 @@ int get_hash(NODE *np, word32 ip, void *bnum, void *blockhash)
    /* perform OP_HASH request and receive -- close socket */
    pdebug("%s sending OP_HASH...", np->id);
    ecode = send_op(np, OP_HASH);
-   if (ecode != VEOK) return ecode;
-   ecode = recv_tx(np, STD_TIMEOUT);
-   if (ecode != VEOK) return ecode;
+   if (ecode == VEOK) ecode = recv_tx(np, STD_TIMEOUT);
+   if (ecode != VEOK) goto cleanup;
 
-   /* cleanup -- check response */
-   sock_close(np->sd);
-   np->sd = INVALID_SOCKET;
+   /* check response -- recv_tx() may move packet buffer */
+   tx = np->tx;
+   ecode = VERROR;
    if (get16(tx->opcode) != OP_HASH) {
       pdebug("%s unexpected opcode...", np->id);
-      return VERROR;
    } else if (get16(tx->len) != HASHLEN) {
       pdebug("%s unexpected len...", np->id);
-      return VERROR;
+   } else {
+      /* pass blockhash on success, if not NULL */
+      if (blockhash) memcpy(blockhash, tx->buffer, HASHLEN);
+      ecode = VEOK;
    }
-   /* pass blockhash on success, if not NULL */
-   if (blockhash) memcpy(blockhash, tx->buffer, HASHLEN);
 
-   /* success */
-   return VEOK;
+cleanup:
+   node_close(np);
+   return ecode;
 }  /* end get_hash() */
 
 /**
  * Handle an incoming packets from the Mochimo network. Reads a TX structure
  * from SOCKET sd.  Handles 3-way handshake and validates crc and id's.
- * Also cares for requests that do not need a child process.
+ * Also cares for requests that do not need a request worker.
  *
  * Returns:
  *          -1 no data yet
- *          0 to create child NODE to process read np->tx
- *          1 to close connection ("You're done, no child")
+ *          0 to submit NODE to a request worker to process read np->tx
+ *          1 to close connection ("You're done, no worker")
  *          2 ip was pinklisted (She was very naughty.)
  *
  * On entry: sd is non-blocking.
+ * On return: np->tx holds a packet buffer (or NULL on allocation failure)
+ * which the caller must release with pkt_free(), or hand to workq_submit().
  *
  * Op sequence: OP_HELLO,OP_HELLO_ACK,OP_(?x)
+ * OP_TX is answered with an empty OP_TX (accepted), or OP_NACK (rejected).
 */
 int gettx(NODE *np, SOCKET sd)
 {
@@ -801,9 +1027,13 @@ int gettx(NODE *np, SOCKET sd)
    TX *tx;
 
    /* init */
-   tx = &np->tx;
    opcode = id1 = id2 = 0;
    memset(np, 0, sizeof(NODE));   /* clear structure */
+   np->tx = tx = pkt_alloc(0);
+   if (tx == NULL) {
+      perrno("gettx() packet buffer failure");
+      return VERROR;
+   }
 
    np->sd = sd;
    np->ip = get_sock_ip(sd);  /* uses getpeername() */
@@ -816,12 +1046,16 @@ int gettx(NODE *np, SOCKET sd)
    if (pinklisted(np->ip)) {
       pdebug("%s dropped (pink)", np->id);
       Nbadlogs++;
+      metrics_inc(METRICS_BADLOGS);
       return VEBAD;
    }
 
    /* hello? */
    if (recv_tx(np, 1)) return VERROR;
-   if (get16(tx->opcode) != OP_HELLO) goto bad1;
+   tx = np->tx;  /* recv_tx() may move packet buffer */
+   opcode = get16(tx->opcode);
+   /* handshake carries no data */
+   if (opcode != OP_HELLO || get16(tx->len) != 0) goto bad1;
 
    /* hi! */
    np->id2 = id2 = rand16();
@@ -832,6 +1066,7 @@ int gettx(NODE *np, SOCKET sd)
 
    /* how can I help you? */
    status = recv_tx(np, INIT_TIMEOUT);
+   tx = np->tx;  /* recv_tx() may move packet buffer */
    opcode = get16(tx->opcode);  /* execute() will check opcode */
    pdebug("%s got opcode = %d  status = %d", np->id, opcode, status);
    if (status == VEBAD) goto bad2;
@@ -852,19 +1087,27 @@ int gettx(NODE *np, SOCKET sd)
       }
       case OP_TX: {
          Nlogins++;  /* raw TX in */
+         metrics_inc(METRICS_LOGINS);
          status = process_tx(np);
          if (status != VEOK) {
+            /* reply with reason for rejection, before any pinklist */
+            send_nack(np, errno);
             if (status == VEBAD2) goto bad1;
             if (status == VEBAD) goto bad2;
-         } else if (tx->version[1] & C_OPTIN) {
+            return 1;
+         }
+         if (tx->version[1] & C_OPTIN) {
             /* only add those that "optin" with a successful op */
             addrecent(np->ip);
          }
+         /* acknowledge acceptance with an empty OP_TX */
+         put16(tx->len, 0);
+         send_op(np, OP_TX);
 
          return 1;
       }
       case OP_FOUND: {
-         /* getblock child, catchup, re-sync, or ignore */
+         /* getblock worker, catchup, re-sync, or ignore */
          if(Blockfound) return 1;  /* Already found one so ignore.  */
          status = contention(np);  /* Do we want this block? */
          if (status == (-1)) pwarn("node may require restart to sync...");
@@ -887,16 +1130,17 @@ int gettx(NODE *np, SOCKET sd)
       case OP_BUSY:        /* fallthrough */
       case OP_NACK:        /* fallthrough */
       case OP_HELLO_ACK:   return 1;
-      default: pdebug("%s requires child...", np->id);
+      default: pdebug("%s requires worker...", np->id);
    }
 
-   /* If too many children in too small a space... */
-   if (crowded(opcode)) return 1;  /* suppress child unless OP_FOUND */
-   return VEOK;  /* success -- fork() child in server() */
+   /* If too many requests in too small a space... */
+   if (crowded(opcode)) return 1;  /* suppress worker unless OP_FOUND */
+   return VEOK;  /* success -- workq_submit() in server() */
 
 bad1: epinklist(np->ip);
 bad2: pinklist(np->ip);
       Nbadlogs++;
+      metrics_inc(METRICS_BADLOGS);
       pdebug("%s pinklisted, opcode = %d", np->id, opcode);
 
    return VEBAD;
@@ -913,6 +1157,7 @@ int scan_quorum
 (word32 quorum[], word32 qlen, void *hash, void *weight, void *bnum)
 {
    NODE node;
+   IPSET netpset;  /* membership of netplist */
    word32 peer;
    word32 scanidx = 0;
    word32 qcount = 0;
@@ -925,10 +1170,19 @@ int scan_quorum
    char ipstr[16];
    word16 len;
 
+   if (ipset_init(&netpset, 1024) != VEOK) {
+      perrno("scan_quorum() netplist failure");
+      return 0;
+   }
+
+#define netplist_add(ip) ( netplistidx < 1024 && (!Noprivate \
+   || !isprivate(ip)) && ipset_add(&netpset, ip, IPSET_FOREVER) \
+   && (netplist[netplistidx++] = ip) )
+
    /* copy current recent peers to netplist */
    for (word32 idx = 0; idx < RPLISTLEN && netplistidx < 1024; idx++) {
       if (Rplist[idx] == 0) break;
-      if (addpeer(Rplist[idx], netplist, 1024, &netplistidx)) {
+      if (netplist_add(Rplist[idx])) {
          pdebug("Added %s to netplist", ntoa(&Rplist[idx], ipstr));
       }
    }
@@ -947,15 +1201,15 @@ int scan_quorum
             OMP_CRITICAL_()
             {
                /* check peer's chain weight against highweight */
-               result = cmp256(node.tx.weight, highweight);
+               result = cmp256(node.tx->weight, highweight);
                if (result >= 0) {
                   /* higher or same chain detected */
                   if (result > 0) {
                      /* higher chain detected */
                      pdebug("new highweight");
-                     memcpy(highhash, node.tx.cblockhash, HASHLEN);
-                     memcpy(highweight, node.tx.weight, 32);
-                     put64(highbnum, node.tx.cblock);
+                     memcpy(highhash, node.tx->cblockhash, HASHLEN);
+                     memcpy(highweight, node.tx->weight, 32);
+                     put64(highbnum, node.tx->cblock);
                      qcount = 0;
                      if (quorum) {
                         memset(quorum, 0, qlen);
@@ -963,7 +1217,7 @@ int scan_quorum
                      }
                   }
                   /* check block hash and add to quorum */
-                  if (memcmp(node.tx.cblockhash, highhash, HASHLEN) >= 0) {
+                  if (memcmp(node.tx->cblockhash, highhash, HASHLEN) >= 0) {
                      /* add ip to quorum, or q consensus */
                      if (quorum && qcount < qlen) {
                         quorum[qcount++] = peer;
@@ -973,15 +1227,15 @@ int scan_quorum
                }  /* end if higher or same chain */
             }  /* end OMP_CRITICAL_() */
             /* inspect peer list */
-            for (len = 0, result = 0; len < get16(node.tx.len); len += 4) {
+            for (len = 0, result = 0; len < get16(node.tx->len); len += 4) {
                if (netplistidx >= 1024) break;
                /* check (and recognise contribution of) valid peers */
-               peer = *((word32 *) &node.tx.buffer[len]);
+               peer = *((word32 *) &node.tx->buffer[len]);
                if (peer == 0 || pinklisted(peer)) continue;
                if (!isprivate(peer) || !Noprivate) result++;
                /* add to network list */
                OMP_CRITICAL_()
-               if (addpeer(peer, netplist, 1024, &netplistidx)) {
+               if (netplist_add(peer)) {
                   pdebug("Added %s to netplist", ntoa(&peer, ipstr));
                }
             }
@@ -992,12 +1246,14 @@ int scan_quorum
                   pdebug("Added %s to Rplist", ntoa(&peer, ipstr));
                }
             }
+            node_close(&node);
          }  /* end if get_ipl() */
          /* atomic increment scan index */
          OMP_ATOMIC_()
             scanidx++;
       }  /* end OMP_PARALLEL_() */
    }  /* end while() */
+   ipset_free(&netpset);
    pdebug("qualifying weight 0x...%s", weight2hex(highweight, NULL));
    pdebug("qualifying block 0x%s", bnum2hex(highbnum, NULL));
    pdebug("qualifying nodes %d...", qcount);
@@ -1021,7 +1277,7 @@ int refresh_ipl(void)
    int j, count;
    word32 ip, *ipp;
    word16 len;
-   TX tx;
+   TX *proof;
    word8 bnum[8];
 
    for(j = ip = 0; j < 1000 && ip == 0; j++)
@@ -1029,8 +1285,8 @@ int refresh_ipl(void)
    if(ip == 0) goto FAIL;
    if (get_ipl(&node, ip) == VEOK) {
       /* add iplist to recent peers */
-      len = get16(node.tx.len);
-      ipp = (word32 *) node.tx.buffer;
+      len = get16(node.tx->len);
+      ipp = (word32 *) node.tx->buffer;
       for( ; len > 0; ipp++, len -= 4) {
          if (*ipp == 0) continue;
          if (Rplist[RPLISTLEN - 1]) break;
@@ -1038,19 +1294,28 @@ int refresh_ipl(void)
       }
    } else goto FAIL;
    /* Check peer's chain weight against ours. */
-   if(cmp256(node.tx.weight, Weight) < 0) {
+   j = cmp256(node.tx->weight, Weight);
+   node_close(&node);
+   if(j < 0) {
       /* get proof from tfile.dat */
-      memset(tx.buffer, 0, sizeof(tx.buffer));
+      proof = pkt_alloc(NTFTX * sizeof(BTRAILER));
+      if (proof == NULL) goto FAIL;
+      memset(proof->buffer, 0, NTFTX * sizeof(BTRAILER));
       if (sub64(Cblocknum, CL64_32(NTFTX), bnum)) memset(bnum, 0, 8);
-      count = read_tfile(tx.buffer, bnum, NTFTX, "tfile.dat");
+      count = read_tfile(proof->buffer, bnum, NTFTX, "tfile.dat");
       /* Send found message to low weight peer */
-      memset(tx.buffer, 0, sizeof(tx.buffer));
-      if (read_tfile(tx.buffer, Cblocknum, 54, "tfile.dat") == 0) goto FAIL;
-      if(callserver(&node, ip) != VEOK) goto FAIL;
-      memcpy(&node.tx, &tx, sizeof(TX));  /* copy in tfile proof */
-      put16(node.tx.len, (word16) count * sizeof(BTRAILER));
+      memset(proof->buffer, 0, NTFTX * sizeof(BTRAILER));
+      if (read_tfile(proof->buffer, Cblocknum, 54, "tfile.dat") == 0
+         || callserver(&node, ip) != VEOK) {
+         pkt_free(proof);
+         goto FAIL;
+      }
+      /* swap in tfile proof -- send_tx() sets handshake ids */
+      pkt_free(node.tx);
+      node.tx = proof;
+      put16(node.tx->len, (word16) count * sizeof(BTRAILER));
       send_op(&node, OP_FOUND);
-      sock_close(node.sd);
+      node_close(&node);
    }
 
    /* success */
@@ -25,20 +25,21 @@
 #include "types.h"
 #include "peer.h"
 
+/* packet header and trailer lengths, about a packet buffer */
+#define TXHDRLEN 124
+#define TXTLRLEN 4
+
 /* The Node struct */
 typedef struct {
-   TX tx;               /* packet buffer */
+   TX *tx;              /* packet buffer -- see pkt_alloc() */
    word32 ip;           /* source ip *//*
    word16 port;         // unused... */
    word16 id1, id2;     /* from tx handshake */
    char id[32];         /* "0.0.0.0 AB~EF" - for logging identification */
-   pid_t pid;           /* process id of child -- zero if empty slot */
    SOCKET sd;
 } NODE;
 
 /* global variables */
-extern NODE Nodes[MAXNODES];
-extern NODE *Hi_node;
 extern word32 Nrecvs;
 extern word32 Nsends;
 extern word32 Nrecverrs;
@@ -49,9 +50,13 @@ extern word32 Nsenderrs;
 extern "C" {
 #endif
 
-NODE *getslot(NODE *np);
-int freeslot(NODE *np);
-int child_status(NODE *np, pid_t pid, int status);
+TX *pkt_alloc(size_t len);
+size_t pkt_cap(const TX *pkt);
+void pkt_free(TX *pkt);
+void node_close(NODE *np);
+int node_reserve(NODE *np, size_t len);
+word64 net_deadline(double timeout);
+int net_wait(SOCKET sd, short events, word64 deadline);
 int recv_tx(NODE *np, double timeout);
 int recv_file(NODE *np, char *fname);
 int send_tx(NODE *np, double timeout);
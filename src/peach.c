@@ -10,9 +10,19 @@
 #define MOCHIMO_PEACH_C
 
 
-#include <math.h>  /* for isnan() */
+#include <math.h>    /* for isnan() */
+#include <stdlib.h>  /* for malloc() */
+#include <stdio.h>   /* for snprintf() */
+#include <fcntl.h>   /* for O_* constants */
+#include <string.h>  /* for strncmp() */
+#include <unistd.h>  /* for close() */
+#include <dirent.h>  /* for opendir() */
+#include <sys/mman.h>   /* for shm_open(), mmap() */
 #include "peach.h"
 
+/* internal support */
+#include "error.h"
+
 /* hashing functions used by Peach's nighthash */
 #include "blake2b.h"
 #include "md2.h"
@@ -21,19 +31,86 @@
 #include "sha256.h"
 #include "sha3.h"
 
-/* Define restricted use Peach semaphores */
-static SHA256_CTX PeachICTX;
-#ifdef ENABLE_CPU_PEACH_CACHE
+/* SIMD Nighthash kernels; x86_64 (SSE2, AVX2 at runtime), aarch64 (NEON) */
+#if !defined(DISABLE_CPU_PEACH_SIMD) && defined(__GNUC__)
+   #if defined(__x86_64__)
+      #include <immintrin.h>
+      #define PEACH_SIMD
+      #define PEACH_SIMD_X86
+      #define PEACH_AVX2   __attribute__((target("avx2")))
+   #elif defined(__aarch64__) && defined(__ARM_NEON)
+      #include <arm_neon.h>
+      #define PEACH_SIMD
+      #define PEACH_SIMD_NEON
+   #endif
+   /* lane-parallel flops only outperform scalar flops where optimized */
+   #if defined(PEACH_SIMD) && defined(__OPTIMIZE__)
+      #define PEACH_SIMD_FLOPS
+   #endif
+#endif
+
+/* Peach Map tile states (PEACH_CTX.tiles) */
+#define PEACH_TILE_EMPTY   0  /* tile not generated */
+#define PEACH_TILE_CLAIM   1  /* tile being generated by a thread */
+#define PEACH_TILE_READY   2  /* tile generated and published */
+
+/* directory of named POSIX shared memory segments, see peach_shm_sweep() */
+#define PEACH_SHM_DIR      "/dev/shm"
+
+/* Peach Map mode, without flags (PEACH_CTX.mode) */
+#define peach_map_mode(m)  ( (m) & 3 )
+
+/* atomic tile state operations (shared Peach Map) */
+#define peach_tile_load(fp)  __atomic_load_n(fp, __ATOMIC_ACQUIRE)
+#define peach_tile_publish(fp) \
+   __atomic_store_n(fp, PEACH_TILE_READY, __ATOMIC_RELEASE)
+
+/* CPU device solve states (PEACH_CPU.solved) */
+#define PEACH_CPU_NONE     0  /* no solve pending */
+#define PEACH_CPU_CLAIM    1  /* solve being stored by a thread */
+#define PEACH_CPU_READY    2  /* solve stored, pending collection */
+
+/* CPU device context (DEVICE_CTX.peach), shared by solving threads */
+typedef struct {
+   PEACH_CTX ctx;    /* Peach solver context, shared by threads */
+   BTRAILER bt;      /* block trailer of current work */
+   BTRAILER solve;   /* solved block trailer, pending collection */
+   word64 seed;      /* nonce generator seed, shared by threads */
+   word64 hashes;    /* hashes since last collection (atomic) */
+   word8 diff;       /* difficulty of current work */
+   int active;       /* threads active on current work (atomic) */
+   int pause;        /* non-zero while work is withdrawn (atomic) */
+   int solved;       /* solve state, PEACH_CPU_* (atomic) */
+   int streams;      /* nonce generator streams taken (atomic) */
+} PEACH_CPU;
+
+/* Define restricted use Peach semaphores (default context) */
+static PEACH_CTX PeachCtx;
+#if defined(ENABLE_CPU_PEACH_CACHE) && !defined(ENABLE_CPU_PEACH_SHM)
    static word8 PeachMap[PEACHMAPLEN];      /* 1GiByte! */
    static word8 PeachCache[PEACHCACHELEN];  /* 1MiByte! */
-   static word8 PeachCleared[SHA256LEN];    /* clearhash */
 
 #endif
 
+/**
+ * @private
+ * Atomically claim an empty tile of a shared Peach Map for generation.
+ * @param fp Pointer to tile flag
+ * @returns Non-zero if the calling thread claimed the tile, else zero
+*/
+static inline int peach_tile_claim(word8 *fp)
+{
+   word8 expect = PEACH_TILE_EMPTY;
+
+   return __atomic_compare_exchange_n(fp, &expect, PEACH_TILE_CLAIM, 0,
+      __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}  /* end peach_tile_claim() */
+
 /**
  * @private
  * Perform deterministic (single precision) floating point operations on
- * @a len bytes of @a data (in 4 byte operations).
+ * @a len bytes of @a data (in 4 byte operations). Scalar kernel of, and
+ * reference for, peach_dflops().
  * @param data Pointer to data to use in operations
  * @param len Length of @a data to use in operations
  * @param index Peach tile index number
@@ -44,7 +121,8 @@ static SHA256_CTX PeachICTX;
  * rounding mode. This should be covered by default on most 21st century
  * hardware, otherwise it may need to be specified at compile-time.
 */
-static word32 peach_dflops(void *data, size_t len, word32 index, int txf)
+static inline word32 peach_dflops_scalar
+   (void *data, size_t len, word32 index, int txf)
 {
    float *flp, temp, flv;
    word8 *bp, shift;
@@ -99,17 +177,19 @@ static word32 peach_dflops(void *data, size_t len, word32 index, int txf)
    }  /* end for(i = 0; ... */
 
    return op;
-}  /* end peach_dflops() */
+}  /* end peach_dflops_scalar() */
 
 /**
  * @private
  * Perform deterministic memory transformations on @a len bytes of @a data.
+ * Scalar kernel of, and reference for, peach_dmemtx().
  * @param data Pointer to data to use in operations
  * @param len Length of @a data to use in operations
  * @param op Operating code from previous Peach algo steps
  * @returns 32-bit unsigned operation code for subsequent Peach algo steps
 */
-static word32 peach_dmemtx(void *data, size_t len, word32 op)
+static inline word32 peach_dmemtx_scalar
+   (void *data, size_t len, word32 op)
 {
    unsigned i, z;
    size_t len16, len32, len64, y;
@@ -166,20 +246,617 @@ static word32 peach_dmemtx(void *data, size_t len, word32 op)
    } /* end for(i = 0; ... */
 
    return op;
+}  /* end peach_dmemtx_scalar() */
+
+#ifdef PEACH_SIMD
+
+/**
+ * @private
+ * Perform the remainder of a memory transformation (see peach_dmemtx()),
+ * from offset @a z, as processed by a SIMD kernel. Offsets of the byte
+ * swap transformations (1 and 6) are offsets into the first half of data.
+ * @param bp Pointer to data to use in operations
+ * @param len Length of @a bp to use in operations
+ * @param tx Memory transformation, 0 through 7
+ * @param i Round of memory transformations
+ * @param z Offset of data to begin operations
+*/
+static inline void peach_dmemtx_tail
+   (word8 *bp, size_t len, unsigned tx, unsigned i, size_t z)
+{
+   size_t len16, y;
+   word8 temp;
+
+   len16 = len >> 1;
+   switch (tx) {
+      case 0:
+         for (; z < (len & ~(size_t) 3); z++) bp[z] ^= 0x81;
+         break;
+      case 1:
+         for (y = len16 + z; z < len16; y++, z++) {
+            temp = bp[z]; bp[z] = bp[y]; bp[y] = temp;
+         }
+         break;
+      case 2:
+         for (; z < (len & ~(size_t) 3); z++) bp[z] = (word8) ~bp[z];
+         break;
+      case 3:
+         for (; z < len; z++) bp[z] += (z & 1) ? -1 : 1;
+         break;
+      case 4:
+         for (; z < len; z++) bp[z] += (word8) ((z & 1) ? i : -i);
+         break;
+      case 5:
+         for (; z < len; z++) if (bp[z] == 104) bp[z] = 72;
+         break;
+      case 6:
+         for (y = len16 + z; z < len16; y++, z++) {
+            if (bp[z] > bp[y]) {
+               temp = bp[z]; bp[z] = bp[y]; bp[y] = temp;
+            }
+         }
+         break;
+      case 7:
+         for (z = z ? z : 1; z < len; z++) bp[z] ^= bp[z - 1];
+         break;
+   }  /* end switch (tx)... */
+}  /* end peach_dmemtx_tail() */
+
+/**
+ * @private
+ * Prepare the operation code bytes and operands of @a n 4 byte lanes of
+ * @a bp, as per peach_dflops_scalar(), for a SIMD kernel.
+ * @param bp Pointer to data to use in operations
+ * @param n Number of lanes to prepare
+ * @param opb Pointer to location to place operation code bytes
+ * @param operand Pointer to location to place operands
+*/
+static inline void peach_dflops_prep
+   (const word8 *bp, size_t n, word8 *opb, int32 *operand)
+{
+   word8 shift;
+   size_t j;
+
+   for (j = 0; j < n; j++, bp += 4) {
+      shift = ((*bp & 7) + 1) << 1;
+      opb[j] = bp[((WORD32_C(0x26C34) >> shift) & 3)];
+      operand[j] = bp[((WORD32_C(0x14198) >> shift) & 3)];
+      if (bp[((WORD32_C(0x3D6EC) >> shift) & 3)] & 1) {
+         operand[j] ^= WORD32_C(0x80000000);
+      }
+   }
+}  /* end peach_dflops_prep() */
+
+/**
+ * @private
+ * Select the results of @a n 4 byte lanes of @a bp, from the results of
+ * all four operations (add, sub, mul, div) computed by a SIMD kernel. The
+ * operation of each lane depends on the results of all previous lanes.
+ * @param bp Pointer to data to use in operations
+ * @param n Number of lanes to select
+ * @param opb Operation code bytes of lanes
+ * @param res Results of lanes, per operation
+ * @param sum Sum of result bytes of lanes, per operation
+ * @param op Operation code of previous lanes
+ * @param txf Flag indicates @a bp should be transformed by operations
+ * @returns 32-bit unsigned operation code for subsequent lanes
+*/
+static inline word32 peach_dflops_select(word8 *bp, size_t n,
+   const word8 *opb, float res[4][8], word32 sum[4][8], word32 op, int txf)
+{
+   size_t j;
+
+   for (j = 0; j < n; j++) {
+      op += opb[j];
+      if (txf) memcpy(&bp[j << 2], &res[op & 3][j], 4);
+      op += sum[op & 3][j];
+   }
+
+   return op;
+}  /* end peach_dflops_select() */
+
+#endif  /* end PEACH_SIMD */
+
+#ifdef PEACH_SIMD_X86
+
+/**
+ * @private
+ * Replace NaN lanes of @a x with @a fi.
+*/
+static inline __m128 peach_nanfix_sse2(__m128 x, __m128 fi)
+{
+   __m128 m = _mm_cmpunord_ps(x, x);
+
+   return _mm_or_ps(_mm_and_ps(m, fi), _mm_andnot_ps(m, x));
+}  /* end peach_nanfix_sse2() */
+
+/**
+ * @private
+ * Store the results (NaN replaced by @a fi) and the sum of result bytes,
+ * of 4 lanes of an operation.
+*/
+static inline void peach_dflops_store_sse2
+   (__m128 r, __m128 fi, float *res, word32 *sum)
+{
+   __m128i v, t, m8, m16;
+
+   m8 = _mm_set1_epi32(0x00ff00ff);
+   m16 = _mm_set1_epi32(0x0000ffff);
+   r = peach_nanfix_sse2(r, fi);
+   _mm_storeu_ps(res, r);
+   v = _mm_castps_si128(r);
+   t = _mm_add_epi32(_mm_and_si128(v, m8),
+      _mm_and_si128(_mm_srli_epi32(v, 8), m8));
+   t = _mm_add_epi32(_mm_and_si128(t, m16), _mm_srli_epi32(t, 16));
+   _mm_storeu_si128((__m128i *) sum, t);
+}  /* end peach_dflops_store_sse2() */
+
+/**
+ * @private
+ * SSE2 kernel of peach_dflops(), 4 lanes at a time.
+*/
+static inline word32 peach_dflops_sse2
+   (void *data, size_t len, word32 index, int txf)
+{
+   float res[4][8];
+   word32 sum[4][8];
+   int32 operand[4];
+   word8 opb[4], buf[16], *bp;
+   __m128 fi, x, y;
+   size_t i, n;
+   word32 op;
+
+   fi = _mm_set1_ps((float) index);
+   for (op = i = 0; i < len; i += n) {
+      bp = (word8 *) data + i;
+      n = (len - i) < 16 ? (len - i) : 16;
+      if (n < 16) {
+         /* zero padded partial block */
+         memset(buf, 0, sizeof(buf));
+         memcpy(buf, bp, n);
+         bp = buf;
+      }
+      peach_dflops_prep(bp, 4, opb, operand);
+      x = peach_nanfix_sse2(_mm_loadu_ps((float *) bp), fi);
+      y = _mm_cvtepi32_ps(_mm_loadu_si128((__m128i *) operand));
+      peach_dflops_store_sse2(_mm_add_ps(x, y), fi, res[0], sum[0]);
+      peach_dflops_store_sse2(_mm_sub_ps(x, y), fi, res[1], sum[1]);
+      peach_dflops_store_sse2(_mm_mul_ps(x, y), fi, res[2], sum[2]);
+      peach_dflops_store_sse2(_mm_div_ps(x, y), fi, res[3], sum[3]);
+      op = peach_dflops_select(bp, n >> 2, opb, res, sum, op, txf);
+      if (txf && bp == buf) memcpy((word8 *) data + i, buf, n);
+   }
+
+   return op;
+}  /* end peach_dflops_sse2() */
+
+/**
+ * @private
+ * Replace NaN lanes of @a x with @a fi.
+*/
+PEACH_AVX2 static inline __m256 peach_nanfix_avx2(__m256 x, __m256 fi)
+{
+   return _mm256_blendv_ps(x, fi, _mm256_cmp_ps(x, x, _CMP_UNORD_Q));
+}  /* end peach_nanfix_avx2() */
+
+/**
+ * @private
+ * Store the results (NaN replaced by @a fi) and the sum of result bytes,
+ * of 8 lanes of an operation.
+*/
+PEACH_AVX2 static inline void peach_dflops_store_avx2
+   (__m256 r, __m256 fi, float *res, word32 *sum)
+{
+   __m256i v, t, m8, m16;
+
+   m8 = _mm256_set1_epi32(0x00ff00ff);
+   m16 = _mm256_set1_epi32(0x0000ffff);
+   r = peach_nanfix_avx2(r, fi);
+   _mm256_storeu_ps(res, r);
+   v = _mm256_castps_si256(r);
+   t = _mm256_add_epi32(_mm256_and_si256(v, m8),
+      _mm256_and_si256(_mm256_srli_epi32(v, 8), m8));
+   t = _mm256_add_epi32(_mm256_and_si256(t, m16), _mm256_srli_epi32(t, 16));
+   _mm256_storeu_si256((__m256i *) sum, t);
+}  /* end peach_dflops_store_avx2() */
+
+/**
+ * @private
+ * AVX2 kernel of peach_dflops(), 8 lanes at a time.
+*/
+PEACH_AVX2 static inline word32 peach_dflops_avx2
+   (void *data, size_t len, word32 index, int txf)
+{
+   float res[4][8];
+   word32 sum[4][8];
+   int32 operand[8];
+   word8 opb[8], buf[32], *bp;
+   __m256 fi, x, y;
+   size_t i, n;
+   word32 op;
+
+   fi = _mm256_set1_ps((float) index);
+   for (op = i = 0; i < len; i += n) {
+      bp = (word8 *) data + i;
+      n = (len - i) < 32 ? (len - i) : 32;
+      if (n < 32) {
+         /* zero padded partial block */
+         memset(buf, 0, sizeof(buf));
+         memcpy(buf, bp, n);
+         bp = buf;
+      }
+      peach_dflops_prep(bp, 8, opb, operand);
+      x = peach_nanfix_avx2(_mm256_loadu_ps((float *) bp), fi);
+      y = _mm256_cvtepi32_ps(_mm256_loadu_si256((__m256i *) operand));
+      peach_dflops_store_avx2(_mm256_add_ps(x, y), fi, res[0], sum[0]);
+      peach_dflops_store_avx2(_mm256_sub_ps(x, y), fi, res[1], sum[1]);
+      peach_dflops_store_avx2(_mm256_mul_ps(x, y), fi, res[2], sum[2]);
+      peach_dflops_store_avx2(_mm256_div_ps(x, y), fi, res[3], sum[3]);
+      op = peach_dflops_select(bp, n >> 2, opb, res, sum, op, txf);
+      if (txf && bp == buf) memcpy((word8 *) data + i, buf, n);
+   }
+
+   return op;
+}  /* end peach_dflops_avx2() */
+
+/**
+ * @private
+ * Perform a memory transformation (see peach_dmemtx()), 16 bytes at a
+ * time, from offset @a z, completing the remainder with scalar operations.
+ * @param bp Pointer to data to use in operations
+ * @param len Length of @a bp to use in operations
+ * @param tx Memory transformation, 0 through 7
+ * @param i Round of memory transformations
+ * @param z Offset of data to begin operations (see peach_dmemtx_tail())
+*/
+static void peach_dmemtx_sse2
+   (word8 *bp, size_t len, unsigned tx, unsigned i, size_t z)
+{
+   __m128i a, b, k;
+   size_t len16, n;
+
+   len16 = len >> 1;
+   switch (tx) {
+      case 0:  /* fallthrough */
+      case 2:
+         n = len & ~(size_t) 3;
+         k = _mm_set1_epi8((char) (tx ? 0xff : 0x81));
+         for (; z + 16 <= n; z += 16) {
+            a = _mm_loadu_si128((__m128i *) &bp[z]);
+            _mm_storeu_si128((__m128i *) &bp[z], _mm_xor_si128(a, k));
+         }
+         break;
+      case 3:  /* fallthrough */
+      case 4:
+         /* alternating addends of even and odd bytes (offsets even) */
+         k = _mm_set1_epi16((short) (tx == 3 ? 0xff01
+            : (((i & 0xff) << 8) | ((0u - i) & 0xff))));
+         for (; z + 16 <= len; z += 16) {
+            a = _mm_loadu_si128((__m128i *) &bp[z]);
+            _mm_storeu_si128((__m128i *) &bp[z], _mm_add_epi8(a, k));
+         }
+         break;
+      case 5:
+         /* 104 ^ 72 == 0x20 */
+         k = _mm_set1_epi8(104);
+         for (; z + 16 <= len; z += 16) {
+            a = _mm_loadu_si128((__m128i *) &bp[z]);
+            b = _mm_and_si128(_mm_cmpeq_epi8(a, k), _mm_set1_epi8(0x20));
+            _mm_storeu_si128((__m128i *) &bp[z], _mm_xor_si128(a, b));
+         }
+         break;
+      case 1:  /* fallthrough */
+      case 6:
+         for (; z + 16 <= len16; z += 16) {
+            a = _mm_loadu_si128((__m128i *) &bp[z]);
+            b = _mm_loadu_si128((__m128i *) &bp[len16 + z]);
+            if (tx == 6) {
+               k = _mm_max_epu8(a, b);
+               b = _mm_min_epu8(a, b);
+               a = k;
+            }
+            _mm_storeu_si128((__m128i *) &bp[z], b);
+            _mm_storeu_si128((__m128i *) &bp[len16 + z], a);
+         }
+         break;
+      case 7:
+         /* prefix XOR, carried across blocks */
+         k = _mm_set1_epi8((char) (z ? bp[z - 1] : 0));
+         for (; z + 16 <= len; z += 16) {
+            a = _mm_loadu_si128((__m128i *) &bp[z]);
+            a = _mm_xor_si128(a, _mm_slli_si128(a, 1));
+            a = _mm_xor_si128(a, _mm_slli_si128(a, 2));
+            a = _mm_xor_si128(a, _mm_slli_si128(a, 4));
+            a = _mm_xor_si128(a, _mm_slli_si128(a, 8));
+            a = _mm_xor_si128(a, k);
+            _mm_storeu_si128((__m128i *) &bp[z], a);
+            k = _mm_set1_epi8((char) bp[z + 15]);
+         }
+         break;
+   }  /* end switch (tx)... */
+   peach_dmemtx_tail(bp, len, tx, i, z);
+}  /* end peach_dmemtx_sse2() */
+
+/**
+ * @private
+ * Perform a memory transformation (see peach_dmemtx()), 32 bytes at a
+ * time, completing the remainder with peach_dmemtx_sse2(). The prefix XOR
+ * transformation (7) is left entirely to peach_dmemtx_sse2().
+ * @param bp Pointer to data to use in operations
+ * @param len Length of @a bp to use in operations
+ * @param tx Memory transformation, 0 through 7
+ * @param i Round of memory transformations
+*/
+PEACH_AVX2 static void peach_dmemtx_avx2
+   (word8 *bp, size_t len, unsigned tx, unsigned i)
+{
+   __m256i a, b, k;
+   size_t len16, n, z;
+
+   len16 = len >> 1;
+   z = 0;
+   switch (tx) {
+      case 0:  /* fallthrough */
+      case 2:
+         n = len & ~(size_t) 3;
+         k = _mm256_set1_epi8((char) (tx ? 0xff : 0x81));
+         for (; z + 32 <= n; z += 32) {
+            a = _mm256_loadu_si256((__m256i *) &bp[z]);
+            _mm256_storeu_si256((__m256i *) &bp[z], _mm256_xor_si256(a, k));
+         }
+         break;
+      case 3:  /* fallthrough */
+      case 4:
+         k = _mm256_set1_epi16((short) (tx == 3 ? 0xff01
+            : (((i & 0xff) << 8) | ((0u - i) & 0xff))));
+         for (; z + 32 <= len; z += 32) {
+            a = _mm256_loadu_si256((__m256i *) &bp[z]);
+            _mm256_storeu_si256((__m256i *) &bp[z], _mm256_add_epi8(a, k));
+         }
+         break;
+      case 5:
+         k = _mm256_set1_epi8(104);
+         for (; z + 32 <= len; z += 32) {
+            a = _mm256_loadu_si256((__m256i *) &bp[z]);
+            b = _mm256_and_si256(_mm256_cmpeq_epi8(a, k),
+               _mm256_set1_epi8(0x20));
+            _mm256_storeu_si256((__m256i *) &bp[z], _mm256_xor_si256(a, b));
+         }
+         break;
+      case 1:  /* fallthrough */
+      case 6:
+         for (; z + 32 <= len16; z += 32) {
+            a = _mm256_loadu_si256((__m256i *) &bp[z]);
+            b = _mm256_loadu_si256((__m256i *) &bp[len16 + z]);
+            if (tx == 6) {
+               k = _mm256_max_epu8(a, b);
+               b = _mm256_min_epu8(a, b);
+               a = k;
+            }
+            _mm256_storeu_si256((__m256i *) &bp[z], b);
+            _mm256_storeu_si256((__m256i *) &bp[len16 + z], a);
+         }
+         break;
+   }  /* end switch (tx)... */
+   peach_dmemtx_sse2(bp, len, tx, i, z);
+}  /* end peach_dmemtx_avx2() */
+
+#endif  /* end PEACH_SIMD_X86 */
+
+#ifdef PEACH_SIMD_NEON
+
+/**
+ * @private
+ * Store the results (NaN replaced by @a fi) and the sum of result bytes,
+ * of 4 lanes of an operation.
+*/
+static inline void peach_dflops_store_neon
+   (float32x4_t r, float32x4_t fi, float *res, word32 *sum)
+{
+   uint32x4_t v, t, m8, m16;
+
+   m8 = vdupq_n_u32(0x00ff00ff);
+   m16 = vdupq_n_u32(0x0000ffff);
+   r = vbslq_f32(vceqq_f32(r, r), r, fi);
+   vst1q_f32(res, r);
+   v = vreinterpretq_u32_f32(r);
+   t = vaddq_u32(vandq_u32(v, m8), vandq_u32(vshrq_n_u32(v, 8), m8));
+   t = vaddq_u32(vandq_u32(t, m16), vshrq_n_u32(t, 16));
+   vst1q_u32(sum, t);
+}  /* end peach_dflops_store_neon() */
+
+/**
+ * @private
+ * NEON kernel of peach_dflops(), 4 lanes at a time.
+*/
+static inline word32 peach_dflops_neon
+   (void *data, size_t len, word32 index, int txf)
+{
+   float res[4][8];
+   word32 sum[4][8];
+   int32 operand[4];
+   word8 opb[4], buf[16], *bp;
+   float32x4_t fi, x, y;
+   size_t i, n;
+   word32 op;
+
+   fi = vdupq_n_f32((float) index);
+   for (op = i = 0; i < len; i += n) {
+      bp = (word8 *) data + i;
+      n = (len - i) < 16 ? (len - i) : 16;
+      if (n < 16) {
+         /* zero padded partial block */
+         memset(buf, 0, sizeof(buf));
+         memcpy(buf, bp, n);
+         bp = buf;
+      }
+      peach_dflops_prep(bp, 4, opb, operand);
+      x = vreinterpretq_f32_u8(vld1q_u8(bp));
+      x = vbslq_f32(vceqq_f32(x, x), x, fi);
+      y = vcvtq_f32_s32(vld1q_s32(operand));
+      peach_dflops_store_neon(vaddq_f32(x, y), fi, res[0], sum[0]);
+      peach_dflops_store_neon(vsubq_f32(x, y), fi, res[1], sum[1]);
+      peach_dflops_store_neon(vmulq_f32(x, y), fi, res[2], sum[2]);
+      peach_dflops_store_neon(vdivq_f32(x, y), fi, res[3], sum[3]);
+      op = peach_dflops_select(bp, n >> 2, opb, res, sum, op, txf);
+      if (txf && bp == buf) memcpy((word8 *) data + i, buf, n);
+   }
+
+   return op;
+}  /* end peach_dflops_neon() */
+
+/**
+ * @private
+ * Perform a memory transformation (see peach_dmemtx()), 16 bytes at a
+ * time, completing the remainder with scalar operations.
+ * @param bp Pointer to data to use in operations
+ * @param len Length of @a bp to use in operations
+ * @param tx Memory transformation, 0 through 7
+ * @param i Round of memory transformations
+*/
+static void peach_dmemtx_neon(word8 *bp, size_t len, unsigned tx, unsigned i)
+{
+   uint8x16_t a, b, k, zero;
+   size_t len16, n, z;
+
+   len16 = len >> 1;
+   z = 0;
+   switch (tx) {
+      case 0:  /* fallthrough */
+      case 2:
+         n = len & ~(size_t) 3;
+         k = vdupq_n_u8(tx ? 0xff : 0x81);
+         for (; z + 16 <= n; z += 16) {
+            vst1q_u8(&bp[z], veorq_u8(vld1q_u8(&bp[z]), k));
+         }
+         break;
+      case 3:  /* fallthrough */
+      case 4:
+         /* alternating addends of even and odd bytes (offsets even) */
+         k = vreinterpretq_u8_u16(vdupq_n_u16((word16) (tx == 3 ? 0xff01
+            : (((i & 0xff) << 8) | ((0u - i) & 0xff)))));
+         for (; z + 16 <= len; z += 16) {
+            vst1q_u8(&bp[z], vaddq_u8(vld1q_u8(&bp[z]), k));
+         }
+         break;
+      case 5:
+         /* 104 ^ 72 == 0x20 */
+         k = vdupq_n_u8(104);
+         for (; z + 16 <= len; z += 16) {
+            a = vld1q_u8(&bp[z]);
+            b = vandq_u8(vceqq_u8(a, k), vdupq_n_u8(0x20));
+            vst1q_u8(&bp[z], veorq_u8(a, b));
+         }
+         break;
+      case 1:  /* fallthrough */
+      case 6:
+         for (; z + 16 <= len16; z += 16) {
+            a = vld1q_u8(&bp[z]);
+            b = vld1q_u8(&bp[len16 + z]);
+            if (tx == 6) {
+               k = vmaxq_u8(a, b);
+               b = vminq_u8(a, b);
+               a = k;
+            }
+            vst1q_u8(&bp[z], b);
+            vst1q_u8(&bp[len16 + z], a);
+         }
+         break;
+      case 7:
+         /* prefix XOR, carried across blocks */
+         zero = vdupq_n_u8(0);
+         k = zero;
+         for (; z + 16 <= len; z += 16) {
+            a = vld1q_u8(&bp[z]);
+            a = veorq_u8(a, vextq_u8(zero, a, 15));
+            a = veorq_u8(a, vextq_u8(zero, a, 14));
+            a = veorq_u8(a, vextq_u8(zero, a, 12));
+            a = veorq_u8(a, vextq_u8(zero, a, 8));
+            a = veorq_u8(a, k);
+            vst1q_u8(&bp[z], a);
+            k = vdupq_n_u8(bp[z + 15]);
+         }
+         break;
+   }  /* end switch (tx)... */
+   peach_dmemtx_tail(bp, len, tx, i, z);
+}  /* end peach_dmemtx_neon() */
+
+#endif  /* end PEACH_SIMD_NEON */
+
+/**
+ * @private
+ * Perform deterministic (single precision) floating point operations on
+ * @a len bytes of @a data (in 4 byte operations). Dispatches to a SIMD
+ * kernel, where available in optimized builds, bit-exact with
+ * peach_dflops_scalar().
+ * @param data Pointer to data to use in operations
+ * @param len Length of @a data to use in operations
+ * @param index Peach tile index number
+ * @param txf Flag indicates @a data should be transformed by operations
+ * @returns 32-bit unsigned operation code for subsequent Peach algo steps
+*/
+static word32 peach_dflops(void *data, size_t len, word32 index, int txf)
+{
+#if defined(PEACH_SIMD_FLOPS) && defined(PEACH_SIMD_X86)
+   if (__builtin_cpu_supports("avx2")) {
+      return peach_dflops_avx2(data, len, index, txf);
+   }
+   return peach_dflops_sse2(data, len, index, txf);
+#elif defined(PEACH_SIMD_FLOPS) && defined(PEACH_SIMD_NEON)
+   return peach_dflops_neon(data, len, index, txf);
+#else
+   return peach_dflops_scalar(data, len, index, txf);
+#endif
+}  /* end peach_dflops() */
+
+/**
+ * @private
+ * Perform deterministic memory transformations on @a len bytes of @a data.
+ * Dispatches to a SIMD kernel, where available, bit-exact with
+ * peach_dmemtx_scalar().
+ * @param data Pointer to data to use in operations
+ * @param len Length of @a data to use in operations
+ * @param op Operating code from previous Peach algo steps
+ * @returns 32-bit unsigned operation code for subsequent Peach algo steps
+*/
+static word32 peach_dmemtx(void *data, size_t len, word32 op)
+{
+#ifdef PEACH_SIMD
+   word8 *bp;
+   unsigned i;
+#if defined(PEACH_SIMD_X86)
+   int avx2;
+
+   avx2 = __builtin_cpu_supports("avx2");
+#endif
+   bp = (word8 *) data;
+   for (i = 0; i < PEACHROUNDS; i++) {
+      op += bp[i & 31];
+#if defined(PEACH_SIMD_X86)
+      if (avx2) peach_dmemtx_avx2(bp, len, op & 7, i);
+      else peach_dmemtx_sse2(bp, len, op & 7, i, 0);
+#else
+      peach_dmemtx_neon(bp, len, op & 7, i);
+#endif
+   }
+
+   return op;
+#else
+   return peach_dmemtx_scalar(data, len, op);
+#endif
 }  /* end peach_dmemtx() */
 
 /**
  * @private
- * Perform Nighthash on @a inlen bytes of @a in and place result in @a out.
- * Utilizes deterministic float operations and memory transformations.
+ * Perform the Nighthash algorithm selected by @a algo on @a inlen bytes
+ * of @a in and place result in @a out. Hash results shorter than 32 bytes
+ * are zero filled.
+ * @param algo Nighthash algorithm selection, 0 through 7
  * @param in Pointer to input data
- * @param inlen Length of data from @a in, used in non-transform steps
- * @param index Peach tile index number
- * @param txlen Length of data from @a in, used in transform steps
+ * @param inlen Length of data from @a in
  * @param out Pointer to location to place resulting hash
 */
-static void peach_nighthash(void *in, size_t inlen, word32 index,
-   size_t txlen, void *out)
+static void peach_nightalgo(word32 algo, void *in, size_t inlen, void *out)
 {
    static const word64 key32B[4] = { 0, 0, 0, 0 };
    static const word64 key64B[8] = {
@@ -189,16 +866,8 @@ static void peach_nighthash(void *in, size_t inlen, word32 index,
       WORD64_C(0x0101010101010101), WORD64_C(0x0101010101010101),
    };
 
-   /* Perform flops to determine initial algo type.
-    * When txlen is non-zero the transformation of input data is enabled,
-    * as well as the additional memory transformation process. */
-   if (txlen) {
-      index = peach_dflops(in, txlen, index, 1);
-      index = peach_dmemtx(in, txlen, index);
-   } else index = peach_dflops(in, inlen, index, 0);
-
    /* reduce algorithm selection to 1 of 8 choices */
-   switch (index & 7) {
+   switch (algo & 7) {
       case 0: blake2b(in, inlen, key32B, 32, out, BLAKE2BLEN256); break;
       case 1: blake2b(in, inlen, key64B, 64, out, BLAKE2BLEN256); break;
       case 2: {
@@ -226,8 +895,244 @@ static void peach_nighthash(void *in, size_t inlen, word32 index,
          break;
       }
    }  /* end switch(algo_type)... */
+}  /* end peach_nightalgo() */
+
+/**
+ * @private
+ * Perform the flops (and transform) steps of Nighthash on @a in.
+ * @param in Pointer to input data
+ * @param inlen Length of data from @a in, used in non-transform steps
+ * @param index Peach tile index number
+ * @param txlen Length of data from @a in, used in transform steps
+ * @returns Nighthash algorithm selection, 0 through 7
+*/
+static inline word32 peach_nightops(void *in, size_t inlen, word32 index,
+   size_t txlen)
+{
+   /* Perform flops to determine initial algo type.
+    * When txlen is non-zero the transformation of input data is enabled,
+    * as well as the additional memory transformation process. */
+   if (txlen) {
+      index = peach_dflops(in, txlen, index, 1);
+      index = peach_dmemtx(in, txlen, index);
+   } else index = peach_dflops(in, inlen, index, 0);
+
+   return index & 7;
+}  /* end peach_nightops() */
+
+/**
+ * @private
+ * Perform Nighthash on @a inlen bytes of @a in and place result in @a out.
+ * Utilizes deterministic float operations and memory transformations.
+ * @param in Pointer to input data
+ * @param inlen Length of data from @a in, used in non-transform steps
+ * @param index Peach tile index number
+ * @param txlen Length of data from @a in, used in transform steps
+ * @param out Pointer to location to place resulting hash
+*/
+static void peach_nighthash(void *in, size_t inlen, word32 index,
+   size_t txlen, void *out)
+{
+   peach_nightalgo(peach_nightops(in, inlen, index, txlen), in, inlen, out);
 }  /* end peach_nighthash() */
 
+/* 32-bit and 64-bit rotations for multi-lane hashing */
+#define peach_ror32(x, n)  ( ((x) >> (n)) | ((x) << (32 - (n))) )
+#define peach_rol64(x, n)  ( ((x) << (n)) | ((x) >> ((64 - (n)) & 63)) )
+
+/**
+ * @private
+ * Perform SHA256 on PEACHGENLEN bytes of each input, for up to PEACHLANES
+ * lanes in lock-step. Lanes are held in structure-of-arrays form so that
+ * each step of the (single block) compression vectorizes across lanes.
+ * Inputs are fully read before any output is written, so an output may
+ * overlap its input.
+ * @param in Array of pointers to (PEACHGENLEN bytes of) input data
+ * @param out Array of pointers to locations to place resulting hashes
+ * @param n Number of lanes in use, from @a in and @a out
+*/
+static void peach_sha256_lanes(word8 *in[], word8 *out[], int n)
+{
+   static const word32 k256[64] = {
+      0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+      0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+      0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+      0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+      0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+      0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+      0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+      0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+      0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+      0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+      0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+   };
+   static const word32 h256[8] = {
+      0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+      0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+   };
+   word32 w[64][PEACHLANES], s[8][PEACHLANES];
+   word32 t1, t2, x;
+   int i, j, k;
+
+   /* load (big endian) message words and single block padding */
+   memset(w, 0, sizeof(w[0]) * 16);
+   for (k = 0; k < n; k++) {
+      for (j = 0; j < (PEACHGENLEN / 4); j++) {
+         w[j][k] = ((word32) in[k][j * 4] << 24) |
+            ((word32) in[k][j * 4 + 1] << 16) |
+            ((word32) in[k][j * 4 + 2] << 8) | in[k][j * 4 + 3];
+      }
+   }
+   for (k = 0; k < PEACHLANES; k++) {
+      w[PEACHGENLEN / 4][k] = 0x80000000;
+      w[15][k] = PEACHGENLEN * 8;
+   }
+
+   /* message schedule */
+   for (j = 16; j < 64; j++) {
+#pragma omp simd private(t1, t2)
+      for (k = 0; k < PEACHLANES; k++) {
+         t1 = w[j - 2][k];
+         t2 = w[j - 15][k];
+         w[j][k] = (peach_ror32(t1, 17) ^ peach_ror32(t1, 19) ^ (t1 >> 10))
+            + w[j - 7][k] + w[j - 16][k]
+            + (peach_ror32(t2, 7) ^ peach_ror32(t2, 18) ^ (t2 >> 3));
+      }
+   }
+
+   /* compression */
+   for (i = 0; i < 8; i++) {
+      for (k = 0; k < PEACHLANES; k++) s[i][k] = h256[i];
+   }
+   for (j = 0; j < 64; j++) {
+#pragma omp simd private(t1, t2, x)
+      for (k = 0; k < PEACHLANES; k++) {
+         x = s[4][k];
+         t1 = s[7][k] + (peach_ror32(x, 6) ^ peach_ror32(x, 11)
+            ^ peach_ror32(x, 25)) + ((x & s[5][k]) ^ (~x & s[6][k]))
+            + k256[j] + w[j][k];
+         x = s[0][k];
+         t2 = (peach_ror32(x, 2) ^ peach_ror32(x, 13) ^ peach_ror32(x, 22))
+            + ((x & s[1][k]) ^ (x & s[2][k]) ^ (s[1][k] & s[2][k]));
+         s[7][k] = s[6][k];
+         s[6][k] = s[5][k];
+         s[5][k] = s[4][k];
+         s[4][k] = s[3][k] + t1;
+         s[3][k] = s[2][k];
+         s[2][k] = s[1][k];
+         s[1][k] = x;
+         s[0][k] = t1 + t2;
+      }
+   }
+
+   /* store (big endian) hash of lanes in use */
+   for (k = 0; k < n; k++) {
+      for (i = 0; i < 8; i++) {
+         x = s[i][k] + h256[i];
+         out[k][i * 4] = (word8) (x >> 24);
+         out[k][i * 4 + 1] = (word8) (x >> 16);
+         out[k][i * 4 + 2] = (word8) (x >> 8);
+         out[k][i * 4 + 3] = (word8) x;
+      }
+   }
+}  /* end peach_sha256_lanes() */
+
+/**
+ * @private
+ * Perform SHA3-256 or Keccak-256 on PEACHGENLEN bytes of each input, for
+ * up to PEACHLANES lanes in lock-step. Lanes are held in structure-of-
+ * arrays form so that each step of Keccak-f[1600] vectorizes across lanes.
+ * Inputs are fully read before any output is written, so an output may
+ * overlap its input.
+ * @param in Array of pointers to (PEACHGENLEN bytes of) input data
+ * @param pad Array of per lane domain padding; 0x06 (SHA3) or 0x01 (Keccak)
+ * @param out Array of pointers to locations to place resulting hashes
+ * @param n Number of lanes in use, from @a in, @a pad and @a out
+*/
+static void peach_keccak_lanes
+   (word8 *in[], const word8 pad[], word8 *out[], int n)
+{
+   static const word64 rc[24] = {
+      WORD64_C(0x0000000000000001), WORD64_C(0x0000000000008082),
+      WORD64_C(0x800000000000808a), WORD64_C(0x8000000080008000),
+      WORD64_C(0x000000000000808b), WORD64_C(0x0000000080000001),
+      WORD64_C(0x8000000080008081), WORD64_C(0x8000000000008009),
+      WORD64_C(0x000000000000008a), WORD64_C(0x0000000000000088),
+      WORD64_C(0x0000000080008009), WORD64_C(0x000000008000000a),
+      WORD64_C(0x000000008000808b), WORD64_C(0x800000000000008b),
+      WORD64_C(0x8000000000008089), WORD64_C(0x8000000000008003),
+      WORD64_C(0x8000000000008002), WORD64_C(0x8000000000000080),
+      WORD64_C(0x000000000000800a), WORD64_C(0x800000008000000a),
+      WORD64_C(0x8000000080008081), WORD64_C(0x8000000000008080),
+      WORD64_C(0x0000000080000001), WORD64_C(0x8000000080008008)
+   };
+   /* rho rotation and pi destination of each state word (x + 5y) */
+   static const int rho[25] = {
+      0, 1, 62, 28, 27, 36, 44, 6, 55, 20, 3, 10, 43, 25, 39,
+      41, 45, 15, 21, 8, 18, 2, 61, 56, 14
+   };
+   static const int pi[25] = {
+      0, 10, 20, 5, 15, 16, 1, 11, 21, 6, 7, 17, 2, 12, 22,
+      23, 8, 18, 3, 13, 14, 24, 9, 19, 4
+   };
+   word64 st[25][PEACHLANES], b[25][PEACHLANES];
+   word64 c[5][PEACHLANES], d;
+   word32 tail;
+   int i, r, x, y, k;
+
+   /* absorb (little endian) input and padding of a single rate block */
+   memset(st, 0, sizeof(st));
+   for (k = 0; k < n; k++) {
+      memcpy(&tail, in[k] + 32, 4);
+      for (i = 0; i < 4; i++) memcpy(&st[i][k], in[k] + (i * 8), 8);
+      st[4][k] = (word64) tail | ((word64) pad[k] << 32);
+      st[16][k] = WORD64_C(0x8000000000000000);
+   }
+
+   /* Keccak-f[1600] permutation */
+   for (r = 0; r < 24; r++) {
+      /* theta */
+      for (x = 0; x < 5; x++) {
+#pragma omp simd
+         for (k = 0; k < PEACHLANES; k++) {
+            c[x][k] = st[x][k] ^ st[x + 5][k] ^ st[x + 10][k]
+               ^ st[x + 15][k] ^ st[x + 20][k];
+         }
+      }
+      for (x = 0; x < 5; x++) {
+#pragma omp simd private(d)
+         for (k = 0; k < PEACHLANES; k++) {
+            d = c[(x + 4) % 5][k] ^ peach_rol64(c[(x + 1) % 5][k], 1);
+            for (y = 0; y < 25; y += 5) st[x + y][k] ^= d;
+         }
+      }
+      /* rho and pi */
+      for (i = 0; i < 25; i++) {
+#pragma omp simd
+         for (k = 0; k < PEACHLANES; k++) {
+            b[pi[i]][k] = peach_rol64(st[i][k], rho[i]);
+         }
+      }
+      /* chi */
+      for (y = 0; y < 25; y += 5) {
+         for (x = 0; x < 5; x++) {
+#pragma omp simd
+            for (k = 0; k < PEACHLANES; k++) {
+               st[x + y][k] = b[x + y][k]
+                  ^ (~b[((x + 1) % 5) + y][k] & b[((x + 2) % 5) + y][k]);
+            }
+         }
+      }
+      /* iota */
+      for (k = 0; k < PEACHLANES; k++) st[0][k] ^= rc[r];
+   }
+
+   /* squeeze (little endian) 256-bit hash of lanes in use */
+   for (k = 0; k < n; k++) {
+      for (i = 0; i < 4; i++) memcpy(out[k] + (i * 8), &st[i][k], 8);
+   }
+}  /* end peach_keccak_lanes() */
+
 /**
  * @private
  * Generate a tile of the Peach map.
@@ -251,36 +1156,191 @@ static void peach_generate(word32 index, const void *phash, word8 *out)
    }
 }  /* end peach_generate() */
 
+/**
+ * @private
+ * Generate up to PEACHBATCH tiles of the Peach map in lock-step. Each row
+ * of Nighthash is advanced across all tiles, with rows grouped by their
+ * selected algorithm, such that SHA256 and SHA3/Keccak rows are hashed
+ * together, PEACHLANES at a time. Results are identical to those of
+ * peach_generate() for each tile.
+ * @param index Array of index numbers of tiles to generate
+ * @param phash Previous block hash for use in tile generation
+ * @param out Array of pointers to locations to place generated tiles
+ * @param n Number of tiles to generate, from @a index and @a out
+*/
+static void peach_generate_lanes
+   (const word32 index[], const void *phash, word8 *out[], int n)
+{
+   word8 *sin[PEACHBATCH], *sout[PEACHBATCH];
+   word8 *kin[PEACHBATCH], *kout[PEACHBATCH], kpad[PEACHBATCH];
+   word8 *in, *dst;
+   word32 algo;
+   int i, k, ns, nk;
+
+   /* place initial data into seed of each tile */
+   for (k = 0; k < n; k++) {
+      memcpy(out[k], &index[k], 4);
+      memcpy(out[k] + 4, phash, SHA256LEN);
+   }
+   /* advance each row of Nighthash across tiles; the initial row is
+    * hashed in place, each following row from the preceding result */
+   for (i = -32; i < 992; i += 32) {
+      ns = nk = 0;
+      for (k = 0; k < n; k++) {
+         if (i < 0) {
+            in = dst = out[k];
+            algo = peach_nightops(in, PEACHGENLEN, index[k], PEACHGENLEN);
+         } else {
+            in = &out[k][i];
+            dst = &out[k][i + 32];
+            memcpy(dst, &index[k], 4);
+            algo = peach_nightops(in, PEACHGENLEN, index[k], SHA256LEN);
+         }
+         /* bucket multi-lane algorithms, otherwise hash directly */
+         switch (algo) {
+            case 3: sin[ns] = in; sout[ns++] = dst; break;
+            case 4: kin[nk] = in; kpad[nk] = 0x06; kout[nk++] = dst; break;
+            case 5: kin[nk] = in; kpad[nk] = 0x01; kout[nk++] = dst; break;
+            default: peach_nightalgo(algo, in, PEACHGENLEN, dst);
+         }
+      }
+      /* dispatch buckets, PEACHLANES at a time */
+      for (k = 0; k < ns; k += PEACHLANES) {
+         peach_sha256_lanes(&sin[k], &sout[k],
+            (ns - k) < PEACHLANES ? (ns - k) : PEACHLANES);
+      }
+      for (k = 0; k < nk; k += PEACHLANES) {
+         peach_keccak_lanes(&kin[k], &kpad[k], &kout[k],
+            (nk - k) < PEACHLANES ? (nk - k) : PEACHLANES);
+      }
+   }
+}  /* end peach_generate_lanes() */
+
 /**
  * @private
  * Generate and/or retrieve a tile of the Peach map. CPU solving only.
+ * Where the context has a Peach Map, an empty tile is claimed and
+ * generated directly into the map, then published for other threads.
+ * A tile claimed by another thread is generated (privately) to @a out,
+ * rather than waiting for publication.
+ * @param ctx Pointer to Peach solver context
  * @param index Index number of tile on Peach map
  * @param phash Previous block hash for use in tile generation
  * @param out Pointer to location to place generated tile
  * @returns Pointer to (previously) generated tile data
 */
 static inline word8 *peach_gencache
-   (word32 index, const void *phash, word8 *out)
+   (PEACH_CTX *ctx, word32 index, const void *phash, word8 *out)
 {
-#ifdef ENABLE_CPU_PEACH_CACHE
-   /* return cache or redirect out to correct map tile */
-   if (PeachCache[index]) {
-      return &PeachMap[index * PEACHTILELEN];
-   } else out = &PeachMap[index * PEACHTILELEN];
+   word8 *tilep;
 
-#endif
+   if (ctx->map) {
+      tilep = &ctx->map[index * PEACHTILELEN];
+      /* return published tile, or claim and generate tile into map */
+      switch (peach_tile_load(&ctx->tiles[index])) {
+         case PEACH_TILE_READY: return tilep;
+         case PEACH_TILE_EMPTY:
+            if (!peach_tile_claim(&ctx->tiles[index])) break;
+            peach_generate(index, phash, tilep);
+            peach_tile_publish(&ctx->tiles[index]);
+            return tilep;
+      }
+   }
 
-   /* generaion tile to out */
+   /* generate tile to out */
    peach_generate(index, phash, out);
 
-#ifdef ENABLE_CPU_PEACH_CACHE
-   /* flag index as generated */
-   PeachCache[index] = 1;
+   return out;
+}  /* end peach_gencache() */
 
+/**
+ * @private
+ * Build the shared memory segment name of a Peach Map.
+ * @param phash Previous block hash of Peach Map tiles
+ * @param name Pointer to location to place segment name
+ * @param len Length of @a name buffer, in bytes
+*/
+static void peach_shm_name(const word8 *phash, char *name, size_t len)
+{
+   size_t n;
+   int i;
+
+   n = (size_t) snprintf(name, len, "%s", PEACH_SHM_PREFIX);
+   for (i = 0; i < HASHLEN && n + 2 < len; i++, n += 2) {
+      snprintf(name + n, len - n, "%02x", phash[i]);
+   }
+}  /* end peach_shm_name() */
+
+/**
+ * @private
+ * Detach a context from its shared Peach Map, if any. The segment is
+ * left for its owner to remove, see peach_shm_sweep().
+ * @param ctx Pointer to Peach solver context
+*/
+static void peach_shm_detach(PEACH_CTX *ctx)
+{
+   if (ctx->tiles == NULL) return;
+   munmap(ctx->tiles, PEACHCACHELEN + PEACHMAPLEN);
+   ctx->map = ctx->tiles = NULL;
+}  /* end peach_shm_detach() */
+
+/**
+ * @private
+ * Attach a context to the shared Peach Map of @a phash, creating the
+ * segment where it does not exist. Segment storage is reserved up front
+ * so that exhausted shared memory is reported here, rather than faulting
+ * on first use of a tile. Reserving storage of an existing segment leaves
+ * its contents intact, so concurrent attachment is safe.
+ * @param ctx Pointer to Peach solver context
+ * @param phash Previous block hash of Peach Map tiles
+ * @returns VEOK on success, else VERROR
+*/
+static int peach_shm_attach(PEACH_CTX *ctx, const word8 *phash)
+{
+   char name[sizeof(PEACH_SHM_PREFIX) + (HASHLEN * 2)];
+   void *mem;
+   int fd, ecode;
+
+   peach_shm_name(phash, name, sizeof(name));
+   fd = shm_open(name, O_RDWR | O_CREAT, 0600);
+   if (fd == -1) return VERROR;
+   /* tile flags precede the map, both zero filled (PEACH_TILE_EMPTY) */
+   ecode = posix_fallocate(fd, 0, PEACHCACHELEN + PEACHMAPLEN);
+   if (ecode != 0) {
+      close(fd);
+      set_errno(ecode);
+      return VERROR;
+   }
+   mem = mmap(NULL, PEACHCACHELEN + PEACHMAPLEN, PROT_READ | PROT_WRITE,
+      MAP_SHARED, fd, 0);
+   close(fd);
+   if (mem == MAP_FAILED) return VERROR;
+#ifdef MADV_HUGEPAGE
+   if (ctx->mode & PEACH_MAP_HUGE) {
+      madvise(mem, PEACHCACHELEN + PEACHMAPLEN, MADV_HUGEPAGE);
+   }
 #endif
+   ctx->tiles = mem;
+   ctx->map = ctx->tiles + PEACHCACHELEN;
 
-   return out;
-}  /* end peach_gencache() */
+   return VEOK;
+}  /* end peach_shm_attach() */
+
+/**
+ * @private
+ * Withdraw work from the solving threads of a CPU device, and wait for
+ * active threads to idle. Work may be safely updated on return.
+ * @param cpu Pointer to CPU device context
+*/
+static void peach_cpu_pause(PEACH_CPU *cpu)
+{
+   struct timespec ts = { 0, 1000000 };
+
+   __atomic_store_n(&cpu->pause, 1, __ATOMIC_SEQ_CST);
+   while (__atomic_load_n(&cpu->active, __ATOMIC_SEQ_CST)) {
+      nanosleep(&ts, NULL);
+   }
+}  /* end peach_cpu_pause() */
 
 /**
  * @private
@@ -351,50 +1411,70 @@ int peach_checkhash(const BTRAILER *bt, word8 diff, void *out)
 }  /* end peach_checkhash() */
 
 /**
- * Initialize configuration parameters for solving a Block Trailer with
- * the Peach Proof-of-Work algorithm.
- * @param bt Pointer to block trailer to initialize for work
- * @returns VEOK
+ * Free resources of a Peach solver context. A shared Peach Map is only
+ * detached, as other processes may still use it.
+ * @param ctx Pointer to Peach solver context
 */
-int peach_init(const BTRAILER *bt)
+void peach_ctx_free(PEACH_CTX *ctx)
 {
-#ifdef ENABLE_CPU_PEACH_CACHE
-   word8 hashphash[SHA256LEN];
-   word64 *zp;
-   int i;
-
-   sha256(bt->phash, SHA256LEN, hashphash);
-   if (memcmp(PeachCleared, hashphash, SHA256LEN)) {
-      /* store last hash the cache was cleared for */
-      memcpy(PeachCleared, hashphash, SHA256LEN);
-      /* clear Cache data if phash does not match block trailer's */
-      zp = (word64 *) PeachCache;
-      for (i = 0; i < PEACHCACHELEN64; zp[i++] = 0);
+   if (peach_map_mode(ctx->mode) == PEACH_MAP_SHARED) {
+      peach_shm_detach(ctx);
+      return;
    }
+   if (ctx->map) free(ctx->map);
+   if (ctx->tiles) free(ctx->tiles);
+   ctx->map = ctx->tiles = NULL;
+}  /* end peach_ctx_free() */
 
+/**
+ * Initialize a Peach solver context. With PEACH_MAP_PRIVATE, a Peach
+ * Map of PEACHMAPLEN bytes is allocated for use by peach_ctx_solve().
+ * Map memory is only committed as tiles are generated. With
+ * PEACH_MAP_SHARED, the shared Peach Map is attached by peach_ctx_work().
+ * @param ctx Pointer to Peach solver context
+ * @param mode Peach Map mode, PEACH_MAP_*, optionally with PEACH_MAP_HUGE
+ * @returns VEOK on success, else VERROR
+ * @note Free context resources with peach_ctx_free().
+*/
+int peach_ctx_init(PEACH_CTX *ctx, int mode)
+{
+   memset(ctx, 0, sizeof(PEACH_CTX));
+   ctx->mode = mode;
+   if (peach_map_mode(mode) == PEACH_MAP_PRIVATE) {
+      ctx->map = malloc(PEACHMAPLEN);
+      ctx->tiles = calloc(PEACHCACHELEN, 1);
+      if (ctx->map == NULL || ctx->tiles == NULL) {
+         peach_ctx_free(ctx);
+         return VERROR;
+      }
+#ifdef MADV_HUGEPAGE
+      if (mode & PEACH_MAP_HUGE) {
+         /* advice applies to whole (aligned) pages within the map */
+         madvise((void *) (((size_t) ctx->map + 0x1fffff) & ~0x1fffff),
+            PEACHMAPLEN - 0x200000, MADV_HUGEPAGE);
+      }
 #endif
-
-   /* pre-compute partial SHA256 of block trailer */
-   sha256_init(&PeachICTX);
-   sha256_update(&PeachICTX, bt, 92);
+   }
 
    return VEOK;
-}  /* end peach_init() */
+}  /* end peach_ctx_init() */
 
 /**
- * Try solve for a tokenized haiku as nonce output for Peach proof of work.
- * Combine haiku protocols implemented in the Trigg Algorithm with the
- * memory intensive protocols of the Peach algorithm to generate haiku
- * output as proof of work.
+ * Try solve for a tokenized haiku as nonce output for Peach proof of work,
+ * using a Peach solver context. Safe to call from multiple threads sharing
+ * a single context, provided peach_ctx_work() is not called concurrently.
+ * @param ctx Pointer to Peach solver context, prepared by peach_ctx_work()
+ * @param rng Pointer to (per thread) nonce generator, or NULL
  * @param bt Pointer to block trailer to solve for
  * @param diff Difficulty to test against entropy of final hash
  * @param out Pointer to location to place nonce on solve
  * @returns VEOK on solve, else VERROR
+ * @note Where @a rng is NULL, nonce generation uses the shared prng of
+ * trigg_generate_fast(), serialized across threads.
 */
-int peach_solve(const BTRAILER *bt, word8 diff, void *out)
+int peach_ctx_solve(PEACH_CTX *ctx, TRIGG_RNG *rng,
+   const BTRAILER *bt, word8 diff, void *out)
 {
-   static const size_t SHA256_CTX_SIZE = sizeof(SHA256_CTX);
-
    SHA256_CTX ictx;
    word8 *tilep, hash[SHA256LEN], tile[PEACHTILELEN], nonce[HASHLEN];
    word32 mario;
@@ -403,10 +1483,18 @@ int peach_solve(const BTRAILER *bt, word8 diff, void *out)
    /* set (initial) tile pointer */
    tilep = tile;
    /* generate (full) nonce */
-   trigg_generate_fast(nonce);
-   trigg_generate_fast(nonce + 16);
+   if (rng) {
+      trigg_generate_fast_r(rng, nonce);
+      trigg_generate_fast_r(rng, nonce + 16);
+   } else {
+      #pragma omp critical(peach_nonce)
+      {
+         trigg_generate_fast(nonce);
+         trigg_generate_fast(nonce + 16);
+      }
+   }
    /* copy pre-computed SHA256 */
-   memcpy(&ictx, &PeachICTX, SHA256_CTX_SIZE);
+   memcpy(&ictx, &ctx->ictx, sizeof(SHA256_CTX));
    /* update pre-computed SHA256 with nonce and finalize */
    sha256_update(&ictx, nonce, SHA256LEN);
    sha256_final(&ictx, hash);
@@ -417,10 +1505,10 @@ int peach_solve(const BTRAILER *bt, word8 diff, void *out)
    mario &= PEACHCACHELEN_M1;
    /* generate tile at index, then determine next jump, for PEACHROUNDS, ... */
    for(i = 0; i < PEACHROUNDS; i++) {
-      tilep = peach_gencache(mario, bt->phash, tilep);
+      tilep = peach_gencache(ctx, mario, bt->phash, tile);
       peach_jump(&mario, nonce, tilep);
    } /* ... then generate final tile for hashing */
-   tilep = peach_gencache(mario, bt->phash, tilep);
+   tilep = peach_gencache(ctx, mario, bt->phash, tile);
    /* hash block trailer with final tile */
    sha256_init(&ictx);
    sha256_update(&ictx, hash, SHA256LEN);
@@ -434,7 +1522,347 @@ int peach_solve(const BTRAILER *bt, word8 diff, void *out)
    }
 
    return VERROR;
+}  /* end peach_ctx_solve() */
+
+/**
+ * Prepare a Peach solver context for solving a Block Trailer. Clears the
+ * tile flags of the Peach Map where the previous block hash has changed.
+ * A shared Peach Map is instead swapped for that of the new previous
+ * block hash, falling back to solving without a map on failure.
+ * @param ctx Pointer to Peach solver context
+ * @param bt Pointer to block trailer to initialize for work
+ * @returns VEOK on success, else VERROR if a shared Peach Map could not
+ * be attached; check errno for details
+ * @note MUST NOT be called while other threads use the context.
+*/
+int peach_ctx_work(PEACH_CTX *ctx, const BTRAILER *bt)
+{
+   int ecode = VEOK;
+
+   if (peach_map_mode(ctx->mode) == PEACH_MAP_SHARED) {
+      /* (re)attach shared map of phash, detaching that of previous phash */
+      if (ctx->map == NULL || memcmp(ctx->phash, bt->phash, HASHLEN) != 0) {
+         peach_shm_detach(ctx);
+         ecode = peach_shm_attach(ctx, bt->phash);
+      }
+   } else if (ctx->map && memcmp(ctx->phash, bt->phash, HASHLEN) != 0) {
+      /* clear tile flags where phash does not match block trailer's */
+      memset(ctx->tiles, PEACH_TILE_EMPTY, PEACHCACHELEN);
+   }
+   /* store phash of map tiles */
+   memcpy(ctx->phash, bt->phash, HASHLEN);
+
+   /* pre-compute partial SHA256 of block trailer */
+   sha256_init(&ctx->ictx);
+   sha256_update(&ctx->ictx, bt, 92);
+
+   return ecode;
+}  /* end peach_ctx_work() */
+
+/**
+ * Free the Peach context of a CPU device. MUST only be called once the
+ * solving threads of the device have returned from peach_work_cpu().
+ * @param devp Pointer to CPU device context
+*/
+void peach_free_cpu_device(DEVICE_CTX *devp)
+{
+   PEACH_CPU *cpu = (PEACH_CPU *) devp->peach;
+
+   if (cpu) {
+      peach_ctx_free(&cpu->ctx);
+      free(cpu);
+   }
+   devp->peach = NULL;
+   devp->status = DEV_NULL;
+}  /* end peach_free_cpu_device() */
+
+/**
+ * Generate a batch of Peach map tiles. Tiles are generated PEACHBATCH at
+ * a time, in lock-step, to amortize hashing across independent tiles.
+ * Results are identical to those of tiles generated during solving.
+ * @param index Array of index numbers of tiles to generate
+ * @param count Number of tiles to generate, from @a index
+ * @param phash Previous block hash for use in tile generation
+ * @param out Pointer to location to place (@a count * PEACHTILELEN bytes
+ * of) generated tiles, in order of @a index
+*/
+void peach_generate_batch
+   (const word32 *index, size_t count, const void *phash, word8 *out)
+{
+   word8 *tiles[PEACHBATCH];
+   size_t j;
+   int k, n;
+
+   for (j = 0; j < count; j += (size_t) n) {
+      n = (count - j) < PEACHBATCH ? (int) (count - j) : PEACHBATCH;
+      for (k = 0; k < n; k++) tiles[k] = &out[(j + k) * PEACHTILELEN];
+      peach_generate_lanes(&index[j], phash, tiles, n);
+   }
+}  /* end peach_generate_batch() */
+
+/**
+ * Initialize configuration parameters for solving a Block Trailer with
+ * the Peach Proof-of-Work algorithm.
+ * @param bt Pointer to block trailer to initialize for work
+ * @returns VEOK on success, else VERROR; see peach_ctx_work()
+*/
+int peach_init(const BTRAILER *bt)
+{
+#if defined(ENABLE_CPU_PEACH_SHM)
+   /* use shared Peach Map for default context */
+   PeachCtx.mode = PEACH_MAP_SHARED | PEACH_MAP_HUGE;
+
+#elif defined(ENABLE_CPU_PEACH_CACHE)
+   /* use static Peach Map for default context */
+   PeachCtx.map = PeachMap;
+   PeachCtx.tiles = PeachCache;
+
+#endif
+
+   return peach_ctx_work(&PeachCtx, bt);
+}  /* end peach_init() */
+
+/**
+ * Initialize the Peach context of a CPU device, as initialized by
+ * init_cpu_devices(). Solving threads share a single Peach Map.
+ * @param devp Pointer to CPU device context
+ * @param mode Peach Map mode, PEACH_MAP_*, optionally with PEACH_MAP_HUGE
+ * @param seed Nonce generator seed, for (disjoint) per thread streams
+ * @returns VEOK on success, else VERROR; check errno for details
+ * @note Where a shared Peach Map cannot be attached for work, solving
+ * threads generate all Peach tiles, as per peach_ctx_work().
+*/
+int peach_init_cpu_device(DEVICE_CTX *devp, int mode, word64 seed)
+{
+   PEACH_CPU *cpu;
+
+   cpu = calloc(1, sizeof(PEACH_CPU));
+   if (cpu == NULL) goto FAIL;
+   if (peach_ctx_init(&cpu->ctx, mode) != VEOK) goto FAIL;
+   cpu->seed = seed;
+   cpu->pause = 1;
+
+   devp->peach = cpu;
+   devp->status = DEV_IDLE;
+   devp->work = devp->hps = 0;
+   devp->last = time(NULL);
+
+   return VEOK;
+
+FAIL:
+   if (cpu) free(cpu);
+   devp->status = DEV_FAIL;
+
+   return VERROR;
+}  /* end peach_init_cpu_device() */
+
+/**
+ * Release stale tile claims of the shared Peach Map of @a phash. A solver
+ * stopped while generating a tile leaves its claim in place, such that
+ * the tile would otherwise never be published. Released tiles are
+ * generated again on next use. MUST only be called by the owner of the
+ * segment, once the solvers it started have stopped.
+ * @param phash Previous block hash of Peach Map tiles
+ * @returns Number of claims released, else (-1) if no segment exists
+*/
+int peach_shm_reclaim(const void *phash)
+{
+   char name[sizeof(PEACH_SHM_PREFIX) + (HASHLEN * 2)];
+   word8 *tiles, expect;
+   int fd, count, j;
+
+   peach_shm_name(phash, name, sizeof(name));
+   fd = shm_open(name, O_RDWR, 0600);
+   if (fd == -1) return (-1);
+   /* tile flags precede the map */
+   tiles = mmap(NULL, PEACHCACHELEN, PROT_READ | PROT_WRITE,
+      MAP_SHARED, fd, 0);
+   close(fd);
+   if (tiles == MAP_FAILED) return (-1);
+   for (count = j = 0; j < PEACHCACHELEN; j++) {
+      expect = PEACH_TILE_CLAIM;
+      if (__atomic_compare_exchange_n(&tiles[j], &expect, PEACH_TILE_EMPTY,
+            0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) count++;
+   }
+   munmap(tiles, PEACHCACHELEN);
+
+   return count;
+}  /* end peach_shm_reclaim() */
+
+/**
+ * Remove the shared Peach Maps of every previous block hash other than
+ * @a phash. Contexts never remove a shared Peach Map, as other processes
+ * may still use it. Instead, the process that starts solvers (e.g. the
+ * node) owns the segments, and sweeps them as its work changes. Contexts
+ * still attached to a removed segment keep their mapping, and storage is
+ * released as the last context detaches.
+ * @param phash Previous block hash of Peach Map to keep, or NULL for none
+ * @returns Number of segments removed, else (-1) on error
+*/
+int peach_shm_sweep(const void *phash)
+{
+   char keep[sizeof(PEACH_SHM_PREFIX) + (HASHLEN * 2)];
+   char name[sizeof(PEACH_SHM_PREFIX) + (HASHLEN * 2)];
+   struct dirent *dp;
+   size_t len;
+   DIR *dir;
+   int count;
+
+   keep[0] = '\0';
+   if (phash) peach_shm_name(phash, keep, sizeof(keep));
+   dir = opendir(PEACH_SHM_DIR);
+   if (dir == NULL) return (-1);
+   for (count = 0; (dp = readdir(dir)) != NULL; ) {
+      /* directory entries are segment names, without the leading '/' */
+      len = strlen(dp->d_name);
+      if (len + 2 > sizeof(name)) continue;
+      if (strncmp(dp->d_name, PEACH_SHM_PREFIX + 1,
+         sizeof(PEACH_SHM_PREFIX) - 2) != 0) continue;
+      name[0] = '/';
+      memcpy(name + 1, dp->d_name, len + 1);
+      if (strcmp(name, keep) == 0) continue;
+      if (shm_unlink(name) == 0) count++;
+   }
+   closedir(dir);
+
+   return count;
+}  /* end peach_shm_sweep() */
+
+/**
+ * Try solve for a tokenized haiku as nonce output for Peach proof of work.
+ * Combine haiku protocols implemented in the Trigg Algorithm with the
+ * memory intensive protocols of the Peach algorithm to generate haiku
+ * output as proof of work.
+ * @param bt Pointer to block trailer to solve for
+ * @param diff Difficulty to test against entropy of final hash
+ * @param out Pointer to location to place nonce on solve
+ * @returns VEOK on solve, else VERROR
+*/
+int peach_solve(const BTRAILER *bt, word8 diff, void *out)
+{
+   return peach_ctx_solve(&PeachCtx, NULL, bt, diff, out);
 }  /* end peach_solve() */
 
+/**
+ * Manage Peach proof of work on a CPU device. Distributes (changed) work
+ * to the solving threads of the device, updates device work and hashrate,
+ * and collects any solve. Does not block on solving; call periodically.
+ * @param devp Pointer to CPU device context
+ * @param bt Pointer to block trailer to solve for, or NULL to pause
+ * @param diff Difficulty to test against entropy of final hash
+ * @param btout Pointer to location to place solved block trailer
+ * @returns VEOK on solve, VERROR on no solve, or VETIMEOUT if the device
+ * is either stopped or uninitialized.
+*/
+int peach_solve_cpu(DEVICE_CTX *devp, BTRAILER *bt, word8 diff,
+   BTRAILER *btout)
+{
+   PEACH_CPU *cpu = (PEACH_CPU *) devp->peach;
+   double delta;
+
+   /* report unuseable devices */
+   if (devp->status < DEV_NULL || cpu == NULL) return VETIMEOUT;
+
+   /* withdraw work where paused */
+   if (bt == NULL) {
+      if (devp->status == DEV_WORK) {
+         peach_cpu_pause(cpu);
+         devp->status = DEV_IDLE;
+      }
+      return VERROR;
+   }
+
+   /* (re)distribute work where changed */
+   if (devp->status != DEV_WORK || memcmp(&cpu->bt, bt, 92) != 0) {
+      peach_cpu_pause(cpu);
+      memcpy(&cpu->bt, bt, sizeof(BTRAILER));
+      cpu->diff = diff && diff < bt->difficulty[0] ? diff : bt->difficulty[0];
+      peach_ctx_work(&cpu->ctx, &cpu->bt);
+      /* drop hashes and solves of previous work */
+      __atomic_store_n(&cpu->hashes, 0, __ATOMIC_RELAXED);
+      __atomic_store_n(&cpu->solved, PEACH_CPU_NONE, __ATOMIC_RELAXED);
+      devp->work = devp->hps = 0;
+      devp->last = time(NULL);
+      devp->status = DEV_WORK;
+      __atomic_store_n(&cpu->pause, 0, __ATOMIC_SEQ_CST);
+   }
+
+   /* update work and hashrate */
+   devp->work += __atomic_exchange_n(&cpu->hashes, 0, __ATOMIC_RELAXED);
+   delta = difftime(time(NULL), devp->last);
+   if (delta > 0) devp->hps = (size_t) ((double) devp->work / delta);
+
+   /* collect solve */
+   if (__atomic_load_n(&cpu->solved, __ATOMIC_ACQUIRE) == PEACH_CPU_READY) {
+      memcpy(btout, &cpu->solve, sizeof(BTRAILER));
+      __atomic_store_n(&cpu->solved, PEACH_CPU_NONE, __ATOMIC_RELEASE);
+      return VEOK;
+   }
+
+   return VERROR;
+}  /* end peach_solve_cpu() */
+
+/**
+ * Try solve for a tokenized haiku as nonce output for Peach proof of work,
+ * as per peach_solve(), using nonces of the generator @a rng. Safe to call
+ * from multiple threads, provided each thread uses its own generator.
+ * @param rng Pointer to (per thread) nonce generator
+ * @param bt Pointer to block trailer to solve for
+ * @param diff Difficulty to test against entropy of final hash
+ * @param out Pointer to location to place nonce on solve
+ * @returns VEOK on solve, else VERROR
+*/
+int peach_solve_r(TRIGG_RNG *rng, const BTRAILER *bt, word8 diff, void *out)
+{
+   return peach_ctx_solve(&PeachCtx, rng, bt, diff, out);
+}  /* end peach_solve_r() */
+
+/**
+ * Solve distributed work of a CPU device, until work is withdrawn.
+ * Called by each of the solving threads of the device, where each call
+ * takes a disjoint stream of the nonce generator of the device.
+ * @param devp Pointer to CPU device context
+ * @returns VEOK where work was solved, else VERROR where no work was
+ * available; callers should wait before calling again.
+*/
+int peach_work_cpu(DEVICE_CTX *devp)
+{
+   PEACH_CPU *cpu = (PEACH_CPU *) devp->peach;
+   BTRAILER bt;
+   TRIGG_RNG rng;
+   word8 diff;
+   int expect, stream;
+
+   /* report unuseable devices */
+   if (cpu == NULL) return VERROR;
+
+   /* flag active, then check for work (see peach_cpu_pause()) */
+   __atomic_add_fetch(&cpu->active, 1, __ATOMIC_SEQ_CST);
+   if (__atomic_load_n(&cpu->pause, __ATOMIC_SEQ_CST)) {
+      __atomic_sub_fetch(&cpu->active, 1, __ATOMIC_SEQ_CST);
+      return VERROR;
+   }
+
+   memcpy(&bt, &cpu->bt, sizeof(BTRAILER));
+   diff = cpu->diff;
+   stream = __atomic_fetch_add(&cpu->streams, 1, __ATOMIC_RELAXED);
+   trigg_rng_init(&rng, cpu->seed, (word64) stream);
+   /* solve (shared Peach context) until paused */
+   do {
+      if (peach_ctx_solve(&cpu->ctx, &rng, &bt, diff, bt.nonce) == VEOK) {
+         expect = PEACH_CPU_NONE;
+         if (__atomic_compare_exchange_n(&cpu->solved, &expect,
+               PEACH_CPU_CLAIM, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            memcpy(&cpu->solve, &bt, sizeof(BTRAILER));
+            __atomic_store_n(&cpu->solved, PEACH_CPU_READY, __ATOMIC_RELEASE);
+         }
+      }
+      __atomic_add_fetch(&cpu->hashes, 1, __ATOMIC_RELAXED);
+   } while (__atomic_load_n(&cpu->pause, __ATOMIC_RELAXED) == 0);
+   __atomic_sub_fetch(&cpu->active, 1, __ATOMIC_SEQ_CST);
+
+   return VEOK;
+}  /* end peach_work_cpu() */
+
 /* end include guard */
 #endif
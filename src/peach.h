@@ -29,6 +29,15 @@
  * generates and stores tiles in a statically aallocated Peach Map
  * and cache taking up 1 Gibibyte and 1 Mibibyte, respectively,
  * enabling a "mining advantage" with the reuse of generated tiles.
+ * <br />If compiled with `ENABLE_CPU_PEACH_SHM`, peach_solve() instead
+ * uses a Peach Map in POSIX shared memory (see PEACH_MAP_SHARED), such
+ * that co-located solving processes share tile generation.
+ * <br />For multi-threaded solving, use a PEACH_CTX with the peach_ctx_*()
+ * functions, where threads share a single (dynamically allocated) map.
+ * <br />Nighthash flops and memory transformations use SIMD kernels on
+ * x86_64 (SSE2, or AVX2 where supported at runtime) and aarch64 (NEON),
+ * bit-exact with the scalar kernels. If compiled with
+ * `DISABLE_CPU_PEACH_SIMD`, only the scalar kernels are used.
 */
 
 /* include guard */
@@ -41,6 +50,7 @@
 #include "extint.h"  /* for word types */
 #include "types.h"   /* for Mochimo types */
 #include "trigg.h"   /* for BTRAILER, generation and evaluation */
+#include "sha256.h"  /* for SHA256_CTX */
 
 
 /**
@@ -103,6 +113,62 @@
 */
 #define PEACHTILELEN64  128
 
+/**
+ * Number of Peach tiles generated in lock-step by peach_generate_batch().
+*/
+#define PEACHBATCH       64
+
+/**
+ * Number of lanes of the multi-lane Nighthash implementations.
+*/
+#define PEACHLANES       8
+
+/**
+ * Peach Map mode, no Peach Map. Tiles are generated on every use.
+*/
+#define PEACH_MAP_NONE     0
+
+/**
+ * Peach Map mode, a Peach Map allocated privately to a context.
+*/
+#define PEACH_MAP_PRIVATE  1
+
+/**
+ * Peach Map mode, a Peach Map (and tile flags) in a named POSIX shared
+ * memory segment, keyed by the previous block hash of the map tiles.
+ * Contexts of any process on the host, working on the same previous block
+ * hash, attach to the same segment and share generated tiles. Segments
+ * are removed by their owner, see peach_shm_sweep().
+*/
+#define PEACH_MAP_SHARED   2
+
+/**
+ * Peach Map mode flag, advise huge page backing of a Peach Map.
+ * Applies to PEACH_MAP_PRIVATE and PEACH_MAP_SHARED modes. Backing of
+ * shared memory depends on the transparent huge page support of shmem.
+*/
+#define PEACH_MAP_HUGE     4
+
+/**
+ * Prefix of named POSIX shared memory segments of shared Peach Maps.
+ * Segment names are completed by the hexadecimal previous block hash.
+*/
+#define PEACH_SHM_PREFIX   "/mochimo-peach-"
+
+/**
+ * Peach solver context. Holds pre-computed work data and an (optional)
+ * Peach Map. A single context may be shared by multiple solving threads,
+ * where map tiles are claimed and published with atomic per-tile flags,
+ * such that each tile is generated (into the map) once per phash.
+*/
+typedef struct {
+   SHA256_CTX ictx;        /**< pre-computed partial SHA256 of trailer */
+   word8 phash[HASHLEN];   /**< previous block hash of Peach Map tiles */
+   word8 *map;             /**< Peach Map (PEACHMAPLEN bytes), or NULL */
+   word8 *tiles;           /**< Peach Map tile flags (PEACHCACHELEN) */
+   int mode;               /**< Peach Map mode, PEACH_MAP_* */
+} PEACH_CTX;
+
 /**
  * Check the Peach Proof of Work of a Block Trailer is valid. Checks Proof
  * of Work against the difficulty within the block trailer and ignores the
@@ -116,8 +182,25 @@ extern "C" {
 #endif
 
 int peach_checkhash(const BTRAILER *bt, word8 diff, void *out);
+void peach_ctx_free(PEACH_CTX *ctx);
+int peach_ctx_init(PEACH_CTX *ctx, int mode);
+int peach_ctx_solve(PEACH_CTX *ctx, TRIGG_RNG *rng,
+   const BTRAILER *bt, word8 diff, void *out);
+int peach_ctx_work(PEACH_CTX *ctx, const BTRAILER *bt);
+void peach_generate_batch
+   (const word32 *index, size_t count, const void *phash, word8 *out);
 int peach_init(const BTRAILER *bt);
+int peach_shm_reclaim(const void *phash);
+int peach_shm_sweep(const void *phash);
 int peach_solve(const BTRAILER *bt, word8 diff, void *out);
+int peach_solve_r(TRIGG_RNG *rng, const BTRAILER *bt, word8 diff, void *out);
+
+/* CPU device functions */
+void peach_free_cpu_device(DEVICE_CTX *devp);
+int peach_init_cpu_device(DEVICE_CTX *devp, int mode, word64 seed);
+int peach_solve_cpu(DEVICE_CTX *devp, BTRAILER *bt, word8 diff,
+   BTRAILER *btout);
+int peach_work_cpu(DEVICE_CTX *devp);
 
 /* CUDA functions */
 int peach_checkhash_cuda(int count, BTRAILER bt[], void *out);
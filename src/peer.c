@@ -24,13 +24,9 @@
 word32 Rplist[RPLISTLEN] = {0};
 word32 Rplistidx = 0;  /* Recent peer list */
 
-/* pink lists of EVIL IP addresses read in from disk */
-word32 Cpinklist[CPINKLEN] = {0};
-word32 Cpinkidx = 0;
-word32 Lpinklist[LPINKLEN] = {0};
-word32 Lpinkidx = 0;
-word32 Epinklist[EPINKLEN] = {0};
-word32 Epinkidx = 0;
+/* pink list of EVIL IP addresses, and its capacity */
+IPSET Pinkset;
+word32 Pinklistlen = PINKLISTLEN;
 
 word8 Nopinklist = 0;  /* disable pinklist IP's when set */
 word8 Noprivate = 0;   /* filter out private IP's when set v.28 */
@@ -223,82 +219,197 @@ int read_ipl(char *fname, word32 *plist, word32 plistlen, word32 *plistidx)
 }  /* end read_ipl() */
 
 
-int pinklisted(word32 ip)
+/**
+ * @private
+ * Get the home slot of an ip address in an IP set.
+*/
+static word32 ipset_hash(const IPSET *set, word32 ip)
 {
-   if(Nopinklist) return 0;
+   /* multiplicative (Fibonacci) hash of seeded ip -- high bits only,
+    * low bits of the product depend only on the low bits of the ip */
+   return ((word32) ((ip ^ set->seed) * 0x9e3779b1UL)) >> set->shift;
+}
 
-   if(search32(ip, Cpinklist, CPINKLEN) != NULL
-      || search32(ip, Lpinklist, LPINKLEN) != NULL
-      || search32(ip, Epinklist, EPINKLEN) != NULL)
-         return 1;
-   return 0;
+/**
+ * @private
+ * Find the slot of an ip address in an IP set, live or expired.
+ * Returns NULL if not found, else a pointer to entry. */
+static IPENTRY *ipset_find(const IPSET *set, word32 ip)
+{
+   word32 idx;
+
+   if (set->entry == NULL || ip == 0) return NULL;
+   for (idx = ipset_hash(set, ip); ; idx = (idx + 1) & set->mask) {
+      if (set->entry[idx].ip == ip) return &set->entry[idx];
+      if (set->entry[idx].ip == 0) return NULL;
+   }
 }
 
 /**
- * Add ip address to current pinklist.
- * Call pinklisted() first to check if already on list.
- */
-int cpinklist(word32 ip)
+ * @private
+ * Rebuild an IP set table, discarding expired entries.
+ * Returns VEOK on success, else VERROR; check errno for details. */
+static int ipset_rehash(IPSET *set)
 {
-   if (isprivate(ip)) {
-      pdebug("%s is private", ntoa(&ip, NULL));
-      pdebug("   not pink-listed");
-      return VEOK;
+   IPENTRY *table, *ep;
+   word32 idx, j;
+
+   table = calloc((size_t) set->mask + 1, sizeof(IPENTRY));
+   if (table == NULL) return VERROR;
+   set->used = 0;
+   for (j = 0; j <= set->mask; j++) {
+      ep = &set->entry[j];
+      if (ep->ip == 0 || ep->expire <= set->epoch) continue;
+      idx = ipset_hash(set, ep->ip);
+      while (table[idx].ip) idx = (idx + 1) & set->mask;
+      table[idx] = *ep;
+      set->used++;
    }
+   free(set->entry);
+   set->entry = table;
 
-   if(Cpinkidx >= CPINKLEN)
-      Cpinkidx = 0;
-   Cpinklist[Cpinkidx++] = ip;
    return VEOK;
 }
 
 /**
- * Add ip address to current pinklist and remove it from
- * current and recent peer lists.
- * Checks the list first...
- */
-int pinklist(word32 ip)
+ * Add an ip address to an IP set, live for @a ttl epochs, or until
+ * removed if @a ttl is IPSET_FOREVER. An ip address already in the set
+ * remains live for the longer of its current and requested lifetimes.
+ * Returns 0 if ip was not added (or was already live), else ip.
+ * NOTE: a full set does not add ip, and sets errno to ENOSPC. */
+word32 ipset_add(IPSET *set, word32 ip, word32 ttl)
 {
-   if (isprivate(ip)) {
-      pdebug("%s is private", ntoa(&ip, NULL));
-      pdebug("   not pink-listed");
-      return VEOK;
+   IPENTRY *ep, *xp;
+   word32 expire, idx;
+   int live;
+
+   if (set->entry == NULL || ip == 0) return 0;
+   expire = set->epoch + ttl;
+   if (ttl == IPSET_FOREVER || expire < set->epoch) expire = IPSET_FOREVER;
+
+   /* find ip, or the first expired slot along the way */
+   xp = NULL;
+   for (idx = ipset_hash(set, ip); ; idx = (idx + 1) & set->mask) {
+      ep = &set->entry[idx];
+      if (ep->ip == ip) {
+         live = ep->expire > set->epoch;
+         if (!live || expire > ep->expire) ep->expire = expire;
+         return live ? 0 : ip;
+      }
+      if (ep->ip == 0) break;
+      if (xp == NULL && ep->expire <= set->epoch) xp = ep;
    }
-
-   pdebug("%s pink-listed", ntoa(&ip, NULL));
-
-   if(!pinklisted(ip)) {
-      if(Cpinkidx >= CPINKLEN)
-         Cpinkidx = 0;
-      Cpinklist[Cpinkidx++] = ip;
+   if (xp) {
+      /* reclaim expired slot */
+      xp->ip = ip;
+      xp->expire = expire;
+      return ip;
    }
-   if(!Nopinklist) {
-      remove32(ip, Rplist, RPLISTLEN, &Rplistidx);
+
+   /* keep load within 3/4, reclaiming expired slots when reached */
+   if (set->used + 1 > ((set->mask + 1) / 4) * 3) {
+      if (ipset_rehash(set) != VEOK) return 0;
+      if (set->used + 1 > ((set->mask + 1) / 4) * 3) {
+         set_errno(ENOSPC);
+         return 0;
+      }
+      for (idx = ipset_hash(set, ip); set->entry[idx].ip; ) {
+         idx = (idx + 1) & set->mask;
+      }
+      ep = &set->entry[idx];
    }
-   return VEOK;
-}  /* end pinklist() */
+   ep->ip = ip;
+   ep->expire = expire;
+   set->used++;
 
+   return ip;
+}
 
 /**
- * Add ip address to last pinklist.
- * Caller checks if already on list.
- */
-int lpinklist(word32 ip)
+ * Advance the epoch of an IP set, expiring entries tagged to expire. */
+void ipset_advance(IPSET *set)
 {
-   if (isprivate(ip)) {
-      pdebug("%s is private", ntoa(&ip, NULL));
-      pdebug("   not pink-listed");
-      return VEOK;
+   set->epoch++;
+}
+
+/**
+ * Free the entry table of an IP set, and clear the set. */
+void ipset_free(IPSET *set)
+{
+   free(set->entry);
+   memset(set, 0, sizeof(IPSET));
+}
+
+/**
+ * Returns non-zero if ip is live in the IP set, else 0. */
+int ipset_has(const IPSET *set, word32 ip)
+{
+   IPENTRY *ep;
+
+   ep = ipset_find(set, ip);
+   return (ep != NULL && ep->expire > set->epoch);
+}
+
+/**
+ * Initialize an IP set, with room for (at least) @a capacity live
+ * entries. The entry table is sized to twice the capacity.
+ * Returns VEOK on success, else VERROR; check errno for details. */
+int ipset_init(IPSET *set, word32 capacity)
+{
+   word32 len;
+
+   memset(set, 0, sizeof(IPSET));
+   if (capacity == 0 || capacity > 0x40000000UL) {
+      set_errno(EINVAL);
+      return VERROR;
    }
+   for (len = 16; len < capacity * 2; len <<= 1);
+   set->entry = calloc(len, sizeof(IPENTRY));
+   if (set->entry == NULL) return VERROR;
+   set->mask = len - 1;
+   for (set->shift = 32; len > 1; len >>= 1) set->shift--;
+   set->seed = ((word32) rand16() << 16) | rand16();
 
-   if(Lpinkidx >= LPINKLEN)
-      Lpinkidx = 0;
-   Lpinklist[Lpinkidx++] = ip;
    return VEOK;
 }
 
+/**
+ * Copy live ip addresses of an IP set to list[len].
+ * Returns number of ip addresses copied. */
+word32 ipset_list(const IPSET *set, word32 *list, word32 len)
+{
+   word32 count, j;
 
-int epinklist(word32 ip)
+   if (set->entry == NULL) return 0;
+   for (count = j = 0; j <= set->mask && count < len; j++) {
+      if (set->entry[j].ip == 0) continue;
+      if (set->entry[j].expire <= set->epoch) continue;
+      list[count++] = set->entry[j].ip;
+   }
+
+   return count;
+}
+
+/**
+ * Remove an ip address from an IP set.
+ * Returns 0 if ip is not live in the set, else ip. */
+word32 ipset_remove(IPSET *set, word32 ip)
+{
+   IPENTRY *ep;
+
+   ep = ipset_find(set, ip);
+   if (ep == NULL || ep->expire <= set->epoch) return 0;
+   ep->expire = 0;  /* expired slot remains, for probing */
+
+   return ip;
+}
+
+/**
+ * @private
+ * Add ip address to pinklist, for ttl epochs. The pinklist is
+ * initialized on first use, with capacity Pinklistlen.
+ * Returns VEOK. */
+static int pinkadd(word32 ip, word32 ttl)
 {
    if (isprivate(ip)) {
       pdebug("%s is private", ntoa(&ip, NULL));
@@ -306,44 +417,123 @@ int epinklist(word32 ip)
       return VEOK;
    }
 
-   if(Epinkidx >= EPINKLEN) {
-      pdebug("Epoch pink list overflow");
-      Epinkidx = 0;
+   if (Pinkset.entry == NULL && ipset_init(&Pinkset, Pinklistlen)) {
+      perrno("pinklist init failure");
+      return VEOK;
    }
-   Epinklist[Epinkidx++] = ip;
+   if (!ipset_add(&Pinkset, ip, ttl) && errno == ENOSPC) {
+      pdebug("pinklist full, %s not pink-listed", ntoa(&ip, NULL));
+   }
+
    return VEOK;
 }
 
+/**
+ * Returns non-zero if ip is pinklisted, else 0. */
+int pinklisted(word32 ip)
+{
+   if(Nopinklist) return 0;
+
+   return ipset_has(&Pinkset, ip);
+}
 
 /**
- * Call after each epoch.
- * Merges current pink list into last pink list
- * and purges current pink list.
- */
-void mergepinklists(void)
+ * Add ip address to pinklist for PINKEPOCHS epochs, and remove it
+ * from the recent peer list. */
+int pinklist(word32 ip)
 {
-   int j;
-   word32 ip, *ptr;
-
-   for(j = 0; j < CPINKLEN; j++) {
-      ip = Cpinklist[j];
-      if(ip == 0) continue;  /* empty */
-      ptr = search32(ip, Lpinklist, LPINKLEN);
-      if(ptr == NULL) lpinklist(ip);  /* add to last bad list */
-      Cpinklist[j] = 0;
+   pdebug("%s pink-listed", ntoa(&ip, NULL));
+   pinkadd(ip, PINKEPOCHS);
+   if(!Nopinklist) {
+      remove32(ip, Rplist, RPLISTLEN, &Rplistidx);
    }
-   Cpinkidx = 0;
+   return VEOK;
+}  /* end pinklist() */
+
+/**
+ * Add ip address to pinklist for the current epoch. */
+int epinklist(word32 ip)
+{
+   return pinkadd(ip, 1);
 }
 
 /**
- * Erase Epoch Pink List */
+ * Call after each epoch.
+ * Expires pinklist entries of the epoch, and the saved list. */
 void purge_epoch(void)
 {
    pdebug("   purging epoch pink list");
    remove("epink.lst");
-   memset(Epinklist, 0, sizeof(Epinklist));
-   Epinkidx = 0;
+   ipset_advance(&Pinkset);
+}
+
+/**
+ * Print pinklisted ip addresses. */
+void print_pinkl(void)
+{
+   word32 *list, count;
+
+   list = malloc(sizeof(word32) * Pinklistlen);
+   if (list == NULL) return;
+   count = ipset_list(&Pinkset, list, Pinklistlen);
+   print_ipl(list, count);
+   free(list);
 }
 
+/**
+ * Read an IP list file, fname, into the pinklist, for the current epoch.
+ * @returns Number of peers pinklisted, else (-1) on error
+*/
+int read_pinkl(char *fname)
+{
+   char buff[128];
+   word32 ip;
+   int count;
+   FILE *fp;
+
+   pdebug("reading %s...", fname);
+   count = 0;
+
+   /* check valid fname and open for reading */
+   if (fname == NULL || *fname == '\0') return (-1);
+   fp = fopen(fname, "r");
+   if (fp == NULL) return (-1);
+
+   /* read file line-by-line */
+   while(fgets(buff, 128, fp)) {
+      if (strtok(buff, " #\r\n\t") == NULL) break;
+      if (*buff == '\0') continue;
+      ip = aton(buff);
+      if (ip == 0 || ipset_has(&Pinkset, ip)) continue;
+      epinklist(ip);
+      if (ipset_has(&Pinkset, ip)) count++;
+   }
+   /* check for read errors */
+   if (ferror(fp)) perr("*** %s I/O error", fname);
+
+   fclose(fp);
+   return count;
+}  /* end read_pinkl() */
+
+/**
+ * Save pinklisted ip addresses to disk.
+ * Returns VEOK on success, else VERROR */
+int save_pinkl(char *fname)
+{
+   word32 *list, count;
+   int ecode;
+
+   list = malloc(sizeof(word32) * Pinklistlen);
+   if (list == NULL) {
+      perrno("save_pinkl() list failure");
+      return VERROR;
+   }
+   count = ipset_list(&Pinkset, list, Pinklistlen);
+   ecode = save_ipl(fname, list, count);
+   free(list);
+
+   return ecode;
+}  /* end save_pinkl() */
+
 /* end include guard */
 #endif
@@ -15,11 +15,38 @@
 
 #define addrecent(ip)   addpeer(ip, Rplist, RPLISTLEN, &Rplistidx)
 
+/**
+ * IP set entry expiry that never expires.
+*/
+#define IPSET_FOREVER   0xffffffffUL
+
+/**
+ * IPv4 hash set entry.
+*/
+typedef struct {
+   word32 ip;        /**< ip address, or zero where slot was never used */
+   word32 expire;    /**< epoch of expiry, entry is live until reached */
+} IPENTRY;
+
+/**
+ * IPv4 hash set, with epoch tagged entries. Open addressing (linear
+ * probing) keeps membership checks O(1). Entries expire when the
+ * epoch of the set is advanced past their tag, without a table scan;
+ * expired entries are reclaimed by later insertions.
+*/
+typedef struct {
+   IPENTRY *entry;   /**< entry table, power of 2 length */
+   word32 mask;      /**< entry table length - 1 */
+   word32 used;      /**< slots in use, by live and expired entries */
+   word32 epoch;     /**< current epoch of set */
+   word32 seed;      /**< hash seed */
+   word32 shift;     /**< hash shift, 32 - log2(entry table length) */
+} IPSET;
+
 /* global variables */
 extern word32 Rplist[RPLISTLEN], Rplistidx;
-extern word32 Cpinklist[CPINKLEN], Cpinkidx;
-extern word32 Lpinklist[LPINKLEN], Lpinkidx;
-extern word32 Epinklist[EPINKLEN], Epinkidx;
+extern IPSET Pinkset;
+extern word32 Pinklistlen;
 extern word8 Nopinklist;
 extern word8 Noprivate;
 
@@ -38,13 +65,20 @@ int loadpeers(word32 *dstipl, int dstlen, word32 *srcipl, int srclen);
 void print_ipl(word32 *list, word32 len);
 int save_ipl(char *fname, word32 *list, word32 len);
 int read_ipl(char *fname, word32 *plist, word32 plistlen, word32 *plistidx);
+word32 ipset_add(IPSET *set, word32 ip, word32 ttl);
+void ipset_advance(IPSET *set);
+void ipset_free(IPSET *set);
+int ipset_has(const IPSET *set, word32 ip);
+int ipset_init(IPSET *set, word32 capacity);
+word32 ipset_list(const IPSET *set, word32 *list, word32 len);
+word32 ipset_remove(IPSET *set, word32 ip);
 int pinklisted(word32 ip);
-int cpinklist(word32 ip);
 int pinklist(word32 ip);
-int lpinklist(word32 ip);
 int epinklist(word32 ip);
-void mergepinklists(void);
 void purge_epoch(void);
+void print_pinkl(void);
+int read_pinkl(char *fname);
+int save_pinkl(char *fname);
 
 #ifdef __cplusplus
 }  /* end extern "C" */
@@ -0,0 +1,329 @@
+/**
+ * @private
+ * @headerfile pstat.h <pstat.h>
+ * @copyright Adequate Systems LLC, 2018-2022. All Rights Reserved.
+ * <br />For license information, please refer to ../LICENSE.md
+*/
+
+/* include guard */
+#ifndef MOCHIMO_PSTAT_C
+#define MOCHIMO_PSTAT_C
+
+
+#include "pstat.h"
+
+/* internal support */
+#include "error.h"
+
+/* external support */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>   /* for mmap() */
+
+/**
+ * @private
+ * Age of statistics discarded by pstat_load(), in seconds (30 days).
+*/
+#define PSTAT_MAXAGE    2592000
+
+/**
+ * @private
+ * Maximum consecutive failures counted toward the cost of a peer.
+*/
+#define PSTAT_MAXFAILS  8
+
+static PSTAT *Pstat;    /* shared peer statistics table, or NULL */
+
+/**
+ * @private
+ * Find the slot of a peer, and optionally claim an unused slot.
+ * @param ip Peer ip address
+ * @param claim Set non-zero to claim an unused slot for the peer
+ * @returns Pointer to slot, or NULL if not found (or table is full)
+*/
+static PSTAT *pstat_find(word32 ip, int claim)
+{
+   PSTAT *ps;
+   word32 expect, idx, j;
+
+   if (Pstat == NULL || ip == 0) return NULL;
+   idx = ((word32) (ip * 0x9e3779b1UL)) >> 22;  /* 10 bit hash */
+   for (j = 0; j < PSTAT_PROBES; j++, idx = (idx + 1) & (PSTATLEN - 1)) {
+      ps = &Pstat[idx];
+      expect = __atomic_load_n(&ps->ip, __ATOMIC_ACQUIRE);
+      if (expect == ip) return ps;
+      if (expect != 0) continue;
+      if (!claim) return NULL;
+      /* claim unused slot; another process may win the same slot */
+      if (__atomic_compare_exchange_n(&ps->ip, &expect, ip, 0,
+            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) || expect == ip) {
+         return ps;
+      }
+   }
+
+   return NULL;
+}  /* end pstat_find() */
+
+/**
+ * @private
+ * Update a smoothed statistic with a sample (weight 1/4).
+*/
+static void pstat_smooth(word32 *stat, word32 sample)
+{
+   word32 prev, next;
+
+   if (sample == 0) sample = 1;  /* zero is unobserved */
+   prev = __atomic_load_n(stat, __ATOMIC_RELAXED);
+   do {
+      next = prev ? prev - (prev / 4) + (sample / 4) : sample;
+      if (next == 0) next = 1;
+   } while (!__atomic_compare_exchange_n(stat, &prev, next, 1,
+      __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}  /* end pstat_smooth() */
+
+/**
+ * @private
+ * Record the success or failure of a peer operation.
+*/
+static void pstat_outcome(PSTAT *ps, int ok)
+{
+   if (ok) {
+      __atomic_store_n(&ps->fails, 0, __ATOMIC_RELAXED);
+      __atomic_store_n(&ps->lastseen, (word32) time(NULL), __ATOMIC_RELAXED);
+   } else __atomic_add_fetch(&ps->fails, 1, __ATOMIC_RELAXED);
+}  /* end pstat_outcome() */
+
+/**
+ * Observe a call (connection and handshake) to a peer.
+ * @param ip Peer ip address
+ * @param ok Non-zero if the call succeeded
+ * @param ms Round trip time of the call, in milliseconds (if @a ok)
+*/
+void pstat_call(word32 ip, int ok, word32 ms)
+{
+   PSTAT *ps;
+
+   ps = pstat_find(ip, 1);
+   if (ps == NULL) return;
+   if (ok) pstat_smooth(&ps->rtt, ms);
+   pstat_outcome(ps, ok);
+}  /* end pstat_call() */
+
+/**
+ * Get the cost of a peer; the expected time to call the peer and receive
+ * a reference transfer (PSTAT_REFLEN bytes), plus a penalty for each
+ * consecutive failure. Unobserved measures are charged at a default.
+ * @param ip Peer ip address
+ * @returns Cost of peer, in milliseconds (lower is better)
+*/
+word32 pstat_cost(word32 ip)
+{
+   PSTAT ps;
+   word32 cost;
+
+   if (pstat_get(ip, &ps) != VEOK) return PSTAT_UNKNOWN;
+   if (ps.rtt == 0 && ps.rate == 0 && ps.fails == 0) return PSTAT_UNKNOWN;
+   cost = ps.rtt ? ps.rtt : (PSTAT_UNKNOWN / 2);
+   cost += ps.rate ? (word32) (((word64) PSTAT_REFLEN * 1000) / ps.rate)
+      : (PSTAT_UNKNOWN / 2);
+   if (ps.fails > PSTAT_MAXFAILS) ps.fails = PSTAT_MAXFAILS;
+   cost += ps.fails * PSTAT_FAILCOST;
+
+   return cost;
+}  /* end pstat_cost() */
+
+/**
+ * Unmap shared peer statistics. Observations are ignored thereafter.
+*/
+void pstat_free(void)
+{
+   PSTAT *ps;
+
+   ps = Pstat;
+   Pstat = NULL;
+   if (ps) munmap(ps, sizeof(PSTAT) * PSTATLEN);
+}  /* end pstat_free() */
+
+/**
+ * Get a (snapshot) copy of the statistics of a peer.
+ * @param ip Peer ip address
+ * @param ps Pointer to place statistics
+ * @returns VEOK if peer has statistics, else VERROR
+*/
+int pstat_get(word32 ip, PSTAT *ps)
+{
+   PSTAT *sp;
+
+   sp = pstat_find(ip, 0);
+   if (sp == NULL) return VERROR;
+   ps->ip = ip;
+   ps->rtt = __atomic_load_n(&sp->rtt, __ATOMIC_RELAXED);
+   ps->rate = __atomic_load_n(&sp->rate, __ATOMIC_RELAXED);
+   ps->fails = __atomic_load_n(&sp->fails, __ATOMIC_RELAXED);
+   ps->lastseen = __atomic_load_n(&sp->lastseen, __ATOMIC_RELAXED);
+
+   return VEOK;
+}  /* end pstat_get() */
+
+/**
+ * Initialize (zeroed) peer statistics in anonymous shared memory. MUST
+ * be called before forking processes whose observations are to be
+ * visible to the caller.
+ * @returns VEOK on success, else VERROR; check errno for details
+*/
+int pstat_init(void)
+{
+   void *mem;
+
+   if (Pstat) return VEOK;
+   mem = mmap(NULL, sizeof(PSTAT) * PSTATLEN, PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+   if (mem == MAP_FAILED) return VERROR;
+   Pstat = (PSTAT *) mem;
+
+   return VEOK;
+}  /* end pstat_init() */
+
+/**
+ * Load peer statistics from file. Statistics of peers not seen for 30
+ * days are discarded.
+ * @param fname Filename of peer statistics, see pstat_save()
+ * @returns Number of peers loaded, else (-1) on error
+*/
+int pstat_load(char *fname)
+{
+   PSTAT rec, *ps;
+   word32 now;
+   int count;
+   FILE *fp;
+
+   if (Pstat == NULL || fname == NULL || *fname == '\0') return (-1);
+   fp = fopen(fname, "rb");
+   if (fp == NULL) return (-1);
+
+   now = (word32) time(NULL);
+   for (count = 0; fread(&rec, sizeof(rec), 1, fp) == 1; ) {
+      if (rec.lastseen == 0 || now - rec.lastseen > PSTAT_MAXAGE) continue;
+      ps = pstat_find(rec.ip, 1);
+      if (ps == NULL) continue;
+      ps->rtt = rec.rtt;
+      ps->rate = rec.rate;
+      ps->fails = rec.fails;
+      ps->lastseen = rec.lastseen;
+      count++;
+   }
+   if (ferror(fp)) perr("*** %s I/O error", fname);
+
+   fclose(fp);
+   return count;
+}  /* end pstat_load() */
+
+/**
+ * Save peer statistics to file.
+ * @param fname Filename to save peer statistics
+ * @returns VEOK on success, else VERROR
+*/
+int pstat_save(char *fname)
+{
+   PSTAT rec;
+   FILE *fp;
+   int j;
+
+   if (Pstat == NULL) return VERROR;
+   pdebug("saving %s...", fname);
+   fp = fopen(fname, "wb");
+   if (fp == NULL) {
+      perrno("fopen(%s) failed", fname);
+      return VERROR;
+   }
+   for (j = 0; j < PSTATLEN; j++) {
+      if (pstat_get(Pstat[j].ip, &rec) != VEOK) continue;
+      if (fwrite(&rec, sizeof(rec), 1, fp) != 1) {
+         fclose(fp);
+         remove(fname);
+         perr("*** %s I/O write error", fname);
+         return VERROR;
+      }
+   }
+
+   fclose(fp);
+   plog("%s saved", fname);
+   return VEOK;
+}  /* end pstat_save() */
+
+/**
+ * Order a list of peers by cost, see pstat_sort(), and get the number
+ * of preferred peers at the head of the list. Peers costing more than
+ * PSTAT_SLOWFACTOR times the best peer are not preferred, where the best
+ * peer is considered no better than half the cost of an unknown peer,
+ * such that unobserved peers remain preferred alongside fast peers.
+ * @param list Pointer to list of peer ip addresses (zero terminated)
+ * @param len Maximum length of list
+ * @returns Number of preferred peers, at least 1 for a non-empty list
+*/
+word32 pstat_select(word32 *list, word32 len)
+{
+   word32 best, j;
+
+   pstat_sort(list, len);
+   if (len == 0 || list[0] == 0) return 0;
+   best = pstat_cost(list[0]);
+   if (best < PSTAT_UNKNOWN / 2) best = PSTAT_UNKNOWN / 2;
+   for (j = 1; j < len && list[j]; j++) {
+      if (pstat_cost(list[j]) > best * PSTAT_SLOWFACTOR) break;
+   }
+
+   return j;
+}  /* end pstat_select() */
+
+/**
+ * Order a list of peers by cost, lowest first (stable). The list ends
+ * at @a len, or the first zero entry. Only the first RPLISTLEN * 4
+ * peers of a list are ordered.
+ * @param list Pointer to list of peer ip addresses (zero terminated)
+ * @param len Maximum length of list
+*/
+void pstat_sort(word32 *list, word32 len)
+{
+   word32 cost[RPLISTLEN * 4];
+   word32 ip, c, j, k;
+
+   if (len > RPLISTLEN * 4) len = RPLISTLEN * 4;
+   for (j = 0; j < len && list[j]; j++) {
+      /* insertion sort, by cost */
+      ip = list[j];
+      c = pstat_cost(ip);
+      for (k = j; k > 0 && cost[k - 1] > c; k--) {
+         list[k] = list[k - 1];
+         cost[k] = cost[k - 1];
+      }
+      list[k] = ip;
+      cost[k] = c;
+   }
+}  /* end pstat_sort() */
+
+/**
+ * Observe a transfer (e.g. file download) from a peer.
+ * @param ip Peer ip address
+ * @param ok Non-zero if the transfer succeeded
+ * @param bytes Number of bytes transferred
+ * @param ms Duration of the transfer, in milliseconds
+*/
+void pstat_xfer(word32 ip, int ok, word64 bytes, word32 ms)
+{
+   PSTAT *ps;
+
+   ps = pstat_find(ip, 1);
+   if (ps == NULL) return;
+   /* small transfers are dominated by latency, and do not measure rate */
+   if (ok && bytes >= 4096) {
+      if (ms == 0) ms = 1;
+      bytes = (bytes * 1000) / ms;
+      pstat_smooth(&ps->rate, bytes > WORD32_MAX ? WORD32_MAX : bytes);
+   }
+   pstat_outcome(ps, ok);
+}  /* end pstat_xfer() */
+
+/* end include guard */
+#endif
@@ -0,0 +1,86 @@
+/**
+ * @file pstat.h
+ * @brief Mochimo peer quality statistics, for peer selection.
+ * @details Peer statistics (handshake round trip time, transfer rate,
+ * consecutive failures and last seen time) are also observed by
+ * send_found() and mirror(), which still run as forked processes, so
+ * the table lives in shared memory, where their observations reach the
+ * peer selection of the server.
+ * <br />
+ * Statistics persist across restarts with pstat_save() and pstat_load().
+ * @copyright Adequate Systems LLC, 2018-2022. All Rights Reserved.
+ * <br />For license information, please refer to ../LICENSE.md
+*/
+
+/* include guard */
+#ifndef MOCHIMO_PSTAT_H
+#define MOCHIMO_PSTAT_H
+
+
+#include "types.h"
+
+/**
+ * Number of peer statistics slots (power of 2).
+*/
+#define PSTATLEN        1024
+
+/**
+ * Maximum slots probed for a peer, before a peer is left untracked.
+*/
+#define PSTAT_PROBES    32
+
+/**
+ * Length of reference transfer (a typical block), for peer cost.
+*/
+#define PSTAT_REFLEN    65536
+
+/**
+ * Cost of a peer without observations, in milliseconds.
+*/
+#define PSTAT_UNKNOWN   2000
+
+/**
+ * Cost added per consecutive failure of a peer, in milliseconds.
+*/
+#define PSTAT_FAILCOST  5000
+
+/**
+ * Peers costing more than this many times the cost of the best peer
+ * (or half the cost of an unknown peer) are not preferred, see
+ * pstat_select().
+*/
+#define PSTAT_SLOWFACTOR   8
+
+/**
+ * Peer statistics. Zero fields are unobserved.
+*/
+typedef struct {
+   word32 ip;        /**< ip address, or zero where slot is unused */
+   word32 rtt;       /**< smoothed handshake round trip time, in ms */
+   word32 rate;      /**< smoothed transfer rate, in bytes per second */
+   word32 fails;     /**< consecutive failures */
+   word32 lastseen;  /**< time of last success, in seconds since Epoch */
+} PSTAT;
+
+/* C/C++ compatible function prototypes */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void pstat_call(word32 ip, int ok, word32 ms);
+word32 pstat_cost(word32 ip);
+void pstat_free(void);
+int pstat_get(word32 ip, PSTAT *ps);
+int pstat_init(void);
+int pstat_load(char *fname);
+int pstat_save(char *fname);
+word32 pstat_select(word32 *list, word32 len);
+void pstat_sort(word32 *list, word32 len);
+void pstat_xfer(word32 ip, int ok, word64 bytes, word32 ms);
+
+#ifdef __cplusplus
+}  /* end extern "C" */
+#endif
+
+/* end include guard */
+#endif
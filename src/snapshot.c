@@ -0,0 +1,286 @@
+/**
+ * @private
+ * @headerfile snapshot.h <snapshot.h>
+ * @copyright Adequate Systems LLC, 2018-2022. All Rights Reserved.
+ * <br />For license information, please refer to ../LICENSE.md
+*/
+
+/* include guard */
+#ifndef MOCHIMO_SNAPSHOT_C
+#define MOCHIMO_SNAPSHOT_C
+
+
+#include "snapshot.h"
+
+/* internal support */
+#include "tfile.h"
+#include "ledger.h"
+#include "error.h"
+
+/* external support */
+#include <string.h>
+#include <stdlib.h>
+#include "extint.h"
+#include "extio.h"
+
+/**
+ * Export a ledger snapshot from a neogenesis block file.
+ * The neogenesis block is expected to be valid (i.e. produced by neogen()
+ * or validated by ng_val()), so only the file structure is checked.
+ * @param ngfile Filename of neogenesis block to export
+ * @param snapfile Filename of ledger snapshot to write
+ * @return (int) value representing operation result
+ * @retval VERROR on error; check errno for details
+ * @retval VEOK on success
+*/
+int snap_export(const char *ngfile, const char *snapfile)
+{
+   SNAPHEADER snh;
+   NGHEADER ngh;
+   LENTRY *buf;
+   FILE *fp, *sfp;
+   long long len;
+   word64 lbytes;
+   size_t n, remain;
+
+   /* init */
+   sfp = NULL;
+   buf = NULL;
+
+   /* open neogenesis block and read trailer (fp left at EOF) */
+   fp = fopen(ngfile, "rb");
+   if (fp == NULL) return VERROR;
+   if (fseek64(fp, -(sizeof(BTRAILER)), SEEK_END) != 0) goto ERROR_CLEANUP;
+   if (fread(&snh.bt, sizeof(BTRAILER), 1, fp) != 1) goto RDERR_CLEANUP;
+   len = ftell64(fp);
+   if (len == (-1)) goto ERROR_CLEANUP;
+   /* read and check neogenesis header data */
+   if (fseek64(fp, 0LL, SEEK_SET) != 0) goto ERROR_CLEANUP;
+   if (fread(&ngh, sizeof(NGHEADER), 1, fp) != 1) goto RDERR_CLEANUP;
+   if (get32(ngh.hdrlen) != sizeof(NGHEADER)) {
+      set_errno(EMCM_HDRLEN);
+      goto ERROR_CLEANUP;
+   }
+   put64(&lbytes, ngh.lbytes);
+   if (lbytes < sizeof(LENTRY) || (lbytes % sizeof(LENTRY)) != 0) {
+      set_errno(EMCM_FILEDATA);
+      goto ERROR_CLEANUP;
+   }
+   if (len != (long long) (sizeof(NGHEADER) + lbytes + sizeof(BTRAILER))) {
+      set_errno(EMCM_FILELEN);
+      goto ERROR_CLEANUP;
+   }
+
+   /* ... fp is left at beginning of ledger entries ... */
+
+   /* prepare snapshot header and output file */
+   memcpy(snh.magic, SNAP_MAGIC, SNAP_MAGICLEN);
+   put32(snh.hdrlen, sizeof(SNAPHEADER));
+   put64(snh.lbytes, ngh.lbytes);
+   buf = malloc(LEBUFCOUNT * sizeof(LENTRY));
+   if (buf == NULL) goto ERROR_CLEANUP;
+   sfp = fopen(snapfile, "wb");
+   if (sfp == NULL) goto ERROR_CLEANUP;
+   if (fwrite(&snh, sizeof(SNAPHEADER), 1, sfp) != 1) goto ERROR_CLEANUP;
+
+   /* copy ledger entries in buffered chunks */
+   for (remain = (size_t) (lbytes / sizeof(LENTRY)); remain; remain -= n) {
+      n = remain < LEBUFCOUNT ? remain : LEBUFCOUNT;
+      if (fread(buf, sizeof(LENTRY), n, fp) != n) goto RDERR_CLEANUP;
+      if (fwrite(buf, sizeof(LENTRY), n, sfp) != n) goto ERROR_CLEANUP;
+   }
+
+   /* cleanup */
+   if (fclose(sfp) != 0) {
+      sfp = NULL;
+      goto ERROR_CLEANUP;
+   }
+   free(buf);
+   fclose(fp);
+
+   return VEOK;
+
+   /* cleanup / error handling */
+RDERR_CLEANUP:
+   if (!ferror(fp)) {
+      set_errno(EMCM_EOF);
+   }
+ERROR_CLEANUP:
+   if (sfp) fclose(sfp);
+   if (buf) free(buf);
+   fclose(fp);
+   remove(snapfile);
+
+   return VERROR;
+}  /* end snap_export() */
+
+/**
+ * Import a ledger snapshot, verified against the trusted Tfile.
+ * The snapshot is read sequentially; ledger entries are checked for sort
+ * order and hashed (in parallel batches) into a streaming merkle tree as
+ * they are written to the output files. Outputs are removed on failure.
+ * @param snapfile Filename of ledger snapshot to import
+ * @param ngfile Filename of neogenesis block to write, or NULL to skip
+ * @param lefile Filename of ledger to write
+ * @return (int) value representing operation result
+ * @retval VEBAD2 on snapshot inconsistent with Tfile; check errno
+ * @retval VERROR on error; check errno for details
+ * @retval VEOK on success
+ * @note The snapshot trailer MUST exist in "tfile.dat". Unlike ng_val(),
+ * there is no fallback to validating against the last Tfile trailer.
+*/
+int snap_import(const char *snapfile, const char *ngfile, const char *lefile)
+{
+   SNAPHEADER snh;
+   NGHEADER ngh;
+   BTRAILER tft;
+   LENTRY *buf;
+   FILE *fp, *lfp, *ngfp;
+   long long len;
+   word64 lbytes;
+   size_t j, n, lcount;
+   MERKLE_CTX mctx;
+   word8 prev[ADDR_LEN];
+   word8 mroot[HASHLEN];
+   int k, ecode;
+   int outputs;
+
+   /* init */
+   lfp = ngfp = NULL;
+   outputs = 0;
+   buf = NULL;
+
+   /* open snapshot and determine file length */
+   fp = fopen(snapfile, "rb");
+   if (fp == NULL) return VERROR;
+   if (fseek64(fp, 0LL, SEEK_END) != 0) goto ERROR_CLEANUP;
+   len = ftell64(fp);
+   if (len == (-1)) goto ERROR_CLEANUP;
+   if (fseek64(fp, 0LL, SEEK_SET) != 0) goto ERROR_CLEANUP;
+   /* read and check snapshot header data */
+   if (fread(&snh, sizeof(SNAPHEADER), 1, fp) != 1) goto RDERR_CLEANUP;
+   if (memcmp(snh.magic, SNAP_MAGIC, SNAP_MAGICLEN) != 0 ||
+         get32(snh.hdrlen) != sizeof(SNAPHEADER)) {
+      set_errno(EMCM_HDRLEN);
+      goto ERROR_CLEANUP;
+   }
+   put64(&lbytes, snh.lbytes);
+   if (lbytes < sizeof(LENTRY) || (lbytes % sizeof(LENTRY)) != 0) {
+      set_errno(EMCM_FILEDATA);
+      goto ERROR_CLEANUP;
+   }
+   if (len != (long long) (sizeof(SNAPHEADER) + lbytes)) {
+      set_errno(EMCM_FILELEN);
+      goto ERROR_CLEANUP;
+   }
+
+   /* ... fp is left at beginning of ledger entries ... */
+
+   /* snapshot trailer MUST be a neogenesis trailer in the Tfile */
+   if (read_tfile(&tft, snh.bt.bnum, 1, "tfile.dat") != 1) {
+      goto ERROR_CLEANUP;
+   } else if (memcmp(&tft, &snh.bt, sizeof(BTRAILER)) != 0) {
+      set_errno(EMCM_TRAILER);
+      goto DROP_CLEANUP;
+   } else if (snh.bt.bnum[0] != 0) {
+      set_errno(EMCM_BNUM);
+      goto DROP_CLEANUP;
+   } else if (get32(snh.bt.tcount) != 0) {
+      set_errno(EMCM_TCOUNT);
+      goto DROP_CLEANUP;
+   }
+
+   /* malloc read buffer and init merkle tree */
+   lcount = (size_t) (lbytes / sizeof(LENTRY));
+   buf = malloc(LEBUFCOUNT * sizeof(LENTRY));
+   if (buf == NULL) goto ERROR_CLEANUP;
+   merkle_init(&mctx, lcount);
+
+   /* open output files -- neogenesis block is optional */
+   outputs = 1;
+   lfp = fopen(lefile, "wb");
+   if (lfp == NULL) goto ERROR_CLEANUP;
+   if (ngfile) {
+      ngfp = fopen(ngfile, "wb");
+      if (ngfp == NULL) goto ERROR_CLEANUP;
+      put32(ngh.hdrlen, sizeof(NGHEADER));
+      put64(ngh.lbytes, snh.lbytes);
+      if (fwrite(&ngh, sizeof(NGHEADER), 1, ngfp) != 1) goto ERROR_CLEANUP;
+   }
+
+   /* stream ledger entries in buffered chunks */
+   for (j = 0; j < lcount; j += n) {
+      n = (lcount - j) < LEBUFCOUNT ? (lcount - j) : LEBUFCOUNT;
+      if (fread(buf, sizeof(LENTRY), n, fp) != n) goto RDERR_CLEANUP;
+      /* check ledger sort -- skip on first read */
+      for (k = 0; k < (int) n; k++) {
+         if ((j + k) > 0 && addr_compare(buf[k].addr, prev) <= 0) {
+            set_errno(EMCM_LESORT);
+            goto DROP_CLEANUP;
+         }
+         memcpy(prev, buf[k].addr, ADDR_LEN);
+      }
+      /* hash ledger entries (in parallel) into merkle tree */
+      merkle_leaves(&mctx, buf, sizeof(LENTRY), n);
+      /* write ledger entries to output files */
+      if (fwrite(buf, sizeof(LENTRY), n, lfp) != n) goto ERROR_CLEANUP;
+      if (ngfp && fwrite(buf, sizeof(LENTRY), n, ngfp) != n) {
+         goto ERROR_CLEANUP;
+      }
+   }
+
+   /* compute and validate merkle root */
+   if (merkle_final(&mctx, mroot) != VEOK) goto ERROR_CLEANUP;
+   if (memcmp(snh.bt.mroot, mroot, HASHLEN) != 0) {
+      set_errno(EMCM_MROOT);
+      goto DROP_CLEANUP;
+   }
+
+   /* append neogenesis block trailer and close outputs */
+   if (ngfp) {
+      if (fwrite(&snh.bt, sizeof(BTRAILER), 1, ngfp) != 1) {
+         goto ERROR_CLEANUP;
+      }
+      ecode = fclose(ngfp);
+      ngfp = NULL;
+      if (ecode != 0) goto ERROR_CLEANUP;
+   }
+   ecode = fclose(lfp);
+   lfp = NULL;
+   if (ecode != 0) goto ERROR_CLEANUP;
+
+   /* cleanup */
+   free(buf);
+   fclose(fp);
+
+   /* index of replaced ledger is stale */
+   le_index_update(lefile);
+
+   return VEOK;
+
+   /* cleanup / error handling */
+RDERR_CLEANUP:
+   if (!ferror(fp)) {
+      set_errno(EMCM_EOF);
+   }
+ERROR_CLEANUP:
+   ecode = VERROR;
+   goto CLEANUP;
+DROP_CLEANUP:
+   ecode = VEBAD2;
+CLEANUP:
+   if (ngfp) fclose(ngfp);
+   if (lfp) fclose(lfp);
+   if (buf) free(buf);
+   fclose(fp);
+   /* remove incomplete outputs */
+   if (outputs) {
+      remove(lefile);
+      if (ngfile) remove(ngfile);
+   }
+
+   return ecode;
+}  /* end snap_import() */
+
+/* end include guard */
+#endif
@@ -0,0 +1,57 @@
+/**
+ * @file snapshot.h
+ * @brief Mochimo ledger snapshot support.
+ * @details A ledger snapshot is a neogenesis block rearranged for a single
+ * sequential read. The neogenesis block trailer is placed at the front of
+ * the file, so the ledger entries that follow may be verified against the
+ * (trusted) Tfile as they are streamed, without first seeking to the end.
+ * ```
+ *    [magic 4][hdrlen 4][lbytes 8][BTRAILER 160]
+ *    [LENTRY 48] ... (lbytes / 48 entries)
+ * ```
+ * The snapshot trailer links the ledger entries to the chain by block
+ * number, block hash and merkle root of the neogenesis block.
+ * @copyright Adequate Systems LLC, 2018-2022. All Rights Reserved.
+ * <br />For license information, please refer to ../LICENSE.md
+*/
+
+/* include guard */
+#ifndef MOCHIMO_SNAPSHOT_H
+#define MOCHIMO_SNAPSHOT_H
+
+
+/* internal support */
+#include "types.h"
+
+/** Ledger snapshot file identifier. */
+#define SNAP_MAGIC      "MLS\x01"
+#define SNAP_MAGICLEN   4
+
+/** Ledger snapshot header. */
+typedef struct {
+   word8 magic[4];   /**< snapshot identifier, SNAP_MAGIC */
+   word8 hdrlen[4];  /**< snapshot header length */
+   word8 lbytes[8];  /**< length of ledger entries, in bytes */
+   BTRAILER bt;      /**< neogenesis block trailer */
+   /*
+    * array of LENTRY's representing lbytes number of bytes, here...
+    */
+} SNAPHEADER;
+/* structure packing assertion required ... */
+STATIC_ASSERT(sizeof(SNAPHEADER) == ( 16 + sizeof(BTRAILER) ),
+   SNAPHEADER_size);
+
+/* C/C++ compatible function prototypes */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int snap_export(const char *ngfile, const char *snapfile);
+int snap_import(const char *snapfile, const char *ngfile, const char *lefile);
+
+#ifdef __cplusplus
+}  /* end extern "C" */
+#endif
+
+/* end include guard */
+#endif
@@ -22,6 +22,10 @@
 #include "error.h"
 #include "bval.h"
 #include "bup.h"
+#include "workq.h"
+#include "pstat.h"
+#include "metrics.h"
+#include "snapshot.h"
 
 /* external support */
 #include "extthrd.h"
@@ -56,6 +60,7 @@ int reset_chain(void)
    BTRAILER bt;
    char fname[FILENAME_MAX];
    char bcfname[FILENAME_MAX];
+   word8 weight[HASHLEN];
 
    /* obtain latest block trailer from Tfile */
    if (read_trailer(&bt, "tfile.dat") != VEOK) return VERROR;
@@ -67,33 +72,295 @@ int reset_chain(void)
       return VERROR;
    }
 
+   /* Re-compute Weight[] -- check double bnum */
+   if (weigh_tfile("tfile.dat", bt.bnum, weight) != VEOK) {
+      perrno("weight_tfile() FAILURE");
+      return VERROR;
+   }
+
    /* initialize chain data from block trailer */
+   mutex_lock(&Chainlock);
    put64(Cblocknum, bt.bnum);
+   memcpy(Prevhash, bt.phash, HASHLEN);
+   memcpy(Cblockhash, bt.bhash, HASHLEN);
+   memcpy(Weight, weight, HASHLEN);
+   mutex_unlock(&Chainlock);
    Eon = get32(bt.bnum) >> 8;
    Time0 = get32(bt.stime);
    Difficulty = next_difficulty(&bt);
-   memcpy(Prevhash, bt.phash, HASHLEN);
-   memcpy(Cblockhash, bt.bhash, HASHLEN);
-
-   /* Re-compute Weight[] -- check double bnum */
-   if (weigh_tfile("tfile.dat", bt.bnum, Weight) != VEOK) {
-      perrno("weight_tfile() FAILURE");
-      return VERROR;
-   }
 
    return VEOK;
 }  /* end reset_chain() */
 
 /**
- * Catch up by getting blocks from peers in plist[count].
- * Returns VEOK if updates made, else b_update() error code. */
+ * @private
+ * Maximum number of catchup() fetch threads (bits of CATCHUP_SLOT.tried).
+*/
+#define CATCHUP_PEERS      32
+
+/**
+ * @private
+ * Outstanding heights per catchup() fetch thread, for window length.
+*/
+#define CATCHUP_DEPTH      4
+
+/**
+ * @private
+ * Maximum length of catchup() window, in heights.
+*/
+#define CATCHUP_WINDOW     64
+
+/**
+ * @private
+ * Delay before the head-of-line height is requested of another peer, in
+ * milliseconds. The first download to complete is kept.
+*/
+#define CATCHUP_HEDGE      2000
+
+/**
+ * @private
+ * Delay before any height is requested of another peer, in milliseconds.
+*/
+#define CATCHUP_DEADLINE   15000
+
+/**
+ * @private
+ * Maximum outstanding requests per height.
+*/
+#define CATCHUP_MAXREQ     2
+
+/**
+ * @private
+ * Consecutive failures before a peer is dropped from catchup().
+*/
+#define CATCHUP_MAXFAILS   3
+
+/* catchup() window slot states */
+#define SLOT_PENDING 0  /* awaiting request */
+#define SLOT_FETCH   1  /* request(s) outstanding */
+#define SLOT_DONE    2  /* downloaded, awaiting update */
+#define SLOT_FAILED  3  /* failed with every remaining peer */
+
+/**
+ * @private
+ * catchup() window slot; a height to download and update.
+*/
+typedef struct {
+   word64 since;        /* time of latest request, in ms */
+   word32 tried;        /* mask of peers requested, by fetch index */
+   int reqs;            /* number of outstanding requests */
+   int state;           /* slot state, SLOT_* */
+   word8 bnum[8];       /* block number */
+} CATCHUP_SLOT;
+
+/**
+ * @private
+ * catchup() scheduler; shared by fetch threads and the (ordered) update
+ * of downloaded blocks. Guarded by lock.
+*/
+typedef struct {
+   Mutex lock;
+   Condition cond;      /* slot state change, or stop */
+   CATCHUP_SLOT slot[CATCHUP_WINDOW];  /* window ring */
+   word32 *plist;       /* peers, by fetch index */
+   word32 active;       /* mask of active peers, by fetch index */
+   int head;            /* slot of next height to update */
+   int count;           /* heights in window */
+   int window;          /* maximum heights in window */
+   int stop;            /* fetch threads exit when set */
+} CATCHUP;
+
+/**
+ * @private
+ * catchup() fetch thread argument.
+*/
+typedef struct {
+   CATCHUP *cp;
+   ThreadId tid;
+   int idx;             /* fetch index, of peer in plist */
+} CATCHUP_FETCH;
+
+/**
+ * @private
+ * Get monotonic time, in milliseconds, for catchup() request deadlines.
+*/
+static word64 catchup_ms(void)
+{
+   return metrics_time() / 1000;
+}  /* end catchup_ms() */
+
+/**
+ * @private
+ * Find the window slot of a height. Lock MUST be held.
+ * @returns Pointer to slot, or NULL if height is not in window
+*/
+static CATCHUP_SLOT *catchup_find(CATCHUP *cp, word8 bnum[8])
+{
+   CATCHUP_SLOT *sp;
+   int j;
+
+   for (j = 0; j < cp->count; j++) {
+      sp = &cp->slot[(cp->head + j) % CATCHUP_WINDOW];
+      if (cmp64(sp->bnum, bnum) == 0) return sp;
+   }
+
+   return NULL;
+}  /* end catchup_find() */
+
+/**
+ * @private
+ * Pick the next height to request of a peer. Lock MUST be held.
+ * In order of preference; the lowest pending height, a duplicate of the
+ * head-of-line height (after CATCHUP_HEDGE), a new height at the end of
+ * the window, or a duplicate of any height (after CATCHUP_DEADLINE).
+ * Heights are never requested of the same peer twice. Pending heights
+ * that every active peer has tried are marked failed.
+ * @param cp Pointer to scheduler
+ * @param idx Fetch index of peer
+ * @returns Pointer to slot to request, or NULL if none
+*/
+static CATCHUP_SLOT *catchup_pick(CATCHUP *cp, int idx)
+{
+   CATCHUP_SLOT *sp, *prev;
+   word64 now;
+   word32 bit;
+   int j;
+
+   now = catchup_ms();
+   bit = (word32) 1 << idx;
+   /* lowest pending height */
+   for (j = 0; j < cp->count; j++) {
+      sp = &cp->slot[(cp->head + j) % CATCHUP_WINDOW];
+      if (sp->state != SLOT_PENDING) continue;
+      if ((sp->tried & cp->active) == cp->active) {
+         sp->state = SLOT_FAILED;
+         condition_broadcast(&cp->cond);
+      } else if (!(sp->tried & bit)) return sp;
+   }
+   /* hedge head-of-line height */
+   sp = &cp->slot[cp->head];
+   if (cp->count && sp->state == SLOT_FETCH && sp->reqs < CATCHUP_MAXREQ
+      && !(sp->tried & bit) && now - sp->since >= CATCHUP_HEDGE) return sp;
+   /* extend window */
+   if (cp->count < cp->window) {
+      sp = &cp->slot[(cp->head + cp->count) % CATCHUP_WINDOW];
+      if (cp->count) {
+         prev = &cp->slot[(cp->head + cp->count - 1) % CATCHUP_WINDOW];
+         add64(prev->bnum, ONE64, sp->bnum);
+      } else add64(Cblocknum, ONE64, sp->bnum);
+      /* skip neo-genesis blocks */
+      if (sp->bnum[0] == 0) add64(sp->bnum, ONE64, sp->bnum);
+      sp->tried = 0;
+      sp->reqs = 0;
+      sp->state = SLOT_PENDING;
+      cp->count++;
+      return sp;
+   }
+   /* re-dispatch heights past deadline */
+   for (j = 0; j < cp->count; j++) {
+      sp = &cp->slot[(cp->head + j) % CATCHUP_WINDOW];
+      if (sp->state == SLOT_FETCH && sp->reqs < CATCHUP_MAXREQ
+         && !(sp->tried & bit) && now - sp->since >= CATCHUP_DEADLINE) {
+         return sp;
+      }
+   }
+
+   return NULL;
+}  /* end catchup_pick() */
+
+/**
+ * @private
+ * catchup() fetch thread. Downloads heights picked by catchup_pick() from
+ * a single peer, until stopped, or the peer fails CATCHUP_MAXFAILS
+ * consecutive requests.
+*/
+static ThreadProc catchup_fetch(void *arg)
+{
+   CATCHUP_FETCH *fp = (CATCHUP_FETCH *) arg;
+   CATCHUP *cp = fp->cp;
+   CATCHUP_SLOT *sp;
+   FILENAME fname_dl = {0};
+   FILENAME fname = {0};
+   word32 peer, bit;
+   word8 bnum[8];
+   int ecode, fails;
+
+   peer = cp->plist[fp->idx];
+   bit = (word32) 1 << fp->idx;
+   snprintf(fname_dl, sizeof(fname_dl), "catchup%d.tmp", fp->idx);
+
+   mutex_lock(&cp->lock);
+   for (fails = 0; !cp->stop && fails < CATCHUP_MAXFAILS; ) {
+      sp = catchup_pick(cp, fp->idx);
+      if (sp == NULL) {
+         /* nothing to request (yet) */
+         condition_timedwait(&cp->cond, &cp->lock, 100);
+         continue;
+      }
+      sp->since = catchup_ms();
+      sp->state = SLOT_FETCH;
+      sp->tried |= bit;
+      sp->reqs++;
+      put64(bnum, sp->bnum);
+      mutex_unlock(&cp->lock);
+
+      /* download without lock */
+      ecode = get_file(peer, bnum, fname_dl);
+      if (ecode == VEOK) bnum2fname(bnum, fname);
+
+      mutex_lock(&cp->lock);
+      /* height may have been downloaded (and updated) by another peer */
+      sp = catchup_find(cp, bnum);
+      if (sp) sp->reqs--;
+      if (ecode == VEOK) {
+         fails = 0;
+         if (sp && sp->state == SLOT_FETCH) {
+            if (rename(fname_dl, fname) == 0) sp->state = SLOT_DONE;
+            else perrno("catchup() rename(%s, %s) FAILURE", fname_dl, fname);
+         }
+      } else {
+         fails++;
+         pdebug("get_file(%s, 0x%s) incomplete...",
+            ntoa(&peer, (char[16]){0}), bnum2hex(bnum, (char[17]){0}));
+      }
+      remove(fname_dl);
+      /* re-dispatch failed height */
+      if (sp && sp->state == SLOT_FETCH && sp->reqs == 0) {
+         sp->state = SLOT_PENDING;
+      }
+      condition_broadcast(&cp->cond);
+   }
+   /* peer drops out */
+   cp->active &= ~bit;
+   condition_broadcast(&cp->cond);
+   mutex_unlock(&cp->lock);
+
+   Unthread;
+}  /* end catchup_fetch() */
+
+/**
+ * Catch up by getting blocks from peers in plist[count]. Peers are
+ * ordered by cost, and slow peers are left out, see pstat_select().
+ * Blocks are downloaded by a fetch thread per peer, from a sliding window
+ * of heights. Heights are re-requested of another peer on failure, or
+ * when a request is slow; the head-of-line height sooner than others.
+ * Blocks are updated in order, by the calling thread, as downloads
+ * complete. A block failing update is requested of another peer.
+ * Returns VEOK when no further blocks are available, else VERROR on
+ * error or interrupt; check errno for details. */
 int catchup(word32 plist[], word32 count)
 {
+   static CATCHUP sched;
+   CATCHUP_FETCH fetch[CATCHUP_PEERS];
    void (*SIGTERM_old)(int);
    void (*SIGINT_old)(int);
+   CATCHUP *cp = &sched;
+   CATCHUP_SLOT *sp;
    FILENAME fname_dl = {0};
    FILENAME fname = {0};
    word8 bnum[8];
+   word32 j, nthreads;
+   int ecode;
 
    /* initialize... */
    show("getblock");  /* get blockchain files */
@@ -102,6 +369,10 @@ int catchup(word32 plist[], word32 count)
       perrno("failed to verify %s/ directory", Bcdir);
       return VERROR;
    }
+   /* prefer fast, reliable peers */
+   count = pstat_select(plist, count);
+   if (count > CATCHUP_PEERS) count = CATCHUP_PEERS;
+   pdebug("catchup(): %" P32u " preferred peers", count);
 
    /* set POW interrupt signal handlers */
    SIGINT_old = signal(SIGINT, SYNC_interrupt_);
@@ -120,70 +391,64 @@ int catchup(word32 plist[], word32 count)
       fname[0] = 0;
    }
 
-   /* download/validate/update blocks from args */
-   OMP_PARALLEL_(private(bnum, fname, fname_dl) num_threads(count))
-   {  /* ... parallel block update handling */
-      word32 peer = plist[OMP_THREADNUM];
-      int ecode = VEOK;
-
-      while (count && ecode == VEOK) {
-         if (SYNC_interrupt_signal_) break;
-         /* asynchronous block download (after set) */
-         if (*fname_dl && fexists(fname_dl)) {
-            /* multiple */
-            ecode = get_file(peer, bnum, fname_dl);
-            if (ecode != VEOK) {
-               OMP_CRITICAL_()
-               {
-                  pdebug("get_file(%s, %s) incomplete...",
-                     ntoa(&peer, (char[16]){0}), fname_dl);
-                  remove(fname_dl);
-                  count--;
-               }
-               break;
-            }
-         }
-         /* synchronous file and update handling */
-         OMP_CRITICAL_()
-         {
-            /* rename downloaded files */
-            if (*fname_dl) {
-               bnum2fname(bnum, fname);
-               rename(fname_dl, fname);
-               fname_dl[0] = 0;
-               fname[0] = 0;
-            }
-            /* check and update next block */
-            add64(Cblocknum, ONE64, bnum);
-            bnum2fname(bnum, fname);
-            while (fexists(fname)) {
-               pdebug("b_update(%s)...", fname);
-               ecode = b_update(fname);
-               if (ecode != VEOK) {
-                  perrno("b_update(%s) FAILURE", fname);
-                  remove(fname);
-                  count--;
-                  break;
-               }
-               /* check for next block */
-               add64(Cblocknum, One, bnum);
-               bnum2fname(bnum, fname);
-            }
-            if (ecode == VEOK) {
-               /* find next download */
-               bnum2hex(bnum, fname_dl);
-               while (fexists(fname_dl) || fexists(fname)) {
-                  add64(bnum, ONE64, bnum);
-                  if (bnum[0] == 0) add64(bnum, ONE64, bnum);
-                  bnum2hex(bnum, fname_dl);
-                  bnum2fname(bnum, fname);
-               }
-               /* reserve download file(name) */
-               ftouch(fname_dl);
-            }
-         }  /* end OMP_CRITICAL_() */
-      }  /* end while (!SYNC_interrupt_signal_... */
-   }  /* end OMP parallel */
+   /* initialize scheduler and start fetch threads */
+   memset(cp, 0, sizeof(*cp));
+   mutex_init(&cp->lock);
+   condition_init(&cp->cond);
+   cp->plist = plist;
+   cp->window = (int) count * CATCHUP_DEPTH;
+   if (cp->window > CATCHUP_WINDOW) cp->window = CATCHUP_WINDOW;
+   mutex_lock(&cp->lock);
+   for (nthreads = 0; nthreads < count; nthreads++) {
+      fetch[nthreads].cp = cp;
+      fetch[nthreads].idx = (int) nthreads;
+      cp->active |= (word32) 1 << nthreads;
+      if (thread_create(&(fetch[nthreads].tid), catchup_fetch,
+            &fetch[nthreads]) != 0) {
+         perrno("catchup() thread_create() FAILURE");
+         cp->active &= ~((word32) 1 << nthreads);
+         break;
+      }
+   }
+
+   /* update downloaded blocks, in order */
+   while (!SYNC_interrupt_signal_) {
+      sp = &cp->slot[cp->head];
+      if (cp->count == 0 || sp->state != SLOT_DONE) {
+         if (cp->active == 0) break;
+         if (cp->count && sp->state == SLOT_FAILED) break;
+         condition_timedwait(&cp->cond, &cp->lock, 100);
+         continue;
+      }
+      bnum2fname(sp->bnum, fname);
+      mutex_unlock(&cp->lock);
+      pdebug("b_update(%s)...", fname);
+      ecode = b_update(fname);
+      if (ecode != VEOK) {
+         perrno("b_update(%s) FAILURE", fname);
+         remove(fname);
+      }
+      mutex_lock(&cp->lock);
+      if (ecode == VEOK) {
+         /* slide window */
+         cp->head = (cp->head + 1) % CATCHUP_WINDOW;
+         cp->count--;
+      } else sp->state = SLOT_PENDING;  /* try another peer */
+      condition_broadcast(&cp->cond);
+   }
+
+   /* stop fetch threads, and clear remaining downloads */
+   cp->stop = 1;
+   condition_broadcast(&cp->cond);
+   mutex_unlock(&cp->lock);
+   for (j = 0; j < nthreads; j++) thread_join(fetch[j].tid);
+   for (j = 0; j < (word32) cp->count; j++) {
+      sp = &cp->slot[(cp->head + j) % CATCHUP_WINDOW];
+      bnum2fname(sp->bnum, fname);
+      remove(fname);
+   }
+   condition_destroy(&cp->cond);
+   mutex_destroy(&cp->lock);
 
    /* restore signal handlers */
    signal(SIGINT, SIGINT_old);
@@ -203,8 +468,10 @@ int catchup(word32 plist[], word32 count)
  * Returns VEOK on success, else restarts. */
 int resync(word32 quorum[], word32 *qidx, void *highweight, void *highbnum)
 {
+   BTRAILER bt;
    char ipaddr[16], fname[FILENAME_MAX], bcfname[21];
    word8 bnum[8], weight[HASHLEN];
+   int snapshot;
 
    /* resync from quorum bnum must be higher than V30TRIGGER */
    if (cmp64(highbnum, CL64_32(V30TRIGGER)) < 0) {
@@ -212,6 +479,9 @@ int resync(word32 quorum[], word32 *qidx, void *highweight, void *highbnum)
       return VERROR;
    }
 
+   /* prefer fast, reliable peers for (large) downloads */
+   pstat_sort(quorum, *qidx);
+
    show("gettfile");  /* get tfile */
    pdebug("fetching tfile.dat from %s", ntoa(&quorum[0], ipaddr));
    pdebug("... this is a large file, please be patient !!!");
@@ -257,12 +527,30 @@ int resync(word32 quorum[], word32 *qidx, void *highweight, void *highbnum)
       pwarn("bumping neo-genesis block to V30TRIGGER");
       put64(bnum, CL64_32(V30TRIGGER));
    }
+   le_close();  /* close ledger, we're gonna grab a new one... */
+   /* bootstrap from ledger snapshot -- verified against tfile.dat */
+   snapshot = 0;
+   if (fexists("snapshot.dat")) {
+      show("snapshot");
+      plog("importing ledger snapshot...");
+      if (snap_import("snapshot.dat", "ngblock.dat", "ledger.dat") != VEOK) {
+         perrno("snap_import() FAILURE, snapshot.dat ignored");
+      } else if (read_trailer(&bt, "ngblock.dat") != VEOK) {
+         perrno("read_trailer(ngblock.dat) FAILURE");
+      } else if (cmp64(bt.bnum, CL64_32(V30TRIGGER)) < 0) {
+         pwarn("snapshot precedes V30TRIGGER, snapshot.dat ignored");
+      } else {
+         put64(bnum, bt.bnum);
+         snapshot = 1;
+      }
+      if (!snapshot) remove("ngblock.dat");
+      if (!Running) resign("snapshot exiting");
+   }
    pdebug("neo-genesis block 0x%s", bnum2hex(bnum, NULL));
-   /* trim the tfile back to the neo-genesis block and close the ledger */
+   /* trim the tfile back to the neo-genesis block */
    if (trim_tfile("tfile.dat", bnum) != VEOK) restart("getneo tfile_trim()");  /* panic */
-   le_close();  /* close ledger, we're gonna grab a new one... */
-   /* download neo-genesis block if no backup */
-   if(!iszero(bnum, 8)) {  /* ... no need to download genesis block */
+   /* download neo-genesis block if no backup (or snapshot) */
+   if(!snapshot && !iszero(bnum, 8)) {  /* ... no need to download genesis block */
       plog("downloading neo-genesis block 0x%s", bnum2hex(bnum, NULL));
       while(Running && *quorum) {
          show("getneo");
@@ -280,6 +568,8 @@ int resync(word32 quorum[], word32 *qidx, void *highweight, void *highbnum)
       }
       if (!(*quorum)) restart("getneo no quorum");
       if (!Running) resign("getneo exiting");
+   }
+   if(!iszero(bnum, 8)) {
       /* transfer neo-genesis block to bcdir */
       bnum2fname(bnum, bcfname);
       path_join(fname, Bcdir, bcfname);
@@ -287,8 +577,8 @@ int resync(word32 quorum[], word32 *qidx, void *highweight, void *highbnum)
          perrno("cannot move neo-genesis to %s", fname);
          return VERROR;
       }
-      /* extract ledger from neo-genesis block... */
-      if(le_extract(fname, "ledger.dat") != VEOK) {
+      /* extract ledger from neo-genesis block (if not from snapshot)... */
+      if(!snapshot && le_extract(fname, "ledger.dat") != VEOK) {
          restart("getneo ledger extraction");
       }  /* ... or from genesis block */
    } /* else extract_gen("ledger.dat"); */
@@ -344,7 +634,6 @@ int syncup(word32 splitblock, word8 *txcblock, word32 peerip)
    word8 lastneo[8], sblock[8];
    FILENAME fname, bcfname;
    int j;
-   NODE *np2;
    time_t lasttime;
 
    Insyncup = 1;
@@ -354,13 +643,8 @@ int syncup(word32 splitblock, word8 *txcblock, word32 peerip)
    stop_bcon();
    stop_found();
 
-   /* Stop block transfer children and others */
-   for(np2 = Nodes; np2 < Hi_node; np2++) {
-      if(np2->pid == 0) continue;
-      kill(np2->pid, SIGTERM);
-      waitpid(np2->pid, NULL, 0);
-      freeslot(np2);
-   }
+   /* Abort block transfer requests */
+   workq_abort();
 
    /* Close server ledger */	
    pdebug("beginning state save...");
@@ -455,7 +739,9 @@ int syncup(word32 splitblock, word8 *txcblock, word32 peerip)
    if(weigh_tfile("tfile.dat", bnum, tfweight)) {
       plog("tf_val() error");
    } else plog("syncup() is good!");
+   mutex_lock(&Chainlock);
    memcpy(Weight, tfweight, HASHLEN);
+   mutex_unlock(&Chainlock);
    Insyncup = 0;
    return VEOK;
 
@@ -465,6 +751,7 @@ badsyncup:
    le_close();
    system("mv split/tfile.dat .");
    system("mv split/ledger.dat .");
+   le_index_update("ledger.dat");  /* index of replaced ledger is stale */
    system("rm -r split/");
    reset_chain();  /* reset Difficulty and others */
    le_open("ledger.dat");
@@ -487,7 +774,7 @@ int contention(NODE *np)
 
    pdebug("IP: %s", ntoa(&np->ip, NULL));
 
-   tx = &np->tx;
+   tx = np->tx;
    splitblock = 0;
    /* ignore low weight */
    if(cmp256(tx->weight, Weight) <= 0) {
@@ -511,7 +798,9 @@ int contention(NODE *np)
    /* Try to do a simple catchup() of more than 1 block on our own chain. */
    pdebug("Trying simple catchup()");
    j = get32(tx->cblock) - get32(Cblocknum);
-   if(j > 1 && j <= NTFTX) {
+   /* ... proof array must be whole, packet buffer is sized to fit */
+   if(j > 1 && j <= NTFTX
+      && (get16(tx->len) / sizeof(BTRAILER)) >= NTFTX) {
         bt = (BTRAILER *) tx->buffer;  /* top of tx proof array */
         /* Check for matching previous hash in the array. */
         if(memcmp(Cblockhash, bt[NTFTX - j].phash, HASHLEN) == 0) {
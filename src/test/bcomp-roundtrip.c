@@ -0,0 +1,135 @@
+
+#include <stdlib.h>
+#include <time.h>
+#include "_assert.h"
+#include "bcomp.h"
+
+#define BCFILE    "bcomp-roundtrip.bc"
+#define NUMTX     512
+#define TXSIZE    2304
+#define WOTSSIZE  2144
+#define ROUNDS    16
+
+static word8 Block[sizeof(BHEADER) + (NUMTX * TXSIZE) + sizeof(BTRAILER)];
+static word8 Frame[BCZ_FRAMELEN];
+static word8 Zframe[BCZ_FRAMEBOUND];
+
+int main()
+{
+   BTRAILER bt;
+   clock_t start;
+   word8 *bp, *raw;
+   size_t j, k, zlen;
+   long len, zsize;
+   double secs;
+   FILE *fp;
+
+   /* build a block resembling transaction layout (hashes, zeros, WOTS+) */
+   srand(1);
+   memset(Block, 0, sizeof(Block));
+   put32(Block, sizeof(BHEADER));
+   for (j = 0; j < 20; j++) Block[4 + j] = (word8) rand();
+   for (bp = Block + sizeof(BHEADER), k = 0; k < NUMTX; k++, bp += TXSIZE) {
+      for (j = 0; j < ADDR_LEN; j++) bp[j] = (word8) rand();
+      /* repeat source tag as change tag, zeroed reference fields */
+      memcpy(bp + ADDR_LEN, bp, ADDR_TAG_LEN);
+      for (j = 0; j < WOTSSIZE; j++) bp[128 + j] = (word8) rand();
+   }
+   for (j = 0; j < sizeof(BTRAILER); j++) {
+      Block[sizeof(Block) - sizeof(BTRAILER) + j] = (word8) rand();
+   }
+
+   /* check frame compression round trip, and malformed input */
+   zlen = bc_zpack(Block, BCZ_FRAMELEN, Zframe, sizeof(Zframe));
+   ASSERT_GT(zlen, 0);
+   ASSERT_LT(zlen, BCZ_FRAMELEN);
+   ASSERT_EQ(bc_zunpack(Zframe, zlen, Frame, sizeof(Frame)), BCZ_FRAMELEN);
+   ASSERT_CMP(Frame, Block, BCZ_FRAMELEN);
+   ASSERT_EQ(bc_zunpack(Zframe, zlen, Frame, BCZ_FRAMELEN - 1), 0);
+   for (j = 1; j < zlen; j += 97) {
+      ASSERT_NE(bc_zunpack(Zframe, j, Frame, sizeof(Frame)), BCZ_FRAMELEN);
+   }
+   /* check small and incompressible inputs */
+   ASSERT_EQ(bc_zpack(Block, 1, Zframe, sizeof(Zframe)), 2);
+   ASSERT_EQ(bc_zunpack(Zframe, 2, Frame, sizeof(Frame)), 1);
+   ASSERT_EQ(bc_zpack(Block + 128, WOTSSIZE, Zframe, 64), 0);
+
+   /* write block file and compress */
+   ASSERT_NE((fp = fopen(BCFILE, "wb")), NULL);
+   ASSERT_EQ(fwrite(Block, sizeof(Block), 1, fp), 1);
+   fclose(fp);
+   ASSERT_EQ(bc_iscompressed(BCFILE), 0);
+   start = clock();
+   ASSERT_EQ(bc_compress(BCFILE), VEOK);
+   secs = (double) (clock() - start) / CLOCKS_PER_SEC;
+   ASSERT_EQ(bc_iscompressed(BCFILE), 1);
+   ASSERT_EQ(bc_compress(BCFILE), VEOK);
+
+   /* check trailer remains readable from end of compressed file */
+   ASSERT_NE((fp = fopen(BCFILE, "rb")), NULL);
+   ASSERT_EQ(fseek(fp, -((long) sizeof(BTRAILER)), SEEK_END), 0);
+   ASSERT_EQ(fread(&bt, sizeof(BTRAILER), 1, fp), 1);
+   zsize = ftell(fp);
+   fclose(fp);
+   ASSERT_CMP(&bt, Block + sizeof(Block) - sizeof(BTRAILER),
+      sizeof(BTRAILER));
+   ASSERT_LT(zsize, (long) sizeof(Block));
+   printf("Block compression: ratio %.03f, pack ~%.02f MB/s\n",
+      (double) sizeof(Block) / (double) zsize,
+      secs > 0 ? (double) sizeof(Block) / secs / 1e6 : 0.0);
+
+   /* check transparent decompression */
+   raw = malloc(sizeof(Block));
+   ASSERT_NE(raw, NULL);
+   start = clock();
+   for (k = 0; k < ROUNDS; k++) {
+      ASSERT_NE((fp = bc_fopen(BCFILE)), NULL);
+      ASSERT_EQ(fread(raw, sizeof(Block), 1, fp), 1);
+      ASSERT_EQ(fseek(fp, 0L, SEEK_END), 0);
+      len = ftell(fp);
+      fclose(fp);
+      ASSERT_EQ(len, (long) sizeof(Block));
+      ASSERT_CMP(raw, Block, sizeof(Block));
+   }
+   secs = (double) (clock() - start) / CLOCKS_PER_SEC;
+   printf("Block decompression: ~%.02f MB/s\n",
+      secs > 0 ? (double) sizeof(Block) * ROUNDS / secs / 1e6 : 0.0);
+
+   /* check random access, across frames and into the trailer */
+   ASSERT_NE((fp = bc_fopen(BCFILE)), NULL);
+   for (k = 0; k < 64; k++) {
+      j = k == 0 ? sizeof(Block) - sizeof(BTRAILER) - 100 :
+         (size_t) rand() % (sizeof(Block) - 1);
+      zlen = sizeof(Block) - j < 4096 ? sizeof(Block) - j : 4096;
+      ASSERT_EQ(fseek(fp, (long) j, SEEK_SET), 0);
+      ASSERT_EQ(fread(raw, zlen, 1, fp), 1);
+      ASSERT_EQ(ftell(fp), (long) (j + zlen));
+      ASSERT_CMP(raw, Block + j, zlen);
+   }
+   ASSERT_EQ(fread(raw, 1, 1, fp), (size_t) (j + zlen < sizeof(Block)));
+   fclose(fp);
+
+   /* check a stored length mismatch is refused on open */
+   ASSERT_NE((fp = fopen(BCFILE, "r+b")), NULL);
+   ASSERT_EQ(fseek(fp, BCZ_MAGICLEN, SEEK_SET), 0);
+   ASSERT_EQ(fputc(0xff, fp), 0xff);
+   fclose(fp);
+   ASSERT_EQ(bc_fopen(BCFILE), NULL);
+   ASSERT_NE((fp = fopen(BCFILE, "r+b")), NULL);
+   ASSERT_EQ(fseek(fp, BCZ_MAGICLEN, SEEK_SET), 0);
+   ASSERT_EQ(fputc((int) (sizeof(Block) & 0xff), fp),
+      (int) (sizeof(Block) & 0xff));
+   fclose(fp);
+
+   /* check in place decompression restores original file */
+   ASSERT_EQ(bc_decompress(BCFILE), VEOK);
+   ASSERT_EQ(bc_iscompressed(BCFILE), 0);
+   ASSERT_NE((fp = fopen(BCFILE, "rb")), NULL);
+   ASSERT_EQ(fread(raw, sizeof(Block), 1, fp), 1);
+   fclose(fp);
+   ASSERT_CMP(raw, Block, sizeof(Block));
+
+   /* cleanup */
+   free(raw);
+   remove(BCFILE);
+}
@@ -0,0 +1,50 @@
+
+#include <stdio.h>
+#include <string.h>
+
+#include "_assert.h"
+#include "error.h"
+#include "types.h"
+
+#define NUMTHREADS   8
+#define NUMLOGS      4096
+
+int main()
+{  /* check asynchronous logs are all written, else counted as dropped */
+   char line[BUFSIZ], *cp;
+   unsigned int count, drops, j;
+   FILE *fp;
+   int n;
+
+   fp = tmpfile();
+   ASSERT_NE(fp, NULL);
+   setplogfile(fp);
+   setploglevel(PLOG_INFO);
+   ASSERT_EQ(setplogasync(1), VEOK);
+
+   /* log concurrently, faster than the writer thread */
+#pragma omp parallel for num_threads(NUMTHREADS)
+   for (n = 0; n < NUMTHREADS * NUMLOGS; n++) plog("async log %d", n);
+   /* unset writes all pending logs */
+   ASSERT_EQ(setplogasync(0), VEOK);
+   plog("sync log");
+
+   /* every line is complete, and every log written or dropped */
+   rewind(fp);
+   count = drops = 0;
+   while (fgets(line, sizeof(line), fp)) {
+      ASSERT_EQ(line[strlen(line) - 1], '\n');
+      ASSERT_EQ(line[0], '[');
+      if (strstr(line, " async log ")) count++;
+      else if ((cp = strstr(line, "Warn... ")) != NULL) {
+         ASSERT_EQ(sscanf(cp, "Warn... %u logs dropped", &j), 1);
+         drops += j;
+      } else ASSERT_NE(strstr(line, " sync log"), NULL);
+   }
+   ASSERT_EQ(count + plogdrops(), NUMTHREADS * NUMLOGS);
+   ASSERT_EQ(drops, plogdrops());
+   ASSERT_EQ(plogcount(), count + 1);
+
+   setplogfile(NULL);
+   fclose(fp);
+}
@@ -0,0 +1,86 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include "_assert.h"
+#include "ledger.h"
+
+#define LEDGER    "ledger.dat"
+#define NLEDGER   4096
+#define NSMALL    16    /* (NLEDGER / LEBATCHRATIO) > NSMALL, galloping */
+#define NLARGE    1024  /* (NLEDGER / LEBATCHRATIO) <= NLARGE, merge join */
+
+static LENTRY Ledger[NLEDGER];
+static word8 Addrs[NLARGE][ADDR_LEN];
+static LENTRY Les[NLARGE];
+static word8 Found[NLARGE];
+
+static void check_batch(size_t count, word16 len)
+{
+   LENTRY le;
+   size_t j, nfound;
+
+   /* every batch result must agree with an individual search */
+   nfound = le_find_batch(Addrs, ADDR_LEN, count, Les, Found, len);
+   for (j = 0; j < count; j++) {
+      ASSERT_EQ(Found[j], le_find(Addrs[j], &le, len));
+      if (Found[j]) {
+         ASSERT_CMP(Les[j].addr, Addrs[j], len);
+         ASSERT_CMP(Les[j].addr, le.addr, len);
+      }
+      nfound -= Found[j];
+   }
+   ASSERT_EQ(nfound, 0);
+}
+
+int main()
+{
+   FILE *fp;
+   size_t j;
+
+   /* build sorted dummy ledger */
+   srand(1);
+   for (j = 0; j < NLEDGER; j++) {
+      for (int k = 0; k < ADDR_LEN; k++) Ledger[j].addr[k] = (word8) rand();
+      put32(Ledger[j].balance, (word32) j);
+   }
+   qsort(Ledger, NLEDGER, sizeof(LENTRY), addr_compare);
+   ASSERT_NE((fp = fopen(LEDGER, "wb")), NULL);
+   ASSERT_EQ(fwrite(Ledger, sizeof(Ledger), 1, fp), 1);
+   fclose(fp);
+
+   /* unsorted batch; alternating existing and non-existing addresses */
+   for (j = 0; j < NLARGE; j++) {
+      if (j & 1) memcpy(Addrs[j], Ledger[rand() % NLEDGER].addr, ADDR_LEN);
+      else for (int k = 0; k < ADDR_LEN; k++) Addrs[j][k] = (word8) rand();
+   }
+   /* include duplicates and ledger boundaries */
+   memcpy(Addrs[1], Ledger[0].addr, ADDR_LEN);
+   memcpy(Addrs[3], Ledger[NLEDGER - 1].addr, ADDR_LEN);
+   memcpy(Addrs[5], Addrs[3], ADDR_LEN);
+
+   /* check ledger function called before le_open() */
+   ASSERT_EQ(le_find_batch(Addrs, ADDR_LEN, NSMALL, Les, Found, ADDR_LEN), 0);
+   ASSERT_EQ(errno, EMCM_LECLOSED);
+   ASSERT_EQ(le_open(LEDGER), VEOK);
+
+   /* check invalid parameters */
+   ASSERT_EQ(le_find_batch(Addrs, ADDR_LEN - 1, NSMALL, Les, Found, 1), 0);
+   ASSERT_EQ(errno, EINVAL);
+   ASSERT_EQ(le_find_batch(Addrs, ADDR_LEN, NSMALL, Les, Found, 0), 0);
+   ASSERT_EQ(errno, EINVAL);
+
+   /* check both search strategies, full and partial address length */
+   check_batch(NSMALL, ADDR_LEN);
+   check_batch(NLARGE, ADDR_LEN);
+   check_batch(NSMALL, 2);
+   check_batch(NLARGE, 2);
+
+   /* check no results is not an error */
+   ASSERT_EQ(le_find_batch(Addrs, 2 * ADDR_LEN, 1, Les, Found, ADDR_LEN), 0);
+   ASSERT_EQ(errno, 0);
+
+   /* cleanup */
+   le_close();
+   remove(LEDGER);
+}
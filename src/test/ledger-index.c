@@ -0,0 +1,98 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include "_assert.h"
+#include "ledger.h"
+
+#define LEDGER       "ledger.dat"
+#define LEDGER_IDX   "ledger.dat.idx"
+#define NLEDGER      4096
+
+static LENTRY Ledger[NLEDGER];
+
+static void check_find(void)
+{
+   LENTRY le;
+   word8 addr[ADDR_LEN];
+   size_t j;
+
+   /* every ledger entry must be found by full address and by tag;
+    * duplicate tags must still resolve to the correct full address */
+   for (j = 0; j < NLEDGER; j++) {
+      ASSERT_EQ(le_find(Ledger[j].addr, &le, ADDR_LEN), 1);
+      ASSERT_CMP(&le, &Ledger[j], sizeof(LENTRY));
+      ASSERT_EQ(le_find(Ledger[j].addr, &le, ADDR_TAG_LEN), 1);
+      ASSERT_CMP(le.addr, Ledger[j].addr, ADDR_TAG_LEN);
+   }
+   /* non-existent tag, and existing tag with non-existent hash */
+   memset(addr, 0xa5, ADDR_LEN);
+   ASSERT_EQ(le_find(addr, &le, ADDR_LEN), 0);
+   ASSERT_EQ(errno, 0);
+   memcpy(addr, Ledger[7].addr, ADDR_TAG_LEN);
+   ASSERT_EQ(le_find(addr, &le, ADDR_LEN), 0);
+   ASSERT_EQ(errno, 0);
+}
+
+int main()
+{
+   LENTRY le;
+   FILE *fp;
+   size_t j;
+
+   /* build sorted dummy ledger (incl. a duplicate tag) */
+   srand(1);
+   for (j = 0; j < NLEDGER; j++) {
+      for (int k = 0; k < ADDR_LEN; k++) Ledger[j].addr[k] = (word8) rand();
+      put32(Ledger[j].balance, (word32) j);
+   }
+   Ledger[0].addr[0] = 0;
+   memcpy(Ledger[NLEDGER - 1].addr, Ledger[0].addr, ADDR_TAG_LEN);
+   Ledger[NLEDGER - 1].addr[ADDR_LEN - 1] ^= 0xff;
+   qsort(Ledger, NLEDGER, sizeof(LENTRY), addr_compare);
+   ASSERT_NE((fp = fopen(LEDGER, "wb")), NULL);
+   ASSERT_EQ(fwrite(Ledger, sizeof(Ledger), 1, fp), 1);
+   fclose(fp);
+
+   /* check binary search (no index) */
+   remove(LEDGER_IDX);
+   ASSERT_EQ(le_open(LEDGER), VEOK);
+   check_find();
+   le_close();
+
+   /* check indexed search */
+   ASSERT_EQ(le_index_build(LEDGER), VEOK);
+   ASSERT_EQ(le_open(LEDGER), VEOK);
+   check_find();
+   le_close();
+
+   /* check stale index is rejected (ledger rewritten without entry) */
+   ASSERT_NE((fp = fopen(LEDGER, "wb")), NULL);
+   ASSERT_EQ(fwrite(Ledger + 1, sizeof(LENTRY), NLEDGER - 1, fp),
+      NLEDGER - 1);
+   fclose(fp);
+   ASSERT_EQ(le_open(LEDGER), VEOK);
+   ASSERT_EQ(le_find(Ledger[NLEDGER - 1].addr, &le, ADDR_LEN), 1);
+   ASSERT_CMP(&le, &Ledger[NLEDGER - 1], sizeof(LENTRY));
+   le_close();
+
+   /* check index is rejected for a ledger replaced by rename, with the
+    * same entry count, first and last addresses (e.g. syncup() restore) */
+   ASSERT_EQ(le_index_build(LEDGER), VEOK);
+   Ledger[100].addr[5] ^= 0x01;
+   ASSERT_LT(addr_compare(Ledger[99].addr, Ledger[100].addr), 0);
+   ASSERT_LT(addr_compare(Ledger[100].addr, Ledger[101].addr), 0);
+   ASSERT_NE((fp = fopen(LEDGER ".new", "wb")), NULL);
+   ASSERT_EQ(fwrite(Ledger + 1, sizeof(LENTRY), NLEDGER - 1, fp),
+      NLEDGER - 1);
+   fclose(fp);
+   ASSERT_EQ(rename(LEDGER ".new", LEDGER), 0);
+   ASSERT_EQ(le_open(LEDGER), VEOK);
+   ASSERT_EQ(le_find(Ledger[100].addr, &le, ADDR_LEN), 1);
+   ASSERT_CMP(&le, &Ledger[100], sizeof(LENTRY));
+   le_close();
+
+   /* cleanup */
+   remove(LEDGER_IDX);
+   remove(LEDGER);
+}
@@ -0,0 +1,100 @@
+
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "_assert.h"
+#include "metrics.h"
+#include "extinet.h"
+#include "exttime.h"
+
+#define PORT   2198
+
+int main()
+{
+   static char buf[65536];
+   const char *req = "GET /metrics HTTP/1.0\r\n\r\n";
+   word64 start;
+   SOCKET sd, silent;
+   size_t n, j;
+   pid_t pid;
+   int count, status;
+
+   /* updates before init are ignored */
+   metrics_inc(METRICS_RECVS);
+   ASSERT_EQ(metrics_format(buf, sizeof(buf)), 0);
+   ASSERT_EQ(metrics_init(), VEOK);
+
+   /* updates of a child process are visible to the parent */
+   pid = fork();
+   ASSERT_NE(pid, -1);
+   if (pid == 0) {
+      metrics_inc(METRICS_RECVS);
+      metrics_inc(METRICS_RECVS);
+      start = metrics_time();
+      metrics_observe(METRICS_TX_VAL, start);
+      metrics_observe_op(OP_GET_BLOCK, start - 2000000);
+      _exit(0);
+   }
+   ASSERT_EQ(waitpid(pid, &status, 0), pid);
+   metrics_inc(METRICS_DUPS);
+   metrics_observe_op(OP_IDENTIFY + 1, metrics_time());
+
+   /* Prometheus text format, cumulative buckets */
+   n = metrics_format(buf, sizeof(buf));
+   ASSERT_EQ(n, strlen(buf));
+   ASSERT_NE(strstr(buf, "# TYPE mochimo_recvs_total counter\n"), NULL);
+   ASSERT_NE(strstr(buf, "\nmochimo_recvs_total 2\n"), NULL);
+   ASSERT_NE(strstr(buf, "\nmochimo_dups_total 1\n"), NULL);
+   ASSERT_NE(strstr(buf, "\nmochimo_timeouts_total 0\n"), NULL);
+   ASSERT_NE(strstr(buf, "# TYPE mochimo_tx_val_seconds histogram\n"), NULL);
+   ASSERT_NE(strstr(buf, "\nmochimo_tx_val_seconds_bucket{le=\"30\"} 1\n"),
+      NULL);
+   ASSERT_NE(strstr(buf, "\nmochimo_tx_val_seconds_bucket{le=\"+Inf\"} 1\n"),
+      NULL);
+   ASSERT_NE(strstr(buf, "\nmochimo_tx_val_seconds_count 1\n"), NULL);
+   ASSERT_NE(strstr(buf, "\nmochimo_b_val_seconds_count 0\n"), NULL);
+   ASSERT_NE(strstr(buf, "\nmochimo_op_seconds_bucket{op=\"OP_GET_BLOCK\","
+      "le=\"1\"} 0\n"), NULL);
+   ASSERT_NE(strstr(buf, "\nmochimo_op_seconds_bucket{op=\"OP_GET_BLOCK\","
+      "le=\"5\"} 1\n"), NULL);
+   ASSERT_NE(strstr(buf, "\nmochimo_op_seconds_count{op=\"OP_GET_BLOCK\"} 1\n"),
+      NULL);
+   /* unobserved (and unknown) opcodes are omitted */
+   ASSERT_EQ(strstr(buf, "op=\"OP_TX\""), NULL);
+   ASSERT_EQ(strstr(buf, "op=\"OP_UNKNOWN\""), NULL);
+   /* output is truncated to fit */
+   ASSERT_EQ(metrics_format(buf, 64), 63);
+   ASSERT_EQ(strlen(buf), 63);
+
+   /* scrape the (loopback) endpoint */
+   sock_startup();
+   ASSERT_EQ(metrics_listen(PORT), VEOK);
+   /* a silent client delays only the endpoint thread */
+   silent = sock_connect_ip(aton("127.0.0.1"), PORT, 3);
+   ASSERT_NE(silent, INVALID_SOCKET);
+   sd = sock_connect_ip(aton("127.0.0.1"), PORT, 3);
+   ASSERT_NE(sd, INVALID_SOCKET);
+   ASSERT_EQ(send(sd, req, strlen(req), 0), (int) strlen(req));
+   /* scrapes are served by the endpoint thread */
+   for (n = 0, j = 0; n < sizeof(buf) - 1 && j < 300; n += (size_t) count) {
+      count = recv(sd, buf + n, sizeof(buf) - 1 - n, 0);
+      if (count == 0) break;
+      if (count < 0) {
+         if (!sock_waiting(sock_errno)) break;
+         millisleep(10);
+         count = 0;
+         j++;
+      }
+   }
+   buf[n] = '\0';
+   sock_close(sd);
+   sock_close(silent);
+   ASSERT_EQ(strncmp(buf, "HTTP/1.0 200 OK\r\n", 17), 0);
+   ASSERT_NE(strstr(buf, "Content-Type: text/plain; version=0.0.4\r\n"), NULL);
+   ASSERT_NE(strstr(buf, "\nmochimo_recvs_total 2\n"), NULL);
+
+   metrics_free();
+   metrics_inc(METRICS_RECVS);
+   ASSERT_EQ(metrics_format(buf, sizeof(buf)), 0);
+}
@@ -0,0 +1,62 @@
+
+#include "_assert.h"
+#include "network.h"
+#include "extthrd.h"
+#include <string.h>
+#include <sys/socket.h>
+
+static NODE Server;
+static int Status;
+
+/* serve a single connection with gettx() */
+static ThreadProc serve(void *arg)
+{
+   Status = gettx(&Server, *((SOCKET *) arg));
+   Unthread;
+}
+
+/* connect a client node to a gettx() server thread, over a socketpair */
+static void connect_pair(NODE *np, SOCKET sv[2], ThreadId *tid)
+{
+   ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+   ASSERT_EQ(sock_set_nonblock(sv[0]), 0);
+   ASSERT_EQ(sock_set_nonblock(sv[1]), 0);
+   memset(np, 0, sizeof(NODE));
+   np->sd = sv[0];
+   np->id1 = 0x1234;
+   ASSERT_EQ(node_reserve(np, 0), VEOK);
+   ASSERT_EQ(thread_create(tid, serve, &sv[1]), 0);
+}
+
+int main()
+{
+   ThreadId tid;
+   NODE node;
+   SOCKET sv[2];
+
+   /* a handshake is acknowledged */
+   connect_pair(&node, sv, &tid);
+   put16(node.tx->opcode, OP_HELLO);
+   ASSERT_EQ(send_tx(&node, 1), VEOK);
+   ASSERT_EQ(recv_tx(&node, 1), VEOK);
+   ASSERT_EQ(get16(node.tx->opcode), OP_HELLO_ACK);
+   ASSERT_EQ(get16(node.tx->id1), 0x1234);
+   shutdown(node.sd, 2);
+   ASSERT_EQ(thread_join(tid), 0);
+   ASSERT_EQ(Status, VERROR);
+   node_close(&node);
+   node_close(&Server);
+
+   /* a handshake with data, that moves the packet buffer, is rejected */
+   connect_pair(&node, sv, &tid);
+   ASSERT_EQ(node_reserve(&node, 4096), VEOK);
+   put16(node.tx->opcode, OP_HELLO);
+   put16(node.tx->len, 4096);
+   memset(node.tx->buffer, 0xa5, 4096);
+   ASSERT_EQ(send_tx(&node, 1), VEOK);
+   ASSERT_EQ(thread_join(tid), 0);
+   ASSERT_EQ(Status, VEBAD);
+   ASSERT_NE(recv_tx(&node, 0.1), VEOK);
+   node_close(&node);
+   node_close(&Server);
+}
@@ -0,0 +1,64 @@
+
+#include "_assert.h"
+#include "network.h"
+#include <string.h>
+
+int main()
+{
+   NODE node;
+   TX *pkt, *next;
+   word8 id[2] = { 0x12, 0x34 };
+
+   /* packet buffers are sized by class */
+   pkt = pkt_alloc(0);
+   ASSERT_NE(pkt, NULL);
+   ASSERT_EQ(pkt_cap(pkt), 512);
+   pkt_free(pkt);
+   pkt = pkt_alloc(600);
+   ASSERT_NE(pkt, NULL);
+   ASSERT_EQ(pkt_cap(pkt), 16384);
+   pkt_free(pkt);
+   pkt = pkt_alloc(20000);
+   ASSERT_NE(pkt, NULL);
+   ASSERT_EQ(pkt_cap(pkt), sizeof(pkt->buffer));
+   pkt_free(pkt);
+   ASSERT_EQ(pkt_alloc(sizeof(pkt->buffer) + 1), NULL);
+   pkt_free(NULL);
+
+   /* released buffers are reused, with a cleared header */
+   pkt = pkt_alloc(64);
+   memset(pkt, 0xff, TXHDRLEN + 64);
+   pkt_free(pkt);
+   next = pkt_alloc(32);
+   ASSERT_EQ(next, pkt);
+   ASSERT_EQ(get16(next->len), 0);
+   ASSERT_EQ(next->weight[31], 0);
+   pkt_free(next);
+
+   /* node buffers grow, retaining header and data */
+   memset(&node, 0, sizeof(NODE));
+   node.sd = INVALID_SOCKET;
+   ASSERT_EQ(node_reserve(&node, 0), VEOK);
+   ASSERT_NE(node.tx, NULL);
+   memcpy(node.tx->id1, id, sizeof(id));
+   memset(node.tx->buffer, 0xaa, 500);
+   put16(node.tx->len, 500);
+   pkt = node.tx;
+   ASSERT_EQ(node_reserve(&node, 512), VEOK);
+   ASSERT_EQ(node.tx, pkt);
+   ASSERT_EQ(node_reserve(&node, 4000), VEOK);
+   ASSERT_NE(node.tx, pkt);
+   ASSERT_EQ(pkt_cap(node.tx), 16384);
+   ASSERT_EQ(memcmp(node.tx->id1, id, sizeof(id)), 0);
+   ASSERT_EQ(get16(node.tx->len), 500);
+   ASSERT_EQ(node.tx->buffer[0], 0xaa);
+   ASSERT_EQ(node.tx->buffer[499], 0xaa);
+   ASSERT_EQ(node_reserve(&node, sizeof(pkt->buffer) + 1), VERROR);
+   ASSERT_NE(node.tx, NULL);
+
+   /* node close is repeatable */
+   node_close(&node);
+   ASSERT_EQ(node.tx, NULL);
+   ASSERT_EQ(node.sd, INVALID_SOCKET);
+   node_close(&node);
+}
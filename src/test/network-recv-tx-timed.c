@@ -0,0 +1,75 @@
+
+#include "_assert.h"
+#include "network.h"
+#include "metrics.h"
+#include "extthrd.h"
+#include <string.h>
+#include <sys/socket.h>
+
+#define ROUNDS 200
+
+/* echo packets back to sender, until closed */
+static ThreadProc echo(void *arg)
+{
+   NODE *np = (NODE *) arg;
+
+   while (recv_tx(np, 5) == VEOK) {
+      if (send_tx(np, 5) != VEOK) break;
+   }
+
+   Unthread;
+}
+
+/* prepare a node, with matching handshake ids, on a socket */
+static void prepare(NODE *np, SOCKET sd)
+{
+   memset(np, 0, sizeof(NODE));
+   np->sd = sd;
+   np->id1 = 0x1234;
+   np->id2 = 0x5678;
+   ASSERT_EQ(sock_set_nonblock(sd), 0);
+   ASSERT_EQ(node_reserve(np, 0), VEOK);
+}
+
+int main()
+{
+   ThreadId tid;
+   NODE node, peer;
+   SOCKET sv[2];
+   word64 start, us;
+   int j;
+
+   ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+   prepare(&node, sv[0]);
+   prepare(&peer, sv[1]);
+
+   /* timeouts have sub-second resolution */
+   start = metrics_time();
+   ASSERT_EQ(recv_tx(&node, 0.05), VETIMEOUT);
+   ASSERT_EQ(errno, ETIMEDOUT);
+   us = metrics_time() - start;
+   ASSERT_GE(us, 40000);
+   ASSERT_LT(us, 500000);
+
+   /* round trips are not delayed by polling intervals */
+   ASSERT_EQ(thread_create(&tid, echo, &peer), 0);
+   start = metrics_time();
+   for (j = 0; j < ROUNDS; j++) {
+      put16(node.tx->opcode, OP_TX);
+      put16(node.tx->len, 100);
+      memset(node.tx->buffer, j & 0xff, 100);
+      ASSERT_EQ(send_tx(&node, 1), VEOK);
+      ASSERT_EQ(recv_tx(&node, 1), VEOK);
+      ASSERT_EQ(get16(node.tx->len), 100);
+      ASSERT_EQ(node.tx->buffer[99], j & 0xff);
+   }
+   us = metrics_time() - start;
+   /* previously, at least 10ms per round trip */
+   ASSERT_LT(us, (word64) ROUNDS * 5000);
+
+   /* a closed connection is reported without waiting for timeout */
+   shutdown(node.sd, 2);
+   ASSERT_EQ(thread_join(tid), 0);
+   node_close(&node);
+   node_close(&peer);
+}
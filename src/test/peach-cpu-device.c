@@ -0,0 +1,88 @@
+#include <string.h>
+#include <time.h>
+#include <omp.h>
+
+#include "_assert.h"
+#include "extint.h"
+#include "device.h"
+#include "peach.h"
+
+#define DIFF      8
+#define SOLVES    4
+#define THREADS   4
+
+/* Block 0x1 trailer data taken directly from the Mochimo Blockchain Tfile */
+static word8 Block1[BTSIZE] = {
+   0x00, 0x17, 0x0c, 0x67, 0x11, 0xb9, 0xdc, 0x3c, 0xa7, 0x46,
+   0xc4, 0x6c, 0xc2, 0x81, 0xbc, 0x69, 0xe3, 0x03, 0xdf, 0xad,
+   0x2f, 0x33, 0x3b, 0xa3, 0x97, 0xba, 0x06, 0x1e, 0xcc, 0xef,
+   0xde, 0x03, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+   0xf4, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00,
+   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+   0xf7, 0x2d, 0x1f, 0xae, 0xa8, 0x7f, 0x5b, 0x8f, 0x3c, 0xa9,
+   0xce, 0x6c, 0xdd, 0x5a, 0xe6, 0xf1, 0xb0, 0x81, 0xe5, 0x70,
+   0xc1, 0xf8, 0xe9, 0x63, 0x90, 0xb1, 0x25, 0x38, 0x8e, 0x48,
+   0x46, 0x73, 0x10, 0xf9, 0x01, 0x05, 0xf1, 0x01, 0x26, 0x00,
+   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x56, 0xdf,
+   0x01, 0x11, 0x05, 0x4b, 0xb7, 0x03, 0x01, 0x56, 0x00, 0x00,
+   0x00, 0x00, 0x00, 0x00, 0xb1, 0x0d, 0x31, 0x5b, 0x78, 0x49,
+   0x1f, 0x37, 0xaa, 0xa7, 0x54, 0xef, 0x7d, 0xb8, 0x1a, 0x96,
+   0x42, 0xd4, 0xba, 0x1c, 0xf7, 0x2f, 0x6e, 0x37, 0xff, 0x92,
+   0x99, 0x9a, 0xa0, 0x32, 0x55, 0x51, 0xbc, 0xf1, 0x5f, 0x69
+};
+
+int main()
+{
+   struct timespec ts = { 0, 1000000 };
+   DEVICE_CTX dev;
+   BTRAILER bt, solve;
+   int done = 0;
+   int solves = 0;
+
+   memcpy(&bt, Block1, BTSIZE);
+   bt.difficulty[0] = DIFF;
+
+   /* check CPU device initialization */
+   ASSERT_EQ(init_cpu_devices(&dev, 1, 0), 0);
+   ASSERT_EQ(init_cpu_devices(&dev, 1, THREADS), 1);
+   ASSERT_EQ(dev.type, CPU_DEVICE);
+   ASSERT_EQ(dev.threads, THREADS);
+   ASSERT_EQ(peach_init_cpu_device(&dev, PEACH_MAP_PRIVATE, 1), VEOK);
+   ASSERT_EQ(dev.status, DEV_IDLE);
+
+   #pragma omp parallel num_threads(1 + THREADS)
+   {
+      int stop;
+
+      if (omp_get_thread_num() == 0) {
+         /* scheduler; solve, then change work, until SOLVES */
+         while (solves < SOLVES) {
+            if (peach_solve_cpu(&dev, &bt, 0, &solve) == VEOK) {
+               ASSERT_EQ(dev.status, DEV_WORK);
+               ASSERT_CMP(&solve, &bt, 92);
+               ASSERT_EQ(peach_checkhash(&solve, DIFF, NULL), VEOK);
+               bt.bnum[0]++;
+               solves++;
+            } else nanosleep(&ts, NULL);
+         }
+         ASSERT_NE(dev.work, 0);
+         /* withdraw work, then release solving threads */
+         ASSERT_EQ(peach_solve_cpu(&dev, NULL, 0, &solve), VERROR);
+         ASSERT_EQ(dev.status, DEV_IDLE);
+         #pragma omp atomic write
+            done = 1;
+      } else {
+         /* solving thread */
+         for (stop = 0; !stop; ) {
+            if (peach_work_cpu(&dev) != VEOK) nanosleep(&ts, NULL);
+            #pragma omp atomic read
+               stop = done;
+         }
+      }
+   }
+
+   peach_free_cpu_device(&dev);
+   ASSERT_EQ(dev.status, DEV_NULL);
+   /* uninitialized devices are reported unuseable */
+   ASSERT_EQ(peach_solve_cpu(&dev, &bt, 0, &solve), VETIMEOUT);
+}
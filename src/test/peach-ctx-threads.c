@@ -0,0 +1,97 @@
+
+#include <string.h>
+#include <time.h>
+#include <omp.h>
+
+#include "_assert.h"
+#include "extint.h"
+#include "peach.h"
+
+#define DIFF      8
+#define SOLVES    4
+
+/* Block 0x1 trailer data taken directly from the Mochimo Blockchain Tfile */
+static word8 Block1[BTSIZE] = {
+   0x00, 0x17, 0x0c, 0x67, 0x11, 0xb9, 0xdc, 0x3c, 0xa7, 0x46,
+   0xc4, 0x6c, 0xc2, 0x81, 0xbc, 0x69, 0xe3, 0x03, 0xdf, 0xad,
+   0x2f, 0x33, 0x3b, 0xa3, 0x97, 0xba, 0x06, 0x1e, 0xcc, 0xef,
+   0xde, 0x03, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+   0xf4, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00,
+   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+   0xf7, 0x2d, 0x1f, 0xae, 0xa8, 0x7f, 0x5b, 0x8f, 0x3c, 0xa9,
+   0xce, 0x6c, 0xdd, 0x5a, 0xe6, 0xf1, 0xb0, 0x81, 0xe5, 0x70,
+   0xc1, 0xf8, 0xe9, 0x63, 0x90, 0xb1, 0x25, 0x38, 0x8e, 0x48,
+   0x46, 0x73, 0x10, 0xf9, 0x01, 0x05, 0xf1, 0x01, 0x26, 0x00,
+   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x56, 0xdf,
+   0x01, 0x11, 0x05, 0x4b, 0xb7, 0x03, 0x01, 0x56, 0x00, 0x00,
+   0x00, 0x00, 0x00, 0x00, 0xb1, 0x0d, 0x31, 0x5b, 0x78, 0x49,
+   0x1f, 0x37, 0xaa, 0xa7, 0x54, 0xef, 0x7d, 0xb8, 0x1a, 0x96,
+   0x42, 0xd4, 0xba, 0x1c, 0xf7, 0x2f, 0x6e, 0x37, 0xff, 0x92,
+   0x99, 0x9a, 0xa0, 0x32, 0x55, 0x51, 0xbc, 0xf1, 0x5f, 0x69
+};
+
+static double solve_hps(PEACH_CTX *ctx, BTRAILER *bt, int threads)
+{
+   double start, delta;
+   long hashes = 0;
+   int solves = 0;
+
+   start = omp_get_wtime();
+   #pragma omp parallel num_threads(threads) reduction(+:hashes)
+   {
+      TRIGG_RNG rng;
+      BTRAILER tbt;
+      int done;
+
+      /* disjoint nonce stream per thread */
+      trigg_rng_init(&rng, (word64) time(NULL), omp_get_thread_num());
+      memcpy(&tbt, bt, sizeof(BTRAILER));
+      for (done = 0; !done; hashes++) {
+         if (peach_ctx_solve(ctx, &rng, &tbt, DIFF, tbt.nonce) == VEOK) {
+            /* ensure solution is correct (uncached tile generation) */
+            ASSERT_EQ(peach_checkhash(&tbt, DIFF, NULL), VEOK);
+            #pragma omp atomic
+               solves++;
+         }
+         #pragma omp atomic read
+            done = solves;
+         done = done >= SOLVES;
+      }
+   }
+   delta = omp_get_wtime() - start;
+
+   return delta > 0 ? (double) hashes / delta : 0.0;
+}
+
+int main()
+{
+   PEACH_CTX ctx;
+   BTRAILER bt;
+   double hps1, hpsn;
+   int threads;
+
+   memcpy(&bt, Block1, BTSIZE);
+   bt.difficulty[0] = DIFF;
+   threads = omp_get_num_procs();
+
+   /* check shared map context (single thread) */
+   ASSERT_EQ(peach_ctx_init(&ctx, 1), VEOK);
+   ASSERT_EQ(peach_ctx_work(&ctx, &bt), VEOK);
+   hps1 = solve_hps(&ctx, &bt, 1);
+   /* check shared map context (all threads), with a cleared map */
+   bt.phash[0] ^= 0xff;
+   ASSERT_EQ(peach_ctx_work(&ctx, &bt), VEOK);
+   bt.phash[0] ^= 0xff;
+   ASSERT_EQ(peach_ctx_work(&ctx, &bt), VEOK);
+   hpsn = solve_hps(&ctx, &bt, threads);
+   peach_ctx_free(&ctx);
+
+   /* check context without map (all threads) */
+   ASSERT_EQ(peach_ctx_init(&ctx, 0), VEOK);
+   ASSERT_EQ(peach_ctx_work(&ctx, &bt), VEOK);
+   solve_hps(&ctx, &bt, threads);
+   peach_ctx_free(&ctx);
+
+   printf("Peach mining performance: ~%.02f H/s (1 thread), "
+      "~%.02f H/s (%d threads)\n", hps1, hpsn, threads);
+}
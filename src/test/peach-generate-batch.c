@@ -0,0 +1,75 @@
+
+#include <string.h>
+#include <stdlib.h>
+#include <omp.h>
+
+#include "_assert.h"
+#include "peach.c"
+
+#define NUMTILES  ( (PEACHBATCH * 8) + 3 )  /* includes partial batch */
+
+/* previous block hash, taken from Block 0x1 of the Mochimo Blockchain */
+static word8 Phash[HASHLEN] = {
+   0x00, 0x17, 0x0c, 0x67, 0x11, 0xb9, 0xdc, 0x3c, 0xa7, 0x46,
+   0xc4, 0x6c, 0xc2, 0x81, 0xbc, 0x69, 0xe3, 0x03, 0xdf, 0xad,
+   0x2f, 0x33, 0x3b, 0xa3, 0x97, 0xba, 0x06, 0x1e, 0xcc, 0xef,
+   0xde, 0x03
+};
+
+static word32 Index[NUMTILES];
+static word8 Expect[NUMTILES][PEACHTILELEN];
+static word8 Batch[NUMTILES][PEACHTILELEN];
+
+int main()
+{
+   word8 data[PEACHLANES][PEACHGENLEN + 32], src[PEACHLANES][PEACHGENLEN];
+   word8 hash[SHA256LEN];
+   word8 *in[PEACHLANES], *out[PEACHLANES], pad[PEACHLANES];
+   double start, scalar, batch;
+   int j, k, n;
+
+   /* check multi-lane hashes against scalar hashes, for each lane count;
+    * outputs overlap inputs, as per rows of a tile */
+   for (n = 1; n <= PEACHLANES; n++) {
+      for (k = 0; k < n; k++) {
+         for (j = 0; j < PEACHGENLEN; j++) src[k][j] = (word8) (j * n + k);
+         in[k] = data[k];
+         out[k] = &data[k][32];
+         pad[k] = (k & 1) ? 0x01 : 0x06;
+      }
+      /* SHA256 */
+      for (k = 0; k < n; k++) memcpy(data[k], src[k], PEACHGENLEN);
+      peach_sha256_lanes(in, out, n);
+      for (k = 0; k < n; k++) {
+         sha256(src[k], PEACHGENLEN, hash);
+         ASSERT_CMP(out[k], hash, SHA256LEN);
+      }
+      /* SHA3-256 and Keccak-256, mixed across lanes */
+      for (k = 0; k < n; k++) memcpy(data[k], src[k], PEACHGENLEN);
+      peach_keccak_lanes(in, pad, out, n);
+      for (k = 0; k < n; k++) {
+         if (k & 1) keccak(src[k], PEACHGENLEN, hash, KECCAKLEN256);
+         else sha3(src[k], PEACHGENLEN, hash, SHA3LEN256);
+         ASSERT_CMP(out[k], hash, SHA256LEN);
+      }
+   }
+
+   /* check batch tile generation against scalar tile generation */
+   srand(1);
+   for (j = 0; j < NUMTILES; j++) {
+      Index[j] = ((word32) rand() << 8 ^ (word32) rand()) & PEACHCACHELEN_M1;
+   }
+   start = omp_get_wtime();
+   for (j = 0; j < NUMTILES; j++) peach_generate(Index[j], Phash, Expect[j]);
+   scalar = omp_get_wtime() - start;
+   start = omp_get_wtime();
+   peach_generate_batch(Index, NUMTILES, Phash, (word8 *) Batch);
+   batch = omp_get_wtime() - start;
+   for (j = 0; j < NUMTILES; j++) {
+      ASSERT_CMP(Batch[j], Expect[j], PEACHTILELEN);
+   }
+
+   printf("Peach tile generation: ~%.02f tiles/s (scalar), "
+      "~%.02f tiles/s (batch of %d)\n", NUMTILES / scalar,
+      NUMTILES / batch, PEACHBATCH);
+}
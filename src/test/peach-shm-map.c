@@ -0,0 +1,132 @@
+
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "_assert.h"
+#include "extint.h"
+#include "peach.h"
+
+#define DIFF      8
+#define SOLVES    2
+
+/* Block 0x1 trailer data taken directly from the Mochimo Blockchain Tfile */
+static word8 Block1[BTSIZE] = {
+   0x00, 0x17, 0x0c, 0x67, 0x11, 0xb9, 0xdc, 0x3c, 0xa7, 0x46,
+   0xc4, 0x6c, 0xc2, 0x81, 0xbc, 0x69, 0xe3, 0x03, 0xdf, 0xad,
+   0x2f, 0x33, 0x3b, 0xa3, 0x97, 0xba, 0x06, 0x1e, 0xcc, 0xef,
+   0xde, 0x03, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+   0xf4, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00,
+   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+   0xf7, 0x2d, 0x1f, 0xae, 0xa8, 0x7f, 0x5b, 0x8f, 0x3c, 0xa9,
+   0xce, 0x6c, 0xdd, 0x5a, 0xe6, 0xf1, 0xb0, 0x81, 0xe5, 0x70,
+   0xc1, 0xf8, 0xe9, 0x63, 0x90, 0xb1, 0x25, 0x38, 0x8e, 0x48,
+   0x46, 0x73, 0x10, 0xf9, 0x01, 0x05, 0xf1, 0x01, 0x26, 0x00,
+   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x56, 0xdf,
+   0x01, 0x11, 0x05, 0x4b, 0xb7, 0x03, 0x01, 0x56, 0x00, 0x00,
+   0x00, 0x00, 0x00, 0x00, 0xb1, 0x0d, 0x31, 0x5b, 0x78, 0x49,
+   0x1f, 0x37, 0xaa, 0xa7, 0x54, 0xef, 0x7d, 0xb8, 0x1a, 0x96,
+   0x42, 0xd4, 0xba, 0x1c, 0xf7, 0x2f, 0x6e, 0x37, 0xff, 0x92,
+   0x99, 0x9a, 0xa0, 0x32, 0x55, 0x51, 0xbc, 0xf1, 0x5f, 0x69
+};
+
+/* check shared map segment of phash exists */
+static int shm_exists(const word8 *phash)
+{
+   char name[sizeof(PEACH_SHM_PREFIX) + (HASHLEN * 2)];
+   int fd, j;
+
+   strcpy(name, PEACH_SHM_PREFIX);
+   for (j = 0; j < HASHLEN; j++) {
+      sprintf(name + strlen(name), "%02x", phash[j]);
+   }
+   fd = shm_open(name, O_RDONLY, 0);
+   if (fd == -1) return 0;
+   close(fd);
+
+   return 1;
+}
+
+/* count generated (non-empty) tile flags of a Peach Map */
+static long count_tiles(const word8 *tiles)
+{
+   long j, n;
+
+   for (j = n = 0; j < PEACHCACHELEN; j++) n += (tiles[j] != 0);
+
+   return n;
+}
+
+int main()
+{
+   PEACH_CTX ctxa, ctxb;
+   BTRAILER bt;
+   long tiles;
+   int solves;
+
+   srand16(1, 0, 0);
+   memcpy(&bt, Block1, BTSIZE);
+   bt.difficulty[0] = DIFF;
+
+   /* check shared map is attached on work (separate mappings) */
+   ASSERT_EQ(peach_ctx_init(&ctxa, PEACH_MAP_SHARED), VEOK);
+   ASSERT_EQ(peach_ctx_init(&ctxb, PEACH_MAP_SHARED | PEACH_MAP_HUGE), VEOK);
+   ASSERT_EQ(ctxa.map, NULL);
+   ASSERT_EQ(peach_ctx_work(&ctxa, &bt), VEOK);
+   ASSERT_EQ(peach_ctx_work(&ctxb, &bt), VEOK);
+   ASSERT_NE(ctxa.map, NULL);
+   ASSERT_NE(ctxb.map, NULL);
+   ASSERT_NE(ctxa.map, ctxb.map);
+
+   /* check tiles generated by one context are published to the other */
+   for (solves = 0; solves < SOLVES; ) {
+      if (peach_ctx_solve(&ctxa, NULL, &bt, DIFF, bt.nonce) == VEOK) {
+         ASSERT_EQ(peach_checkhash(&bt, DIFF, NULL), VEOK);
+         solves++;
+      }
+   }
+   ASSERT_GT((tiles = count_tiles(ctxa.tiles)), 0);
+   ASSERT_EQ(count_tiles(ctxb.tiles), tiles);
+   ASSERT_EQ(memcmp(ctxa.map, ctxb.map, PEACHMAPLEN), 0);
+   /* ... and solutions using published tiles are correct */
+   for (solves = 0; solves < SOLVES; ) {
+      if (peach_ctx_solve(&ctxb, NULL, &bt, DIFF, bt.nonce) == VEOK) {
+         ASSERT_EQ(peach_checkhash(&bt, DIFF, NULL), VEOK);
+         solves++;
+      }
+   }
+
+   /* check unchanged phash keeps shared map */
+   ASSERT_EQ(peach_ctx_work(&ctxb, &bt), VEOK);
+   ASSERT_GE(count_tiles(ctxb.tiles), tiles);
+
+   /* check new phash attaches new (empty) shared map */
+   bt.phash[0] ^= 0xff;
+   ASSERT_EQ(peach_ctx_work(&ctxb, &bt), VEOK);
+   ASSERT_EQ(count_tiles(ctxb.tiles), 0);
+   ASSERT_EQ(shm_exists(bt.phash), 1);
+   /* ... keeping the previous segment, for its owner to remove */
+   ASSERT_EQ(shm_exists(Block1), 1);
+   ASSERT_GE(peach_shm_sweep(bt.phash), 1);
+   ASSERT_EQ(shm_exists(Block1), 0);
+   ASSERT_EQ(shm_exists(bt.phash), 1);
+   /* ... while the previous map remains valid for attached contexts */
+   ASSERT_GT(count_tiles(ctxa.tiles), 0);
+
+   /* check stale tile claims are released */
+   ctxb.tiles[7] = ctxb.tiles[9] = 1;  /* PEACH_TILE_CLAIM */
+   ASSERT_EQ(peach_shm_reclaim(bt.phash), 2);
+   ASSERT_EQ(ctxb.tiles[7], 0);
+   ASSERT_EQ(ctxb.tiles[9], 0);
+   ASSERT_EQ(peach_shm_reclaim(Block1), -1);
+
+   /* check free keeps shared map segment, for its owner to remove */
+   peach_ctx_free(&ctxa);
+   peach_ctx_free(&ctxb);
+   ASSERT_EQ(ctxb.map, NULL);
+   ASSERT_EQ(shm_exists(bt.phash), 1);
+   ASSERT_GE(peach_shm_sweep(NULL), 1);
+   ASSERT_EQ(shm_exists(bt.phash), 0);
+}
@@ -0,0 +1,95 @@
+#include <string.h>
+#include <stdlib.h>
+
+#include "_assert.h"
+#include "peach.c"
+
+#define NUMTESTS  4096
+
+/* lengths of Nighthash data; transforms (32, 36) and jumps (1060) */
+static size_t Len[] = { 32, PEACHGENLEN, PEACHJUMPLEN };
+
+/* fill data with random bytes, float specials and Peach's byte 104 */
+static void fill(word8 *data, size_t len)
+{
+   static const word32 special[] = {
+      0x7fc00000, 0xffc00001, 0x7f800000, 0xff800000,
+      0x00000000, 0x80000000, 0x00000001, 0x7f7fffff
+   };
+   size_t j;
+
+   for (j = 0; j < len; j++) data[j] = (word8) rand();
+   for (j = 0; j + 4 <= len; j += 4) {
+      switch (rand() & 15) {
+         case 0: memcpy(&data[j], &special[rand() & 7], 4); break;
+         case 1: data[j + (rand() & 3)] = 104; break;
+      }
+   }
+}
+
+int main()
+{
+   word8 expect[PEACHJUMPLEN], data[PEACHJUMPLEN], src[PEACHJUMPLEN];
+#ifdef PEACH_SIMD_X86
+   word8 avx2[PEACHJUMPLEN];
+#endif
+   word32 eop, op, index;
+   size_t len;
+   int j, n, txf;
+
+   srand(1);
+   for (n = 0; n < NUMTESTS; n++) {
+      len = Len[n % 3];
+      fill(src, len);
+      index = ((word32) rand() << 8 ^ (word32) rand()) & PEACHCACHELEN_M1;
+      txf = n & 1;
+      /* flops, against the scalar reference */
+      memcpy(expect, src, len);
+      eop = peach_dflops_scalar(expect, len, index, txf);
+      memcpy(data, src, len);
+      op = peach_dflops(data, len, index, txf);
+      ASSERT_EQ_MSG(op, eop, "peach_dflops() opcode mismatch");
+      ASSERT_CMP_MSG(data, expect, len, "peach_dflops() data mismatch");
+#ifdef PEACH_SIMD_X86
+      /* each kernel, regardless of dispatch */
+      memcpy(data, src, len);
+      op = peach_dflops_sse2(data, len, index, txf);
+      ASSERT_EQ_MSG(op, eop, "peach_dflops_sse2() opcode mismatch");
+      ASSERT_CMP_MSG(data, expect, len, "peach_dflops_sse2() data mismatch");
+      if (__builtin_cpu_supports("avx2")) {
+         memcpy(data, src, len);
+         op = peach_dflops_avx2(data, len, index, txf);
+         ASSERT_EQ_MSG(op, eop, "peach_dflops_avx2() opcode mismatch");
+         ASSERT_CMP_MSG(data, expect, len, "peach_dflops_avx2() data mismatch");
+      }
+#endif
+      /* memory transforms, every transform in every round (by opcode) */
+      for (j = 0; j < 8; j++) {
+         memcpy(expect, src, len);
+         eop = peach_dmemtx_scalar(expect, len, (word32) (n + j));
+         memcpy(data, src, len);
+         op = peach_dmemtx(data, len, (word32) (n + j));
+         ASSERT_EQ_MSG(op, eop, "peach_dmemtx() opcode mismatch");
+         ASSERT_CMP_MSG(data, expect, len, "peach_dmemtx() data mismatch");
+      }
+   }
+#ifdef PEACH_SIMD_X86
+   /* each memory transform kernel, regardless of dispatch */
+   for (n = 0; n < NUMTESTS; n++) {
+      len = Len[n % 3];
+      fill(src, len);
+      memcpy(expect, src, len);
+      memcpy(data, src, len);
+      memcpy(avx2, src, len);
+      for (j = 0; j < PEACHROUNDS; j++) {
+         peach_dmemtx_tail(expect, len, (unsigned) (n + j) & 7, j, 0);
+         peach_dmemtx_sse2(data, len, (unsigned) (n + j) & 7, j, 0);
+         if (__builtin_cpu_supports("avx2")) {
+            peach_dmemtx_avx2(avx2, len, (unsigned) (n + j) & 7, j);
+         } else peach_dmemtx_tail(avx2, len, (unsigned) (n + j) & 7, j, 0);
+      }
+      ASSERT_CMP_MSG(data, expect, len, "peach_dmemtx_sse2() data mismatch");
+      ASSERT_CMP_MSG(avx2, expect, len, "peach_dmemtx_avx2() data mismatch");
+   }
+#endif
+}
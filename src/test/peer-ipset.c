@@ -0,0 +1,97 @@
+
+#include "_assert.h"
+#include "peer.h"
+
+int main()
+{
+   IPSET set;
+   word32 list[8], ip, count, run, max;
+
+   /* invalid capacity */
+   ASSERT_EQ(ipset_init(&set, 0), VERROR);
+   ASSERT_EQ(ipset_has(&set, 1), 0);
+
+   /* add, find and remove */
+   ASSERT_EQ(ipset_init(&set, 4), VEOK);
+   ASSERT_EQ(ipset_add(&set, 0, 1), 0);
+   ASSERT_EQ(ipset_add(&set, 0x01020304, 1), 0x01020304);
+   ASSERT_EQ(ipset_add(&set, 0x01020304, 1), 0);
+   ASSERT_EQ(ipset_add(&set, 0x05060708, IPSET_FOREVER), 0x05060708);
+   ASSERT_NE(ipset_has(&set, 0x01020304), 0);
+   ASSERT_NE(ipset_has(&set, 0x05060708), 0);
+   ASSERT_EQ(ipset_has(&set, 0x090a0b0c), 0);
+   ASSERT_EQ(ipset_list(&set, list, 8), 2);
+   ASSERT_EQ(ipset_remove(&set, 0x05060708), 0x05060708);
+   ASSERT_EQ(ipset_remove(&set, 0x05060708), 0);
+   ASSERT_EQ(ipset_has(&set, 0x05060708), 0);
+   ASSERT_EQ(ipset_add(&set, 0x05060708, 3), 0x05060708);
+
+   /* entries expire with their epoch, and may be extended */
+   ASSERT_EQ(ipset_add(&set, 0x090a0b0c, 1), 0x090a0b0c);
+   ASSERT_EQ(ipset_add(&set, 0x090a0b0c, 2), 0);
+   ipset_advance(&set);
+   ASSERT_EQ(ipset_has(&set, 0x01020304), 0);
+   ASSERT_NE(ipset_has(&set, 0x05060708), 0);
+   ASSERT_NE(ipset_has(&set, 0x090a0b0c), 0);
+   ipset_advance(&set);
+   ASSERT_EQ(ipset_has(&set, 0x090a0b0c), 0);
+   ASSERT_EQ(ipset_list(&set, list, 8), 1);
+   ASSERT_EQ(list[0], 0x05060708);
+   ipset_free(&set);
+
+   /* expired entries are reclaimed; live entries are never dropped */
+   ASSERT_EQ(ipset_init(&set, 100), VEOK);
+   for (ip = 1; ip <= 10000; ip++) {
+      if ((ip % 50) == 1) ipset_advance(&set);
+      ipset_add(&set, ip, 1);
+   }
+   for (ip = 9951; ip <= 10000; ip++) ASSERT_NE(ipset_has(&set, ip), 0);
+   ASSERT_EQ(ipset_has(&set, 9950), 0);
+   ASSERT_LE(set.used, set.mask);
+   for (count = 0, ip = 20001; ip <= 21000; ip++) {
+      if (ipset_add(&set, ip, IPSET_FOREVER)) count++;
+   }
+   ASSERT_GE(count + 50, 100);
+   ASSERT_LT(count, 1000);
+   ASSERT_EQ(errno, ENOSPC);
+   for (ip = 20001; ip < 20001 + count; ip++) {
+      ASSERT_NE(ipset_has(&set, ip), 0);
+   }
+   ipset_free(&set);
+
+   /* addresses of one network spread across the table; the hosts of
+    * 52.0.0.0/11, in network order, differ only in their high bits */
+   ASSERT_EQ(ipset_init(&set, 4096), VEOK);
+   for (ip = 0; ip < 3000; ip++) {
+      count = (ip * 0x2f1b) & 0x1fffff;
+      ASSERT_NE(ipset_add(&set, 52 | (count >> 16) << 8 |
+         ((count >> 8) & 0xff) << 16 | (count & 0xff) << 24, 1), 0);
+   }
+   /* ... with no long probe sequences */
+   for (max = run = ip = 0; ip <= set.mask; ip++) {
+      run = set.entry[ip].ip ? run + 1 : 0;
+      if (run > max) max = run;
+   }
+   ASSERT_LT(max, 64);
+   ipset_free(&set);
+
+   /* pinklist expires with epochs */
+   ip = 0x08080808;
+   ASSERT_EQ(pinklisted(ip), 0);
+   epinklist(ip);
+   ASSERT_NE(pinklisted(ip), 0);
+   Nopinklist = 1;
+   ASSERT_EQ(pinklisted(ip), 0);
+   Nopinklist = 0;
+   purge_epoch();
+   ASSERT_EQ(pinklisted(ip), 0);
+   pinklist(ip);
+   for (count = 0; count < PINKEPOCHS - 1; count++) purge_epoch();
+   ASSERT_NE(pinklisted(ip), 0);
+   purge_epoch();
+   ASSERT_EQ(pinklisted(ip), 0);
+   /* private ip's are never pinklisted */
+   ip = 0x0100007f;
+   epinklist(ip);
+   ASSERT_EQ(pinklisted(ip), 0);
+}
@@ -0,0 +1,67 @@
+
+#include "_assert.h"
+#include "pstat.h"
+#include <stdio.h>
+
+#define FAST   0x01010101
+#define SLOW   0x02020202
+#define FAILS  0x03030303
+#define NEW    0x04040404
+
+int main()
+{
+   word32 list[5] = { FAILS, NEW, SLOW, FAST, 0 };
+   PSTAT ps;
+
+   /* observations are ignored before init */
+   pstat_call(FAST, 1, 10);
+   ASSERT_EQ(pstat_get(FAST, &ps), VERROR);
+   ASSERT_EQ(pstat_cost(FAST), PSTAT_UNKNOWN);
+   ASSERT_EQ(pstat_init(), VEOK);
+
+   /* calls and transfers are smoothed */
+   pstat_call(FAST, 1, 10);
+   pstat_call(FAST, 1, 30);
+   pstat_xfer(FAST, 1, 1000000, 100);
+   ASSERT_EQ(pstat_get(FAST, &ps), VEOK);
+   ASSERT_EQ(ps.rtt, 15);
+   ASSERT_EQ(ps.rate, 10000000);
+   ASSERT_EQ(ps.fails, 0);
+   ASSERT_NE(ps.lastseen, 0);
+   /* small transfers do not measure rate */
+   pstat_xfer(FAST, 1, 100, 100);
+   ASSERT_EQ(pstat_get(FAST, &ps), VEOK);
+   ASSERT_EQ(ps.rate, 10000000);
+   pstat_call(SLOW, 1, 200);
+   pstat_xfer(SLOW, 1, 65536, 10000);
+   pstat_call(FAILS, 1, 5);
+   pstat_call(FAILS, 0, 0);
+   pstat_xfer(FAILS, 0, 0, 0);
+   ASSERT_EQ(pstat_get(FAILS, &ps), VEOK);
+   ASSERT_EQ(ps.fails, 2);
+
+   /* peers are ordered by cost, and slow peers are not preferred */
+   ASSERT_LT(pstat_cost(FAST), pstat_cost(NEW));
+   ASSERT_LT(pstat_cost(NEW), pstat_cost(SLOW));
+   ASSERT_EQ(pstat_select(list, 5), 2);
+   ASSERT_EQ(list[0], FAST);
+   ASSERT_EQ(list[1], NEW);
+   ASSERT_EQ(list[2], SLOW);
+   ASSERT_EQ(list[3], FAILS);
+   ASSERT_EQ(list[4], 0);
+   /* a success clears failures */
+   pstat_call(FAILS, 1, 5);
+   ASSERT_LT(pstat_cost(FAILS), pstat_cost(NEW));
+
+   /* statistics persist */
+   ASSERT_EQ(pstat_save("pstat.tmp"), VEOK);
+   pstat_free();
+   ASSERT_EQ(pstat_init(), VEOK);
+   ASSERT_EQ(pstat_get(FAST, &ps), VERROR);
+   ASSERT_EQ(pstat_load("pstat.tmp"), 3);
+   ASSERT_EQ(pstat_get(FAST, &ps), VEOK);
+   ASSERT_EQ(ps.rtt, 15);
+   ASSERT_EQ(ps.rate, 10000000);
+   remove("pstat.tmp");
+   pstat_free();
+}
@@ -0,0 +1,145 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include "_assert.h"
+#include "snapshot.h"
+#include "ledger.h"
+#include "tfile.h"
+#include "sha256.h"
+
+#define NGBLOCK      "snapshot-ng.dat"
+#define NGCOPY       "snapshot-ng.copy"
+#define SNAPFILE     "snapshot.dat"
+#define LEDGER       "ledger.dat"
+#define TFILE        "tfile.dat"
+#define NLEDGER      ( LEBUFCOUNT + 1000 )  /* more than one read */
+
+static LENTRY Ledger[NLEDGER];
+static word8 Mtree[NLEDGER][HASHLEN];
+
+static void write_file(const char *fname, const void *data, size_t len)
+{
+   FILE *fp;
+
+   ASSERT_NE((fp = fopen(fname, "wb")), NULL);
+   ASSERT_EQ(fwrite(data, len, 1, fp), 1);
+   fclose(fp);
+}
+
+static void check_file(const char *fname, const void *data, size_t len)
+{
+   FILE *fp;
+   word8 *buf;
+
+   ASSERT_NE((buf = malloc(len + 1)), NULL);
+   ASSERT_NE((fp = fopen(fname, "rb")), NULL);
+   ASSERT_EQ(fread(buf, 1, len + 1, fp), len);
+   fclose(fp);
+   ASSERT_CMP(buf, data, len);
+   free(buf);
+}
+
+static void check_same(const char *fname, const char *expect)
+{
+   FILE *fp;
+   word8 *buf;
+   long len;
+
+   ASSERT_NE((fp = fopen(expect, "rb")), NULL);
+   ASSERT_EQ(fseek(fp, 0L, SEEK_END), 0);
+   ASSERT_GT((len = ftell(fp)), 0);
+   rewind(fp);
+   ASSERT_NE((buf = malloc((size_t) len)), NULL);
+   ASSERT_EQ(fread(buf, (size_t) len, 1, fp), 1);
+   fclose(fp);
+   check_file(fname, buf, (size_t) len);
+   free(buf);
+}
+
+static void write_tfile(const BTRAILER *bt, size_t count)
+{
+   BTRAILER tf[257];
+
+   memset(tf, 0, sizeof(tf));
+   memcpy(&tf[256], bt, sizeof(BTRAILER));
+   write_file(TFILE, tf, count * sizeof(BTRAILER));
+}
+
+int main()
+{
+   NGHEADER ngh;
+   BTRAILER bt;
+   FILE *fp;
+   size_t j;
+
+   /* build sorted dummy ledger and neogenesis trailer (0x100) */
+   srand(1);
+   for (j = 0; j < NLEDGER; j++) {
+      for (int k = 0; k < ADDR_LEN; k++) Ledger[j].addr[k] = (word8) rand();
+      put32(Ledger[j].balance, (word32) j);
+   }
+   qsort(Ledger, NLEDGER, sizeof(LENTRY), addr_compare);
+   for (j = 0; j < NLEDGER; j++) sha256(&Ledger[j], sizeof(LENTRY), Mtree[j]);
+   memset(&bt, 0, sizeof(bt));
+   bt.bnum[1] = 1;
+   merkle_root((word8 *) Mtree, NLEDGER, bt.mroot);
+   for (j = 0; j < HASHLEN; j++) bt.bhash[j] = (word8) rand();
+
+   /* write neogenesis block and matching tfile */
+   put32(ngh.hdrlen, sizeof(NGHEADER));
+   put64(ngh.lbytes, CL64_32(sizeof(Ledger)));
+   ASSERT_NE((fp = fopen(NGBLOCK, "wb")), NULL);
+   ASSERT_EQ(fwrite(&ngh, sizeof(ngh), 1, fp), 1);
+   ASSERT_EQ(fwrite(Ledger, sizeof(Ledger), 1, fp), 1);
+   ASSERT_EQ(fwrite(&bt, sizeof(bt), 1, fp), 1);
+   fclose(fp);
+   write_tfile(&bt, 257);
+
+   /* check export, and import reproduces ledger and neogenesis block */
+   ASSERT_EQ(snap_export(NGBLOCK, SNAPFILE), VEOK);
+   ASSERT_EQ(snap_import(SNAPFILE, NGCOPY, LEDGER), VEOK);
+   check_file(LEDGER, Ledger, sizeof(Ledger));
+   check_same(NGCOPY, NGBLOCK);
+   remove(NGCOPY);
+   ASSERT_EQ(snap_import(SNAPFILE, NULL, LEDGER), VEOK);
+   ASSERT_EQ(fopen(NGCOPY, "rb"), NULL);
+
+   /* check snapshot trailer must exist in tfile */
+   write_tfile(&bt, 256);
+   ASSERT_EQ(snap_import(SNAPFILE, NGCOPY, LEDGER), VERROR);
+   ASSERT_EQ(errno, EMCM_EOF);
+   /* check snapshot trailer must match tfile -- outputs removed */
+   bt.bhash[0] ^= 0xff;
+   write_tfile(&bt, 257);
+   bt.bhash[0] ^= 0xff;
+   ASSERT_EQ(snap_import(SNAPFILE, NGCOPY, LEDGER), VEBAD2);
+   ASSERT_EQ(errno, EMCM_TRAILER);
+
+   /* check tampered ledger entry is detected by merkle root */
+   write_tfile(&bt, 257);
+   ASSERT_NE((fp = fopen(SNAPFILE, "r+b")), NULL);
+   ASSERT_EQ(fseek(fp, (long) (sizeof(SNAPHEADER) + sizeof(LENTRY) * 5000
+      + ADDR_LEN), SEEK_SET), 0);
+   ASSERT_EQ(fputc(0xff, fp), 0xff);
+   fclose(fp);
+   ASSERT_EQ(snap_import(SNAPFILE, NGCOPY, LEDGER), VEBAD2);
+   ASSERT_EQ(errno, EMCM_MROOT);
+   ASSERT_EQ(fopen(LEDGER, "rb"), NULL);
+   ASSERT_EQ(fopen(NGCOPY, "rb"), NULL);
+
+   /* check truncated snapshot */
+   ASSERT_EQ(snap_export(NGBLOCK, SNAPFILE), VEOK);
+   ASSERT_NE((fp = fopen(SNAPFILE, "ab")), NULL);
+   ASSERT_EQ(fputc(0, fp), 0);
+   fclose(fp);
+   ASSERT_EQ(snap_import(SNAPFILE, NGCOPY, LEDGER), VERROR);
+   ASSERT_EQ(errno, EMCM_FILELEN);
+
+   /* cleanup */
+   remove(NGBLOCK);
+   remove(NGCOPY);
+   remove(SNAPFILE);
+   remove(LEDGER);
+   remove(TFILE);
+}
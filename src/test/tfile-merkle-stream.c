@@ -0,0 +1,63 @@
+
+#include <stdlib.h>
+#include <errno.h>
+#include "_assert.h"
+#include "tfile.h"
+
+#define MAXLEAVES ( (MERKLE_BATCH * 8) + 3 )
+
+static word8 Data[MAXLEAVES][48];
+static word8 Hashlist[MAXLEAVES][HASHLEN];
+
+static void check_count(size_t count)
+{
+   MERKLE_CTX ctx;
+   word8 expect[HASHLEN], root[HASHLEN];
+   size_t j;
+
+   merkle_root((word8 *) Hashlist, count, expect);
+   /* check streaming root by leaf hash */
+   merkle_init(&ctx, count);
+   for (j = 0; j < count; j++) merkle_leaf(&ctx, Hashlist[j]);
+   ASSERT_EQ(merkle_final(&ctx, root), VEOK);
+   ASSERT_CMP(root, expect, HASHLEN);
+   /* check streaming root by (uneven) chunks of data items */
+   merkle_init(&ctx, count);
+   for (j = 0; j < count; j += 777) {
+      merkle_leaves(&ctx, Data[j], sizeof(Data[0]),
+         (count - j) < 777 ? (count - j) : 777);
+   }
+   ASSERT_EQ(merkle_final(&ctx, root), VEOK);
+   ASSERT_CMP(root, expect, HASHLEN);
+}
+
+int main()
+{
+   MERKLE_CTX ctx;
+   word8 root[HASHLEN];
+   size_t j;
+
+   /* build dummy data and leaf hashes */
+   srand(1);
+   for (j = 0; j < MAXLEAVES; j++) {
+      for (size_t k = 0; k < sizeof(Data[0]); k++) Data[j][k] = (word8) rand();
+      sha256(Data[j], sizeof(Data[0]), Hashlist[j]);
+   }
+
+   /* check streaming merkle root matches merkle_root() split rule */
+   for (j = 1; j <= 300; j++) check_count(j);
+   check_count(MERKLE_BATCH);
+   check_count(MERKLE_BATCH + 1);
+   check_count(MAXLEAVES);
+
+   /* check incorrect number of leaves */
+   merkle_init(&ctx, 0);
+   ASSERT_EQ(merkle_final(&ctx, root), VERROR);
+   ASSERT_EQ(errno, EINVAL);
+   merkle_init(&ctx, 3);
+   merkle_leaf(&ctx, Hashlist[0]);
+   merkle_leaf(&ctx, Hashlist[1]);
+   ASSERT_EQ(merkle_final(&ctx, root), VERROR);
+   merkle_leaves(&ctx, Data[2], sizeof(Data[0]), 2);
+   ASSERT_EQ(merkle_final(&ctx, root), VERROR);
+}
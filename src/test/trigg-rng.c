@@ -0,0 +1,75 @@
+#include <string.h>
+#include "_assert.h"
+#include "extint.h"
+#include "trigg.h"
+
+/* Philox4x32-10 known answers (Random123 kat_vectors) */
+static word32 Kat[3][10] = {
+   {  /* counter[4], key[2] -> output[4] */
+      0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+      0x00000000, 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8
+   }, {
+      0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+      0xffffffff, 0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd
+   }, {
+      0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344, 0xa4093822,
+      0x299f31d0, 0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1
+   }
+};
+
+int main()
+{  /* check trigg_rng32() and trigg_generate_fast_r() */
+   TRIGG_RNG rng, rng2;
+   word8 halfnonce[16], halfnonce2[16];
+   word32 v;
+   int j, k, same;
+
+   /* check Philox4x32-10 known answers */
+   for (j = 0; j < 3; j++) {
+      trigg_rng_init(&rng, 0, 0);
+      memcpy(rng.ctr, Kat[j], sizeof(rng.ctr));
+      memcpy(rng.key, &Kat[j][4], sizeof(rng.key));
+      for (k = 0; k < 4; k++) ASSERT_EQ(trigg_rng32(&rng), Kat[j][6 + k]);
+   }
+
+   /* check seed and stream placement */
+   trigg_rng_init(&rng, WORD64_C(0x0370734413198a2e),
+      WORD64_C(0x299f31d0a4093822));
+   ASSERT_CMP(&rng.ctr[2], &Kat[2][2], 8);
+   ASSERT_CMP(rng.key, &Kat[2][4], 8);
+   rng.ctr[0] = Kat[2][0];
+   rng.ctr[1] = Kat[2][1];
+   for (k = 0; k < 4; k++) ASSERT_EQ(trigg_rng32(&rng), Kat[2][6 + k]);
+   /* check 64-bit block counter carry */
+   rng.ctr[0] = 0xffffffff;
+   rng.ctr[1] = 5;
+   trigg_rng32(&rng);
+   ASSERT_EQ(rng.ctr[0], 0);
+   ASSERT_EQ(rng.ctr[1], 6);
+
+   /* check streams of a seed are independent */
+   trigg_rng_init(&rng, 1, 0);
+   trigg_rng_init(&rng2, 1, 1);
+   for (same = j = 0; j < 1000; j++) {
+      same += (trigg_rng32(&rng) == trigg_rng32(&rng2));
+   }
+   ASSERT_LT(same, 2);
+   /* ... and generators of equal seed and stream are identical */
+   trigg_rng_init(&rng, 1, 7);
+   trigg_rng_init(&rng2, 1, 7);
+   for (j = 0; j < 1000; j++) {
+      v = trigg_rng32(&rng);
+      ASSERT_EQ(trigg_rng32(&rng2), v);
+   }
+
+   /* check trigg_generate_fast_r() produces expected syntax */
+   trigg_rng_init(&rng, 2, 0);
+   trigg_rng_init(&rng2, 2, 1);
+   for (same = j = 0; j < 1000000; j++) {
+      trigg_generate_fast_r(&rng, halfnonce);
+      ASSERT_EQ(trigg_syntax(halfnonce), VEOK);
+      trigg_generate_fast_r(&rng2, halfnonce2);
+      same += (memcmp(halfnonce, halfnonce2, 16) == 0);
+   }
+   ASSERT_LT(same, 10);
+}
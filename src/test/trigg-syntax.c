@@ -0,0 +1,198 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "_assert.h"
+#include "trigg.c"
+
+/* automaton states and token classes, as (re)built from Frame[] */
+static word8 Class[MAXDICT], Rep[TSYNTAX_CLASSES];
+static word8 Next[TSYNTAX_STATES][TSYNTAX_CLASSES];
+static word32 Mask[TSYNTAX_STATES];
+static int Pos[TSYNTAX_STATES];
+
+/* frame unification, as per the original trigg_syntax() */
+static int frame_syntax(const word8 *np)
+{
+   word32 sf[MAXH], *fp;
+   int j;
+
+   for (j = 0; j < MAXH; j++) sf[j] = Dict[np[j]].fe;
+   for (fp = &Frame[0][0]; fp < &Frame[NFRAMES][0]; fp += MAXH) {
+      for (j = 0; j < MAXH; j++) {
+         if (fp[j] == 0) {
+            if (sf[j] == 0) return VEOK;
+            break;
+         }
+         if (fp[j] & F_XLIT) {
+            if ((fp[j] & 255) != np[j]) break;
+            continue;
+         }
+         if ((sf[j] & fp[j]) == 0) break;
+      }
+      if (j >= MAXH) return VEOK;
+   }
+
+   return VERROR;
+}
+
+static int frame_len(int f)
+{
+   int j;
+
+   for (j = 0; j < MAXH && Frame[f][j]; j++);
+
+   return j;
+}
+
+static int frame_match(int f, int j, int tok)
+{
+   if (Frame[f][j] & F_XLIT) return (int) (Frame[f][j] & 255) == tok;
+   return (Dict[tok].fe & Frame[f][j]) != 0;
+}
+
+/* tokens are of one class where they match the same frame elements */
+static int same_class(int a, int b)
+{
+   int f, j;
+
+   if ((Dict[a].fe == 0) != (Dict[b].fe == 0)) return 0;
+   for (f = 0; f < NFRAMES; f++) {
+      for (j = frame_len(f) - 1; j >= 0; j--) {
+         if (frame_match(f, j, a) != frame_match(f, j, b)) return 0;
+      }
+   }
+
+   return 1;
+}
+
+/* build automaton; states are sets of live frames at a position */
+static void build(void)
+{
+   word32 live;
+   int c, f, j, n, s, t, u, accept, states, classes;
+
+   for (classes = t = 0; t < MAXDICT; t++) {
+      for (u = 0; u < t && !same_class(t, u); u++);
+      if (u < t) Class[t] = Class[u];
+      else {
+         ASSERT_LT(classes, TSYNTAX_CLASSES);
+         Rep[classes] = (word8) t;
+         Class[t] = (word8) classes++;
+      }
+   }
+   ASSERT_EQ(classes, TSYNTAX_CLASSES);
+   Pos[TSYNTAX_START] = 0;
+   Mask[TSYNTAX_START] = (1u << NFRAMES) - 1;
+   for (states = s = TSYNTAX_START; s <= states; s++) {
+      for (c = 0; c < TSYNTAX_CLASSES; c++) {
+         t = Rep[c];
+         j = Pos[s];
+         live = 0;
+         accept = 0;
+         for (f = 0; f < NFRAMES; f++) {
+            if ((Mask[s] & (1u << f)) == 0) continue;
+            if (frame_len(f) == j) accept |= (Dict[t].fe == 0);
+            else if (frame_match(f, j, t)) live |= 1u << f;
+         }
+         if (accept || (live && j + 1 == MAXH)) n = TSYNTAX_ACCEPT;
+         else if (live == 0) n = TSYNTAX_REJECT;
+         else {
+            for (n = TSYNTAX_START + 1; n <= states; n++) {
+               if (Pos[n] == j + 1 && Mask[n] == live) break;
+            }
+            if (n > states) {
+               ASSERT_LT(n, TSYNTAX_STATES);
+               Pos[n] = j + 1;
+               Mask[n] = live;
+               states = n;
+            }
+         }
+         Next[s][c] = (word8) n;
+      }
+   }
+   ASSERT_EQ(states + 1, TSYNTAX_STATES);
+}
+
+/* print automaton tables, for replacement of those in trigg.c */
+static void print_tables(void)
+{
+   int c, s, t;
+
+   printf("static const word8 Tclass[MAXDICT] = {");
+   for (t = 0; t < MAXDICT; t++) {
+      printf("%s%2d", t == 0 ? "\n   " : (t & 15) ? ", " : ",\n   ",
+         Class[t]);
+   }
+   printf("\n};\n\nstatic const word8 Tsyntax[TSYNTAX_STATES][TSYNTAX_CLASSES]"
+      " = {\n   { 0 }, { 0 },  /* TSYNTAX_REJECT, TSYNTAX_ACCEPT */\n");
+   for (s = TSYNTAX_START; s < TSYNTAX_STATES; s++) {
+      for (c = 0; c < TSYNTAX_CLASSES; c++) {
+         printf("%s%2d", c == 0 ? "   { " : (c % 14) ? ", " : ",\n     ",
+            Next[s][c]);
+      }
+      printf(s + 1 < TSYNTAX_STATES ? " },\n" : " }\n");
+   }
+   printf("};\n");
+   fflush(stdout);
+}
+
+/* check every path of token classes through the automaton */
+static long walk(word8 *np, int s, int j)
+{
+   long paths = 0;
+   int c, n, expect;
+
+   for (c = 0; c < TSYNTAX_CLASSES; c++) {
+      np[j] = Rep[c];
+      memset(np + j + 1, 0, MAXH - j - 1);
+      n = Next[s][c];
+      if (n == TSYNTAX_ACCEPT || n == TSYNTAX_REJECT) {
+         expect = (n == TSYNTAX_ACCEPT) ? VEOK : VERROR;
+         ASSERT_EQ(frame_syntax(np), expect);
+         ASSERT_EQ(trigg_syntax(np), expect);
+         /* trailing tokens are irrelevant once decided */
+         memset(np + j + 1, 0xff, MAXH - j - 1);
+         ASSERT_EQ(frame_syntax(np), expect);
+         ASSERT_EQ(trigg_syntax(np), expect);
+         paths++;
+      } else paths += walk(np, n, j + 1);
+   }
+
+   return paths;
+}
+
+int main()
+{
+   word8 nonce[MAXH];
+   long paths;
+   int j, k;
+
+   /* check tables in trigg.c match those built from Frame[] */
+   build();
+   if (memcmp(Class, Tclass, sizeof(Class)) != 0 ||
+         memcmp(&Next[TSYNTAX_START], &Tsyntax[TSYNTAX_START],
+            sizeof(Next[0]) * (TSYNTAX_STATES - TSYNTAX_START)) != 0) {
+      print_tables();
+      ASSERT_EQ_MSG(0, 1, "automaton tables do not match Frame[]");
+   }
+
+   /* check token classes match frames alike, for every token */
+   for (j = 0; j < MAXDICT; j++) {
+      ASSERT_EQ(same_class(j, Rep[Class[j]]), 1);
+   }
+
+   /* check equivalence on every path of token classes */
+   paths = walk(nonce, TSYNTAX_START, 0);
+   ASSERT_GT(paths, 0);
+
+   /* check equivalence on generated and (mostly) random tokens */
+   srand16(1, 0, 0);
+   for (j = 0; j < 1000000; j++) {
+      trigg_generate(nonce);
+      ASSERT_EQ(trigg_syntax(nonce), VEOK);
+      nonce[rand16() % MAXH] = (word8) rand16();
+      ASSERT_EQ(trigg_syntax(nonce), frame_syntax(nonce));
+      for (k = 0; k < MAXH; k++) nonce[k] = (word8) rand16();
+      ASSERT_EQ(trigg_syntax(nonce), frame_syntax(nonce));
+   }
+}
@@ -0,0 +1,118 @@
+
+#include "_assert.h"
+#include "workq.h"
+#include "global.h"
+#include "exttime.h"
+#include <string.h>
+#include <sys/socket.h>
+
+static volatile int Blocked;
+
+/* request handler; status by opcode, OP_GET_BLOCK waits on its socket */
+static int handler(NODE *np)
+{
+   char c;
+
+   switch (get16(np->tx->opcode)) {
+      case OP_GET_BLOCK:
+         __atomic_store_n(&Blocked, 1, __ATOMIC_RELAXED);
+         if (recv(np->sd, &c, 1, 0) <= 0) return VERROR;
+         return VEOK;
+      case OP_TF: return VEBAD2;
+      default: return VEOK;
+   }
+}
+
+/* prepare a request node, on one end of a socket pair */
+static void request(NODE *np, SOCKET *peer, word16 opcode, word32 ip)
+{
+   SOCKET sv[2];
+
+   ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+   memset(np, 0, sizeof(NODE));
+   np->sd = sv[0];
+   np->ip = ip;
+   np->tx = pkt_alloc(0);
+   ASSERT_NE(np->tx, NULL);
+   put16(np->tx->opcode, opcode);
+   np->tx->version[1] = C_OPTIN;
+   *peer = sv[1];
+}
+
+/* collect a completion record, waiting up to a second */
+static int collect(WORKQ_DONE *done)
+{
+   int n;
+
+   for (n = 0; n < 100; n++) {
+      if (workq_collect(done)) return 1;
+      millisleep(10);
+   }
+
+   return 0;
+}
+
+int main()
+{
+   WORKQ_DONE done;
+   NODE node;
+   SOCKET peer[3];
+   int n;
+
+   /* no worker queue */
+   request(&node, &peer[0], OP_TF, 0x01020304);
+   ASSERT_EQ(workq_submit(&node, 0), VERROR);
+   ASSERT_NE(node.tx, NULL);
+   ASSERT_EQ(workq_init(0, 2, handler), VERROR);
+   ASSERT_EQ(workq_init(1, 2, NULL), VERROR);
+   ASSERT_EQ(workq_init(1, 2, handler), VEOK);
+   ASSERT_EQ(workq_init(1, 2, handler), VERROR);
+
+   /* completion records report handler status */
+   ASSERT_EQ(workq_submit(&node, 1), VEOK);
+   ASSERT_EQ(node.tx, NULL);
+   ASSERT_EQ(node.sd, INVALID_SOCKET);
+   ASSERT_EQ(collect(&done), 1);
+   ASSERT_EQ(done.status, VEBAD2);
+   ASSERT_EQ(done.opcode, OP_TF);
+   ASSERT_EQ(done.ip, 0x01020304);
+   ASSERT_NE(done.optin, 0);
+   ASSERT_EQ(done.start, 1);
+   ASSERT_EQ(Nonline, 0);
+   ASSERT_EQ(workq_collect(&done), 0);
+   sock_close(peer[0]);
+
+   /* a running job, a queued job, and a full queue */
+   request(&node, &peer[0], OP_GET_BLOCK, 1);
+   ASSERT_EQ(workq_submit(&node, 0), VEOK);
+   for (n = 0; n < 100 && !Blocked; n++) millisleep(10);
+   ASSERT_EQ(Blocked, 1);
+   request(&node, &peer[1], OP_HELLO, 2);
+   ASSERT_EQ(workq_submit(&node, 0), VEOK);
+   ASSERT_EQ(Nonline, 2);
+   request(&node, &peer[2], OP_HELLO, 3);
+   ASSERT_EQ(workq_submit(&node, 0), VERROR);
+   ASSERT_EQ(errno, EAGAIN);
+   node_close(&node);
+
+   /* abort cancels queued jobs, and unblocks running jobs */
+   workq_abort();
+   ASSERT_EQ(workq_collect(&done), 1);
+   ASSERT_EQ(done.ip, 2);
+   ASSERT_EQ(done.status, VERROR);
+   ASSERT_EQ(done.errnum, ECANCELED);
+   ASSERT_EQ(workq_collect(&done), 1);
+   ASSERT_EQ(done.ip, 1);
+   ASSERT_EQ(done.opcode, OP_GET_BLOCK);
+   ASSERT_EQ(done.status, VERROR);
+   ASSERT_EQ(workq_collect(&done), 0);
+   ASSERT_EQ(Nonline, 0);
+   for (n = 0; n < 3; n++) sock_close(peer[n]);
+
+   /* worker queue is reusable after release */
+   workq_free();
+   workq_free();
+   ASSERT_EQ(workq_collect(&done), 0);
+   ASSERT_EQ(workq_init(2, 4, handler), VEOK);
+   workq_free();
+}
@@ -0,0 +1,117 @@
+
+#include <string.h>
+
+#include "_assert.h"
+#include "wserv.h"
+#include "peach.h"
+#include "extinet.h"
+#include "extlib.h"
+#include "exttime.h"
+
+#define PORT   2197
+#define DIFF   8
+
+/* Block 0x1 trailer data taken directly from the Mochimo Blockchain Tfile */
+static word8 Block1[BTSIZE] = {
+   0x00, 0x17, 0x0c, 0x67, 0x11, 0xb9, 0xdc, 0x3c, 0xa7, 0x46,
+   0xc4, 0x6c, 0xc2, 0x81, 0xbc, 0x69, 0xe3, 0x03, 0xdf, 0xad,
+   0x2f, 0x33, 0x3b, 0xa3, 0x97, 0xba, 0x06, 0x1e, 0xcc, 0xef,
+   0xde, 0x03, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+   0xf4, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00,
+   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+   0xf7, 0x2d, 0x1f, 0xae, 0xa8, 0x7f, 0x5b, 0x8f, 0x3c, 0xa9,
+   0xce, 0x6c, 0xdd, 0x5a, 0xe6, 0xf1, 0xb0, 0x81, 0xe5, 0x70,
+   0xc1, 0xf8, 0xe9, 0x63, 0x90, 0xb1, 0x25, 0x38, 0x8e, 0x48,
+   0x46, 0x73, 0x10, 0xf9, 0x01, 0x05, 0xf1, 0x01, 0x26, 0x00,
+   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x56, 0xdf,
+   0x01, 0x11, 0x05, 0x4b, 0xb7, 0x03, 0x01, 0x56, 0x00, 0x00,
+   0x00, 0x00, 0x00, 0x00, 0xb1, 0x0d, 0x31, 0x5b, 0x78, 0x49,
+   0x1f, 0x37, 0xaa, 0xa7, 0x54, 0xef, 0x7d, 0xb8, 0x1a, 0x96,
+   0x42, 0xd4, 0xba, 0x1c, 0xf7, 0x2f, 0x6e, 0x37, 0xff, 0x92,
+   0x99, 0x9a, 0xa0, 0x32, 0x55, 0x51, 0xbc, 0xf1, 0x5f, 0x69
+};
+
+/* poll the work server until the subscriber receives a message */
+static int recv_polled(SOCKET sd, WSERV_MSG *msg)
+{
+   int ecode, n;
+
+   for (n = 0; n < 100; n++) {
+      wserv_poll();
+      ecode = wserv_recv(sd, msg, 0);
+      if (ecode != VETIMEOUT) return ecode;
+      millisleep(10);
+   }
+
+   return VETIMEOUT;
+}
+
+int main()
+{
+   WSERV_MSG msg, work;
+   BTRAILER bt, mbt;
+   SOCKET sd;
+   FILE *fp;
+
+   /* candidate block (trailer only) */
+   memcpy(&bt, Block1, BTSIZE);
+   bt.difficulty[0] = DIFF;
+   memset(bt.nonce, 0, HASHLEN);
+   remove("mblock.dat");
+   fp = fopen("cblock.dat", "wb");
+   ASSERT_NE(fp, NULL);
+   ASSERT_EQ(fwrite(&bt, sizeof(bt), 1, fp), 1);
+   fclose(fp);
+
+   sock_startup();
+   ASSERT_EQ(wserv_init(PORT, 0), VEOK);
+   ASSERT_EQ(wserv_work("cblock.dat"), VEOK);
+
+   /* subscribers receive current work on connect */
+   sd = sock_connect_ip(aton("127.0.0.1"), PORT, 3);
+   ASSERT_NE(sd, INVALID_SOCKET);
+   sock_set_nonblock(sd);
+   ASSERT_EQ(recv_polled(sd, &work), VEOK);
+   ASSERT_EQ(work.type, WSERV_WORK);
+   ASSERT_EQ(work.diff, DIFF);
+   ASSERT_CMP(work.data, &bt, WSERV_WORKLEN);
+
+   /* submissions for unknown work are rejected */
+   memset(&msg, 0, sizeof(msg));
+   msg.type = WSERV_SUBMIT;
+   put32(msg.id, get32(work.id) + 1);
+   ASSERT_EQ(wserv_send(sd, &msg), VEOK);
+   ASSERT_EQ(recv_polled(sd, &msg), VEOK);
+   ASSERT_EQ(msg.type, WSERV_REJECT);
+
+   /* solve work from (only) the pushed trailer prefix, and submit */
+   memset(&bt, 0, sizeof(bt));
+   memcpy(&bt, work.data, WSERV_WORKLEN);
+   peach_init(&bt);
+   while (peach_solve(&bt, work.diff, bt.nonce) != VEOK);
+   memset(&msg, 0, sizeof(msg));
+   msg.type = WSERV_SUBMIT;
+   memcpy(msg.id, work.id, sizeof(msg.id));
+   memcpy(msg.data, bt.nonce, HASHLEN);
+   ASSERT_EQ(wserv_send(sd, &msg), VEOK);
+   /* solved work is withdrawn, then the solve is accepted */
+   ASSERT_EQ(recv_polled(sd, &msg), VEOK);
+   ASSERT_EQ(msg.type, WSERV_IDLE);
+   ASSERT_EQ(recv_polled(sd, &msg), VEOK);
+   ASSERT_EQ(msg.type, WSERV_SOLVE);
+
+   /* node reassembles the solved block */
+   fp = fopen("mblock.dat", "rb");
+   ASSERT_NE(fp, NULL);
+   ASSERT_EQ(fread(&mbt, sizeof(mbt), 1, fp), 1);
+   fclose(fp);
+   ASSERT_CMP(&mbt, &bt, WSERV_WORKLEN + HASHLEN);
+   ASSERT_EQ(peach_check(&mbt), VEOK);
+
+   sock_close(sd);
+   wserv_free();
+   remove("cblock.dat");
+   remove("mblock.dat");
+   remove("cblock.lck");
+   sock_cleanup();
+}
@@ -0,0 +1,56 @@
+
+#include <string.h>
+#include <sys/socket.h>
+
+#include "_assert.h"
+#include "wserv.h"
+#include "extinet.h"
+#include "extthrd.h"
+#include "exttime.h"
+
+static WSERV_MSG Msg;
+static SOCKET Sd;
+
+/* send the remainder of a message, after a delay */
+static ThreadProc send_rest(void *arg)
+{
+   size_t half = sizeof(WSERV_MSG) / 2;
+
+   (void) arg;
+   millisleep(200);
+   send(Sd, (char *) &Msg + half, sizeof(WSERV_MSG) - half, 0);
+
+   Unthread;
+}
+
+int main()
+{
+   WSERV_MSG msg;
+   ThreadId tid;
+   SOCKET sv[2];
+
+   ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+   ASSERT_EQ(sock_set_nonblock(sv[0]), 0);
+   Sd = sv[1];
+   memset(&Msg, 0, sizeof(Msg));
+   Msg.type = WSERV_WORK;
+   memset(Msg.data, 0xa5, WSERV_WORKLEN);
+
+   /* no message is reported without waiting */
+   ASSERT_EQ(wserv_recv(sv[0], &msg, 0), VETIMEOUT);
+
+   /* a message split across reads completes, without a timeout */
+   ASSERT_EQ(send(Sd, (char *) &Msg, sizeof(WSERV_MSG) / 2, 0),
+      (int) (sizeof(WSERV_MSG) / 2));
+   ASSERT_EQ(thread_create(&tid, send_rest, NULL), 0);
+   ASSERT_EQ(wserv_recv(sv[0], &msg, 0), VEOK);
+   ASSERT_CMP(&msg, &Msg, sizeof(WSERV_MSG));
+   ASSERT_EQ(thread_join(tid), 0);
+
+   /* an incomplete message is an error, once begun */
+   ASSERT_EQ(send(Sd, (char *) &Msg, 10, 0), 10);
+   ASSERT_EQ(wserv_recv(sv[0], &msg, 0), VERROR);
+
+   sock_close(sv[0]);
+   sock_close(sv[1]);
+}
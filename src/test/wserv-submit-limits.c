@@ -0,0 +1,113 @@
+
+#include <string.h>
+#include <time.h>
+
+#include "_assert.h"
+#include "wserv.h"
+#include "peach.h"
+#include "extinet.h"
+#include "extlib.h"
+#include "exttime.h"
+
+#define PORT   2199
+#define DIFF   4
+
+/* poll the work server until the subscriber receives a message */
+static int recv_polled(SOCKET sd, WSERV_MSG *msg)
+{
+   int ecode, n;
+
+   for (n = 0; n < 100; n++) {
+      wserv_poll();
+      ecode = wserv_recv(sd, msg, 0);
+      if (ecode != VETIMEOUT) return ecode;
+      millisleep(10);
+   }
+
+   return VETIMEOUT;
+}
+
+/* submit a nonce for work, returning the response type */
+static int submit(SOCKET sd, const WSERV_MSG *work, const word8 *nonce)
+{
+   WSERV_MSG msg;
+
+   memset(&msg, 0, sizeof(msg));
+   msg.type = WSERV_SUBMIT;
+   memcpy(msg.id, work->id, sizeof(msg.id));
+   memcpy(msg.data, nonce, HASHLEN);
+   ASSERT_EQ(wserv_send(sd, &msg), VEOK);
+   ASSERT_EQ(recv_polled(sd, &msg), VEOK);
+   ASSERT_CMP(msg.id, work->id, sizeof(msg.id));
+
+   return msg.type;
+}
+
+int main()
+{
+   WSERV_MSG work;
+   BTRAILER bt;
+   SOCKET sd;
+   FILE *fp;
+   time_t start;
+   word8 share[3][HASHLEN];
+   word8 nonce[HASHLEN];
+   int n;
+
+   /* candidate block (trailer only), too hard to solve by chance */
+   memset(&bt, 0, sizeof(bt));
+   put32(bt.bnum, 1);
+   bt.difficulty[0] = 60;
+   fp = fopen("cblock.dat", "wb");
+   ASSERT_NE(fp, NULL);
+   ASSERT_EQ(fwrite(&bt, sizeof(bt), 1, fp), 1);
+   fclose(fp);
+
+   sock_startup();
+   ASSERT_EQ(wserv_init(PORT, DIFF), VEOK);
+   ASSERT_EQ(wserv_work("cblock.dat"), VEOK);
+   sd = sock_connect_ip(aton("127.0.0.1"), PORT, 3);
+   ASSERT_NE(sd, INVALID_SOCKET);
+   sock_set_nonblock(sd);
+   ASSERT_EQ(recv_polled(sd, &work), VEOK);
+   ASSERT_EQ(work.type, WSERV_WORK);
+   ASSERT_EQ(work.diff, DIFF);
+
+   /* prepare shares */
+   memset(&bt, 0, sizeof(bt));
+   memcpy(&bt, work.data, WSERV_WORKLEN);
+   peach_init(&bt);
+   for (n = 0; n < 3; n++) {
+      do {
+         while (peach_solve(&bt, work.diff, share[n]) != VEOK);
+      } while (n && memcmp(share[n], share[n - 1], HASHLEN) == 0);
+   }
+
+   /* a share is accepted once, and its repeat is rejected */
+   ASSERT_EQ(submit(sd, &work, share[0]), WSERV_SHARE);
+   ASSERT_EQ(submit(sd, &work, share[0]), WSERV_REJECT);
+
+   /* a flood of submissions exceeds the submission rate... */
+   memset(nonce, 0, sizeof(nonce));
+   for (n = 0; n < 64; n++) {
+      put32(nonce, (word32) n + 1);
+      ASSERT_EQ(submit(sd, &work, nonce), WSERV_REJECT);
+   }
+   /* ... such that even a valid share is rejected, until the rate allows */
+   ASSERT_EQ(submit(sd, &work, share[1]), WSERV_REJECT);
+   millisleep(1100);
+   ASSERT_EQ(submit(sd, &work, share[2]), WSERV_SHARE);
+
+   /* a subscriber that stops reading is disconnected, without stalling */
+   start = time(NULL);
+   for (n = 0; n < 100000; n++) wserv_work("cblock.dat");
+   ASSERT_LT(difftime(time(NULL), start), 5);
+   while (wserv_recv(sd, &work, 0) == VEOK);
+   ASSERT_EQ(wserv_recv(sd, &work, 0), VERROR);
+
+   sock_close(sd);
+   wserv_free();
+   remove("cblock.dat");
+   remove("cblock.lck");
+   sock_cleanup();
+}
@@ -22,11 +22,13 @@
 #include "error.h"
 
 /* external support */
+#include "sha256.h"
 #include "extmath.h"
 #include "extlib.h"
 #include "extio.h"
 
 /* system support */
+#include <errno.h>
 #include <signal.h>
 #include <string.h>
 
@@ -234,6 +236,115 @@ void get_mreward(word8 reward[8], const word8 bnum[8])
    }
 }  /* end get_mreward() */
 
+/**
+ * Finalize a streaming merkle tree and obtain the Merkle Root.
+ * @param ctx Pointer to streaming merkle tree context
+ * @param root Pointer to place Merkle Root hash
+ * @return (int) value representing operation result
+ * @retval VERROR on incorrect number of leaves; check errno for details
+ * @retval VEOK on success
+*/
+int merkle_final(MERKLE_CTX *ctx, word8 *root)
+{
+   if (ctx->count == 0 || ctx->added != ctx->count) {
+      set_errno(EINVAL);
+      return VERROR;
+   }
+
+   memcpy(root, ctx->stack[0].hash, HASHLEN);
+
+   return VEOK;
+}  /* end merkle_final() */
+
+/**
+ * Initialize a streaming merkle tree context. The number of leaves must
+ * be known in advance, so the tree may be split exactly as merkle_root().
+ * @param ctx Pointer to streaming merkle tree context
+ * @param count Number of leaves to expect
+*/
+void merkle_init(MERKLE_CTX *ctx, size_t count)
+{
+   ctx->count = count;
+   ctx->added = 0;
+   ctx->depth = 0;
+   if (count) {
+      ctx->stack[0].size = count;
+      ctx->stack[0].left = 0;
+      ctx->depth = 1;
+   }
+}  /* end merkle_init() */
+
+/**
+ * Add a leaf hash to a streaming merkle tree. Completed subtrees are
+ * folded into their parents immediately, leaving at most one partial
+ * root per tree level on the context stack. Leaves in excess of the
+ * count provided to merkle_init() are ignored (and fail merkle_final()).
+ * @param ctx Pointer to streaming merkle tree context
+ * @param hash Pointer to leaf hash
+*/
+void merkle_leaf(MERKLE_CTX *ctx, const word8 *hash)
+{
+   word8 merkle[HASHLEN * 2];
+   word8 node[HASHLEN];
+   size_t size;
+   int top;
+
+   if (ctx->added++ >= ctx->count) return;
+
+   /* descend to leaf position (left subtree takes the larger half) */
+   for (top = ctx->depth - 1; ctx->stack[top].size > 1; top++) {
+      size = ctx->stack[top].size;
+      ctx->stack[top + 1].size = size - (size / 2);
+      ctx->stack[top + 1].left = 0;
+   }
+   /* ascend, folding completed subtrees into parent nodes */
+   memcpy(node, hash, HASHLEN);
+   while (top-- > 0) {
+      if (!ctx->stack[top].left) {
+         /* left subtree complete -- store root, descend right subtree */
+         memcpy(ctx->stack[top].hash, node, HASHLEN);
+         ctx->stack[top].left = 1;
+         ctx->stack[top + 1].size = ctx->stack[top].size / 2;
+         ctx->stack[top + 1].left = 0;
+         ctx->depth = top + 2;
+         return;
+      }
+      /* right subtree complete -- hash merkle node hashes into node */
+      memcpy(merkle, ctx->stack[top].hash, HASHLEN);
+      memcpy(merkle + HASHLEN, node, HASHLEN);
+      sha256(merkle, HASHLEN * 2, node);
+   }
+   /* tree complete -- store root */
+   memcpy(ctx->stack[0].hash, node, HASHLEN);
+   ctx->depth = 0;
+}  /* end merkle_leaf() */
+
+/**
+ * Hash a list of data items and add them as leaves to a streaming merkle
+ * tree. Items are hashed in parallel batches of MERKLE_BATCH.
+ * @param ctx Pointer to streaming merkle tree context
+ * @param data Pointer to list of data items
+ * @param len Length of a single data item, in bytes
+ * @param count Number of data items in list
+*/
+void merkle_leaves
+   (MERKLE_CTX *ctx, const void *data, size_t len, size_t count)
+{
+   word8 hashlist[MERKLE_BATCH][HASHLEN];
+   const word8 *dp;
+   size_t j, n;
+   int k;
+
+   for (dp = data, j = 0; j < count; j += n, dp += n * len) {
+      n = (count - j) < MERKLE_BATCH ? (count - j) : MERKLE_BATCH;
+      #pragma omp parallel for
+      for (k = 0; k < (int) n; k++) {
+         sha256(dp + ((size_t) k * len), len, hashlist[k]);
+      }
+      for (k = 0; k < (int) n; k++) merkle_leaf(ctx, hashlist[k]);
+   }
+}  /* end merkle_leaves() */
+
 /**
  * Compute the Merkle Root of a list of hashes. Assumes HASHLEN byte hashes.
  * @note This function is recursive with an integral depth of 1 + log2(n).
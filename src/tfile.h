@@ -22,6 +22,30 @@
 #define NTFTX_SPACE  ( sizeof(((TX *) NULL)->buffer) / sizeof(BTRAILER) )
 STATIC_ASSERT(NTFTX <= NTFTX_SPACE, NTFTX_too_large_for_buffer);
 
+/* number of merkle leaves hashed per (parallel) batch */
+#ifndef MERKLE_BATCH
+   #define MERKLE_BATCH 1024
+#endif
+
+/* maximum depth of a merkle tree with a size_t number of leaves */
+#define MERKLE_DEPTH ( (sizeof(size_t) * 8) + 1 )
+
+/**
+ * Streaming merkle tree context. Holds the stack of partial roots along
+ * the path to the next leaf, such that leaves may be folded into the
+ * tree as they are read, in bounded memory.
+*/
+typedef struct {
+   size_t count;  /**< number of leaves expected */
+   size_t added;  /**< number of leaves added */
+   int depth;     /**< number of subtrees on stack */
+   struct {
+      size_t size;            /**< number of leaves in subtree */
+      int left;               /**< non-zero when left subtree is done */
+      word8 hash[HASHLEN];    /**< left subtree root (or final root) */
+   } stack[MERKLE_DEPTH];
+} MERKLE_CTX;
+
 /* C/C++ compatible prototypes */
 #ifdef __cplusplus
 extern "C" {
@@ -31,6 +55,11 @@ void add_weight(word8 weight[32], word8 difficulty);
 int append_tfile(const BTRAILER *bt, size_t count, const char *file);
 void get_mreward(word8 reward[8], const word8 bnum[8]);
 int get_tfrewards(const char *tfile, word8 rewards[8], const word8 bnum[8]);
+int merkle_final(MERKLE_CTX *ctx, word8 *root);
+void merkle_init(MERKLE_CTX *ctx, size_t count);
+void merkle_leaf(MERKLE_CTX *ctx, const word8 *hash);
+void merkle_leaves
+   (MERKLE_CTX *ctx, const void *data, size_t len, size_t count);
 void merkle_root(const word8 *hashlist, size_t count, word8 *root);
 size_t read_tfile
    (void *buffer, const word8 bnum[8], size_t count, const char *tfile);
@@ -355,6 +355,210 @@ static word32 Frame[NFRAMES][MAXH] = {
    }, /* ! increment NFRAMES if adding more frames... */
 };  /* end Frame[][] */
 
+/* Haiku syntax automaton states (Tsyntax[][]) */
+#define TSYNTAX_REJECT  0  /* haiku syntax is incorrect */
+#define TSYNTAX_ACCEPT  1  /* haiku syntax is correct */
+#define TSYNTAX_START   2  /* initial state, at first token */
+#define TSYNTAX_STATES  82
+#define TSYNTAX_CLASSES 21
+
+/**
+ * @private
+ * Token classes of the haiku syntax automaton. Tokens of a class match
+ * the same elements of every case frame in Frame[][].
+*/
+static const word8 Tclass[MAXDICT] = {
+    0,  1,  2,  3,  4,  5,  4,  4,  4,  6,  4,  4,  7,  7,  7,  7,
+    7,  7,  8,  8,  8,  8,  8,  8,  8,  8,  8,  8,  8,  8,  8,  8,
+    8,  8,  8,  8,  8,  8,  8,  8,  8,  8,  8,  8,  9,  9,  9,  9,
+    9,  9,  9,  9,  9,  9,  9,  9,  9,  9,  9,  9,  9, 10, 10, 10,
+   10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 11, 10, 10,
+   10, 10, 12, 12, 12, 13, 13, 13, 13, 10, 10, 10, 10, 10, 11, 11,
+   11, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10,
+   10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 11, 10,
+   10, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 15, 15, 15, 15, 15,
+   15, 14, 15, 15, 15, 14, 15, 15, 15, 15, 14, 14, 14, 14, 15, 15,
+   15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+   15, 14, 14, 14, 14, 15, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14,
+   14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14,
+   14, 14, 14, 14, 14, 14, 16, 16, 16, 16, 16, 16, 16, 17, 16, 16,
+   16, 16, 16, 16, 16, 17, 17, 17, 17, 17, 17, 17, 16, 16, 16, 16,
+   16, 14, 17, 18, 14, 14, 14, 14, 14, 19, 19, 19, 19, 19, 20, 19
+};
+
+/**
+ * @private
+ * Haiku syntax automaton, precompiled from the case frames of Frame[][].
+ * Each state represents the set of frames still unified with a haiku at
+ * a token position, such that the next state is determined by the class
+ * of the next token, until reaching TSYNTAX_ACCEPT or TSYNTAX_REJECT.
+ * @note Tables MUST be regenerated where Dict[] or Frame[][] changes;
+ * test/trigg-syntax.c checks and prints the expected tables.
+*/
+static const word8 Tsyntax[TSYNTAX_STATES][TSYNTAX_CLASSES] = {
+   { 0 }, { 0 },  /* TSYNTAX_REJECT, TSYNTAX_ACCEPT */
+   {  0,  0,  0,  0,  0,  3,  0,  4,  5,  0,  0,  0,  6,  6,
+      0,  0,  0,  0,  6,  6,  6 },
+   {  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      7,  0,  0,  0,  0,  7,  7 },
+   {  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  8,  8,  9,  8,
+      0,  0, 10, 10, 11, 11,  0 },
+   {  0,  0,  0,  0,  0,  0,  0, 12,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 13,  0,  0,
+      0,  0, 14, 15,  0,  0,  0 },
+   {  0, 16,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0, 17, 17,  0,  0,  0 },
+   {  0, 18,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0, 17, 17,  0,  0,  0 },
+   {  0, 19,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0, 18,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0,  0,  0,  0,  0, 20,  0,  0,  0,  0,  0,  0, 21, 21,
+      0,  0,  0,  0, 21, 21, 21 },
+   {  0, 22,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0, 23,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0, 24,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0,  0,  0,  0,  0,  0,  0, 25,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0, 26,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0,  0,  0,  0,  0, 27,  0,  0,  0,  0, 28, 28, 28, 28,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 29, 29, 29, 29,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 30, 30, 30, 30,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0, 31, 31,  0,  0,  0 },
+   {  0,  0,  0,  0,  0,  0,  0, 32,  0,  0, 33, 33, 33, 33,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0,  0,  0,  0,  0,  0,  0, 32,  0, 34, 33, 33, 33, 33,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0,  0,  0,  0,  0,  0,  0,  0,  0, 34,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 35,  0,
+      0,  0,  0,  0, 35, 35,  0 },
+   {  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0, 36,  0,  0,  0,  0,  0 },
+   {  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     37,  0,  0,  0,  0, 37, 37 },
+   {  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0, 38,  0,  0,  0,  0,  0 },
+   {  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0, 39,  0,  0,  0,  0,  0 },
+   {  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     40,  0,  0,  0,  0, 40, 40 },
+   {  0, 41,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0,  0,  0,  0,  0, 42,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0, 43, 43,  0,  0,  0 },
+   {  0,  0,  0,  0,  0,  0, 44,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0, 45, 45,  0,  0,  0 },
+   {  0, 46,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0, 47,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0, 48,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0, 49,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0, 50,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0, 51, 51,  0,  0,  0 },
+   {  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 52, 52, 52, 52,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0, 53,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0,  0, 54,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0,  0,  0, 55,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0,  0,  0,  0,  0,  0,  0,  0, 56, 56,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0,  0,  0,  0,  0,  0,  0,  0, 57,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0,  0,  0,  0,  0,  0,  0,  0, 58, 58,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0,  0,  0,  0,  0,  0,  0,  0, 59, 59,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0, 60, 60,  0,  0,  0 },
+   {  0,  0,  0,  0,  0,  0,  0,  0, 61,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     62,  0,  0,  0,  0, 62, 62 },
+   {  0,  0,  0,  0,  0,  0,  0,  0, 63,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0, 64,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0, 65,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0,  0,  0,  0,  0,  0,  0,  0, 66,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0,  0,  0, 67,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0,  0,  0, 68,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 69,  0,  0,
+      0,  0, 69,  0,  0,  0,  0 },
+   {  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 70, 70, 70, 70,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0,  0,  0, 71,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0, 72,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0, 73,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0, 74,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0,  0,  0,  0,  0, 75,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0,  0,  0,  0,  0,  0,  0,  0, 76,  0, 76, 76, 76, 76,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0,  0,  0,  0,  0, 77,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 78, 78, 78, 78,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 79, 79, 79, 79,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     80,  0,  0,  0,  0, 80, 80 },
+   {  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     81,  0,  0,  0,  0, 81, 81 },
+   {  1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 },
+   {  1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+      0,  0,  0,  0,  0,  0,  0 }
+};
+
 /* Z_* constant semantics array lengths are rounded up to the nearest
  * power-of-2 for efficient use in trigg_generate_fast(). The effect
  * of repeat filler values on subsequent results is negligible. */
@@ -445,19 +649,13 @@ void *trigg_generate(void *out)
 }  /* end trigg_generate() */
 
 /**
- * Generate a tokenized haiku (fast). Generates tokenized haiku into @a out
- * using pseudo-rng from rand16(). Seed with srand16() before use.
- * @note using trigg_generate() for the first half of a nonce, and this
- * function for the second half of a nonce, is suitable without reasonable
- * consideration towards collisions until rates reach the "Peta" scale.
- * After which, one should start to consider a "difficulty-weighted"
- * revision of trigg_generate() for the first half of a nonce.
+ * @private
+ * Map 64 bits of pseudo-random data to a tokenized haiku.
+ * @param rnd32 Pseudo-random data, as two 32-bit words
  * @param out Pointer to place tokenized haiku into
 */
-void *trigg_generate_fast(void *out)
+static void trigg_tokens_fast(const word32 rnd32[2], void *out)
 {
-   /* generate prng(64 bits) */
-   word32 rnd32[2] = { rand32(), rand32() };
    word8 tokens[16] = {0};
 
    /* determine frame type from rnd value */
@@ -586,10 +784,101 @@ void *trigg_generate_fast(void *out)
 
    /* copy tokens to output */
    memcpy(out, tokens, 16);
+}  /* end trigg_tokens_fast() */
+
+/**
+ * Generate a tokenized haiku (fast). Generates tokenized haiku into @a out
+ * using pseudo-rng from rand16(). Seed with srand16() before use.
+ * @note using trigg_generate() for the first half of a nonce, and this
+ * function for the second half of a nonce, is suitable without reasonable
+ * consideration towards collisions until rates reach the "Peta" scale.
+ * After which, one should start to consider a "difficulty-weighted"
+ * revision of trigg_generate() for the first half of a nonce.
+ * @param out Pointer to place tokenized haiku into
+*/
+void *trigg_generate_fast(void *out)
+{
+   /* generate prng(64 bits) */
+   word32 rnd32[2] = { rand32(), rand32() };
+
+   trigg_tokens_fast(rnd32, out);
 
    return out;
 }  /* end trigg_generate_fast() */
 
+/**
+ * Generate a tokenized haiku (fast), as per trigg_generate_fast(), using
+ * pseudo-rng from the generator @a rng. Safe to call from multiple
+ * threads, provided each thread uses its own generator.
+ * @param rng Pointer to pseudo-random generator, see trigg_rng_init()
+ * @param out Pointer to place tokenized haiku into
+*/
+void *trigg_generate_fast_r(TRIGG_RNG *rng, void *out)
+{
+   /* generate prng(64 bits) */
+   word32 rnd32[2];
+
+   rnd32[0] = trigg_rng32(rng);
+   rnd32[1] = trigg_rng32(rng);
+   trigg_tokens_fast(rnd32, out);
+
+   return out;
+}  /* end trigg_generate_fast_r() */
+
+/**
+ * Initialize a counter-based pseudo-random generator for nonce generation.
+ * The seed occupies the upper half of the Philox counter, and the stream
+ * the key, such that each (seed, stream) pair is an independent sequence
+ * of 2^64 blocks (of four 32-bit words).
+ * @param rng Pointer to pseudo-random generator to initialize
+ * @param seed Seed value, shared by all streams (e.g. from urandom)
+ * @param stream Stream identifier, unique per thread or device
+*/
+void trigg_rng_init(TRIGG_RNG *rng, word64 seed, word64 stream)
+{
+   rng->ctr[0] = rng->ctr[1] = 0;
+   rng->ctr[2] = (word32) seed;
+   rng->ctr[3] = (word32) (seed >> 32);
+   rng->key[0] = (word32) stream;
+   rng->key[1] = (word32) (stream >> 32);
+   rng->avail = 0;
+}  /* end trigg_rng_init() */
+
+/**
+ * Obtain 32 bits of pseudo-random data from a counter-based generator.
+ * Each Philox4x32-10 block produces four words, buffered in @a rng.
+ * @param rng Pointer to pseudo-random generator, see trigg_rng_init()
+ * @returns 32-bit pseudo-random value
+*/
+word32 trigg_rng32(TRIGG_RNG *rng)
+{
+   word64 p0, p1;
+   word32 c[4], k[2];
+   int r;
+
+   if (rng->avail == 0) {
+      memcpy(c, rng->ctr, sizeof(c));
+      memcpy(k, rng->key, sizeof(k));
+      /* 10 rounds of Philox4x32 */
+      for (r = 0; r < 10; r++) {
+         p0 = (word64) 0xD2511F53 * c[0];
+         p1 = (word64) 0xCD9E8D57 * c[2];
+         c[0] = (word32) (p1 >> 32) ^ c[1] ^ k[0];
+         c[2] = (word32) (p0 >> 32) ^ c[3] ^ k[1];
+         c[1] = (word32) p1;
+         c[3] = (word32) p0;
+         k[0] += 0x9E3779B9;
+         k[1] += 0xBB67AE85;
+      }
+      memcpy(rng->buf, c, sizeof(c));
+      rng->avail = 4;
+      /* increment (64-bit) block counter */
+      if (++rng->ctr[0] == 0) rng->ctr[1]++;
+   }
+
+   return rng->buf[4 - rng->avail--];
+}  /* end trigg_rng32() */
+
 /**
  * Expand a haiku to character format. It must have the correct syntax
  * and vibe.
@@ -651,32 +940,23 @@ int trigg_eval(const void *hash, word8 diff)
 
 /**
  * Check haiku syntax against semantic grammar. It must have the correct
- * syntax, semantics, and vibe.
+ * syntax, semantics, and vibe. Tokens are checked in a single pass of the
+ * precompiled haiku syntax automaton, Tsyntax[][].
  * @param nonce Pointer to tokenized haiku (nonce) to check
  * @returns VEOK on correct syntax, else VERROR if incorrect
 */
 int trigg_syntax(const void *nonce)
 {
-   word32 sf[MAXH], *fp;
-   word8 *np;
+   const word8 *np;
+   word8 state;
    int j;
 
-   /* load semantic frame associated with nonce */
-   for (j = 0, np = (word8 *) nonce; j < MAXH; j++) sf[j] = Dict[np[j]].fe;
-   /* check input for respective semantic features, use unification on sets. */
-   for (fp = &Frame[0][0]; fp < &Frame[NFRAMES][0]; fp += MAXH) {
-      for (j = 0; j < MAXH; j++) {
-         if (fp[j] == 0) {
-            if (sf[j] == 0) return VEOK;
-            break;
-         }
-         if (fp[j] & F_XLIT) {
-            if ((fp[j] & 255) != np[j]) break;
-            continue;
-         }
-         if ((sf[j] & fp[j]) == 0) break;
-      }
-      if (j >= MAXH) return VEOK;
+   /* step automaton through tokens, until syntax is decided */
+   np = (const word8 *) nonce;
+   for (state = TSYNTAX_START, j = 0; j < MAXH; j++) {
+      state = Tsyntax[state][Tclass[np[j]]];
+      if (state == TSYNTAX_ACCEPT) return VEOK;
+      if (state == TSYNTAX_REJECT) break;
    }
 
    return VERROR;
@@ -91,6 +91,19 @@ typedef struct {
   word32 fe;      /**< semantic features */
 } DICT;  /**< Dictionary entry with semantic grammar features */
 
+/**
+ * Counter-based pseudo-random generator state for nonce generation, using
+ * Philox4x32-10. Generators of the same seed, but with distinct streams,
+ * produce independent sequences, suitable for (at least) one generator
+ * per solving thread or device. Initialize with trigg_rng_init().
+*/
+typedef struct {
+   word32 ctr[4];    /**< block counter [0..1] and seed [2..3] */
+   word32 key[2];    /**< stream identifier */
+   word32 buf[4];    /**< output of last block */
+   int avail;        /**< number of unused words in buf */
+} TRIGG_RNG;
+
 /* Check Trigg's Proof of Work without passing the final hash */
 #define trigg_check(btp)  trigg_checkhash(btp, (btp)->difficulty[0], NULL)
 
@@ -101,6 +114,9 @@ extern "C" {
 
 void *trigg_generate(void *out);
 void *trigg_generate_fast(void *out);
+void *trigg_generate_fast_r(TRIGG_RNG *rng, void *out);
+void trigg_rng_init(TRIGG_RNG *rng, word64 seed, word64 stream);
+word32 trigg_rng32(TRIGG_RNG *rng);
 char *trigg_expand(const void *nonce, void *haiku);
 int trigg_eval(const void *hash, word8 diff);
 int trigg_syntax(const void *nonce);
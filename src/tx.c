@@ -18,8 +18,11 @@
 /* internal support */
 #include "wots.h"
 #include "ledger.h"
+#include "metrics.h"
+#include "pstat.h"
 #include "global.h"
 #include "error.h"
+#include "bcomp.h"
 
 /* external support */
 #include <sys/wait.h>
@@ -153,39 +156,44 @@ int tx_bot_is_active(void)
    return Txbot.active;
 }
 
-static void tx_bot_get_secret(word8 *secret, word8 *idx)
+/**
+ * Derive a WOTS+ secret from a master secret, for an address index, as
+ * per the transaction bot. Index zero derives the master secret itself.
+ * @param secret Pointer to place derived secret
+ * @param master Pointer to master secret
+ * @param idx Pointer to 8-byte address index
+ */
+void tx_secret(word8 secret[HASHLEN], const word8 master[HASHLEN],
+   const word8 idx[8])
 {
    SHA256_CTX ctx;
 
    /* generate WOTS+ address for index... */
    if (iszero(idx, 8)) {
       /* ... copy origin secret */
-      memcpy(secret, Txbot.secret, HASHLEN);
+      memmove(secret, master, HASHLEN);
    } else {
       /* ... or generate idx secret */
       sha256_init(&ctx);
       sha256_update(&ctx, idx, 8);
-      sha256_update(&ctx, Txbot.secret, HASHLEN);
+      sha256_update(&ctx, master, HASHLEN);
       sha256_final(&ctx, secret);
    }
-}
+}  /* end tx_secret() */
 
-static void tx_bot_get_wots
-   (word8 wots[WOTS_ADDR_LEN], word8 *secret, word8 *idx)
+/**
+ * Generate a WOTS+ address from a secret, as per the transaction bot.
+ * @param wots Pointer to place WOTS+ address
+ * @param secret Pointer to secret of WOTS+ address
+ */
+void tx_wots(word8 wots[WOTS_ADDR_LEN], const word8 secret[HASHLEN])
 {
-   /* local copies */
    word32 *wots_adrs;
    word8 *wots_pubseed;
-   word8 private[32];
 
    wots_pubseed = wots + WOTS_PK_LEN;
    wots_adrs = (word32 *) (wots + WOTS_PK_LEN + SHA256LEN);
 
-   if (secret == NULL) {
-      tx_bot_get_secret(private, idx);
-      secret = private;
-   }
-
    /* fill wots with sha256 using length expansion */
    for (int len = 0; len < WOTS_ADDR_LEN; len += SHA256LEN) {
       sha256(secret, HASHLEN, wots + len);
@@ -193,6 +201,24 @@ static void tx_bot_get_wots
 
    /* update sacrificial adrs and generate public key */
    wots_pkgen(wots, secret, wots_pubseed, wots_adrs);
+}  /* end tx_wots() */
+
+static void tx_bot_get_secret(word8 *secret, word8 *idx)
+{
+   tx_secret(secret, Txbot.secret, idx);
+}
+
+static void tx_bot_get_wots
+   (word8 wots[WOTS_ADDR_LEN], word8 *secret, word8 *idx)
+{
+   word8 private[32];
+
+   if (secret == NULL) {
+      tx_bot_get_secret(private, idx);
+      secret = private;
+   }
+
+   tx_wots(wots, secret);
 }
 
 int tx_bot_activate(const void *seeds, size_t seedlen)
@@ -330,8 +356,13 @@ int tx_bot_process(void)
 
    /* place transaction in empty NODE and process */
    memset(&node, 0, sizeof(NODE));
-   memcpy(node.tx.buffer, &tx, TXLEN_MIN);
-   put16(node.tx.len, TXLEN_MIN);
+   node.tx = pkt_alloc(TXLEN_MIN);
+   if (node.tx == NULL) {
+      perrno("pkt_alloc(txbot) FAILURE");
+      goto DONE;
+   }
+   memcpy(node.tx->buffer, &tx, TXLEN_MIN);
+   put16(node.tx->len, TXLEN_MIN);
 
    if (process_tx(&node) != VEOK) {
       errnum = errno;
@@ -344,6 +375,7 @@ int tx_bot_process(void)
          }
       }
    }
+   pkt_free(node.tx);
 
 DONE:
    return VEOK;
@@ -353,6 +385,8 @@ DONE:
  * Read a single Transaction Entry in to the provided container, @a txe,
  * from the given input @a stream. The file position indicator is
  * advanced by the size of the Transaction Entry (size varies).
+ * @note Archived block files may be compressed; open block files with
+ * bc_fopen() to read transactions from (decompressed) block data.
  * @param txe Pointer to Transaction Entry container
  * @param stream The stream to read from
  * @return (int) value representing the read result
@@ -646,31 +680,23 @@ static int tx_val__wots(const TXENTRY *tx)
 }  /* end tx_val__wots() */
 
 /**
- * Validate transaction data, as if received directly from a wallet.
- * DOES NOT validate nonce or id. Requires an open ledger.
+ * @private
+ * Validate transaction data, fields and signature, WITHOUT the ledger.
  * @param txe Pointer to Transaction Entry to validate
  * @param bnum Pointer to block number to validate against
+ * @param mfee Pointer to minimum transaction fee
  * @return (int) value representing validation result
- * @retval VEBAD2 on invalid signature; check errno for details
- * @retval VEBAD on bad transaction data; check errno for details
- * @retval VERROR on error; check errno for details
- * @retval VEOK on success
- */
-int tx_val(const TXENTRY *txe, const void *bnum, const void *mfee)
+*/
+static int tx_val__data(const TXENTRY *txe, const void *bnum,
+   const void *mfee)
 {
-   LENTRY le;
    word8 total[8];
    word8 *src_addr;
    word8 *chg_addr;
-   word8 *send_total;
-   word8 *change_total;
-   int overflow;
 
    /* derefence header pointers */
    src_addr = txe->hdr->src_addr;
    chg_addr = txe->hdr->chg_addr;
-   send_total = txe->hdr->send_total;
-   change_total = txe->hdr->change_total;
 
    /* only non-zero block-to-live values are checked */
    if (!iszero(txe->tx_btl, 8)) {
@@ -724,28 +750,74 @@ int tx_val(const TXENTRY *txe, const void *bnum, const void *mfee)
          return VEBAD2;
    }  /* end switch(DSA) */
 
-   /* look up source address in ledger */
-   if (!le_find(src_addr, &le, ADDR_LEN)) {
+   return VEOK;
+}  /* end tx_val__data() */
+
+/**
+ * @private
+ * Validate transaction totals against a source ledger entry. Checked
+ * last, after tx_val__data(), so bad transactions never cost a lookup.
+ * @param txe Pointer to Transaction Entry to validate
+ * @param le Pointer to source ledger entry, or NULL if not in ledger
+ * @return (int) value representing validation result
+*/
+static int tx_val__le(const TXENTRY *txe, const LENTRY *le)
+{
+   word8 total[8];
+   int overflow;
+
+   /* check source address was found in ledger */
+   if (le == NULL) {
       set_errno(EMCM_TXSRCLE);
       return VERROR;
    }
    /* check total amounts match balance */
    memset(total, 0, sizeof(total));
    /* use add64() to check for overflow */
-   overflow =  add64(send_total, change_total, total);
+   overflow =  add64(txe->hdr->send_total, txe->hdr->change_total, total);
    overflow += add64(txe->tx_fee, total, total);
    if (overflow) {
       set_errno(EMCM_TXOVERFLOW);
       return VEBAD;
    }
    /* check totals match ledger balance */
-   if (cmp64(le.balance, total) != 0) {
+   if (cmp64(le->balance, total) != 0) {
       set_errno(EMCM_TXTOTAL);
       return VERROR;
    }
 
    /* transaction is valid */
    return VEOK;
+}  /* end tx_val__le() */
+
+/**
+ * Validate transaction data, as if received directly from a wallet.
+ * DOES NOT validate nonce or id. Requires an open ledger.
+ * @param txe Pointer to Transaction Entry to validate
+ * @param bnum Pointer to block number to validate against
+ * @return (int) value representing validation result
+ * @retval VEBAD2 on invalid signature; check errno for details
+ * @retval VEBAD on bad transaction data; check errno for details
+ * @retval VERROR on error; check errno for details
+ * @retval VEOK on success
+ */
+int tx_val(const TXENTRY *txe, const void *bnum, const void *mfee)
+{
+   LENTRY le;
+   word64 start;
+   int ecode;
+
+   start = metrics_time();
+   ecode = tx_val__data(txe, bnum, mfee);
+   if (ecode == VEOK) {
+      /* look up source address in ledger */
+      if (!le_find(txe->hdr->src_addr, &le, ADDR_LEN)) {
+         ecode = tx_val__le(txe, NULL);
+      } else ecode = tx_val__le(txe, &le);
+   }
+   metrics_observe(METRICS_TX_VAL, start);
+
+   return ecode;
 }  /* end tx_val() */
 
 /**
@@ -849,6 +921,8 @@ int txclean(const char *txfname, const char *bcfname)
    FILE *fp, *bfp, *tfp;   /* input, blockchain and temporary files */
    void *ptr;              /* realloc pointer */
    TXPOS *tx;              /* malloc'd transaction positions */
+   LENTRY *les;            /* malloc'd source ledger entries */
+   word8 *found;           /* malloc'd source ledger entry flags */
    size_t count, actual;   /* malloc'd and actual tx element counts */
    size_t j, nout;
    fpos_t pos;             /* file position offset indicator */
@@ -864,6 +938,8 @@ int txclean(const char *txfname, const char *bcfname)
 
    /* error handling init */
    fp = bfp = tfp = NULL;
+   les = NULL;
+   found = NULL;
    tx = NULL;
 
    /* GENERATE SORTED (ASCENDING) TXID REFERENCES FOR COMPARE */
@@ -919,12 +995,20 @@ int txclean(const char *txfname, const char *bcfname)
    /* sort the txid reference array */
    qsort(tx, actual, sizeof(TXPOS), txpos_compare);
 
+   /* resolve (sorted) source ledger entries in a single batch */
+   les = malloc((actual + 1) * sizeof(LENTRY));
+   found = malloc(actual + 1);
+   if (les == NULL || found == NULL) goto ERROR_CLEANUP;
+   if (le_find_batch(tx, sizeof(TXPOS), actual, les, found, ADDR_LEN) == 0) {
+      if (errno != 0) goto ERROR_CLEANUP;
+   }
+
    /* PREPARE BLOCKCHAIN FILE FOR TRANSACTION COMPARISON (IF PROVIDED) */
 
    /* only if blockchain file is provided */
    if (bcfname != NULL) {
-      /* open validated block file */
-      bfp = fopen(bcfname, "rb");
+      /* open validated (decompressed) block file */
+      bfp = bc_fopen(bcfname);
       if (bfp == NULL) goto ERROR_CLEANUP;
       /* read and check fixed length header */
       if (fread(&hdrlen, 4, 1, bfp) != 1) {
@@ -974,6 +1058,8 @@ int txclean(const char *txfname, const char *bcfname)
          /* if src from block compares EQUAL TO reference, skip... */
          if (bfp != NULL && cond == 0) continue;
       }
+      /* source no longer in ledger cannot (re)validate, skip... */
+      if (!found[j]) continue;
       /* .. else; read reference transaction from previously set fpos */
       if (fsetpos(fp, &(tx[j].pos)) != 0) goto ERROR_CLEANUP;
       if (tx_fread(&txc, fp) != VEOK) goto ERROR_CLEANUP;
@@ -981,7 +1067,8 @@ int txclean(const char *txfname, const char *bcfname)
       add64(Cblocknum, ONE64, txc.tx_nonce);
       /* if (re)validation fails, skip... */
       /** @todo: replace tx_val with less wasteful tx_reval process */
-      if (tx_val(&txc, txc.tx_nonce, Myfee) != VEOK) continue;
+      if (tx_val__data(&txc, txc.tx_nonce, Myfee) != VEOK) continue;
+      if (tx_val__le(&txc, &les[j]) != VEOK) continue;
       /* write clean (valid) transaction to output */
       if (tx_fwrite(&txc, tfp) != VEOK) goto ERROR_CLEANUP;
       nout++;
@@ -990,6 +1077,8 @@ int txclean(const char *txfname, const char *bcfname)
    /* cleanup */
    if (bfp) fclose(bfp);
    fclose(fp);
+   free(found);
+   free(les);
    free(tx);
 
    /* out with the old, in with the new */
@@ -1010,6 +1099,8 @@ ERROR_CLEANUP:
    if (tfp) fclose(tfp);
    if (bfp) fclose(bfp);
    if (fp) fclose(fp);
+   if (found) free(found);
+   if (les) free(les);
    if (tx) free(tx);
 
    return VERROR;
@@ -1046,7 +1137,8 @@ pid_t mgc(word32 ip)
    FILE *fp;
    long offset;
    int lockfd, count;
-   TX mtx;
+   word16 len;
+   TX *mtx;
    NODE node;
 
    /* create grandchild */
@@ -1067,6 +1159,7 @@ pid_t mgc(word32 ip)
       exit(1);
    }
    offset = 0;
+   mtx = NULL;
 
    while(Running) {
       lockfd = lock("mq.lck", 20);
@@ -1076,25 +1169,39 @@ pid_t mgc(word32 ip)
       if(fseek(fp, offset, SEEK_SET)) {
          unlock(lockfd); fclose(fp); exit(1);
       }
-      /* read the TX from mirror.dat */
-      count = fread(&mtx, 1, sizeof(TX), fp);
+      /* read the TX header, then (variable length) data, from mirror.dat */
+      count = 0;
+      if (mtx || (mtx = pkt_alloc(0)) != NULL) {
+         count = fread(mtx, 1, TXHDRLEN, fp);
+      }
+      if (count == TXHDRLEN) {
+         len = get16(mtx->len);
+         if (len > pkt_cap(mtx)) {
+            /* enlarge TX buffer, retaining header */
+            node.tx = mtx;
+            if (node_reserve(&node, len) != VEOK) count = 0;
+            mtx = node.tx;
+         }
+         if (count && fread(mtx->buffer, 1, len, fp) != len) count = 0;
+      }
       /* preserve seek pos because other mgc()'s may be running */
       offset = ftell(fp);
       unlock(lockfd);
-      if(count != sizeof(TX)) break;
+      if(count != TXHDRLEN) break;
       /* if not in -v modes... */
       if(Port == Dstport) {
          /* Skip this TX if ip address is already in map. */
-         if(search32(ip, (word32 *) mtx.weight, 8)) continue;
+         if(search32(ip, (word32 *) mtx->weight, 8)) continue;
       }
       if(callserver(&node, ip) != VEOK) break;
-      memcpy(node.tx.buffer, mtx.buffer, get16(mtx.len));
-      /* copy buffer length and ip address map to outgoing TX */
-      memcpy(node.tx.weight, mtx.weight, 32);
-      put16(node.tx.len, get16(mtx.len));
+      /* swap in TX -- buffer length and ip address map included */
+      pkt_free(node.tx);
+      node.tx = mtx;
       send_op(&node, OP_TX);
-      sock_close(node.sd);
+      node.tx = NULL;  /* TX buffer is retained for next record */
+      node_close(&node);
    }  /* end while Running */
+   pkt_free(mtx);
    fclose(fp);
    exit(0);
 }  /* end mgc() */
@@ -1105,6 +1212,7 @@ pid_t mgc(word32 ip)
 pid_t mirror(void)
 {
    pid_t pid, peer[RPLISTLEN];
+   word32 plist[RPLISTLEN];
    int j, len;
    word8 busy;
 
@@ -1117,11 +1225,13 @@ pid_t mirror(void)
    pdebug("mirror()...");
    show("mirror");
 
-   /* Create up to len mgc() grandchildren */
+   /* Create up to len mgc() grandchildren, fastest peers first */
    memset(peer, 0, sizeof(peer));
-   for (j = len = 0; j < RPLISTLEN; j++) {
-      if (Rplist[j] == 0) continue;
-      peer[len++] = mgc(Rplist[j]);  /* grandchild */
+   memset(plist, 0, sizeof(plist));
+   len = loadpeers(plist, RPLISTLEN, Rplist, RPLISTLEN);
+   pstat_sort(plist, (word32) len);
+   for (j = 0; j < len; j++) {
+      peer[j] = mgc(plist[j]);  /* grandchild */
    }
    pdebug("prepared %d mgc()...", len);
 
@@ -1154,10 +1264,10 @@ int mirror_tx(NODE *np)
 {
    TX *tx;
    FILE *fp;
-   int count, lockfd;
+   int count, len, lockfd;
    int ecode;
 
-   tx = &np->tx;
+   tx = np->tx;
 
    /* lock mirror file */
    lockfd = lock("mq.lck", 20);
@@ -1171,10 +1281,12 @@ int mirror_tx(NODE *np)
 
    /* If empty slot in mirror address map, fill it
    * in and then write tx to mirror queue, mq.dat.
+   * Records are variable length, header and data only.
    */
    if(txmap(tx, np->ip) == VEOK) {
-      count = fwrite(tx, 1, sizeof(TX), fp);
-      if(count != sizeof(TX)) {
+      len = TXHDRLEN + get16(tx->len);
+      count = fwrite(tx, 1, len, fp);
+      if(count != len) {
          ecode = VERROR;
       } else Mqcount++;
    }
@@ -1206,7 +1318,7 @@ int process_tx(NODE *np)
 
    show("tx");
 
-   tx = &np->tx;
+   tx = np->tx;
 
    /* read transaction entry from buffer */
    ecode = tx_read(&txe, tx->buffer, get16(tx->len));
@@ -1216,6 +1328,7 @@ int process_tx(NODE *np)
    ecode = txcheck(txe.src_addr);
    if (ecode != VEOK) {
       Ndups++;
+      metrics_inc(METRICS_DUPS);
       return ecode;
    }
 
@@ -1237,6 +1350,7 @@ int process_tx(NODE *np)
 
    Txcount++;
    Nrec++;  /* total good TX received */
+   metrics_inc(METRICS_TXGOOD);
 
    return mirror_tx(np);
 }  /* end process_tx() */
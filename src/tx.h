@@ -51,7 +51,10 @@ int tx_fread(TXENTRY *tx, FILE *stream);
 int tx_fwrite(const TXENTRY *tx, FILE *stream);
 void tx_hash(const TXENTRY *tx, tx_hash_t type, void *out);
 int tx_read(TXENTRY *tx, const void *buf, size_t bufsz);
+void tx_secret(word8 secret[HASHLEN], const word8 master[HASHLEN],
+   const word8 idx[8]);
 int tx_val(const TXENTRY *txe, const void *bnum, const void *mfee);
+void tx_wots(word8 wots[WOTS_ADDR_LEN], const word8 secret[HASHLEN]);
 int txe_val(const TXENTRY *txe, const void *bnum, const void *mfee);
 int txcheck(const word8 *src_addr);
 int txclean(const char *txfname, const char *bcfname);
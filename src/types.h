@@ -27,16 +27,15 @@
 #define PVERSION     5        /* protocol version number (short) */
 
 /* Adjustable Parameters */
-#define MAXNODES     37       /**< maximum number of connected nodes */
+#define MAXNODES     128      /**< maximum number of connected nodes */
 #define INIT_TIMEOUT 3        /**< initial timeout after accept() */
 #define STD_TIMEOUT  5        /**< connection timeout in callserver() */
 #define LQLEN        100      /**< listen() queue length */
 #define TXQUEBIG     32       /**< big enough to run bcon */
 #define MAXBLTX      32768    /**< max TX's in a block for bcon (~1M) */
 #define STATUSFREQ   10       /**< status display interval sec. */
-#define CPINKLEN     100       /* maximum entries in pinklists */
-#define LPINKLEN     100
-#define EPINKLEN     100
+#define PINKLISTLEN  4096     /**< default capacity of pinklist */
+#define PINKEPOCHS   16       /**< epochs an ip remains pinklisted */
 #define EPOCHMASK    15       /**< update pinklist Epoch count - 1 */
 #define EPOCHSHIFT   4
 #define RPLISTLEN    64       /**< recent peer list v.28 */
@@ -359,6 +358,7 @@
 #define NO_DEVICE       0  /**< No device */
 #define CUDA_DEVICE     1  /**< CUDA device type */
 #define OPENCL_DEVICE   2  /**< OPENCL device type */
+#define CPU_DEVICE      3  /**< CPU (solving threads) device type */
 
 /* device status (DEVICE_CTX.status) */
 
@@ -380,7 +380,17 @@
  * Device status.
  *
  * @property DEVICE::peach
- * Peach context pointer. Can refer to either a CUDA or OpenCL context.
+ * Peach context pointer. Can refer to either a CUDA, OpenCL or CPU context.
+ *
+ * @property DEVICE::threads
+ * Number of solving threads. For CPU devices, the number of host threads
+ * expected to call peach_work_cpu().
+ *
+ * @property DEVICE::work
+ * Number of hashes performed on the current work.
+ *
+ * @property DEVICE::hps
+ * Hashrate (hashes per second) on the current work.
  *
  */
 typedef struct {
@@ -0,0 +1,365 @@
+/**
+ * @private
+ * @headerfile workq.h <workq.h>
+ * @copyright Adequate Systems LLC, 2018-2022. All Rights Reserved.
+ * <br />For license information, please refer to ../LICENSE.md
+*/
+
+/* include guard */
+#ifndef MOCHIMO_WORKQ_C
+#define MOCHIMO_WORKQ_C
+
+
+#include "workq.h"
+
+/* internal support */
+#include "global.h"
+#include "metrics.h"
+#include "error.h"
+
+/* external support */
+#include <stdlib.h>
+#include "extinet.h"
+#include "extthrd.h"
+
+#ifndef _WIN32
+   #include <pthread.h>  /* for pthread_atfork() */
+
+#endif
+
+/**
+ * @private
+ * Worker queue job; a request NODE and its start time.
+*/
+typedef struct {
+   NODE node;        /* request node -- owns connection and packet buffer */
+   word64 start;     /* request start time */
+} WORKQ_JOB;
+
+/**
+ * @private
+ * Worker queue thread.
+*/
+typedef struct {
+   ThreadId tid;     /* worker thread id */
+   SOCKET sd;        /* connection of running job, or INVALID_SOCKET */
+} WORKQ_THREAD;
+
+/* worker queue state -- guarded by Wqlock, once initialized */
+static Mutex Wqlock = MUTEX_INITIALIZER;
+static Condition Wqready = CONDITION_INITIALIZER;  /* job queued, or stop */
+static Condition Wqidle = CONDITION_INITIALIZER;   /* job completed */
+static WORKQ_THREAD *Wqthread;
+static WORKQ_JOB *Wqjob;      /* job ring */
+static WORKQ_DONE *Wqdone;    /* completion ring */
+static WORKQ_FN Wqfn;
+static int Wqthreads;         /* number of worker threads */
+static int Wqdepth;           /* length of job and completion rings */
+static int Wqhead, Wqcount;   /* next job, and count of queued jobs */
+static int Wqdhead, Wqdcount; /* next completion, and count of completions */
+static int Wqrunning;         /* count of running jobs */
+static int Wqinflight;        /* count of uncollected jobs (server only) */
+static int Wqstop;            /* non-zero when worker threads shall exit */
+
+#ifndef _WIN32
+
+/**
+ * @private
+ * Fork handler; acquire the chain state lock before fork(), such that
+ * forked children do not inherit a lock held by a worker thread.
+*/
+static void workq_atfork_prepare(void)
+{
+   mutex_lock(&Chainlock);
+}  /* end workq_atfork_prepare() */
+
+/**
+ * @private
+ * Fork handler; release the chain state lock after fork().
+*/
+static void workq_atfork_release(void)
+{
+   mutex_unlock(&Chainlock);
+}  /* end workq_atfork_release() */
+
+#endif
+
+/**
+ * @private
+ * Append a completion record. Wqlock MUST be held.
+*/
+static void workq_done(const WORKQ_DONE *done)
+{
+   Wqdone[(Wqdhead + Wqdcount) % Wqdepth] = *done;
+   Wqdcount++;
+}  /* end workq_done() */
+
+/**
+ * @private
+ * Worker thread; handles queued jobs until stopped.
+*/
+static ThreadProc workq_thread(void *arg)
+{
+   WORKQ_THREAD *wp = (WORKQ_THREAD *) arg;
+   WORKQ_DONE done;
+   WORKQ_JOB job;
+
+   mutex_lock(&Wqlock);
+   for (;;) {
+      while (Wqcount == 0 && !Wqstop) condition_wait(&Wqready, &Wqlock);
+      if (Wqstop) break;
+      /* take next job */
+      job = Wqjob[Wqhead];
+      Wqhead = (Wqhead + 1) % Wqdepth;
+      Wqcount--;
+      Wqrunning++;
+      wp->sd = job.node.sd;
+      mutex_unlock(&Wqlock);
+
+      /* read request before handler (re)uses packet buffer */
+      done.start = job.start;
+      done.ip = job.node.ip;
+      done.opcode = get16(job.node.tx->opcode);
+      done.optin = job.node.tx->version[1] & C_OPTIN;
+      done.status = Wqfn(&job.node);
+      done.errnum = errno;
+
+      /* release connection, before it may be closed */
+      mutex_lock(&Wqlock);
+      wp->sd = INVALID_SOCKET;
+      mutex_unlock(&Wqlock);
+      node_close(&job.node);
+      metrics_observe_op(done.opcode, done.start);
+
+      /* record completion */
+      mutex_lock(&Wqlock);
+      workq_done(&done);
+      Wqrunning--;
+      condition_broadcast(&Wqidle);
+   }
+   mutex_unlock(&Wqlock);
+
+   Unthread;
+}  /* end workq_thread() */
+
+/**
+ * Abort all jobs. Queued jobs are discarded, and complete with VERROR
+ * (errno ECANCELED). Connections of running jobs are shut down, and
+ * running jobs are waited on to complete.
+*/
+void workq_abort(void)
+{
+   WORKQ_DONE done;
+   WORKQ_JOB *jp;
+   int j;
+
+   if (Wqthread == NULL) return;
+
+   mutex_lock(&Wqlock);
+   /* discard queued jobs */
+   for ( ; Wqcount > 0; Wqcount--) {
+      jp = &Wqjob[Wqhead];
+      Wqhead = (Wqhead + 1) % Wqdepth;
+      done.start = jp->start;
+      done.ip = jp->node.ip;
+      done.status = VERROR;
+      done.errnum = ECANCELED;
+      done.opcode = get16(jp->node.tx->opcode);
+      done.optin = jp->node.tx->version[1] & C_OPTIN;
+      node_close(&jp->node);
+      workq_done(&done);
+   }
+   /* shut down connections of running jobs, and wait */
+   for (j = 0; j < Wqthreads; j++) {
+      if (Wqthread[j].sd != INVALID_SOCKET) {
+         shutdown(Wqthread[j].sd, 2);  /* SHUT_RDWR, or SD_BOTH */
+      }
+   }
+   while (Wqrunning > 0) condition_wait(&Wqidle, &Wqlock);
+   mutex_unlock(&Wqlock);
+}  /* end workq_abort() */
+
+/**
+ * Collect a completion record, of a completed job.
+ * @param done Pointer to place completion record
+ * @returns 1 if a completion record was collected, else 0
+*/
+int workq_collect(WORKQ_DONE *done)
+{
+   int count;
+
+   if (Wqthread == NULL) return 0;
+
+   mutex_lock(&Wqlock);
+   count = Wqdcount;
+   if (count > 0) {
+      *done = Wqdone[Wqdhead];
+      Wqdhead = (Wqdhead + 1) % Wqdepth;
+      Wqdcount--;
+   }
+   mutex_unlock(&Wqlock);
+   if (count == 0) return 0;
+
+   Wqinflight--;
+   __atomic_store_n(&Nonline, Wqinflight, __ATOMIC_RELAXED);
+
+   return 1;
+}  /* end workq_collect() */
+
+/**
+ * Stop worker threads, and release all worker queue resources. Queued
+ * jobs are discarded, and completion records are dropped. Running jobs
+ * are NOT aborted; use workq_abort() first, where required.
+*/
+void workq_free(void)
+{
+   WORKQ_JOB *jp;
+   int j;
+
+   if (Wqthread == NULL) return;
+
+   /* stop worker threads */
+   mutex_lock(&Wqlock);
+   Wqstop = 1;
+   condition_broadcast(&Wqready);
+   mutex_unlock(&Wqlock);
+   for (j = 0; j < Wqthreads; j++) thread_join(Wqthread[j].tid);
+
+   /* discard queued jobs */
+   for ( ; Wqcount > 0; Wqcount--) {
+      jp = &Wqjob[Wqhead];
+      Wqhead = (Wqhead + 1) % Wqdepth;
+      node_close(&jp->node);
+   }
+   free(Wqthread);
+   free(Wqjob);
+   free(Wqdone);
+   Wqthread = NULL;
+   Wqjob = NULL;
+   Wqdone = NULL;
+   Wqthreads = Wqdepth = 0;
+   Wqhead = Wqdhead = Wqdcount = 0;
+   Wqinflight = Wqstop = 0;
+   __atomic_store_n(&Nonline, 0, __ATOMIC_RELAXED);
+}  /* end workq_free() */
+
+/**
+ * Initialize the worker queue, and start worker threads.
+ * @param threads Number of worker threads (1 to WORKQ_THREADS_MAX)
+ * @param depth Maximum number of uncollected jobs (queued, running and
+ * completed), see workq_submit()
+ * @param fn Request handler, called by worker threads
+ * @return (int) value representing operation result
+ * @retval VERROR on error; check errno for details
+ * @retval VEOK on success
+*/
+int workq_init(int threads, int depth, WORKQ_FN fn)
+{
+#ifndef _WIN32
+   static int registered;
+#endif
+   int ecode;
+
+   if (Wqthread != NULL) {
+      set_errno(EALREADY);
+      return VERROR;
+   }
+   if (threads < 1 || threads > WORKQ_THREADS_MAX || depth < 1
+         || fn == NULL) {
+      set_errno(EINVAL);
+      return VERROR;
+   }
+
+#ifndef _WIN32
+   if (!registered) {
+      ecode = pthread_atfork(workq_atfork_prepare,
+         workq_atfork_release, workq_atfork_release);
+      if (ecode != 0) {
+         set_errno(ecode);
+         return VERROR;
+      }
+      registered = 1;
+   }
+#endif
+
+   Wqjob = malloc(sizeof(*Wqjob) * (size_t) depth);
+   Wqdone = malloc(sizeof(*Wqdone) * (size_t) depth);
+   Wqthread = malloc(sizeof(*Wqthread) * (size_t) threads);
+   if (Wqjob == NULL || Wqdone == NULL || Wqthread == NULL) goto FAIL;
+   Wqfn = fn;
+   Wqdepth = depth;
+
+   /* start worker threads */
+   for (Wqthreads = 0; Wqthreads < threads; Wqthreads++) {
+      Wqthread[Wqthreads].sd = INVALID_SOCKET;
+      ecode = thread_create(&(Wqthread[Wqthreads].tid), workq_thread,
+         &(Wqthread[Wqthreads]));
+      if (ecode != 0) {
+         set_errno(ecode);
+         goto FAIL;
+      }
+   }
+
+   return VEOK;
+
+   /* cleanup / error handling */
+FAIL:
+   ecode = errno;
+   if (Wqthreads > 0) workq_free();
+   else {
+      free(Wqthread);
+      free(Wqjob);
+      free(Wqdone);
+      Wqthread = NULL;
+      Wqjob = NULL;
+      Wqdone = NULL;
+   }
+   set_errno(ecode);
+
+   return VERROR;
+}  /* end workq_init() */
+
+/**
+ * Submit a request to the worker queue. On success, the worker queue
+ * takes ownership of the connection and packet buffer of @a np, and
+ * clears them from @a np. A completion record is available for every
+ * submitted job, see workq_collect().
+ * @param np Pointer to (handshaked) NODE of request
+ * @param start Request start time, see metrics_time()
+ * @return (int) value representing operation result
+ * @retval VERROR on error, or when the worker queue is full (errno
+ * EAGAIN); check errno for details
+ * @retval VEOK on success
+*/
+int workq_submit(NODE *np, word64 start)
+{
+   WORKQ_JOB *jp;
+
+   if (Wqthread == NULL || np->tx == NULL) {
+      set_errno(EINVAL);
+      return VERROR;
+   }
+   if (Wqinflight >= Wqdepth) {
+      set_errno(EAGAIN);
+      return VERROR;
+   }
+
+   mutex_lock(&Wqlock);
+   jp = &Wqjob[(Wqhead + Wqcount) % Wqdepth];
+   jp->node = *np;
+   jp->start = start;
+   Wqcount++;
+   condition_signal(&Wqready);
+   mutex_unlock(&Wqlock);
+
+   /* connection and packet buffer are handed to job */
+   np->sd = INVALID_SOCKET;
+   np->tx = NULL;
+   Wqinflight++;
+   __atomic_store_n(&Nonline, Wqinflight, __ATOMIC_RELAXED);
+
+   return VEOK;
+}  /* end workq_submit() */
+
+/* end include guard */
+#endif
@@ -0,0 +1,64 @@
+/**
+ * @file workq.h
+ * @brief Mochimo request worker queue, a thread pool for peer requests.
+ * @details Peer requests that are not answered inline by gettx() (e.g.
+ * block and tfile transfers) are submitted to a bounded job queue and
+ * handled by a pool of worker threads. The outcome of each request is
+ * returned to the server as a completion record, collected with
+ * workq_collect(), rather than as the exit status of a child process.
+ * <br />
+ * Submitted jobs own their connection and packet buffer; both are
+ * released by the worker queue. All functions, except the handler, are
+ * to be called by a single (server) thread.
+ * @copyright Adequate Systems LLC, 2018-2022. All Rights Reserved.
+ * <br />For license information, please refer to ../LICENSE.md
+*/
+
+/* include guard */
+#ifndef MOCHIMO_WORKQ_H
+#define MOCHIMO_WORKQ_H
+
+
+#include "types.h"
+#include "network.h"
+
+/**
+ * Maximum number of worker threads.
+*/
+#define WORKQ_THREADS_MAX  255
+
+/**
+ * Worker queue request handler. Called by a worker thread with the
+ * (handshaked) NODE of a request. Returns a request status, e.g. VEOK.
+*/
+typedef int (*WORKQ_FN)(NODE *np);
+
+/**
+ * Worker queue completion record.
+*/
+typedef struct {
+   word64 start;     /**< request start time, see metrics_time() */
+   word32 ip;        /**< peer ip address of request */
+   int status;       /**< handler status (e.g. VEOK, VEBAD, VETIMEOUT) */
+   int errnum;       /**< handler errno, on return */
+   word16 opcode;    /**< request opcode */
+   word8 optin;      /**< non-zero where peer set C_OPTIN */
+} WORKQ_DONE;
+
+/* C/C++ compatible function prototypes */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void workq_abort(void);
+int workq_collect(WORKQ_DONE *done);
+void workq_free(void);
+int workq_init(int threads, int depth, WORKQ_FN fn);
+int workq_submit(NODE *np, word64 start);
+
+#ifdef __cplusplus
+}  /* end extern "C" */
+#endif
+
+/* end include guard */
+#endif
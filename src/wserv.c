@@ -0,0 +1,422 @@
+/**
+ * @private
+ * @headerfile wserv.h <wserv.h>
+ * @copyright Adequate Systems LLC, 2018-2022. All Rights Reserved.
+ * <br />For license information, please refer to ../LICENSE.md
+*/
+
+/* include guard */
+#ifndef MOCHIMO_WSERV_C
+#define MOCHIMO_WSERV_C
+
+
+#include "wserv.h"
+
+/* internal support */
+#include "bcon.h"
+#include "network.h"
+#include "peach.h"
+#include "peer.h"
+#include "tfile.h"
+#include "trigg.h"
+#include "error.h"
+
+/* external support */
+#include <string.h>
+#include "extinet.h"
+#include "extlib.h"
+
+#ifndef _WIN32
+   #include <poll.h>    /* for POLLIN, POLLOUT */
+
+#endif
+
+/**
+ * @private
+ * Seconds allowed for a message to complete, once begun, see wserv_recv().
+*/
+#define WSERV_COMPLETE  1
+
+/**
+ * @private
+ * Submissions checked per second, per subscriber; excess is rejected.
+*/
+#define WSERV_RATE      16
+
+/**
+ * @private
+ * Recent submissions remembered per subscriber, to reject duplicates.
+*/
+#define WSERV_SEEN      32
+
+/**
+ * @private
+ * Work server subscriber connection.
+*/
+typedef struct {
+   SOCKET sd;        /* subscriber socket, or INVALID_SOCKET */
+   word32 ip;        /* subscriber ip address */
+   size_t len;       /* length of (partial) message received */
+   WSERV_MSG msg;    /* (partial) message received */
+   word64 tat;       /* time next submission is due, see WSERV_RATE */
+   word32 seenid;    /* work identifier of recent submissions */
+   word32 nseen;     /* number of recent submissions */
+   word8 seen[WSERV_SEEN][HASHLEN]; /* recent submissions, nonces */
+} WSERV_CONN;
+
+/* work server state */
+static WSERV_CONN Wconn[WSERV_MAX];
+static SOCKET Wlsd = INVALID_SOCKET;
+static BTRAILER Wbt;    /* block trailer of current work */
+static char Wfname[FILENAME_MAX];   /* candidate block of current work */
+static word32 Wid;      /* identifier of current work */
+static word8 Wdiff;     /* share difficulty, or 0 for block difficulty */
+static int Wready;      /* non-zero while work is available */
+
+/**
+ * @private
+ * Close a work server subscriber connection.
+ * @param cp Pointer to subscriber connection
+*/
+static void wserv_close(WSERV_CONN *cp)
+{
+   char ipaddr[16];
+
+   pdebug("wserv: %s unsubscribed", ntoa(&cp->ip, ipaddr));
+   sock_close(cp->sd);
+   cp->sd = INVALID_SOCKET;
+   cp->len = 0;
+}  /* end wserv_close() */
+
+/**
+ * @private
+ * Send a work server message to a subscriber, without waiting. A
+ * subscriber that cannot take a whole message (i.e. its socket buffer
+ * is full) is closed, rather than stall the server; it may reconnect
+ * for current work.
+ * @param cp Pointer to subscriber connection
+ * @param msg Pointer to message to send
+*/
+static void wserv_push(WSERV_CONN *cp, const WSERV_MSG *msg)
+{
+   int count;
+
+   count = send(cp->sd, (const char *) msg, sizeof(WSERV_MSG), 0);
+   if (count != (int) sizeof(WSERV_MSG)) wserv_close(cp);
+}  /* end wserv_push() */
+
+/**
+ * @private
+ * Build a work server message of current work (or idle) for sending.
+ * @param msg Pointer to message to build
+*/
+static void wserv_msgwork(WSERV_MSG *msg)
+{
+   memset(msg, 0, sizeof(WSERV_MSG));
+   if (Wready) {
+      msg->type = WSERV_WORK;
+      msg->diff = Wdiff && Wdiff < Wbt.difficulty[0]
+         ? Wdiff : Wbt.difficulty[0];
+      put32(msg->id, Wid);
+      memcpy(msg->data, &Wbt, WSERV_WORKLEN);
+   } else msg->type = WSERV_IDLE;
+}  /* end wserv_msgwork() */
+
+/**
+ * @private
+ * Send current work (or idle) to all subscribers.
+*/
+static void wserv_broadcast(void)
+{
+   WSERV_MSG msg;
+   int idx;
+
+   wserv_msgwork(&msg);
+   for (idx = 0; idx < WSERV_MAX; idx++) {
+      if (Wconn[idx].sd == INVALID_SOCKET) continue;
+      wserv_push(&Wconn[idx], &msg);
+   }
+}  /* end wserv_broadcast() */
+
+/**
+ * @private
+ * Check a nonce submission against current work. A submission meeting
+ * the block difficulty is reassembled into a solved block, for update.
+ * Submissions in excess of WSERV_RATE, and repeated nonces, are rejected
+ * before the (costly) hash check.
+ * @param cp Pointer to subscriber connection, holding a submission
+ * @returns Message type of response, WSERV_SHARE, WSERV_SOLVE or
+ * WSERV_REJECT
+*/
+static int wserv_submit(WSERV_CONN *cp)
+{
+   BTRAILER bt;
+   word8 hash[HASHLEN];
+   char ipaddr[16];
+   word64 now;
+   word32 j;
+   word8 diff;
+
+   /* submission MUST be for current work */
+   if (!Wready || get32(cp->msg.id) != Wid) return WSERV_REJECT;
+
+   /* limit submission rate, allowing bursts of up to WSERV_RATE */
+   now = net_deadline(0);
+   if (cp->tat < now) cp->tat = now;
+   if (cp->tat - now >= 1000) return WSERV_REJECT;
+   cp->tat += 1000 / WSERV_RATE;
+
+   /* reject repeated nonces */
+   if (cp->seenid != Wid) {
+      cp->seenid = Wid;
+      cp->nseen = 0;
+   }
+   for (j = 0; j < cp->nseen && j < WSERV_SEEN; j++) {
+      if (memcmp(cp->seen[j], cp->msg.data, HASHLEN) == 0) {
+         return WSERV_REJECT;
+      }
+   }
+   memcpy(cp->seen[cp->nseen++ % WSERV_SEEN], cp->msg.data, HASHLEN);
+
+   memcpy(&bt, &Wbt, sizeof(BTRAILER));
+   memcpy(bt.nonce, cp->msg.data, HASHLEN);
+   diff = Wdiff && Wdiff < bt.difficulty[0] ? Wdiff : bt.difficulty[0];
+   if (peach_checkhash(&bt, diff, hash) != VEOK) return WSERV_REJECT;
+   if (trigg_eval(hash, bt.difficulty[0]) != VEOK) return WSERV_SHARE;
+
+   /* reassemble solved block from candidate block */
+   if (b_mined(&bt, Wfname) != VEOK) return WSERV_REJECT;
+   plog("wserv: %s solved block 0x%" P32x, ntoa(&cp->ip, ipaddr),
+      get32(bt.bnum));
+   /* work is solved, withdraw */
+   wserv_idle();
+
+   return WSERV_SOLVE;
+}  /* end wserv_submit() */
+
+/**
+ * Close the work server and all subscriber connections.
+*/
+void wserv_free(void)
+{
+   int idx;
+
+   for (idx = 0; idx < WSERV_MAX; idx++) {
+      if (Wconn[idx].sd != INVALID_SOCKET) wserv_close(&Wconn[idx]);
+   }
+   if (Wlsd != INVALID_SOCKET) sock_close(Wlsd);
+   Wlsd = INVALID_SOCKET;
+   Wready = 0;
+}  /* end wserv_free() */
+
+/**
+ * Withdraw current work from subscribers. Called where the candidate
+ * block of current work is replaced or solved.
+*/
+void wserv_idle(void)
+{
+   if (Wlsd == INVALID_SOCKET || !Wready) return;
+   Wready = 0;
+   wserv_broadcast();
+}  /* end wserv_idle() */
+
+/**
+ * Initialize the work server, listening for subscribers on @a port.
+ * Only private (local network) addresses may subscribe.
+ * @param port Listening port of work server
+ * @param diff Share difficulty, or 0 to accept only solves
+ * @returns VEOK on success, else VERROR; check errno for details
+*/
+int wserv_init(word16 port, word8 diff)
+{
+   struct sockaddr_in addr;
+   int idx, on = 1;
+
+   for (idx = 0; idx < WSERV_MAX; idx++) {
+      Wconn[idx].sd = INVALID_SOCKET;
+      Wconn[idx].len = 0;
+   }
+   Wdiff = diff;
+   Wready = 0;
+
+   Wlsd = socket(AF_INET, SOCK_STREAM, 0);
+   if (Wlsd == INVALID_SOCKET) return VERROR;
+   memset(&addr, 0, sizeof(addr));
+   addr.sin_port = htons(port);
+   addr.sin_addr.s_addr = INADDR_ANY;
+   addr.sin_family = AF_INET;
+   setsockopt(Wlsd, SOL_SOCKET, SO_REUSEADDR, (void *) &on, sizeof(on));
+   if (bind(Wlsd, (struct sockaddr *) &addr, sizeof(addr)) != 0) goto FAIL;
+   if (sock_set_nonblock(Wlsd) == SOCKET_ERROR) goto FAIL;
+   if (listen(Wlsd, WSERV_MAX) != 0) goto FAIL;
+
+   return VEOK;
+
+FAIL:
+   sock_close(Wlsd);
+   Wlsd = INVALID_SOCKET;
+
+   return VERROR;
+}  /* end wserv_init() */
+
+/**
+ * Service the work server, without blocking. Accepts subscribers, sending
+ * current work, and answers complete submissions. Call once per server
+ * loop. A solve is handed to the server as "mblock.dat" (see b_mined()).
+*/
+void wserv_poll(void)
+{
+   WSERV_MSG msg;
+   WSERV_CONN *cp;
+   SOCKET sd;
+   word32 ip;
+   char ipaddr[16];
+   int count, idx;
+
+   if (Wlsd == INVALID_SOCKET) return;
+
+   /* accept (private) subscribers */
+   while ((sd = accept(Wlsd, NULL, NULL)) != INVALID_SOCKET) {
+      ip = get_sock_ip(sd);
+      for (idx = 0; idx < WSERV_MAX; idx++) {
+         if (Wconn[idx].sd == INVALID_SOCKET) break;
+      }
+      if (idx == WSERV_MAX || !isprivate(ip) ||
+            sock_set_nonblock(sd) == SOCKET_ERROR) {
+         pdebug("wserv: %s dropped", ntoa(&ip, ipaddr));
+         sock_close(sd);
+         continue;
+      }
+      cp = &Wconn[idx];
+      cp->sd = sd;
+      cp->ip = ip;
+      cp->len = 0;
+      cp->tat = 0;
+      cp->seenid = 0;
+      pdebug("wserv: %s subscribed", ntoa(&ip, ipaddr));
+      /* subscribers receive current work on connect */
+      wserv_msgwork(&msg);
+      wserv_push(cp, &msg);
+   }
+
+   /* receive submissions */
+   for (idx = 0; idx < WSERV_MAX; idx++) {
+      cp = &Wconn[idx];
+      if (cp->sd == INVALID_SOCKET) continue;
+      count = recv(cp->sd, (char *) &cp->msg + cp->len,
+         sizeof(WSERV_MSG) - cp->len, 0);
+      if (count < 0 && sock_waiting(sock_errno)) continue;
+      if (count <= 0) {
+         wserv_close(cp);
+         continue;
+      }
+      cp->len += (size_t) count;
+      if (cp->len < sizeof(WSERV_MSG)) continue;
+      /* complete message */
+      cp->len = 0;
+      if (cp->msg.type != WSERV_SUBMIT) {
+         wserv_close(cp);
+         continue;
+      }
+      memset(&msg, 0, sizeof(msg));
+      msg.type = (word8) wserv_submit(cp);
+      memcpy(msg.id, cp->msg.id, sizeof(msg.id));
+      /* subscriber may be closed by the withdrawal of solved work */
+      if (cp->sd == INVALID_SOCKET) continue;
+      wserv_push(cp, &msg);
+   }
+}  /* end wserv_poll() */
+
+/**
+ * Receive a work server message from a (non-blocking) socket. A message
+ * may arrive in parts, so once a message begins, it is given at least
+ * WSERV_COMPLETE seconds to complete, even where @a timeout is zero.
+ * @param sd Socket to receive from
+ * @param msg Pointer to location to place message received
+ * @param timeout Seconds to wait for a message to begin, and complete
+ * @returns VEOK on success, VETIMEOUT where no message began, else VERROR
+ * where the connection is closed or a message is incomplete
+*/
+int wserv_recv(SOCKET sd, WSERV_MSG *msg, double timeout)
+{
+   word64 deadline;
+   size_t n;
+   int count, ecode;
+
+   deadline = net_deadline(timeout);
+   for (n = 0; n < sizeof(WSERV_MSG); n += (size_t) count) {
+      count = recv(sd, (char *) msg + n, sizeof(WSERV_MSG) - n, 0);
+      if (count == 0) return VERROR;
+      if (count > 0) {
+         /* message began -- allow time to complete */
+         if (n == 0) {
+            deadline = net_deadline(timeout > WSERV_COMPLETE ?
+               timeout : WSERV_COMPLETE);
+         }
+         continue;
+      }
+      if (!sock_waiting(sock_errno)) return VERROR;
+      /* wait for (remaining) message data */
+      ecode = net_wait(sd, POLLIN, deadline);
+      if (ecode == VETIMEOUT) return n ? VERROR : VETIMEOUT;
+      if (ecode != VEOK) return VERROR;
+      count = 0;
+   }
+
+   return VEOK;
+}  /* end wserv_recv() */
+
+/**
+ * Send a work server message to a (non-blocking) socket, waiting up to
+ * WSERV_COMPLETE seconds for the message to be sent. For miners; the work
+ * server itself never waits on a subscriber.
+ * @param sd Socket to send to
+ * @param msg Pointer to message to send
+ * @returns VEOK on success, else VERROR
+*/
+int wserv_send(SOCKET sd, const WSERV_MSG *msg)
+{
+   word64 deadline;
+   size_t n;
+   int count;
+
+   deadline = net_deadline(WSERV_COMPLETE);
+   for (n = 0; n < sizeof(WSERV_MSG); n += (size_t) count) {
+      count = send(sd, (const char *) msg + n, sizeof(WSERV_MSG) - n, 0);
+      if (count < 0) {
+         if (!sock_waiting(sock_errno)) return VERROR;
+         /* wait for room in socket buffer */
+         if (net_wait(sd, POLLOUT, deadline) != VEOK) return VERROR;
+         count = 0;
+      }
+   }
+
+   return VEOK;
+}  /* end wserv_send() */
+
+/**
+ * Set current work from the candidate block, @a fname, and push the work
+ * to all subscribers. The candidate block MUST remain unchanged until work
+ * is withdrawn with wserv_idle(); it is used to reassemble solves.
+ * @param fname Filename of candidate block
+ * @returns VEOK on success, else VERROR; check errno for details
+*/
+int wserv_work(const char *fname)
+{
+   if (Wlsd == INVALID_SOCKET) return VEOK;
+   if (read_trailer(&Wbt, fname) != VEOK) {
+      wserv_idle();
+      return VERROR;
+   }
+   strncpy(Wfname, fname, sizeof(Wfname) - 1);
+   Wfname[sizeof(Wfname) - 1] = '\0';
+   /* unique (non-zero) identifier per work */
+   if (++Wid == 0) Wid++;
+   Wready = 1;
+   wserv_broadcast();
+
+   return VEOK;
+}  /* end wserv_work() */
+
+/* end include guard */
+#endif
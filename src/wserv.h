@@ -0,0 +1,75 @@
+/**
+ * @file wserv.h
+ * @brief Mochimo work server support, for local miner farms.
+ * @details The work server pushes work to subscribed miners over
+ * persistent connections. Work is the first 92 bytes of a candidate
+ * block trailer (the portion pre-computed by solvers) and a share
+ * difficulty. Miners submit nonces for shares and solves, and the node
+ * reassembles a solved block itself, from its own candidate block.
+ * <br />
+ * All messages are a fixed length WSERV_MSG. A connection subscribes on
+ * connect, receiving current work (or WSERV_IDLE) immediately, and each
+ * time work changes. Each WSERV_SUBMIT is answered with WSERV_SHARE,
+ * WSERV_SOLVE or WSERV_REJECT; repeated nonces and submissions beyond a
+ * per subscriber rate are rejected. The server never waits to send; a
+ * subscriber too slow to take a message is disconnected.
+ * @copyright Adequate Systems LLC, 2018-2022. All Rights Reserved.
+ * <br />For license information, please refer to ../LICENSE.md
+*/
+
+/* include guard */
+#ifndef MOCHIMO_WSERV_H
+#define MOCHIMO_WSERV_H
+
+
+#include "types.h"
+#include "extinet.h"
+
+/**
+ * Maximum number of work server subscribers.
+*/
+#define WSERV_MAX       64
+
+/**
+ * Length of work in a work server message; the pre-computed portion of
+ * a block trailer (phash through mroot).
+*/
+#define WSERV_WORKLEN   92
+
+/* work server message types (WSERV_MSG.type) */
+#define WSERV_IDLE      0  /**< No work available (node to miner) */
+#define WSERV_WORK      1  /**< Work available (node to miner) */
+#define WSERV_SUBMIT    2  /**< Nonce submission (miner to node) */
+#define WSERV_SHARE     3  /**< Share accepted (node to miner) */
+#define WSERV_SOLVE     4  /**< Solve accepted (node to miner) */
+#define WSERV_REJECT    5  /**< Submission rejected (node to miner) */
+
+/**
+ * Work server message. Fixed length, in either direction.
+*/
+typedef struct {
+   word8 type;                /**< message type, WSERV_* */
+   word8 diff;                /**< share difficulty, of WSERV_WORK */
+   word8 id[4];               /**< work identifier, of work or submission */
+   word8 data[WSERV_WORKLEN]; /**< work, or nonce (HASHLEN) of submission */
+} WSERV_MSG;
+
+/* C/C++ compatible function prototypes */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void wserv_free(void);
+void wserv_idle(void);
+int wserv_init(word16 port, word8 diff);
+void wserv_poll(void);
+int wserv_recv(SOCKET sd, WSERV_MSG *msg, double timeout);
+int wserv_send(SOCKET sd, const WSERV_MSG *msg);
+int wserv_work(const char *fname);
+
+#ifdef __cplusplus
+}  /* end extern "C" */
+#endif
+
+/* end include guard */
+#endif